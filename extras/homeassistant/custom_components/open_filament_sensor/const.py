@@ -16,6 +16,7 @@ SENSORS = [
     ("hard_jam_percent", "Hard Jam", PERCENTAGE, None, SensorStateClass.MEASUREMENT, "mdi:alert-circle", "elegoo.hardJamPercent"),
     ("soft_jam_percent", "Soft Jam", PERCENTAGE, None, SensorStateClass.MEASUREMENT, "mdi:alert", "elegoo.softJamPercent"),
     ("grace_state", "Grace State", None, None, None, "mdi:timer-sand", "elegoo.graceState"),
+    ("time_to_jam", "Time To Jam", UnitOfTime.SECONDS, SensorDeviceClass.DURATION, SensorStateClass.MEASUREMENT, "mdi:timer-alert", "elegoo.timeToJamMs"),
 
     # Filament Tracking
     ("expected_filament", "Expected Filament", UnitOfLength.MILLIMETERS, SensorDeviceClass.DISTANCE, SensorStateClass.TOTAL_INCREASING, "mdi:printer-3d-nozzle", "elegoo.expectedFilament"),
@@ -48,6 +49,7 @@ BINARY_SENSORS = [
     ("filament_runout", "Filament Runout", "mdi:alert", "mdi:check-circle", "problem", "filamentRunout"),
     ("printer_connected", "Printer Connected", "mdi:lan-connect", "mdi:lan-disconnect", "connectivity", "elegoo.isWebsocketConnected"),
     ("is_printing", "Printing", "mdi:printer-3d-nozzle", "mdi:printer-3d-nozzle-off", None, "elegoo.isPrinting"),
+    ("jam_warning", "Jam Warning", "mdi:alert-decagram", "mdi:check-circle", "problem", "elegoo.jamWarning"),
     ("grace_active", "Grace Active", "mdi:timer-sand", "mdi:timer-sand-empty", None, "elegoo.graceActive"),
     ("telemetry_available", "Telemetry Available", "mdi:satellite-uplink", "mdi:satellite-variant", "connectivity", "elegoo.telemetryAvailable"),
 ]
@@ -97,6 +97,9 @@ class OFSSensor(CoordinatorEntity[OFSDataUpdateCoordinator], SensorEntity):
             return PRINT_STATUS_MAP.get(value, f"Unknown ({value})")
         if self._key == "grace_state" and value is not None:
             return GRACE_STATE_MAP.get(value, f"Unknown ({value})")
+        # Reported in ms, -1 when no trip is in sight
+        if self._key == "time_to_jam" and value is not None:
+            return round(value / 1000, 1) if value >= 0 else None
 
         # Round floating point values for cleaner display
         if isinstance(value, float):
@@ -7,25 +7,45 @@
 #include "FilamentMotionSensor.h"
 #include "Logger.h"
 #include "SDCPProtocol.h"
+#include "SDCPStatusParser.h"
 #include "SettingsManager.h"
 
 #include <vector>
 
-// Define and initialize the static pulse counter
-volatile unsigned long ElegooCC::isrPulseCounter = 0;
-
 #define ACK_TIMEOUT_MS SDCPTiming::ACK_TIMEOUT_MS
 constexpr float        DEFAULT_FILAMENT_DEFICIT_THRESHOLD_MM = SDCPDefaults::FILAMENT_DEFICIT_THRESHOLD_MM;
 constexpr unsigned int EXPECTED_FILAMENT_SAMPLE_MS           = SDCPTiming::EXPECTED_FILAMENT_SAMPLE_MS;  // Log max once per second to prevent heap exhaustion
 constexpr unsigned int EXPECTED_FILAMENT_STALE_MS            = SDCPTiming::EXPECTED_FILAMENT_STALE_MS;
 constexpr unsigned int SDCP_LOSS_TIMEOUT_MS                  = SDCPTiming::SDCP_LOSS_TIMEOUT_MS;
 constexpr unsigned int PAUSE_REARM_DELAY_MS                  = SDCPTiming::PAUSE_REARM_DELAY_MS;
-static const char*     TOTAL_EXTRUSION_HEX_KEY       = SDCPKeys::TOTAL_EXTRUSION_HEX;
-static const char*     CURRENT_EXTRUSION_HEX_KEY     = SDCPKeys::CURRENT_EXTRUSION_HEX;
 static const uint16_t  SDCP_DISCOVERY_PORT = 3000;
 
+// At the slowest poll a frame must still land before extrapolation gives up
+static_assert(StatusPollScheduler::MAX_INTERVAL_LIMIT_MS + StatusPollScheduler::ROUND_TRIP_MARGIN_MS <=
+                  FilamentMotionSensor::EXTRAPOLATE_MAX_MS,
+              "Slowest status poll outlasts the expected-flow extrapolation");
+
 namespace
 {
+    // Pause goes out ahead of everything and retries quickly; continue may
+    // wait its turn; status polls are never ack-tracked
+    SdcpCommandPolicy commandPolicy(int command)
+    {
+        switch (command)
+        {
+            case SDCP_COMMAND_STATUS:
+                return {SDCP_PRIORITY_STATUS, false, 0, 1};
+            case SDCP_COMMAND_PAUSE_PRINT:
+                return {SDCP_PRIORITY_PAUSE, true, SDCPTiming::PAUSE_ACK_TIMEOUT_MS,
+                        SDCPTiming::PAUSE_MAX_ATTEMPTS};
+            case SDCP_COMMAND_CONTINUE_PRINT:
+                return {SDCP_PRIORITY_CONTROL, true, ACK_TIMEOUT_MS,
+                        SDCPTiming::CONTINUE_MAX_ATTEMPTS};
+            default:
+                return {SDCP_PRIORITY_CONTROL, true, ACK_TIMEOUT_MS, 1};
+        }
+    }
+
 JamConfig buildJamConfigFromSettings()
 {
     JamConfig config;
@@ -55,6 +75,12 @@ JamConfig buildJamConfigFromSettings()
 
     config.graceTimeMs    = settingsManager.getDetectionGracePeriodMs();
     config.detectionMode   = static_cast<DetectionMode>(settingsManager.getDetectionMode());
+    config.windowMode      = static_cast<WindowMode>(settingsManager.getDetectionWindowMode());
+    config.likelihoodThreshold = settingsManager.getDetectionLikelihoodThreshold();
+    config.umPerPulse      = FlowUnits::mmToUm(settingsManager.getMovementMmPerPulse());
+    config.softJamAlgorithm = static_cast<SoftJamAlgorithm>(settingsManager.getDetectionSoftAlgorithm());
+    config.ratioSource     = static_cast<FlowRatioSource>(settingsManager.getDetectionRatioSource());
+    config.adaptiveThreshold = settingsManager.getDetectionAdaptiveThreshold();
     return config;
 }
 }  // namespace
@@ -93,9 +119,9 @@ printer_info_t ElegooCC::getCurrentInformation()
     info.PrintSpeedPct        = PrintSpeedPct;
     info.isWebsocketConnected = transport.webSocket.isConnected();
     info.currentZ             = currentZ;
-    info.waitingForAck        = transport.waitingForAck;
-    info.expectedFilamentMM   = expectedFilamentMM;
-    info.actualFilamentMM     = actualFilamentMM;
+    info.waitingForAck        = transport.commands.inFlightCount() > 0;
+    info.expectedFilamentMM   = FlowUnits::umToMm(expectedFilamentUm);
+    info.actualFilamentMM     = FlowUnits::umToMm(actualFilamentUm);
     info.lastExpectedDeltaMM  = lastExpectedDeltaMM;
     info.telemetryAvailable   = telemetryAvailableLastStatus;
 
@@ -103,21 +129,90 @@ printer_info_t ElegooCC::getCurrentInformation()
     // to avoid race with checkFilamentMovement() updates)
     info.currentDeficitMm     = jamState.deficit;
     info.deficitThresholdMm   = 0.0f;
-    float expectedDist        = motionSensor.getExpectedDistance();
+    float expectedDist        = FlowUnits::umToMm(lastWindowSnapshot.expectedUm);
     info.deficitRatio         = jamState.deficit / (expectedDist > 0.1f ? expectedDist : 1.0f);
     info.passRatio            = jamState.passRatio;
+    info.softThreshold        = jamState.softThreshold;
     info.hardJamPercent       = jamState.hardJamPercent;
     info.softJamPercent       = jamState.softJamPercent;
+    info.deficitTrend         = jamState.deficitTrend;
+    info.timeToJamMs          = jamState.timeToJamMs;
+    info.jamWarning           = jamState.jamWarning;
     info.graceActive          = jamState.graceActive;
     info.graceState           = static_cast<uint8_t>(jamState.graceState);
     info.expectedRateMmPerSec = jamState.expectedRateMmPerSec;
     info.actualRateMmPerSec   = jamState.actualRateMmPerSec;
     info.movementPulseCount   = movementPulseCount;
+    info.pulseEdgeOverflows   = getPulseEdgeOverflows();
+    info.flowLagMs            = motionSensor.getLagMs();
+    PulseCalibration calibration = pulseCalibrator.getCalibration();
+    info.mmPerPulseEstimate   = calibration.umPerPulse / 1000.0f;
+    info.mmPerPulseCi         = calibration.ciUmPerPulse / 1000.0f;
+    info.mmPerPulseConverged  = calibration.converged;
+    StatusPollMetrics pollMetrics = statusPollScheduler.getMetrics();
+    info.statusPollIntervalMs   = pollMetrics.intervalMs;
+    info.statusPollHz           = pollMetrics.achievedHz;
+    info.statusCpuSavedUsPerSec = pollMetrics.cpuSavedUsPerSec;
     portEXIT_CRITICAL(&_stateMutex);
 
     return info;
 }
 
+SdcpLatencyReport ElegooCC::getLatencyReport()
+{
+    portENTER_CRITICAL(&_stateMutex);
+    SdcpLatencyReport report = latencyReport;
+    portEXIT_CRITICAL(&_stateMutex);
+    return report;
+}
+
+void ElegooCC::publishLatencyReport()
+{
+    SdcpLatencyReport report = transport.latency.getReport();
+    portENTER_CRITICAL(&_stateMutex);
+    latencyReport = report;
+    portEXIT_CRITICAL(&_stateMutex);
+}
+
+void ElegooCC::publishShadowReport()
+{
+    // Built here, on the loop that changes the bank; readers only see
+    // whole reports
+    ShadowBankReport report = shadowBank.getReport();
+    portENTER_CRITICAL(&_stateMutex);
+    shadowReport = report;
+    portEXIT_CRITICAL(&_stateMutex);
+}
+
+ShadowBankReport ElegooCC::getShadowReport()
+{
+    portENTER_CRITICAL(&_stateMutex);
+    ShadowBankReport report = shadowReport;
+    portEXIT_CRITICAL(&_stateMutex);
+    return report;
+}
+
+bool ElegooCC::requestReplay(const JamConfig& config)
+{
+    portENTER_CRITICAL(&_stateMutex);
+    bool accepted = !replayResult.active;
+    if (accepted)
+    {
+        replayConfig        = config;
+        replayResult.active = true;
+    }
+    portEXIT_CRITICAL(&_stateMutex);
+    return accepted;
+}
+
+FlowReplayResult ElegooCC::getReplayResult()
+{
+    portENTER_CRITICAL(&_stateMutex);
+    FlowReplayResult result = replayResult;
+    portEXIT_CRITICAL(&_stateMutex);
+    return result;
+}
+
 ElegooCC &ElegooCC::getInstance()
 {
     static ElegooCC instance;
@@ -127,8 +222,8 @@ ElegooCC &ElegooCC::getInstance()
 ElegooCC::ElegooCC()
 {
     startedAt = 0;  // Initialize to prevent invalid grace periods
-    // Interrupt-driven pulse counter initialization
-    lastIsrPulseCount = 0;
+    // Pulse source is attached in setup()
+    pulseSource = nullptr;
     // Legacy pin tracking (used only when tracking is frozen after jam pause)
     lastMovementValue = -1;  // Initialize to invalid value
     lastChangeTime    = 0;
@@ -149,15 +244,12 @@ ElegooCC::ElegooCC()
     runoutPauseCommanded      = false;
     runoutPauseRemainingMm    = 0.0f;
     runoutPauseDelayMm        = DEFAULT_RUNOUT_PAUSE_DELAY_MM;
-    runoutPauseStartExpectedMm = 0.0f;
+    runoutPauseStartExpectedUm = 0;
     transport.lastPing            = 0;
-    transport.waitingForAck       = false;
-    transport.pendingAckCommand   = -1;
-    transport.pendingAckRequestId = "";
-    transport.ackWaitStartTime    = 0;
+    transport.commands.clear();
     transport.lastStatusRequestMs = 0;
-    expectedFilamentMM            = 0;
-    actualFilamentMM              = 0;
+    expectedFilamentUm            = 0;
+    actualFilamentUm              = 0;
     lastExpectedDeltaMM           = 0;
     expectedTelemetryAvailable    = false;
     lastSuccessfulTelemetryMs     = 0;
@@ -165,6 +257,7 @@ ElegooCC::ElegooCC()
     lastStatusReceiveMs           = 0;
     telemetryAvailableLastStatus  = false;
     movementPulseCount            = 0;
+    edgeOverflowsAtReset          = 0;
     lastFlowLogMs                 = 0;
     lastSummaryLogMs              = 0;
     lastPinDebugLogMs             = 0;
@@ -182,6 +275,20 @@ ElegooCC::ElegooCC()
     lastPauseRequestMs = 0;
     lastPrintEndMs     = 0;
     lastJamDetectorUpdateMs = 0;
+    lastWindowSnapshot      = WindowSnapshot{0, 0, 0, 0, 0, 0};
+    replayResult            = FlowReplayResult{};
+    replayProgress          = FlowReplayResult{};
+    replayRunning           = false;
+    baselineLoadPending     = false;
+    calibratedUmPerPulse    = 0;
+    shadowConfigPending     = true;
+    pendingPollMinMs        = 0;
+    pendingPollMaxMs        = 0;
+    pollConfigPending       = false;
+    pendingWindowMode       = WindowMode::TIME;
+    windowModePending       = false;
+    shadowReport            = shadowBank.getReport();
+    latencyReport           = transport.latency.getReport();
     cacheLock   = portMUX_INITIALIZER_UNLOCKED;
     _stateMutex = portMUX_INITIALIZER_UNLOCKED;
 
@@ -195,14 +302,16 @@ void ElegooCC::setup()
     // Initialize settings and config caches
     refreshCaches();
 
-    // Set up GPIO interrupt for pulse detection on MOVEMENT_SENSOR_PIN
-    // Rising edge trigger: counts each time sensor goes LOW→HIGH
-    // IRAM_ATTR requirement handled by Arduino framework for static method
-    pinMode(MOVEMENT_SENSOR_PIN, INPUT);
-    attachInterrupt(digitalPinToInterrupt(MOVEMENT_SENSOR_PIN),
-                    ElegooCC::pulseCounterISR,
-                    RISING);
-    logger.logf("Pulse detection via GPIO%d interrupt enabled", MOVEMENT_SENSOR_PIN);
+    // Set up pulse detection on MOVEMENT_SENSOR_PIN: a rising-edge GPIO
+    // interrupt that timestamps every edge, or PCNT when the build opts in
+    // (no per-edge CPU cost, but no edge times and so no edge velocity).
+    pulseSource = &PulseSource::selectForPin(MOVEMENT_SENSOR_PIN);
+    motionSensor.setEdgeTimestamps(pulseSource->hasEdgeTimestamps());
+    logger.logf("Pulse detection via %s on GPIO%d enabled", pulseSource->getName(),
+                MOVEMENT_SENSOR_PIN);
+    logger.logf("Flow history: %d of %d samples allocated (%u bytes)",
+                flowHistory.getCapacity(), FLOW_HISTORY_SAMPLES,
+                (unsigned) flowHistory.getAllocatedBytes());
 
     // Initialize filament runout state from actual pin reading at startup
     // This ensures jam detection is correctly disarmed if device boots with no filament
@@ -230,11 +339,10 @@ void ElegooCC::webSocketEvent(WStype_t type, uint8_t *payload, size_t length)
         case WStype_DISCONNECTED:
             logger.logf("Disconnected from Centauri Carbon (prior failures: %d)",
                         transport.consecutiveFailures);
-            // Reset acknowledgment state on disconnect
-            transport.waitingForAck       = false;
-            transport.pendingAckCommand   = -1;
-            transport.pendingAckRequestId = "";
-            transport.ackWaitStartTime    = 0;
+            // Acks for anything in flight will never arrive on a new connection
+            transport.commands.clear();
+            transport.latency.onDisconnect();
+            publishLatencyReport();
             break;
         case WStype_CONNECTED:
             logger.log("Connected to Carbon Centauri");
@@ -243,24 +351,35 @@ void ElegooCC::webSocketEvent(WStype_t type, uint8_t *payload, size_t length)
             break;
         case WStype_TEXT:
         {
-            messageDoc.clear();
-            DeserializationError error = deserializeJson(messageDoc, payload, length);
-
-            if (error)
+            // Status frames arrive several times a second; scan them in
+            // place instead of building a document
+            unsigned long frameStartUs = micros();
+            if (!SDCPStatusParser::parse((const char *) payload, length, statusFrame))
             {
-                logger.logf("JSON parsing failed: %s (payload size: %zu)", error.c_str(), length);
+                logger.logf("JSON parsing failed (payload size: %zu)", length);
                 return;
             }
 
             // Check if this is a command acknowledgment response
-            if (messageDoc.containsKey("Id") && messageDoc.containsKey("Data"))
+            if (statusFrame.isCommandResponse)
             {
+                messageDoc.clear();
+                DeserializationError error = deserializeJson(messageDoc, payload, length);
+                if (error)
+                {
+                    logger.logf("JSON parsing failed: %s (payload size: %zu)", error.c_str(), length);
+                    return;
+                }
                 handleCommandResponse(messageDoc);
             }
             // Check if this is a status response
-            else if (messageDoc.containsKey("Status"))
+            else if (statusFrame.hasStatus)
             {
-                handleStatus(messageDoc);
+                transport.latency.onStatusFrame(statusFrame.hasTimeStamp, statusFrame.timeStamp,
+                                                millis());
+                publishLatencyReport();
+                handleStatus(statusFrame);
+                statusPollScheduler.onFrameHandled((uint32_t) (micros() - frameStartUs));
             }
         }
         break;
@@ -281,25 +400,24 @@ void ElegooCC::webSocketEvent(WStype_t type, uint8_t *payload, size_t length)
 
 void ElegooCC::handleCommandResponse(JsonDocument &doc)
 {
-    String     id   = doc["Id"];
     JsonObject data = doc["Data"];
 
     if (data.containsKey("Cmd") && data.containsKey("RequestID"))
     {
-        int    cmd         = data["Cmd"];
-        int    ack         = data["Data"]["Ack"];
-        String requestId   = data["RequestID"];
-        String mainboardId = data["MainboardID"];
+        int         cmd       = data["Cmd"];
+        int         ack       = data["Data"]["Ack"];
+        const char *requestId = data["RequestID"] | "";
+
+        if (cmd == SDCP_COMMAND_STATUS)
+        {
+            transport.latency.onAck(requestId, millis());
+            publishLatencyReport();
+        }
 
         // Only log acknowledgments for commands that can ack
-        if (transport.waitingForAck && cmd == transport.pendingAckCommand &&
-            requestId == transport.pendingAckRequestId)
+        if (transport.commands.acknowledge(cmd, requestId))
         {
             logger.logf("Received acknowledgment for command %d (Ack: %d)", cmd, ack);
-            transport.waitingForAck       = false;
-            transport.pendingAckCommand   = -1;
-            transport.pendingAckRequestId = "";
-            transport.ackWaitStartTime    = 0;
         }
 
         // Store mainboard ID if we don't have it yet
@@ -311,50 +429,30 @@ void ElegooCC::handleCommandResponse(JsonDocument &doc)
     }
 }
 
-void ElegooCC::handleStatus(JsonDocument &doc)
+void ElegooCC::handleStatus(const SdcpStatusFrame &frame)
 {
-    JsonObject status      = doc["Status"];
-    String     mainboardId = doc["MainboardID"];
     unsigned long statusTimestamp = millis();
     bool wasPrinting = isPrinting();
     lastStatusReceiveMs          = statusTimestamp;
     // Parse current status (which contains machine status array)
-    if (status.containsKey("CurrentStatus"))
+    if (frame.hasMachineStatuses)
     {
-        JsonArray currentStatus = status["CurrentStatus"];
-
-        // Convert JsonArray to int array for machine statuses
-        int statuses[5];  // Max 5 statuses
-        int count = min((int) currentStatus.size(), 5);
-        for (int i = 0; i < count; i++)
-        {
-            statuses[i] = currentStatus[i].as<int>();
-        }
-
         // Set all machine statuses at once
-        setMachineStatuses(statuses, count);
+        setMachineStatuses(frame.machineStatuses, frame.machineStatusCount);
     }
 
-    // Parse CurrentCoords to extract Z coordinate
-    if (status.containsKey("CurrenCoord"))
+    // Z coordinate from CurrenCoord
+    if (frame.hasCurrentZ)
     {
-        String coordsStr   = status["CurrenCoord"].as<String>();
-        int    firstComma  = coordsStr.indexOf(',');
-        int    secondComma = coordsStr.indexOf(',', firstComma + 1);
-        if (firstComma != -1 && secondComma != -1)
-        {
-            String zStr = coordsStr.substring(secondComma + 1);
-            portENTER_CRITICAL(&_stateMutex);
-            currentZ    = zStr.toFloat();
-            portEXIT_CRITICAL(&_stateMutex);
-        }
+        portENTER_CRITICAL(&_stateMutex);
+        currentZ = frame.currentZ;
+        portEXIT_CRITICAL(&_stateMutex);
     }
 
     // Parse print info
-    if (status.containsKey("PrintInfo"))
+    if (frame.hasPrintInfo)
     {
-        JsonObject          printInfo = status["PrintInfo"];
-        sdcp_print_status_t newStatus = printInfo["Status"].as<sdcp_print_status_t>();
+        sdcp_print_status_t newStatus = (sdcp_print_status_t) frame.printStatus;
         sdcp_print_status_t previousStatus = printStatus;
 
         // Any time we receive a well-formed PrintInfo block, treat SDCP
@@ -391,7 +489,13 @@ void ElegooCC::handleStatus(JsonDocument &doc)
                     trackingFrozen = false;
                     // On resume, reset the motion sensor so jam detection starts fresh
                     motionSensor.reset();
-                    jamDetector.onResume(statusTimestamp, movementPulseCount, actualFilamentMM);
+                    flowEstimator.reset(cachedSettings.movementUmPerPulse);
+                    jamDetector.onResume(statusTimestamp, movementPulseCount,
+                                         FlowUnits::umToMm(actualFilamentUm));
+                    shadowBank.onResume(statusTimestamp, movementPulseCount,
+                                        FlowUnits::umToMm(actualFilamentUm));
+                    publishShadowReport();
+                    flowHistory.markResume();
                     filamentStopped = false;
                     if (settingsManager.getVerboseLogging())
                     {
@@ -405,6 +509,9 @@ void ElegooCC::handleStatus(JsonDocument &doc)
                     logger.log("Print status changed to printing");
                     startedAt = statusTimestamp;
                     resetFilamentTracking();
+                    shadowBank.clearResults();
+                    publishShadowReport();
+                    baselineLoadPending = true;  // Filename may arrive later in this status
 
                     // Log active settings for this print (excluding network config)
                     logger.logf(
@@ -445,73 +552,58 @@ void ElegooCC::handleStatus(JsonDocument &doc)
                 {
                     // Print has ended (stopped/completed/etc). Log a summary and
                     // fully reset tracking for the next job.
-                    float finalDeficit = expectedFilamentMM - actualFilamentMM;
+                    float expectedFilamentMM = FlowUnits::umToMm(expectedFilamentUm);
+                    float actualFilamentMM   = FlowUnits::umToMm(actualFilamentUm);
+                    float finalDeficit       = expectedFilamentMM - actualFilamentMM;
                     if (finalDeficit < 0.0f) finalDeficit = 0.0f;
 
                     logger.logf(
                         "Print summary: status=%d progress=%d layer=%d/%d ticks=%d/%d "
-                        "expected=%.2fmm actual=%.2fmm deficit=%.2fmm pulses=%lu",
+                        "expected=%.2fmm actual=%.2fmm deficit=%.2fmm pulses=%lu edge_overflows=%lu",
                         (int) newStatus, progress, currentLayer, totalLayer, currentTicks,
                         totalTicks, expectedFilamentMM, actualFilamentMM, finalDeficit,
-                        movementPulseCount);
-
-                    // Auto-calibration logic...
-                    if (settingsManager.getAutoCalibrateSensor() && movementPulseCount > 0 &&
-                        expectedFilamentMM > 50.0f)
+                        movementPulseCount,
+                        (unsigned long) (getPulseEdgeOverflows() - edgeOverflowsAtReset));
+                    shadowBank.logSummary();
+
+                    // Persist the online calibration once per print, only if it
+                    // converged and the setting is outside its confidence interval
+                    PulseCalibration calibration = pulseCalibrator.getCalibration();
+                    if (settingsManager.getAutoCalibrateSensor())
                     {
-                        // Minimum thresholds: 50+ pulses and 50+mm expected for reliable calibration
-                        if (movementPulseCount >= 50)
+                        float settingUm = FlowUnits::mmToUm(settingsManager.getMovementMmPerPulse());
+                        if (!calibration.converged)
                         {
-                            // Health check: only calibrate if flow quality was good (>90%)
-                            float flowQuality = actualFilamentMM / expectedFilamentMM;
-
-                            if (flowQuality >= 0.90f)
-                            {
-                                float calculatedMmPerPulse = expectedFilamentMM / (float) movementPulseCount;
-
-                                // Sanity check: should be between 2.5-3.5mm (reasonable range for SFS 2.0)
-                                if (calculatedMmPerPulse >= 2.5f && calculatedMmPerPulse <= 3.5f)
-                                {
-                                    float oldValue = settingsManager.getMovementMmPerPulse();
-                                    settingsManager.setMovementMmPerPulse(calculatedMmPerPulse);
-
-                                    // Disable auto-calibration after successful calibration
-                                    settingsManager.setAutoCalibrateSensor(false);
-                                    settingsManager.save();
-                                    refreshCaches();
-
-                                    logger.logf(
-                                        "Auto-calibration: Updated mm_per_pulse from %.3f to %.3f "
-                                        "(based on %.2fmm expected / %lu pulses, flow quality %.1f%%)",
-                                        oldValue, calculatedMmPerPulse, expectedFilamentMM,
-                                        movementPulseCount, flowQuality * 100.0f);
-                                    logger.log("Auto-calibration: Disabled after successful calibration");
-                                }
-                                else
-                                {
-                                    logger.logf(
-                                        "Auto-calibration: Calculated value %.3f is outside valid range "
-                                        "(2.5-3.5mm), keeping current setting",
-                                        calculatedMmPerPulse);
-                                }
-                            }
-                            else
-                            {
-                                logger.logf(
-                                    "Auto-calibration: Skipped - flow quality %.1f%% < 90%% threshold "
-                                    "(print may have had jams/under-extrusion)",
-                                    flowQuality * 100.0f);
-                            }
+                            logger.logf(
+                                "Auto-calibration: Not converged (%u segments, %.3f +/- %.3f mm/pulse), "
+                                "keeping current setting",
+                                (unsigned) calibration.segments, calibration.umPerPulse / 1000.0f,
+                                calibration.ciUmPerPulse / 1000.0f);
                         }
-                        else
+                        else if (fabsf(calibration.umPerPulse - settingUm) > calibration.ciUmPerPulse)
                         {
+                            float oldValue = settingsManager.getMovementMmPerPulse();
+                            float newValue = calibration.umPerPulse / 1000.0f;
+                            settingsManager.setMovementMmPerPulse(newValue);
+                            settingsManager.save();
                             logger.logf(
-                                "Auto-calibration: Not enough pulses (%lu, need 50+) for reliable "
-                                "calibration",
-                                movementPulseCount);
+                                "Auto-calibration: Updated mm_per_pulse from %.3f to %.3f "
+                                "(+/- %.3f from %u healthy segments)",
+                                oldValue, newValue, calibration.ciUmPerPulse / 1000.0f,
+                                (unsigned) calibration.segments);
                         }
                     }
 
+                    // Keep what this print taught the adaptive threshold
+                    FlowBaseline baseline = jamDetector.getBaseline();
+                    if (baseline.samples > 0 && baselineStore.save(filename, baseline))
+                    {
+                        logger.logf("Flow baseline saved for %s: mean=%.3f sigma=%.3f n=%u",
+                                    filename.c_str(), baseline.meanPermille / 1000.0f,
+                                    baseline.sigmaPermille / 1000.0f, (unsigned) baseline.samples);
+                    }
+                    baselineLoadPending = false;
+
                     logger.log("Print left printing state, resetting filament tracking");
                     resetFilamentTracking();
                 }
@@ -539,23 +631,19 @@ void ElegooCC::handleStatus(JsonDocument &doc)
         {
             lastPrintEndMs = 0;
         }
-        currentLayer = printInfo["CurrentLayer"];
-        totalLayer   = printInfo["TotalLayer"];
-        progress     = printInfo["Progress"];
-        currentTicks = printInfo["CurrentTicks"];
-        totalTicks   = printInfo["TotalTicks"];
-        PrintSpeedPct = printInfo["PrintSpeedPct"];
+        currentLayer = frame.currentLayer;
+        totalLayer   = frame.totalLayer;
+        progress     = frame.progress;
+        currentTicks = frame.currentTicks;
+        totalTicks   = frame.totalTicks;
+        PrintSpeedPct = frame.printSpeedPct;
+        motionSensor.setPrintSpeedPct(PrintSpeedPct);
 
         // Extract TaskId - any change indicates a new print job
-        String newTaskId = "";
-        if (printInfo.containsKey("TaskId") && !printInfo["TaskId"].isNull())
-        {
-            newTaskId = printInfo["TaskId"].as<String>();
-        }
-
-        if (newTaskId != taskId)
+        const char *newTaskId = frame.taskId;
+        if (strcmp(newTaskId, taskId.c_str()) != 0)
         {
-            if (!newTaskId.isEmpty())
+            if (newTaskId[0] != '\0')
             {
                 newPrintDetected = true;
                 if (printStatus == SDCP_PRINT_STATUS_PRINTING && startedAt == 0)
@@ -565,24 +653,20 @@ void ElegooCC::handleStatus(JsonDocument &doc)
                 }
                 if (settingsManager.getVerboseLogging())
                 {
-                    logger.logf("New Print detected via TaskId: %s", newTaskId.c_str());
+                    logger.logf("New Print detected via TaskId: %s", newTaskId);
                 }
             }
             taskId = newTaskId;
         }
 
-        if (printInfo.containsKey("Filename") && !printInfo["Filename"].isNull())
+        if (frame.filename[0] != '\0' && strcmp(frame.filename, filename.c_str()) != 0)
         {
-            String newFilename = printInfo["Filename"].as<String>();
-            if (!newFilename.isEmpty())
-            {
-                filename = newFilename;
-            }
+            filename = frame.filename;
         }
 
         // Update extrusion tracking (expected/actual/deficit) based on any
         // TotalExtrusion / CurrentExtrusion fields present in this payload.
-        processFilamentTelemetry(printInfo, statusTimestamp);
+        processFilamentTelemetry(frame, statusTimestamp);
         
         if (settingsManager.getVerboseLogging())
         {
@@ -594,8 +678,8 @@ void ElegooCC::handleStatus(JsonDocument &doc)
                 logger.logf(
                     "Flow debug: SDCP status print=%d layer=%d/%d progress=%d expected=%.2fmm "
                     "delta=%.2fmm telemetry=%d",
-                    (int) printStatus, currentLayer, totalLayer, progress, expectedFilamentMM,
-                    lastExpectedDeltaMM, telemetryAvailableLastStatus ? 1 : 0);
+                    (int) printStatus, currentLayer, totalLayer, progress,
+                    FlowUnits::umToMm(expectedFilamentUm), lastExpectedDeltaMM, telemetryAvailableLastStatus ? 1 : 0);
                 lastLoggedPrintStatus = (int)printStatus;
                 lastLoggedLayer = currentLayer;
                 lastLoggedTotalLayer = totalLayer;
@@ -617,21 +701,33 @@ void ElegooCC::resetFilamentTracking(bool resetGrace)
 
     lastMovementValue          = -1;
     lastChangeTime             = currentTime;
-    actualFilamentMM           = 0;
-    expectedFilamentMM         = 0;
+    actualFilamentUm           = 0;
+    expectedFilamentUm         = 0;
     lastExpectedDeltaMM        = 0;
     expectedTelemetryAvailable = false;
     lastSuccessfulTelemetryMs  = 0;
     filamentStopped            = false;
     lastTelemetryReceiveMs     = 0;
     movementPulseCount         = 0;
+    edgeOverflowsAtReset       = getPulseEdgeOverflows();
     lastFlowLogMs              = 0;
     trackingFrozen             = false;
     resetRunoutPauseState();
 
     // Reset the motion sensor and jam detector
     motionSensor.reset();
+    flowEstimator.reset(cachedSettings.movementUmPerPulse);
     jamDetector.reset(currentTime);
+    shadowBank.reset(currentTime);
+    publishShadowReport();
+    flowHistory.markReset();
+    pulseCalibrator.reset(cachedSettings.movementUmPerPulse);
+    statusPollScheduler.reset();
+    if (calibratedUmPerPulse > 0)
+    {
+        calibratedUmPerPulse = 0;
+        refreshCaches();
+    }
 
     if (settingsManager.getVerboseLogging())
     {
@@ -639,36 +735,18 @@ void ElegooCC::resetFilamentTracking(bool resetGrace)
     }
 }
 
-bool ElegooCC::tryReadExtrusionValue(JsonObject &printInfo, const char *key, const char *hexKey,
-                                     float &output)
+bool ElegooCC::processFilamentTelemetry(const SdcpStatusFrame &frame, unsigned long currentTime)
 {
-    if (printInfo.containsKey(key) && !printInfo[key].isNull())
-    {
-        output = printInfo[key].as<float>();
-        return true;
-    }
-
-    if (hexKey != nullptr && printInfo.containsKey(hexKey) && !printInfo[hexKey].isNull())
+    if (frame.hasTotalExtrusion)
     {
-        output = printInfo[hexKey].as<float>();
-        return true;
-    }
+        float totalValue = frame.totalExtrusion;
 
-    return false;
-}
-
-bool ElegooCC::processFilamentTelemetry(JsonObject &printInfo, unsigned long currentTime)
-{
-    float totalValue = 0;
-    bool  hasTotal   = tryReadExtrusionValue(printInfo, "TotalExtrusion", TOTAL_EXTRUSION_HEX_KEY,
-                                            totalValue);
-
-    if (hasTotal)
-    {
-        expectedFilamentMM = totalValue < 0 ? 0 : totalValue;
+        // Convert once at the SDCP boundary; the tracking path is integer
+        expectedFilamentUm = totalValue < 0 ? 0 : FlowUnits::mmToUm(totalValue);
 
         // Update the motion sensor with the new expected position
-        motionSensor.updateExpectedPosition(expectedFilamentMM);
+        motionSensor.updateExpectedPositionUm(expectedFilamentUm);
+        flowEstimator.addExpectedUm(expectedFilamentUm, currentTime);
 
         // Mark telemetry as available and fresh
         expectedTelemetryAvailable = true;
@@ -676,9 +754,10 @@ bool ElegooCC::processFilamentTelemetry(JsonObject &printInfo, unsigned long cur
 
         if (settingsManager.getVerboseLogging())
         {
-            float windowedExpected = motionSensor.getExpectedDistance();
-            float windowedSensor = motionSensor.getSensorDistance();
-            float currentDeficit = motionSensor.getDeficit();
+            WindowSnapshot window  = motionSensor.getWindowSnapshot(millis());
+            float windowedExpected = FlowUnits::umToMm(window.expectedUm);
+            float windowedSensor   = FlowUnits::umToMm(window.actualUm);
+            float currentDeficit   = FlowUnits::umToMm(window.deficitUm);
 
             // Only log if values have changed
             if (windowedExpected != lastLoggedExpected ||
@@ -688,7 +767,8 @@ bool ElegooCC::processFilamentTelemetry(JsonObject &printInfo, unsigned long cur
                 JamState jamState = jamDetector.getState();
                 // Consolidated telemetry log with jam state info
                 logger.logf("Debug: sdcp_exp=%.2fmm cumul_sns=%.2fmm pulses=%lu | win_exp=%.2f win_sns=%.2f deficit=%.2f | jam=%d hard=%.2f soft=%.2f pass=%.2f grace=%d heap=%lu",
-                            expectedFilamentMM, actualFilamentMM, movementPulseCount,
+                            FlowUnits::umToMm(expectedFilamentUm),
+                            FlowUnits::umToMm(actualFilamentUm), movementPulseCount,
                             windowedExpected, windowedSensor, currentDeficit,
                             jamState.jammed ? 1 : 0,
                             jamState.hardJamPercent, jamState.softJamPercent, jamState.passRatio,
@@ -727,15 +807,17 @@ void ElegooCC::pausePrint()
     }
 
     logger.logf("Pause command sent to printer");
-    sendCommand(SDCP_COMMAND_PAUSE_PRINT, true);
+    transport.commands.cancel(SDCP_COMMAND_CONTINUE_PRINT);
+    sendCommand(SDCP_COMMAND_PAUSE_PRINT);
 }
 
 void ElegooCC::continuePrint()
 {
-    sendCommand(SDCP_COMMAND_CONTINUE_PRINT, true);
+    transport.commands.cancel(SDCP_COMMAND_PAUSE_PRINT);
+    sendCommand(SDCP_COMMAND_CONTINUE_PRINT);
 }
 
-void ElegooCC::sendCommand(int command, bool waitForAck)
+void ElegooCC::sendCommand(int command)
 {
     if (!transport.webSocket.isConnected())
     {
@@ -743,54 +825,108 @@ void ElegooCC::sendCommand(int command, bool waitForAck)
         return;
     }
 
-    // If this command requires an ack and we're already waiting for one, skip it
-    if (waitForAck && transport.waitingForAck)
+    if (!transport.commands.enqueue(command, commandPolicy(command)))
     {
-        logger.logf("Skipping command %d - already waiting for ack from command %d", command,
-                    transport.pendingAckCommand);
-        return;
+        logger.logf("Dropping command %d - send queue full of higher priority commands", command);
     }
+    flushCommands();
+}
 
-    uuid.generate();
-    String uuidStr = String(uuid.toCharArray());
-    uuidStr.replace("-", "");  // RequestID doesn't want dashes
-
-    // Get current timestamp
-    unsigned long timestamp = getTime();
-
-    // Reuse shared message document for outbound SDCP commands
-    messageDoc.clear();
-    if (!SDCPProtocol::buildCommandMessage(messageDoc,
-                                           command,
-                                           uuidStr,
-                                           mainboardID,
-                                           timestamp,
-                                           static_cast<int>(printStatus),
-                                           machineStatusMask))
-    {
-        logger.logf("Failed to build SDCP command %d: JSON document too small", command);
+void ElegooCC::flushCommands()
+{
+    if (!transport.webSocket.isConnected())
+    {
         return;
     }
 
-    String jsonPayload;
-    serializeJson(messageDoc, jsonPayload);
+    SdcpQueuedCommand queued;
+    while (transport.commands.next(queued))
+    {
+        char requestId[SDCP_REQUEST_ID_LENGTH + 1];
+        if (!transmitCommand(queued.command, requestId))
+        {
+            continue;
+        }
+        transport.commands.markSent(queued, requestId, millis());
+        if (queued.policy.waitForAck)
+        {
+            logger.logf("Waiting for acknowledgment for command %d with request ID %s (attempt %d)",
+                        queued.command, requestId, queued.attempts + 1);
+        }
+    }
+}
+
+bool ElegooCC::transmitCommand(int command, char *requestId)
+{
+    const SDCPCommandTemplate *frameTemplate = commandTemplate(command);
+    if (frameTemplate == nullptr)
+    {
+        logger.logf("Failed to encode SDCP command %d: MainboardID unusable", command);
+        return false;
+    }
+
+    // RequestID is the UUID without dashes
+    uuid.generate();
+    size_t      requestIdLength = 0;
+    const char *uuidChars       = uuid.toCharArray();
+    for (; *uuidChars != '\0' && requestIdLength < SDCP_REQUEST_ID_LENGTH; uuidChars++)
+    {
+        if (*uuidChars != '-')
+        {
+            requestId[requestIdLength++] = *uuidChars;
+        }
+    }
+    requestId[requestIdLength] = '\0';
 
-    // If this command requires an ack, set the tracking state
-    if (waitForAck)
+    // Leading headroom lets the websocket library add the frame header and
+    // mask in place instead of allocating a copy
+    uint8_t frame[WEBSOCKETS_MAX_HEADER_SIZE + SDCPCommandTemplate::MAX_FRAME_LENGTH];
+    size_t  frameLength = frameTemplate->render((char *) frame + WEBSOCKETS_MAX_HEADER_SIZE,
+                                                SDCPCommandTemplate::MAX_FRAME_LENGTH, requestId,
+                                                getTime(), static_cast<int>(printStatus),
+                                                machineStatusMask);
+    if (frameLength == 0)
     {
-        transport.waitingForAck       = true;
-        transport.pendingAckCommand   = command;
-        transport.pendingAckRequestId = uuidStr;
-        transport.ackWaitStartTime    = millis();
-        logger.logf("Waiting for acknowledgment for command %d with request ID %s", command,
-                    uuidStr.c_str());
+        logger.logf("Failed to build SDCP command %d: frame too large", command);
+        return false;
     }
 
-    transport.webSocket.sendTXT(jsonPayload);
+    transport.webSocket.sendTXT(frame, frameLength, true);
     if (command == SDCP_COMMAND_STATUS)
     {
         transport.lastStatusRequestMs = millis();
+        transport.latency.onRequestSent(requestId, transport.lastStatusRequestMs);
+        publishLatencyReport();
     }
+    return true;
+}
+
+const SDCPCommandTemplate *ElegooCC::commandTemplate(int command)
+{
+    uint8_t slot;
+    switch (command)
+    {
+        case SDCP_COMMAND_STATUS:
+            slot = 0;
+            break;
+        case SDCP_COMMAND_PAUSE_PRINT:
+            slot = 1;
+            break;
+        case SDCP_COMMAND_CONTINUE_PRINT:
+            slot = 2;
+            break;
+        default:
+            slot = COMMAND_TEMPLATE_SLOTS - 1;  // Rare commands share a slot
+            break;
+    }
+
+    SDCPCommandTemplate &frameTemplate = commandTemplates[slot];
+    if (!frameTemplate.matches(command, mainboardID.c_str()) &&
+        !frameTemplate.encode(command, mainboardID.c_str()))
+    {
+        return nullptr;
+    }
+    return &frameTemplate;
 }
 
 void ElegooCC::refreshCaches()
@@ -810,12 +946,44 @@ void ElegooCC::refreshSettingsCache()
     cachedSettings.pinDebugLogging = settingsManager.getPinDebugLogging();
     cachedSettings.motionMonitoringEnabled = settingsManager.getEnabled();
     cachedSettings.pulseReductionPercent = settingsManager.getPulseReductionPercent();
-    cachedSettings.movementMmPerPulse = settingsManager.getMovementMmPerPulse();
+    cachedSettings.movementUmPerPulse = FlowUnits::mmToUm(settingsManager.getMovementMmPerPulse());
+    cachedSettings.autoCalibrateSensor = settingsManager.getAutoCalibrateSensor();
+    pendingPollMinMs  = settingsManager.getStatusPollMinMs();
+    pendingPollMaxMs  = settingsManager.getStatusPollMaxMs();
+    pollConfigPending = true;  // May run on the web task; the loop owns the scheduler
 }
 
 void ElegooCC::refreshJamConfig()
 {
     cachedJamConfig = buildJamConfigFromSettings();
+    if (calibratedUmPerPulse > 0)
+    {
+        cachedJamConfig.umPerPulse = calibratedUmPerPulse;
+    }
+    pendingWindowMode   = cachedJamConfig.windowMode;
+    windowModePending   = true;  // May run on the web task; the loop owns the sensor
+    shadowConfigPending = true;  // May run on the web task; the loop owns the bank
+}
+
+void ElegooCC::applyPendingConfig()
+{
+    if (pollConfigPending)
+    {
+        portENTER_CRITICAL(&cacheLock);
+        pollConfigPending = false;
+        uint16_t minMs    = pendingPollMinMs;
+        uint16_t maxMs    = pendingPollMaxMs;
+        portEXIT_CRITICAL(&cacheLock);
+        statusPollScheduler.configure(minMs, maxMs);
+    }
+    if (windowModePending)
+    {
+        portENTER_CRITICAL(&cacheLock);
+        windowModePending = false;
+        WindowMode mode   = pendingWindowMode;
+        portEXIT_CRITICAL(&cacheLock);
+        motionSensor.setWindowMode(mode);
+    }
 }
 
 void ElegooCC::reconnect()
@@ -843,6 +1011,7 @@ void ElegooCC::maybeRequestStatus(unsigned long currentTime)
     // Use isPrintJobActive() for polling decisions - this includes heating, homing,
     // bed leveling, pausing, etc. (any non-idle state)
     bool jobActive = isPrintJobActive();
+    bool printing  = jobActive && isPrinting();
     unsigned long interval;
     bool inPostPrintGrace = false;
 
@@ -855,23 +1024,33 @@ void ElegooCC::maybeRequestStatus(unsigned long currentTime)
         }
     }
 
-    if (jobActive || inPostPrintGrace)
+    if (printing)
+    {
+        // Adaptive while extruding, bounded by settings
+        interval = statusPollScheduler.getIntervalMs();
+    }
+    else if (jobActive || inPostPrintGrace)
     {
+        // Heating, homing, pausing, or just finished
         interval = STATUS_ACTIVE_INTERVAL_MS;
-        if (jobActive)
-        {
-            lastPrintEndMs = 0;
-        }
     }
     else
     {
         interval = STATUS_IDLE_INTERVAL_MS;
     }
+    if (jobActive)
+    {
+        lastPrintEndMs = 0;
+    }
 
     if (transport.lastStatusRequestMs == 0 ||
         currentTime - transport.lastStatusRequestMs >= interval)
     {
         sendCommand(SDCP_COMMAND_STATUS);
+        if (printing)
+        {
+            statusPollScheduler.onPollSent();
+        }
     }
 }
 
@@ -926,17 +1105,18 @@ void ElegooCC::updateTransport(unsigned long currentTime)
             transport.reconnectBackoffMs  = 5000;  // Reset backoff to initial value
         }
 
-        if (transport.waitingForAck &&
-            (currentTime - transport.ackWaitStartTime) >= ACK_TIMEOUT_MS)
+        SdcpCommandTimeout timeout;
+        while (transport.commands.expireNext(currentTime, timeout))
         {
-            logger.logf("Acknowledgment timeout for command %d, resetting ack state",
-                        transport.pendingAckCommand);
-            transport.waitingForAck       = false;
-            transport.pendingAckCommand   = -1;
-            transport.pendingAckRequestId = "";
-            transport.ackWaitStartTime    = 0;
+            logger.logf("Acknowledgment timeout for command %d after %d attempt(s), %s",
+                        timeout.command, timeout.attempts,
+                        timeout.retrying ? "retrying" : "giving up");
         }
-        else if (currentTime - transport.lastPing > 29900)
+        transport.latency.expire(currentTime);
+        publishLatencyReport();
+        flushCommands();
+
+        if (currentTime - transport.lastPing > 29900)
         {
             // Keepalive ping every ~30s
             transport.webSocket.sendTXT("ping");
@@ -1006,6 +1186,7 @@ void ElegooCC::loop()
 {
     unsigned long currentTime = millis();
 
+    applyPendingConfig();
     updateTransport(currentTime);
     currentTime = millis();
 
@@ -1020,6 +1201,7 @@ void ElegooCC::loop()
     // before checkFilamentMovement uses it to decide whether to run jam detection
     checkFilamentRunout(currentTime);
     checkFilamentMovement(currentTime);
+    runPendingReplay();
 
     // Check if we should pause the print
     if (shouldPausePrint(currentTime))
@@ -1058,12 +1240,74 @@ bool ElegooCC::shouldApplyPulseReduction(float reductionPercent)
     return false; // Skip this pulse
 }
 
+void ElegooCC::updateLiveCalibration()
+{
+    if (!cachedSettings.autoCalibrateSensor)
+    {
+        return;
+    }
+
+    // Once converged, new pulses and the detector use the estimate
+    int32_t umPerPulse = pulseCalibrator.getConvergedUmPerPulse();
+    if (umPerPulse <= 0 || umPerPulse == calibratedUmPerPulse)
+    {
+        return;
+    }
+    if (calibratedUmPerPulse == 0)
+    {
+        PulseCalibration calibration = pulseCalibrator.getCalibration();
+        logger.logf("Sensor calibration converged: %.3f +/- %.3f mm/pulse after %u segments (setting %.3f)",
+                    calibration.umPerPulse / 1000.0f, calibration.ciUmPerPulse / 1000.0f,
+                    (unsigned) calibration.segments, FlowUnits::umToMm(cachedSettings.movementUmPerPulse));
+    }
+    calibratedUmPerPulse = umPerPulse;
+
+    portENTER_CRITICAL(&cacheLock);
+    cachedJamConfig.umPerPulse = umPerPulse;
+    portEXIT_CRITICAL(&cacheLock);
+    shadowConfigPending = true;
+}
+
+void ElegooCC::runPendingReplay()
+{
+    // Requested from the web task; run here, where the history is written,
+    // so the async server never waits on it. A few samples per pass keep
+    // the loop responsive however large the ring is.
+    if (!replayRunning)
+    {
+        portENTER_CRITICAL(&_stateMutex);
+        bool      pending = replayResult.active;
+        JamConfig config  = replayConfig;
+        portEXIT_CRITICAL(&_stateMutex);
+        if (!pending)
+        {
+            return;
+        }
+        flowHistory.beginReplay(config, replayCursor, replayProgress);
+        replayRunning = true;
+    }
+
+    if (!flowHistory.stepReplay(replayCursor, replayProgress, FLOW_REPLAY_SAMPLES_PER_STEP))
+    {
+        return;
+    }
+    replayRunning = false;
+    logger.logf("Flow replay: %u samples over %lums, %u trips, took %luus (slowest step %luus)",
+                (unsigned) replayProgress.samples, (unsigned long) replayProgress.spanMs,
+                (unsigned) replayProgress.trips, (unsigned long) replayProgress.elapsedUs,
+                (unsigned long) replayProgress.maxStepUs);
+
+    portENTER_CRITICAL(&_stateMutex);
+    replayResult = replayProgress;
+    portEXIT_CRITICAL(&_stateMutex);
+}
+
 void ElegooCC::resetRunoutPauseState()
 {
     runoutPausePending         = false;
     runoutPauseCommanded       = false;
     runoutPauseRemainingMm     = 0.0f;
-    runoutPauseStartExpectedMm = expectedFilamentMM;
+    runoutPauseStartExpectedUm = expectedFilamentUm;
     pauseTriggeredByRunout     = false;
 }
 
@@ -1087,20 +1331,20 @@ void ElegooCC::updateRunoutPauseCountdown()
     {
         runoutPausePending         = true;
         runoutPauseCommanded       = false;
-        runoutPauseStartExpectedMm = expectedFilamentMM;
+        runoutPauseStartExpectedUm = expectedFilamentUm;
         runoutPauseRemainingMm     = runoutPauseDelayMm;
         logger.logf("Filament runout detected; delaying pause for %.1fmm of expected extrusion (start=%.2fmm)",
-                    runoutPauseDelayMm, runoutPauseStartExpectedMm);
+                    runoutPauseDelayMm, FlowUnits::umToMm(runoutPauseStartExpectedUm));
     }
 
-    float consumed = expectedFilamentMM - runoutPauseStartExpectedMm;
-    if (consumed < 0.0f)
+    int32_t consumedUm = expectedFilamentUm - runoutPauseStartExpectedUm;
+    if (consumedUm < 0)
     {
-        consumed = 0.0f;
-        runoutPauseStartExpectedMm = expectedFilamentMM;
+        consumedUm = 0;
+        runoutPauseStartExpectedUm = expectedFilamentUm;
     }
 
-    runoutPauseRemainingMm = runoutPauseDelayMm - consumed;
+    runoutPauseRemainingMm = runoutPauseDelayMm - FlowUnits::umToMm(consumedUm);
     if (runoutPauseRemainingMm < 0.0f)
     {
         runoutPauseRemainingMm = 0.0f;
@@ -1176,8 +1420,11 @@ void ElegooCC::checkFilamentMovement(unsigned long currentTime)
     // ============================================================================
     if (trackingFrozen)
     {
-        // Sync ISR counter to discard pulses accumulated while frozen
-        lastIsrPulseCount = ElegooCC::isrPulseCounter;
+        // Sync pulse counter to discard pulses accumulated while frozen
+        if (pulseSource)
+        {
+            pulseSource->syncCount();
+        }
 
         // When tracking is frozen (printer paused after a jam), just track pin changes
         int currentMovementValue = digitalRead(MOVEMENT_SENSOR_PIN);
@@ -1213,19 +1460,27 @@ void ElegooCC::checkFilamentMovement(unsigned long currentTime)
     bool shouldCountPulses = isPrintJobActive();
 
     // ============================================================================
-    // READ ACCUMULATED PULSES FROM ISR COUNTER
+    // READ ACCUMULATED PULSES FROM PULSE SOURCE
     // ============================================================================
-    unsigned long currentPulseCount = ElegooCC::isrPulseCounter;
-    unsigned long newPulses = currentPulseCount - lastIsrPulseCount;
-    lastIsrPulseCount = currentPulseCount;
+    unsigned long newPulses = pulseSource ? pulseSource->takeNewPulses() : 0;
+
+    // Edge timestamps are relative to this instant
+    unsigned long drainNowMs = millis();
+    uint32_t      drainNowUs = (uint32_t) micros();
+
+    if (!shouldCountPulses && pulseSource)
+    {
+        pulseSource->discardEdgeTimestamps();
+    }
 
     // Process accumulated pulses
     if (newPulses > 0 && shouldCountPulses)
     {
-        float movementMm = cachedSettings.movementMmPerPulse;
-        if (movementMm <= 0.0f)
+        int32_t movementUm = calibratedUmPerPulse > 0 ? calibratedUmPerPulse
+                                                      : cachedSettings.movementUmPerPulse;
+        if (movementUm <= 0)
         {
-            movementMm = 2.88f;  // Default sensor spec
+            movementUm = 2880;  // Default sensor spec (2.88mm)
         }
 
         // Process each pulse through reduction filter (for test recording mode)
@@ -1237,12 +1492,17 @@ void ElegooCC::checkFilamentMovement(unsigned long currentTime)
             if (!shouldApplyPulseReduction(reductionPercent))
             {
                 // Skip this pulse due to reduction setting (test feature)
+                pulseSource->nextEdgeTimeMs(drainNowMs, drainNowUs);
                 continue;
             }
 
+            // Attribute the pulse to its captured edge time. Backends without
+            // timestamps (opt-in PCNT) or an overflowed ring fall back to now.
+            unsigned long edgeMs = pulseSource->nextEdgeTimeMs(drainNowMs, drainNowUs);
+
             // Add pulse to motion sensor (Klipper-style)
-            motionSensor.addSensorPulse(movementMm);
-            actualFilamentMM += movementMm;
+            motionSensor.addSensorPulseAtUm(movementUm, edgeMs);
+            actualFilamentUm += movementUm;
             movementPulseCount++;
 
             // Pin debug logging for pulse detection
@@ -1301,27 +1561,91 @@ void ElegooCC::checkFilamentMovement(unsigned long currentTime)
     // Use cached jam config instead of rebuilding
     const JamConfig& jamConfig = cachedJamConfig;
 
-    // Get windowed distances from motion sensor
-    float expectedDistance = motionSensor.getExpectedDistance();
-    float actualDistance = motionSensor.getSensorDistance();
-    float windowedExpectedRate = 0.0f;
-    float windowedActualRate = 0.0f;
-    motionSensor.getWindowedRates(windowedExpectedRate, windowedActualRate);
+    // Get windowed distances and rates from motion sensor in one O(1) query.
+    // Taken at drain time so it is never earlier than the pulses just added.
+    WindowSnapshot window       = motionSensor.getWindowSnapshot(drainNowMs);
+    WindowSnapshot shortWindow  = motionSensor.getShortWindowSnapshot(drainNowMs);
+    int32_t        edgeVelocity = motionSensor.getEdgeVelocityUmPerSec(drainNowMs);
+    portENTER_CRITICAL(&_stateMutex);
+    lastWindowSnapshot = window;
+    portEXIT_CRITICAL(&_stateMutex);
 
     // Update jam detector and get current state
     // Throttle jamDetector.update() to 4Hz
     if ((currentTime - lastJamDetectorUpdateMs) >= JAM_DETECTOR_UPDATE_INTERVAL_MS)
     {
         lastJamDetectorUpdateMs = currentTime;
+
+        // A new print starts from what earlier prints of the file learned
+        if (baselineLoadPending && !filename.isEmpty())
+        {
+            baselineLoadPending = false;
+            FlowBaseline baseline;
+            if (baselineStore.load(filename, baseline))
+            {
+                jamDetector.setBaseline(baseline);
+                logger.logf("Flow baseline loaded for %s: mean=%.3f sigma=%.3f n=%u",
+                            filename.c_str(), baseline.meanPermille / 1000.0f,
+                            baseline.sigmaPermille / 1000.0f, (unsigned) baseline.samples);
+            }
+        }
+
+        // The sensor track is observed every update, pulses or not
+        flowEstimator.addActualUm(actualFilamentUm, drainNowMs);
+        FlowEstimate flowEstimate = flowEstimator.getEstimate(drainNowMs);
         
         // Update jam detector and get current state
-        cachedJamState = jamDetector.update(
-            expectedDistance, actualDistance, movementPulseCount,
+        cachedJamState = jamDetector.updateUm(
+            window.expectedUm, window.actualUm, movementPulseCount,
             currentlyPrinting, expectedTelemetryAvailable,
             currentTime, startedAt, jamConfig,
-            windowedExpectedRate, windowedActualRate
+            window.expectedRateUmPerSec, window.actualRateUmPerSec,
+            shortWindow.expectedRateUmPerSec, shortWindow.actualRateUmPerSec,
+            edgeVelocity, &flowEstimate
+        );
+        if (currentlyPrinting && expectedTelemetryAvailable)
+        {
+            transport.latency.onTelemetryUsed(currentTime);
+            publishLatencyReport();
+        }
+        if (currentlyPrinting)
+        {
+            statusPollScheduler.update(cachedJamState.passRatio, cachedJamState.hardJamPercent,
+                                       cachedJamState.softJamPercent, cachedJamState.graceActive,
+                                       currentTime);
+        }
+
+        // Same inputs for the shadow detectors; they only record
+        if (shadowConfigPending)
+        {
+            shadowConfigPending = false;
+            shadowBank.configure(jamConfig);
+        }
+        shadowBank.update(
+            cachedJamState, window.expectedUm, window.actualUm, movementPulseCount,
+            currentlyPrinting, expectedTelemetryAvailable,
+            currentTime, startedAt,
+            window.expectedRateUmPerSec, window.actualRateUmPerSec,
+            shortWindow.expectedRateUmPerSec, shortWindow.actualRateUmPerSec,
+            edgeVelocity, &flowEstimate
+        );
+        publishShadowReport();
+        flowHistory.record(
+            window.expectedUm, window.actualUm, movementPulseCount,
+            currentlyPrinting, expectedTelemetryAvailable,
+            currentTime, startedAt,
+            window.expectedRateUmPerSec, window.actualRateUmPerSec,
+            shortWindow.expectedRateUmPerSec, shortWindow.actualRateUmPerSec,
+            edgeVelocity, &flowEstimate
         );
         
+        // Online sensor calibration from healthy extrusion only
+        bool healthyFlow = currentlyPrinting && expectedTelemetryAvailable &&
+                           cachedJamState.graceState == GraceState::ACTIVE &&
+                           cachedJamState.hardJamPercent == 0.0f && cachedJamState.softJamPercent == 0.0f;
+        pulseCalibrator.update(expectedFilamentUm, movementPulseCount, healthyFlow);
+        updateLiveCalibration();
+
         // Update filament stopped state (unless latched by pause/tracking freeze)
         if (!jamDetector.isPauseRequested() && !trackingFrozen)
         {
@@ -1340,8 +1664,9 @@ void ElegooCC::checkFilamentMovement(unsigned long currentTime)
 
         logger.logf(
             "Debug: sdcp_exp=%.2fmm cumul_sns=%.2fmm pulses=%lu | win_exp=%.2f win_sns=%.2f deficit=%.2f | jam=%d hard=%.2f soft=%.2f pass=%.2f grace=%d heap=%lu",
-            expectedFilamentMM, actualFilamentMM, movementPulseCount,
-            expectedDistance, actualDistance, jamState.deficit,
+            FlowUnits::umToMm(expectedFilamentUm), FlowUnits::umToMm(actualFilamentUm),
+            movementPulseCount,
+            FlowUnits::umToMm(window.expectedUm), FlowUnits::umToMm(window.actualUm), jamState.deficit,
             jamState.jammed ? 1 : 0,
             jamState.hardJamPercent, jamState.softJamPercent, jamState.passRatio,
             jamState.graceActive ? 1 : 0, freeHeap);
@@ -1350,10 +1675,11 @@ void ElegooCC::checkFilamentMovement(unsigned long currentTime)
     if (summaryFlow && currentlyPrinting && !debugFlow && (currentTime - lastSummaryLogMs) >= 1000)
     {
         lastSummaryLogMs = currentTime;
+        float windowExpectedMm = FlowUnits::umToMm(window.expectedUm);
         logger.logf("Debug summary: expected=%.2fmm sensor=%.2fmm deficit=%.2fmm "
                     "ratio=%.2f hard=%.2f%% soft=%.2f%% pass=%.2f pulses=%lu",
-                    expectedDistance, actualDistance, jamState.deficit,
-                    jamState.deficit / (expectedDistance > 0.1f ? expectedDistance : 1.0f),
+                    windowExpectedMm, FlowUnits::umToMm(window.actualUm), jamState.deficit,
+                    jamState.deficit / (windowExpectedMm > 0.1f ? windowExpectedMm : 1.0f),
                     jamState.hardJamPercent, jamState.softJamPercent, jamState.passRatio,
                     movementPulseCount);
     }
@@ -1392,7 +1718,8 @@ bool ElegooCC::shouldPausePrint(unsigned long currentTime)
     }
 
     if (currentTime - startedAt < settingsManager.getDetectionGracePeriodMs() ||
-        !transport.webSocket.isConnected() || transport.waitingForAck || !isPrinting() ||
+        !transport.webSocket.isConnected() ||
+        transport.commands.isPending(SDCP_COMMAND_PAUSE_PRINT) || !isPrinting() ||
         !pauseCondition ||
         (lastPauseRequestMs != 0 && (currentTime - lastPauseRequestMs) < PAUSE_REARM_DELAY_MS))
     {
@@ -1404,7 +1731,8 @@ bool ElegooCC::shouldPausePrint(unsigned long currentTime)
     if (runoutPauseReady && !runoutPauseCommanded)
     {
         logger.logf("Runout pause delay satisfied after %.2fmm expected (start=%.2fmm current=%.2fmm)",
-                    runoutPauseDelayMm, runoutPauseStartExpectedMm, expectedFilamentMM);
+                    runoutPauseDelayMm, FlowUnits::umToMm(runoutPauseStartExpectedUm),
+                    FlowUnits::umToMm(expectedFilamentUm));
     }
 
     // log why we paused...
@@ -1423,8 +1751,8 @@ bool ElegooCC::shouldPausePrint(unsigned long currentTime)
         JamState jamState = jamDetector.getState();
         logger.logf("Flow state: expected=%.2fmm actual=%.2fmm deficit=%.2fmm "
                     "pass_ratio=%.2f pulses=%lu",
-                    expectedFilamentMM, actualFilamentMM, jamState.deficit,
-                    jamState.passRatio, movementPulseCount);
+                    FlowUnits::umToMm(expectedFilamentUm), FlowUnits::umToMm(actualFilamentUm),
+                    jamState.deficit, jamState.passRatio, movementPulseCount);
     }
 
     return true;
@@ -1632,20 +1960,3 @@ void ElegooCC::updateDiscovery(unsigned long currentTime)
         yield();
     }
 }
-
-// ============================================================================
-// INTERRUPT SERVICE ROUTINE FOR PULSE COUNTING
-// ============================================================================
-// Static interrupt handler that increments the pulse counter on rising edge.
-// This replaces polling-based edge detection and guarantees no pulses are dropped,
-// even during loop stalls or high-speed extrusion.
-//
-// Called by GPIO interrupt on MOVEMENT_SENSOR_PIN rising edge.
-// Execution time: ~2-3 microseconds (very fast, safe for ISR).
-// ============================================================================
-void IRAM_ATTR ElegooCC::pulseCounterISR()
-{
-    // Directly increment the static counter. This is safe to do from an ISR
-    // as it involves no flash-based code.
-    ElegooCC::isrPulseCounter++;
-}
@@ -8,7 +8,18 @@
 #include <functional>
 
 #include "FilamentMotionSensor.h"
+#include "FlowBaselineStore.h"
+#include "FlowHistory.h"
+#include "FlowRatioEstimator.h"
 #include "JamDetector.h"
+#include "PulseCalibrator.h"
+#include "PulseSource.h"
+#include "SDCPCommandQueue.h"
+#include "SDCPCommandTemplate.h"
+#include "SDCPLatencyTracker.h"
+#include "SDCPStatusParser.h"
+#include "ShadowJamBank.h"
+#include "StatusPollScheduler.h"
 //#include "JamDetector_iface.h"
 #include "UUID.h"
 #include <vector>
@@ -109,13 +120,25 @@ typedef struct
     float               deficitThresholdMm;
     float               deficitRatio;
     float               passRatio;
+    float               softThreshold;  // Soft pass-ratio threshold in effect
     float               hardJamPercent;
     float               softJamPercent;
+    float               deficitTrend;   // Fitted flow deficit slope (fraction per second)
+    int32_t             timeToJamMs;    // Predicted ms until a trip, -1 = none in sight
+    bool                jamWarning;     // Trip predicted within the warning horizon
     bool                graceActive;
     uint8_t             graceState;  // GraceState enum value (0=IDLE, 1=START_GRACE, 2=RESUME_GRACE, 3=ACTIVE, 4=JAMMED)
     float               expectedRateMmPerSec;
     float               actualRateMmPerSec;
     unsigned long       movementPulseCount;
+    uint32_t            pulseEdgeOverflows;  // Edge timestamps dropped since boot (pulses still counted)
+    unsigned long       flowLagMs;  // Measured planner-to-extruder lag the windows are shifted by
+    float               mmPerPulseEstimate;   // Online sensor calibration
+    float               mmPerPulseCi;         // 95% confidence half-width
+    bool                mmPerPulseConverged;
+    uint16_t            statusPollIntervalMs;    // Adaptive status poll interval while printing
+    float               statusPollHz;            // Achieved poll rate this print
+    uint32_t            statusCpuSavedUsPerSec;  // Frame handling saved against a fixed 4Hz poll
 } printer_info_t;
 
 class ElegooCC
@@ -126,10 +149,8 @@ class ElegooCC
         WebSocketsClient webSocket;
         String           ipAddress;
         unsigned long    lastPing            = 0;
-        bool             waitingForAck       = false;
-        int              pendingAckCommand   = -1;
-        String           pendingAckRequestId;
-        unsigned long    ackWaitStartTime    = 0;
+        SDCPCommandQueue commands;                     // Send queue and requests awaiting ack
+        SDCPLatencyTracker latency;                    // Status poll RTT and telemetry age
         unsigned long    lastStatusRequestMs = 0;
         unsigned long    connectionStartMs   = 0;  // When connect() was called (for throttle bypass)
         bool             blocked             = false;  // Discovery lockout for transport
@@ -142,11 +163,17 @@ class ElegooCC
     };
 
     TransportState        transport;
+    SdcpLatencyReport     latencyReport;         // Last published transport.latency report, under _stateMutex
     UUID                  uuid;
-    StaticJsonDocument<1200> messageDoc;
+    StaticJsonDocument<1200> messageDoc;         // Incoming command acks
+    SdcpStatusFrame       statusFrame;           // Reused by every incoming frame
 
-    // Interrupt-driven pulse counter (replaces polling-based edge detection)
-    unsigned long lastIsrPulseCount;            // Last value read in main loop
+    // Pre-encoded outgoing commands: status, pause, continue, anything else
+    static const uint8_t  COMMAND_TEMPLATE_SLOTS = 4;
+    SDCPCommandTemplate   commandTemplates[COMMAND_TEMPLATE_SLOTS];
+
+    // Movement sensor edge source (PCNT or GPIO interrupt, chosen in setup())
+    PulseSource  *pulseSource;
 
     // Legacy pin tracking (used only when tracking is frozen after jam pause)
     int           lastMovementValue;  // Initialize to invalid value
@@ -171,9 +198,9 @@ class ElegooCC
     bool                runoutPauseCommanded;
     float               runoutPauseRemainingMm;
     float               runoutPauseDelayMm;
-    float               runoutPauseStartExpectedMm;
-    float               expectedFilamentMM;
-    float               actualFilamentMM;
+    int32_t             runoutPauseStartExpectedUm;
+    int32_t             expectedFilamentUm;  // Micrometres; converted to mm at the UI boundary
+    int32_t             actualFilamentUm;
     float               lastExpectedDeltaMM;
     bool                expectedTelemetryAvailable;
     unsigned long       lastSuccessfulTelemetryMs;
@@ -184,7 +211,28 @@ class ElegooCC
     unsigned long startedAt;
     FilamentMotionSensor motionSensor;  // Windowed sensor tracking (Klipper-style)
     JamDetector         jamDetector;    // Consolidated jam detection logic
+    FlowRatioEstimator  flowEstimator;  // Kalman flow ratio (telemetry + pulses)
+    ShadowJamBank       shadowBank;     // Alternative configs, record-only (loop task only)
+    ShadowBankReport    shadowReport;   // Last published bank report, under _stateMutex
+    volatile bool       shadowConfigPending;  // Jam config changed; reconfigure the bank
+    FlowHistory         flowHistory;    // Recent detector inputs for what-if replay
+    JamConfig           replayConfig;   // Candidate config of a requested replay
+    FlowReplayResult    replayResult;   // Last finished replay, under _stateMutex
+    FlowReplayCursor    replayCursor;   // Replay in progress (loop task only)
+    FlowReplayResult    replayProgress;
+    bool                replayRunning;
+    FlowBaselineStore   baselineStore;  // Learned healthy pass ratio per print file
+    bool                baselineLoadPending;
+    PulseCalibrator     pulseCalibrator;       // Online mm/pulse (RLS) from healthy extrusion
+    int32_t             calibratedUmPerPulse;  // Converged value in use this print, 0 = settings
+    StatusPollScheduler statusPollScheduler;   // Status poll interval while a job is active
+    uint16_t            pendingPollMinMs;      // Poll bounds from settings, applied by the loop
+    uint16_t            pendingPollMaxMs;
+    volatile bool       pollConfigPending;
+    WindowMode          pendingWindowMode;     // Detection window mode, applied by the loop
+    volatile bool       windowModePending;
     unsigned long       movementPulseCount;
+    uint32_t            edgeOverflowsAtReset;  // getPulseEdgeOverflows() when tracking last reset
     unsigned long       lastFlowLogMs;
     unsigned long       lastSummaryLogMs;
     unsigned long       lastPinDebugLogMs;
@@ -206,14 +254,13 @@ class ElegooCC
     
     // Jam detector state caching (for throttled updates)
     JamState      cachedJamState;
+    // Last motion sensor window read by checkFilamentMovement (for status readers
+    // on other tasks, which must not advance the sensor's window themselves)
+    WindowSnapshot lastWindowSnapshot;
     // command to the printer when it is detected.
     unsigned long lastJamDetectorUpdateMs;
     bool          pauseTriggeredByRunout;
 
-   public:
-    // Public static counter for the ISR to access safely
-    static volatile unsigned long isrPulseCounter;
-
    private:
     // Settings caching (for hot-path optimization)
     struct CachedSettings {
@@ -223,7 +270,8 @@ class ElegooCC
         bool pinDebugLogging;
         bool motionMonitoringEnabled;
         float pulseReductionPercent;
-        float movementMmPerPulse;
+        int32_t movementUmPerPulse;
+        bool autoCalibrateSensor;
     };
     CachedSettings cachedSettings;
     JamConfig cachedJamConfig;
@@ -234,7 +282,7 @@ class ElegooCC
     unsigned long lastPauseRequestMs;
     unsigned long lastPrintEndMs;
     static constexpr unsigned long STATUS_IDLE_INTERVAL_MS          = 10000;
-    static constexpr unsigned long STATUS_ACTIVE_INTERVAL_MS        = 250;
+    static constexpr unsigned long STATUS_ACTIVE_INTERVAL_MS        = 250;  // Post-print grace
     static constexpr unsigned long STATUS_POST_PRINT_COOLDOWN_MS    = 20000;
     static constexpr unsigned long JAM_DEBUG_INTERVAL_MS            = 1000;
     static constexpr unsigned long JAM_DETECTOR_UPDATE_INTERVAL_MS  = 250;  // 4Hz
@@ -250,12 +298,20 @@ class ElegooCC
     void connect();
     void updateTransport(unsigned long currentTime);
     void handleCommandResponse(JsonDocument &doc);
-    void handleStatus(JsonDocument &doc);
-    void sendCommand(int command, bool waitForAck = false);
+    void handleStatus(const SdcpStatusFrame &frame);
+    void sendCommand(int command);
+    void flushCommands();
+    bool transmitCommand(int command, char *requestId);
+    const SDCPCommandTemplate *commandTemplate(int command);
     void refreshSettingsCache();
     void refreshJamConfig();
+    void applyPendingConfig();
+    void publishShadowReport();
+    void publishLatencyReport();
 
     void resetRunoutPauseState();
+    void runPendingReplay();
+    void updateLiveCalibration();
     void updateRunoutPauseCountdown();
     bool isRunoutPauseReady() const;
    public:
@@ -263,9 +319,7 @@ class ElegooCC
     void continuePrint();
 
     void resetFilamentTracking(bool resetGrace = true);
-    bool processFilamentTelemetry(JsonObject& printInfo, unsigned long currentTime);
-    bool tryReadExtrusionValue(JsonObject& printInfo, const char* key, const char* hexKey,
-                               float& output);
+    bool processFilamentTelemetry(const SdcpStatusFrame& frame, unsigned long currentTime);
 
     // Helper methods for machine status bitmask
     bool hasMachineStatus(sdcp_machine_status_t status);
@@ -282,9 +336,6 @@ class ElegooCC
     // Singleton access method
     static ElegooCC &getInstance();
 
-    // Interrupt handler for pulse detection (static, attached to GPIO interrupt)
-    static void IRAM_ATTR pulseCounterISR();
-
     void setup();
     void loop();
 
@@ -294,8 +345,20 @@ class ElegooCC
     // Get current printer information
     printer_info_t getCurrentInformation();
 
+    // What the shadow detectors would have done this print, and their cost
+    ShadowBankReport getShadowReport();
+
+    // Status poll round trips, telemetry age, and late or dropped frames
+    SdcpLatencyReport getLatencyReport();
+
+    // What-if replay of recent flow history; runs on the next loop() pass
+    JamConfig getJamConfig() const { return cachedJamConfig; }
+    bool requestReplay(const JamConfig& config);
+    FlowReplayResult getReplayResult();
+
     // Status display accessors
     bool isJammed() const { return cachedJamState.jammed; }
+    uint32_t getPulseEdgeOverflows() const { return pulseSource ? pulseSource->getEdgeOverflows() : 0; }
     bool isFilamentRunout() const { return filamentRunout; }
 
     // Discovery
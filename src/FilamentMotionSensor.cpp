@@ -1,82 +1,353 @@
 #include "FilamentMotionSensor.h"
 
-FilamentMotionSensor::FilamentMotionSensor()
+using namespace FlowUnits;
+
+namespace
 {
+    // Lag estimation smoothing, in correlated (active) buckets
+    constexpr int32_t LAG_MEAN_DIVISOR       = 16;
+    constexpr int64_t LAG_COVARIANCE_DIVISOR = 64;
+}
+
+template <unsigned long BucketMs, unsigned long WindowMs>
+FilamentMotionSensorT<BucketMs, WindowMs>::FilamentMotionSensorT()
+{
+    windowMode = WindowMode::TIME;
+    edgeTimestamps = true;
+
+    // The lag estimate outlives reset(); it starts from nothing only here
+    lagMeanExpectedUm = 0;
+    lagMeanActualUm   = 0;
+    lagVarianceExpected = 0;
+    lagVarianceActual   = 0;
+    for (int k = 0; k <= MAX_LAG_BUCKETS; k++)
+    {
+        lagCovariance[k] = 0;
+    }
+    lagSamples = 0;
+    lagBuckets = 0;
+
+    printSpeedPct = 0;
+
     reset();
 }
 
-void FilamentMotionSensor::reset()
+template <unsigned long BucketMs, unsigned long WindowMs>
+void FilamentMotionSensorT<BucketMs, WindowMs>::reset()
 {
     initialized           = false;
     firstPulseReceived    = false;
     lastExpectedUpdateMs  = millis();
-    lastTotalExtrusionMm  = 0.0f;
+    lastTotalExtrusionUm  = 0;
+    retractDebtUm         = 0;
+    extrapolationRateUmPerSec = 0;
+    extrapolationSpeedPct     = 0;
+    lastChunkMs               = lastExpectedUpdateMs;
+    chunkHead                 = 0;
+    chunkCount                = 0;
     
     // Reset global pulse counters
-    totalSensorMm         = 0.0f;
-    sensorMmAtLastUpdate  = 0.0f;
-    preInitActualMm       = 0.0f;
+    totalSensorUm         = 0;
+    sensorUmAtLastUpdate  = 0;
+    preInitActualUm       = 0;
     preInitPulseCount     = 0;
     lastSensorPulseMs     = millis();
 
     // Clear buckets
     for (int i = 0; i < BUCKET_COUNT; i++)
     {
-        expectedBuckets[i]  = 0.0f;
-        actualBuckets[i]    = 0.0f;
-        bucketTimestamps[i] = 0; // 0 will be treated as stale immediately
+        expectedBuckets[i]  = 0;
+        actualBuckets[i]    = 0;
+        bucketTimestamps[i] = UNUSED_BUCKET;  // Never counted toward the window
+        bucketInWindow[i]   = false;
     }
+
+    windowExpectedUm  = 0;
+    windowActualUm    = 0;
+    windowBucketCount = 0;
+    windowNowMs       = millis();
+
+    lastEdgeMs        = millis();
+    lastEdgePeriodMs  = 0;
+    lastEdgeUm        = 0;
+
+    // Distance window history restarts with the first expected update
+    expectedTotalUm  = 0;
+    checkpointSeq    = 0;
+    windowStartSeq   = 0;
+    nextCheckpointMs = millis();
+
+    // Buckets before the reset were cleared above; correlate from now on
+    lagNextBucket    = bucketNumber(millis());
 }
 
-int FilamentMotionSensor::getCurrentBucketIndex()
+template <unsigned long BucketMs, unsigned long WindowMs>
+int FilamentMotionSensorT<BucketMs, WindowMs>::getBucketIndexFor(unsigned long timeMs)
 {
-    unsigned long now = millis();
-    int index = (now / BUCKET_SIZE_MS) % BUCKET_COUNT;
-    
-    // Check if this bucket belongs to a previous time cycle
-    // We allow a small tolerance or strict equality, but strictly 
-    // speaking, if the stored timestamp isn't essentially "now" (rounded to bucket),
-    // it is stale.
-    // Simpler check: If timestamp is older than WINDOW_SIZE, it is definitely garbage.
-    // But since we wrap around, we must clear it *before* writing if it's from the last lap.
-    
-    
-    // We clear aggressively: If the bucket's timestamp doesn't match the current 
-    // calculated window-slot time, it is stale.
-    // Actually, simple ring buffer logic:
-    // If we are writing to it, we ensure it's fresh.
-    
-    unsigned long bucketStart = (now / BUCKET_SIZE_MS) * BUCKET_SIZE_MS;
-    
-    if (bucketTimestamps[index] != bucketStart)
+    int index = slotFor(bucketNumber(timeMs));
+
+    // Each slot is owned by exactly one bucket-aligned time. If the stored
+    // timestamp is older, the slot is from a previous lap and gets recycled.
+    // If it is newer, the requested time has already fallen out of the ring.
+    unsigned long bucketStart = bucketStartFor(timeMs);
+
+    if (bucketTimestamps[index] == bucketStart)
     {
-        // This is a new time slot for this index. Reset it.
-        expectedBuckets[index] = 0.0f;
-        actualBuckets[index]   = 0.0f;
-        bucketTimestamps[index] = bucketStart;
+        return index;
+    }
+    if (bucketTimestamps[index] != UNUSED_BUCKET && bucketTimestamps[index] > bucketStart)
+    {
+        return -1;
+    }
+
+    // This is a new time slot for this index. Reset it.
+    if (bucketInWindow[index])
+    {
+        evictBucket(index);
+    }
+    expectedBuckets[index]  = 0;
+    actualBuckets[index]    = 0;
+    bucketTimestamps[index] = bucketStart;
+
+    // Buckets belong to the window from the moment they are claimed
+    if (bucketStart >= windowCutoff(windowNowMs) && bucketStart <= windowNowMs)
+    {
+        admitBucket(index);
     }
-    
     return index;
 }
 
-void FilamentMotionSensor::clearStaleBuckets(unsigned long currentTime)
+template <unsigned long BucketMs, unsigned long WindowMs>
+void FilamentMotionSensorT<BucketMs, WindowMs>::evictBucket(int index)
 {
-    // Optional maintenance: Iterate and clear buckets older than window
-    // This isn't strictly necessary for correctness if we only Sum valid ones,
-    // but helps debugging.
-    // We will rely on sumWindow() filtering instead for performance.
+    // Integer totals are exact, so eviction is a plain subtraction
+    bucketInWindow[index] = false;
+    windowBucketCount--;
+    windowExpectedUm -= expectedBuckets[index];
+    windowActualUm   -= actualBuckets[index];
 }
 
-void FilamentMotionSensor::updateExpectedPosition(float totalExtrusionMm)
+template <unsigned long BucketMs, unsigned long WindowMs>
+void FilamentMotionSensorT<BucketMs, WindowMs>::admitBucket(int index)
+{
+    bucketInWindow[index] = true;
+    windowBucketCount++;
+    windowExpectedUm += expectedBuckets[index];
+    windowActualUm   += actualBuckets[index];
+}
+
+template <unsigned long BucketMs, unsigned long WindowMs>
+void FilamentMotionSensorT<BucketMs, WindowMs>::rebuildWindow(unsigned long now)
+{
+    unsigned long cutoff = windowCutoff(now);
+
+    windowExpectedUm  = 0;
+    windowActualUm    = 0;
+    windowBucketCount = 0;
+
+    for (int i = 0; i < BUCKET_COUNT; i++)
+    {
+        bucketInWindow[i] = false;
+        // Only include buckets that are strictly within the window
+        if (bucketTimestamps[i] >= cutoff && bucketTimestamps[i] <= now)
+        {
+            admitBucket(i);
+        }
+    }
+    windowNowMs = now;
+}
+
+template <unsigned long BucketMs, unsigned long WindowMs>
+int32_t FilamentMotionSensorT<BucketMs, WindowMs>::bucketExpectedUm(unsigned long bucketNum) const
+{
+    int index = slotFor(bucketNum);
+    return (bucketTimestamps[index] == bucketNum * BucketMs) ? expectedBuckets[index] : 0;
+}
+
+template <unsigned long BucketMs, unsigned long WindowMs>
+int32_t FilamentMotionSensorT<BucketMs, WindowMs>::bucketActualUm(unsigned long bucketNum) const
+{
+    int index = slotFor(bucketNum);
+    return (bucketTimestamps[index] == bucketNum * BucketMs) ? actualBuckets[index] : 0;
+}
+
+template <unsigned long BucketMs, unsigned long WindowMs>
+void FilamentMotionSensorT<BucketMs, WindowMs>::correlateLag(unsigned long now)
+{
+    if (MAX_LAG_BUCKETS <= 0)
+    {
+        return;
+    }
+
+    // A bucket is correlated once LAG_SETTLE_BUCKETS have passed, against
+    // the MAX_LAG_BUCKETS expected buckets before it; anything the ring has
+    // already recycled is skipped.
+    long nowBucket = (long) bucketNumber(now);
+    long settled   = nowBucket - LAG_SETTLE_BUCKETS;
+    long oldest    = nowBucket - (BUCKET_COUNT - 1) + MAX_LAG_BUCKETS;
+    if ((long) lagNextBucket < oldest)
+    {
+        lagNextBucket = (unsigned long) (oldest > 0 ? oldest : 0);
+    }
+
+    for (; (long) lagNextBucket <= settled; lagNextBucket++)
+    {
+        if (!initialized || lagNextBucket < (unsigned long) MAX_LAG_BUCKETS)
+        {
+            continue;
+        }
+
+        int32_t actual   = bucketActualUm(lagNextBucket);
+        int32_t activity = actual;
+        int32_t expected[MAX_LAG_BUCKETS + 1];
+        for (int k = 0; k <= MAX_LAG_BUCKETS; k++)
+        {
+            expected[k] = bucketExpectedUm(lagNextBucket - k);
+            activity += expected[k];
+        }
+
+        // Idle stretches carry no timing and would only wash the estimate out
+        if (activity == 0)
+        {
+            continue;
+        }
+
+        lagMeanExpectedUm += (expected[0] - lagMeanExpectedUm) / LAG_MEAN_DIVISOR;
+        lagMeanActualUm   += (actual - lagMeanActualUm) / LAG_MEAN_DIVISOR;
+
+        int64_t expectedDeviation = expected[0] - lagMeanExpectedUm;
+        int64_t actualDeviation   = actual - lagMeanActualUm;
+        lagVarianceExpected += (expectedDeviation * expectedDeviation - lagVarianceExpected) / LAG_COVARIANCE_DIVISOR;
+        lagVarianceActual   += (actualDeviation * actualDeviation - lagVarianceActual) / LAG_COVARIANCE_DIVISOR;
+        for (int k = 0; k <= MAX_LAG_BUCKETS; k++)
+        {
+            int64_t product = (int64_t) (expected[k] - lagMeanExpectedUm) * actualDeviation;
+            lagCovariance[k] += (product - lagCovariance[k]) / LAG_COVARIANCE_DIVISOR;
+        }
+
+        if (++lagSamples < LAG_MIN_SAMPLES)
+        {
+            continue;
+        }
+
+        // Peak of the cross-covariance; ties go to the shorter lag
+        int best = 0;
+        for (int k = 1; k <= MAX_LAG_BUCKETS; k++)
+        {
+            if (lagCovariance[k] > lagCovariance[best])
+            {
+                best = k;
+            }
+        }
+
+        // Only trust a peak that is a real correlation, not noise
+        int64_t spread = (int64_t) isqrt64((uint64_t) lagVarianceExpected) *
+                         (int64_t) isqrt64((uint64_t) lagVarianceActual);
+        bool correlated = lagCovariance[best] > 0 &&
+                          lagCovariance[best] * PERMILLE_ONE >= spread * LAG_MIN_CORRELATION_PERMILLE;
+        lagBuckets = correlated ? best : 0;
+    }
+}
+
+template <unsigned long BucketMs, unsigned long WindowMs>
+void FilamentMotionSensorT<BucketMs, WindowMs>::advanceWindow(unsigned long now)
+{
+    correlateLag(now);
+
+    if (now == windowNowMs)
+    {
+        return;
+    }
+
+    unsigned long oldCutoff = windowCutoff(windowNowMs);
+    unsigned long newCutoff = windowCutoff(now);
+
+    // Time went backwards or jumped a whole window: nothing incremental left
+    if (now < windowNowMs || (newCutoff - oldCutoff) >= WINDOW_SIZE_MS)
+    {
+        rebuildWindow(now);
+        return;
+    }
+
+    // Evict only the slots whose bucket start the cutoff just passed. At most
+    // one window's worth of slots, amortised one per bucket period.
+    for (unsigned long bucketStart = bucketStartFor(oldCutoff);
+         bucketStart < newCutoff; bucketStart += BUCKET_SIZE_MS)
+    {
+        int index = slotFor(bucketNumber(bucketStart));
+        if (bucketInWindow[index] && bucketTimestamps[index] < newCutoff)
+        {
+            evictBucket(index);
+        }
+    }
+    windowNowMs = now;
+}
+
+template <unsigned long BucketMs, unsigned long WindowMs>
+void FilamentMotionSensorT<BucketMs, WindowMs>::recordCheckpoint(unsigned long now)
+{
+    if (!initialized)
+    {
+        return;
+    }
+    if (checkpointSeq > 0 && (long)(now - nextCheckpointMs) < 0)
+    {
+        return;
+    }
+
+    // Cumulative totals only ever grow, so the distance between any two
+    // checkpoints is a plain subtraction and old ones never need updating
+    Checkpoint &cp = checkpoints[checkpointSeq % CHECKPOINT_SLOTS];
+    cp.timeMs        = now;
+    cp.expectedUm    = expectedTotalUm;
+    cp.actualUm      = totalSensorUm;
+    checkpointSeq++;
+    nextCheckpointMs = now + CHECKPOINT_PERIOD_MS;
+}
+
+template <unsigned long BucketMs, unsigned long WindowMs>
+void FilamentMotionSensorT<BucketMs, WindowMs>::recordEdge(int32_t umPerPulse, unsigned long edgeMs)
+{
+    // Edges drained in one batch without timestamps share a time; keep the
+    // last real period rather than recording a zero one. Late edges that
+    // arrive out of order are ignored for timing.
+    if (lastEdgeUm > 0)
+    {
+        long period = (long)(edgeMs - lastEdgeMs);
+        if (period <= 0)
+        {
+            return;
+        }
+        lastEdgePeriodMs = (unsigned long)period;
+    }
+    lastEdgeMs = edgeMs;
+    lastEdgeUm = umPerPulse;
+}
+
+template <unsigned long BucketMs, unsigned long WindowMs>
+void FilamentMotionSensorT<BucketMs, WindowMs>::updateExpectedPosition(float totalExtrusionMm)
+{
+    updateExpectedPositionUm(mmToUm(totalExtrusionMm));
+}
+
+template <unsigned long BucketMs, unsigned long WindowMs>
+void FilamentMotionSensorT<BucketMs, WindowMs>::updateExpectedPositionUm(int32_t totalExtrusionUm)
 {
     unsigned long now = millis();
+    advanceWindow(now);
+    recordCheckpoint(now);
 
     if (!initialized)
     {
         initialized           = true;
         lastExpectedUpdateMs  = now;
-        lastTotalExtrusionMm  = totalExtrusionMm;
-        sensorMmAtLastUpdate  = totalSensorMm;
+        lastChunkMs           = now;
+        chunkHead             = 0;
+        chunks[0].timeMs      = now;
+        chunks[0].expectedUm  = expectedTotalUm;
+        chunkCount            = 1;
+        lastTotalExtrusionUm  = totalExtrusionUm;
+        sensorUmAtLastUpdate  = totalSensorUm;
         
         // Handle pre-init pulses?
         // In the old code, we added them to the first sample.
@@ -87,199 +358,433 @@ void FilamentMotionSensor::updateExpectedPosition(float totalExtrusionMm)
         if (preInitPulseCount > 0)
         {
              firstPulseReceived = true;
-             // Add pre-init mm to totalSensorMm? It's already there (addSensorPulse adds to total).
+             // Add pre-init um to totalSensorUm? It's already there (addSensorPulse adds to total).
              // But we need to sync the snapshot.
-             sensorMmAtLastUpdate = totalSensorMm; // Baseline starts NOW.
+             sensorUmAtLastUpdate = totalSensorUm; // Baseline starts NOW.
         }
+        recordCheckpoint(now);
         return;
     }
 
-    // 1. Calculate Raw Deltas
-    float expectedDelta = totalExtrusionMm - lastTotalExtrusionMm;
-    float actualSinceLast = totalSensorMm - sensorMmAtLastUpdate;
+    // 1. Calculate Raw Deltas. A retraction becomes debt and the
+    // un-retract pays it off, so only new filament counts as expected.
+    int32_t expectedDelta   = totalExtrusionUm - lastTotalExtrusionUm;
+    int32_t actualSinceLast = totalSensorUm - sensorUmAtLastUpdate;
+    if (expectedDelta < 0)
+    {
+        retractDebtUm -= expectedDelta;
+        if (retractDebtUm > MAX_RETRACT_DEBT_UM) retractDebtUm = MAX_RETRACT_DEBT_UM;
+    }
+    else if (retractDebtUm > 0)
+    {
+        int32_t repaid = expectedDelta < retractDebtUm ? expectedDelta : retractDebtUm;
+        retractDebtUm -= repaid;
+        expectedDelta -= repaid;
+    }
     
     // 2. Calculate "Orphaned" Actuals
     // These are pulses that happened since the last update but are NO LONGER in the window.
-    // To find this, we sum the *current* window.
-    float winExpected, winActual;
-    sumWindow(winExpected, winActual);
+    // To find this, we use the running total of the *current* window.
+    int32_t winActual = windowActualUm;
     
     // If the window holds 20mm, but we moved 100mm since last update, 
     // then 80mm have fallen off the edge.
-    float orphanedActual = actualSinceLast - winActual;
-    if (orphanedActual < 0.0f) orphanedActual = 0.0f;
+    int32_t orphanedActual = actualSinceLast - winActual;
+    if (orphanedActual < 0) orphanedActual = 0;
     
     // 3. Adjust Expected Delta (Orphan Subtraction)
     // Reduce the spike by the amount of history we lost.
-    float adjustedDelta = expectedDelta - orphanedActual;
-    if (adjustedDelta < 0.0f) adjustedDelta = 0.0f;
+    int32_t adjustedDelta = expectedDelta - orphanedActual;
+    if (adjustedDelta < 0) adjustedDelta = 0;
 
     // 4. Record to Bucket
-    if (adjustedDelta > 0.001f) // Filter tiny noise
+    if (adjustedDelta > 1) // Filter tiny noise (~0.001mm)
     {
-        int index = getCurrentBucketIndex();
+        // The time the window was advanced to, so the bucket is admitted
+        int index = getBucketIndexFor(now);
         expectedBuckets[index] += adjustedDelta;
+        if (bucketInWindow[index])
+        {
+            windowExpectedUm += adjustedDelta;
+        }
+    }
+
+    // The distance window works on cumulative totals, so a late telemetry
+    // chunk simply lands next to the pulses it caused; no orphan handling
+    if (expectedDelta > 1)
+    {
+        expectedTotalUm += expectedDelta;
     }
 
-    // 5. Update Snapshots
-    lastTotalExtrusionMm = totalExtrusionMm;
-    sensorMmAtLastUpdate = totalSensorMm;
+    // 5. Rate for extrapolating until the next chunk. TotalExtrusion moves
+    // in 0.5-1s chunks with unchanged frames between them, and the chunk
+    // sizes jitter with when the printer sampled, so the rate spans at
+    // least EXTRAPOLATE_RATE_SPAN_MS of chunks and unchanged frames keep
+    // it; a retraction ends it. A chunk after EXTRAPOLATE_CHUNK_MAX_MS
+    // starts over: the gap was a stop, not flow.
+    if (expectedDelta > 1)
+    {
+        if (chunkCount > 0 && now - lastChunkMs >= EXTRAPOLATE_CHUNK_MAX_MS)
+        {
+            chunkCount                = 0;
+            extrapolationRateUmPerSec = 0;
+        }
+        chunkHead = (chunkHead + 1) % CHUNK_HISTORY;
+        chunks[chunkHead].timeMs     = now;
+        chunks[chunkHead].expectedUm = expectedTotalUm;
+        if (chunkCount < CHUNK_HISTORY) chunkCount++;
+        lastChunkMs = now;
+
+        // Newest chunk at least the rate span back, else the oldest kept
+        const Chunk *from = nullptr;
+        for (int i = 1; i < chunkCount; i++)
+        {
+            const Chunk &older = chunks[(chunkHead - i + CHUNK_HISTORY) % CHUNK_HISTORY];
+            if (now - older.timeMs >= EXTRAPOLATE_MIN_INTERVAL_MS) from = &older;
+            if (now - older.timeMs >= EXTRAPOLATE_RATE_SPAN_MS) break;
+        }
+        if (from != nullptr)
+        {
+            extrapolationRateUmPerSec =
+                (int32_t) ((int64_t) (expectedTotalUm - from->expectedUm) * 1000 / (now - from->timeMs));
+            extrapolationSpeedPct = printSpeedPct;
+        }
+    }
+    else if (expectedDelta < 0)
+    {
+        // A retraction: the printer is not extruding until the next chunk
+        extrapolationRateUmPerSec = 0;
+    }
+
+    // 6. Update Snapshots
+    lastTotalExtrusionUm = totalExtrusionUm;
+    sensorUmAtLastUpdate = totalSensorUm;
     lastExpectedUpdateMs = now;
 }
 
-void FilamentMotionSensor::addSensorPulse(float mmPerPulse)
+template <unsigned long BucketMs, unsigned long WindowMs>
+int32_t FilamentMotionSensorT<BucketMs, WindowMs>::getExtrapolatedExpectedUm(unsigned long now) const
 {
-    if (mmPerPulse <= 0.0f) return;
+    if (!initialized || extrapolationRateUmPerSec <= 0)
+    {
+        return 0;
+    }
+
+    // From EXTRAPOLATE_MAX_MS on the frame is not late, telemetry has
+    // stopped; from EXTRAPOLATE_CHUNK_MAX_MS on, extrusion has. Invented
+    // flow would outlive either and read as a jam.
+    long sinceFrame = (long) (now - lastExpectedUpdateMs);
+    long sinceChunk = (long) (now - lastChunkMs);
+    if (sinceChunk <= 0 || (unsigned long) sinceFrame >= EXTRAPOLATE_MAX_MS ||
+        (unsigned long) sinceChunk >= EXTRAPOLATE_CHUNK_MAX_MS)
+    {
+        return 0;
+    }
+
+    // A speed override changed since the rate was measured scales it
+    int64_t rate = extrapolationRateUmPerSec;
+    if (printSpeedPct > 0 && extrapolationSpeedPct > 0)
+    {
+        rate = rate * printSpeedPct / extrapolationSpeedPct;
+    }
+    return (int32_t) (rate * sinceChunk / 1000);
+}
+
+template <unsigned long BucketMs, unsigned long WindowMs>
+void FilamentMotionSensorT<BucketMs, WindowMs>::addSensorPulse(float mmPerPulse)
+{
+    addSensorPulseUm(mmToUm(mmPerPulse));
+}
+
+template <unsigned long BucketMs, unsigned long WindowMs>
+void FilamentMotionSensorT<BucketMs, WindowMs>::addSensorPulseUm(int32_t umPerPulse)
+{
+    if (umPerPulse <= 0) return;
 
     if (!initialized)
     {
-        preInitActualMm += mmPerPulse;
+        preInitActualUm += umPerPulse;
         preInitPulseCount++;
-        totalSensorMm += mmPerPulse; // Maintain global total
+        totalSensorUm += umPerPulse; // Maintain global total
         return;
     }
 
-    // Simply add to the current time bucket
-    int index = getCurrentBucketIndex();
-    actualBuckets[index] += mmPerPulse;
+    // Simply add to the current time bucket. One clock read: a bucket claimed
+    // past the time the window was advanced to would never be admitted.
+    unsigned long now = millis();
+    advanceWindow(now);
+    recordCheckpoint(now);
+    int index = getBucketIndexFor(now);
+    actualBuckets[index] += umPerPulse;
+    if (bucketInWindow[index])
+    {
+        windowActualUm += umPerPulse;
+    }
     
     // Maintain global monotonic counter
-    totalSensorMm += mmPerPulse;
-    lastSensorPulseMs = millis();
+    totalSensorUm += umPerPulse;
+    lastSensorPulseMs = now;
+    recordEdge(umPerPulse, lastSensorPulseMs);
     firstPulseReceived = true;
 }
 
-void FilamentMotionSensor::sumWindow(float &outExpected, float &outActual)
+template <unsigned long BucketMs, unsigned long WindowMs>
+void FilamentMotionSensorT<BucketMs, WindowMs>::addSensorPulseAt(float mmPerPulse, unsigned long pulseTimeMs)
 {
-    outExpected = 0.0f;
-    outActual   = 0.0f;
-    
+    addSensorPulseAtUm(mmToUm(mmPerPulse), pulseTimeMs);
+}
+
+template <unsigned long BucketMs, unsigned long WindowMs>
+void FilamentMotionSensorT<BucketMs, WindowMs>::addSensorPulseAtUm(int32_t umPerPulse, unsigned long pulseTimeMs)
+{
+    if (umPerPulse <= 0) return;
+
+    if (!initialized)
+    {
+        addSensorPulseUm(umPerPulse);
+        return;
+    }
+
+    // Edges are never attributed to the future
     unsigned long now = millis();
-    unsigned long cutoff = (now < WINDOW_SIZE_MS) ? 0 : (now - WINDOW_SIZE_MS);
-    
-    // Iterate all buckets
-    for (int i = 0; i < BUCKET_COUNT; i++)
+    advanceWindow(now);
+    recordCheckpoint(now);
+    if ((long)(now - pulseTimeMs) < 0)
     {
-        // Only include buckets that are strictly within the window
-        // (bucketTimestamp >= cutoff)
-        if (bucketTimestamps[i] >= cutoff && bucketTimestamps[i] <= now)
+        pulseTimeMs = now;
+    }
+
+    // Edges older than the window still count toward the monotonic total (so
+    // orphan subtraction sees them) but no longer belong to any bucket.
+    if (now - pulseTimeMs < WINDOW_SIZE_MS)
+    {
+        int index = getBucketIndexFor(pulseTimeMs);
+        if (index >= 0)
         {
-            outExpected += expectedBuckets[i];
-            outActual   += actualBuckets[i];
+            actualBuckets[index] += umPerPulse;
+            if (bucketInWindow[index])
+            {
+                windowActualUm += umPerPulse;
+            }
         }
     }
+
+    totalSensorUm += umPerPulse;
+    recordEdge(umPerPulse, pulseTimeMs);
+    if (!firstPulseReceived || (long)(pulseTimeMs - lastSensorPulseMs) > 0)
+    {
+        lastSensorPulseMs = pulseTimeMs;
+    }
+    firstPulseReceived = true;
 }
 
-float FilamentMotionSensor::getDeficit()
+template <unsigned long BucketMs, unsigned long WindowMs>
+WindowSnapshot FilamentMotionSensorT<BucketMs, WindowMs>::getWindowSnapshot(unsigned long now)
 {
-    if (!initialized) return 0.0f;
-    
-    float exp, act;
-    sumWindow(exp, act);
-    
-    float deficit = exp - act;
-    return (deficit > 0.0f) ? deficit : 0.0f;
+    return (windowMode == WindowMode::DISTANCE) ? getDistanceWindowSnapshot(now)
+                                                : getTimeWindowSnapshot(now);
 }
 
-float FilamentMotionSensor::getExpectedDistance()
+template <unsigned long BucketMs, unsigned long WindowMs>
+WindowSnapshot FilamentMotionSensorT<BucketMs, WindowMs>::getTimeWindowSnapshot(unsigned long now)
 {
-    if (!initialized) return 0.0f;
-    float exp, act;
-    sumWindow(exp, act);
-    return exp;
+    WindowSnapshot snap = {0, 0, 0, 0, 0, 0};
+    if (!initialized) return snap;
+
+    advanceWindow(now);
+
+    // Shift by the measured lag: expected drops its newest buckets, actual
+    // its oldest, so both cover the same filament over a shorter span.
+    // Unshifted, the newest bucket gets the extrapolated expected instead.
+    int32_t expectedUm     = windowExpectedUm + (lagBuckets == 0 ? getExtrapolatedExpectedUm(now) : 0);
+    int32_t actualUm       = windowActualUm;
+    int     bucketsCovered = windowBucketCount - lagBuckets;
+    if (lagBuckets > 0)
+    {
+        unsigned long newest = bucketNumber(now);
+        unsigned long oldest = bucketNumber(windowCutoff(now) + BucketMs - 1);
+        for (int k = 0; k < lagBuckets; k++)
+        {
+            expectedUm -= bucketExpectedUm(newest - k);
+            actualUm   -= bucketActualUm(oldest + k);
+        }
+    }
+
+    // Rates are taken over the time actually covered by live buckets, so a
+    // window that is still filling up does not under-report. Duration is a
+    // whole number of buckets, so the rate needs no per-query timestamps.
+    if (bucketsCovered < 1) bucketsCovered = 1;
+    int32_t deficit = expectedUm - actualUm;
+
+    snap.expectedUm           = expectedUm;
+    snap.actualUm             = actualUm;
+    snap.deficitUm            = (deficit > 0) ? deficit : 0;
+    snap.expectedRateUmPerSec = ratePerSecond(expectedUm, bucketsCovered);
+    snap.actualRateUmPerSec   = ratePerSecond(actualUm, bucketsCovered);
+    snap.validDurationMs      = (unsigned long)bucketsCovered * BUCKET_SIZE_MS;
+    return snap;
 }
 
-float FilamentMotionSensor::getSensorDistance()
+template <unsigned long BucketMs, unsigned long WindowMs>
+WindowSnapshot FilamentMotionSensorT<BucketMs, WindowMs>::getShortWindowSnapshot(unsigned long now)
 {
-    if (!initialized) return 0.0f;
-    float exp, act;
-    sumWindow(exp, act);
-    return act;
+    WindowSnapshot snap = {0, 0, 0, 0, 0, 0};
+    if (!initialized) return snap;
+
+    advanceWindow(now);
+
+    // Only the newest few slots, so summing them is as cheap as keeping a
+    // second set of running totals. A slot holding an older lap or an
+    // unclaimed bucket simply contributes nothing: no data is zero flow.
+    // Expected is read lagBuckets further back, as in the long window.
+    int32_t       expectedUm = (lagBuckets == 0) ? getExtrapolatedExpectedUm(now) : 0;
+    int32_t       actualUm   = 0;
+    unsigned long newest     = bucketNumber(now);
+    for (int i = 0; i < SHORT_BUCKET_COUNT && (unsigned long) i <= newest; i++)
+    {
+        actualUm += bucketActualUm(newest - i);
+        if ((unsigned long) (i + lagBuckets) <= newest)
+        {
+            expectedUm += bucketExpectedUm(newest - i - lagBuckets);
+        }
+    }
+
+    int32_t deficit           = expectedUm - actualUm;
+    snap.expectedUm           = expectedUm;
+    snap.actualUm             = actualUm;
+    snap.deficitUm            = (deficit > 0) ? deficit : 0;
+    snap.expectedRateUmPerSec = ratePerSecond(expectedUm, SHORT_BUCKET_COUNT);
+    snap.actualRateUmPerSec   = ratePerSecond(actualUm, SHORT_BUCKET_COUNT);
+    snap.validDurationMs      = SHORT_WINDOW_MS;
+    return snap;
 }
 
-void FilamentMotionSensor::getWindowedRates(float &expectedRate, float &actualRate)
+template <unsigned long BucketMs, unsigned long WindowMs>
+WindowSnapshot FilamentMotionSensorT<BucketMs, WindowMs>::getDistanceWindowSnapshot(unsigned long now)
 {
-    expectedRate = 0.0f;
-    actualRate   = 0.0f;
-    
-    if (!initialized) return;
+    WindowSnapshot snap = getTimeWindowSnapshot(now);
+    if (!initialized) return snap;
 
-    float expSum, actSum;
-    sumWindow(expSum, actSum);
-    
-    // In the decoupled model, we calculate rate over the full window size
-    // OR the valid duration.
-    // For simplicity and stability, we assume the window is filling up or full.
-    // We divide by WINDOW_SIZE_MS if full?
-    // Better: We track how much time is actually covered by the valid buckets.
-    
-        static const unsigned long MIN_VALID_DURATION_MS = 250;
-    
-        unsigned long now = millis();
-    
-        unsigned long cutoff;
-    
-        if (now < WINDOW_SIZE_MS) {
-    
-            cutoff = 0; // Prevent unsigned long underflow
-    
-        } else {
-    
-            cutoff = now - WINDOW_SIZE_MS;
-    
+    recordCheckpoint(now);
+
+    // Slide the start forward to the newest checkpoint that still leaves
+    // DISTANCE_WINDOW_UM of expected extrusion and DISTANCE_MIN_SPAN_MS behind
+    // now. Both only grow, so a checkpoint that qualifies keeps qualifying
+    // and the start never moves back: amortised one step per checkpoint.
+    unsigned long slots     = (unsigned long)CHECKPOINT_SLOTS;
+    unsigned long oldestSeq = (checkpointSeq > slots) ? checkpointSeq - slots : 0;
+    if (windowStartSeq < oldestSeq)
+    {
+        windowStartSeq = oldestSeq;
+    }
+    while (windowStartSeq + 1 < checkpointSeq)
+    {
+        const Checkpoint &next = checkpoints[(windowStartSeq + 1) % CHECKPOINT_SLOTS];
+        if ((long)(now - next.timeMs) < (long)DISTANCE_MIN_SPAN_MS ||
+            expectedTotalUm - next.expectedUm < DISTANCE_WINDOW_UM)
+        {
+            break;
         }
-    
-    
-    
-        unsigned long validDuration = 0;
-    
-        
-    
-        for (int i = 0; i < BUCKET_COUNT; i++)
-    
+        windowStartSeq++;
+    }
+
+    // Until enough history exists this is simply everything retained
+    const Checkpoint &start = checkpoints[windowStartSeq % CHECKPOINT_SLOTS];
+    int32_t expectedUm = expectedTotalUm - start.expectedUm;
+    int32_t actualUm   = totalSensorUm - start.actualUm;
+    int32_t deficit    = expectedUm - actualUm;
+
+    snap.expectedUm      = expectedUm;
+    snap.actualUm        = actualUm;
+    snap.deficitUm       = (deficit > 0) ? deficit : 0;
+    snap.validDurationMs = now - start.timeMs;
+    return snap;
+}
+
+template <unsigned long BucketMs, unsigned long WindowMs>
+int32_t FilamentMotionSensorT<BucketMs, WindowMs>::getEdgeVelocityUmPerSec(unsigned long now)
+{
+    if (!initialized || !edgeTimestamps || lastEdgeUm <= 0) return -1;
+
+    long sinceEdge = (long)(now - lastEdgeMs);
+    if (sinceEdge < 0) sinceEdge = 0;
+
+    // Stall: the commanded rate should have produced several edges by now
+    int32_t expectedRate = getShortWindowSnapshot(now).expectedRateUmPerSec;
+    if (expectedRate > 0)
+    {
+        int64_t expectedPeriodMs = (int64_t)lastEdgeUm * 1000 / expectedRate;
+        if ((int64_t)sinceEdge > expectedPeriodMs * (int64_t)EDGE_STALL_PERIODS)
         {
-    
-            if (bucketTimestamps[i] >= cutoff && bucketTimestamps[i] <= now)
-    
-            {
-    
-                validDuration += BUCKET_SIZE_MS;
-    
-            }
-    
+            return 0;
         }
-    
-        
-    
-        // If we have very little data (e.g. just started), prevent division by zero
-    
-        if (validDuration < MIN_VALID_DURATION_MS) validDuration = MIN_VALID_DURATION_MS;  
-    
-    float durationSec = validDuration / 1000.0f;
-    expectedRate = expSum / durationSec;
-    actualRate   = actSum / durationSec;
+    }
+
+    if (lastEdgePeriodMs == 0) return -1;
+
+    // Once the next edge is overdue, velocity is at most one pulse over the
+    // time since the newest edge; until then the last period is the estimate
+    unsigned long periodMs = lastEdgePeriodMs;
+    if ((unsigned long)sinceEdge > periodMs)
+    {
+        periodMs = (unsigned long)sinceEdge;
+    }
+    return (int32_t)((int64_t)lastEdgeUm * 1000 / (int64_t)periodMs);
+}
+
+template <unsigned long BucketMs, unsigned long WindowMs>
+float FilamentMotionSensorT<BucketMs, WindowMs>::getDeficit()
+{
+    return umToMm(getWindowSnapshot(millis()).deficitUm);
+}
+
+template <unsigned long BucketMs, unsigned long WindowMs>
+float FilamentMotionSensorT<BucketMs, WindowMs>::getExpectedDistance()
+{
+    return umToMm(getWindowSnapshot(millis()).expectedUm);
 }
 
-bool FilamentMotionSensor::isInitialized() const
+template <unsigned long BucketMs, unsigned long WindowMs>
+float FilamentMotionSensorT<BucketMs, WindowMs>::getSensorDistance()
+{
+    return umToMm(getWindowSnapshot(millis()).actualUm);
+}
+
+template <unsigned long BucketMs, unsigned long WindowMs>
+void FilamentMotionSensorT<BucketMs, WindowMs>::getWindowedRates(float &expectedRate, float &actualRate)
+{
+    WindowSnapshot snap = getWindowSnapshot(millis());
+    expectedRate = umToMm(snap.expectedRateUmPerSec);
+    actualRate   = umToMm(snap.actualRateUmPerSec);
+}
+
+template <unsigned long BucketMs, unsigned long WindowMs>
+bool FilamentMotionSensorT<BucketMs, WindowMs>::isInitialized() const
 {
     return initialized;
 }
 
-bool FilamentMotionSensor::isWithinGracePeriod(unsigned long gracePeriodMs) const
+template <unsigned long BucketMs, unsigned long WindowMs>
+bool FilamentMotionSensorT<BucketMs, WindowMs>::isWithinGracePeriod(unsigned long gracePeriodMs) const
 {
     if (!initialized || gracePeriodMs == 0) return false;
     unsigned long now = millis();
     return (now - lastExpectedUpdateMs) < gracePeriodMs;
 }
 
-float FilamentMotionSensor::getFlowRatio()
+template <unsigned long BucketMs, unsigned long WindowMs>
+float FilamentMotionSensorT<BucketMs, WindowMs>::getFlowRatio()
 {
     if (!initialized) return 0.0f;
-    float exp = getExpectedDistance();
-    if (exp <= 0.001f) return 0.0f;
+    WindowSnapshot snap = getWindowSnapshot(millis());
+    if (snap.expectedUm <= 1) return 0.0f;
     
-    float ratio = getSensorDistance() / exp;
+    float ratio = (float)snap.actualUm / (float)snap.expectedUm;
     if (ratio > 1.5f) ratio = 1.5f;
     if (ratio < 0.0f) ratio = 0.0f;
     return ratio;
-}
\ No newline at end of file
+}
+
+// Firmware geometry (other instantiations are only used by host tests, which
+// compile this file directly)
+template class FilamentMotionSensorT<FMS_BUCKET_MS, FMS_WINDOW_MS>;
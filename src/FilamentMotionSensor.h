@@ -3,6 +3,71 @@
 
 #include <Arduino.h>
 
+#include "FlowUnits.h"
+
+// Window geometry. Board profiles in platformio.ini override these; the
+// defaults are the historical 250ms x 20 bucket window.
+#ifndef FMS_BUCKET_MS
+#define FMS_BUCKET_MS 250
+#endif
+#ifndef FMS_WINDOW_MS
+#define FMS_WINDOW_MS 5000
+#endif
+// Short window for hard jams, rounded to whole buckets of the same ring.
+// Longer than the ~1s cadence of SDCP extrusion totals so it always holds one.
+#ifndef FMS_SHORT_WINDOW_MS
+#define FMS_SHORT_WINDOW_MS 1500
+#endif
+// Edge velocity stalls after this many expected pulse periods without an edge
+#ifndef FMS_EDGE_STALL_PERIODS
+#define FMS_EDGE_STALL_PERIODS 2
+#endif
+// Longest planner-to-extruder lag the time windows compensate for
+#ifndef FMS_MAX_LAG_MS
+#define FMS_MAX_LAG_MS 2000
+#endif
+// Expected extrusion is extrapolated for less than this long past the last
+// telemetry frame; after that telemetry counts as stopped, not late
+#ifndef FMS_EXTRAPOLATE_MAX_MS
+#define FMS_EXTRAPOLATE_MAX_MS 1000
+#endif
+// ... and for less than this long past the last frame that advanced
+// TotalExtrusion. It moves in 0.5-1s chunks, so unchanged frames in between
+// are normal; this long without a chunk means extrusion stopped.
+#ifndef FMS_EXTRAPOLATE_CHUNK_MAX_MS
+#define FMS_EXTRAPOLATE_CHUNK_MAX_MS 2000
+#endif
+// Most retracted filament the expected series holds back for the un-retract
+// (one retraction; anything further back is an unload, not a retraction)
+#ifndef FMS_MAX_RETRACT_DEBT_MM
+#define FMS_MAX_RETRACT_DEBT_MM 15
+#endif
+// Distance-domain window: last N mm of expected extrusion
+#ifndef FMS_DISTANCE_WINDOW_MM
+#define FMS_DISTANCE_WINDOW_MM 20
+#endif
+
+// How the pass ratio window is bounded
+enum class WindowMode : uint8_t
+{
+    TIME     = 0,  // Last WindowMs of time
+    DISTANCE = 1   // Last FMS_DISTANCE_WINDOW_MM of expected extrusion
+};
+
+/**
+ * Everything the jam pipeline needs from the sliding window, taken at one
+ * instant so the figures are mutually consistent.
+ */
+struct WindowSnapshot
+{
+    int32_t       expectedUm;            // Expected extrusion within window
+    int32_t       actualUm;              // Sensor-measured extrusion within window
+    int32_t       deficitUm;             // max(expected - actual, 0)
+    int32_t       expectedRateUmPerSec;  // expectedUm / validDuration
+    int32_t       actualRateUmPerSec;    // actualUm / validDuration
+    unsigned long validDurationMs;       // Time covered by the window (>= one bucket)
+};
+
 /**
  * FilamentMotionSensor - Decoupled Dual-Buffer Implementation
  * 
@@ -10,41 +75,214 @@
  * data in independent time-series buffers. This allows the sliding window
  * to absorb the variable delay between planning and execution without
  * artifacting/coupling errors.
+ *
+ * In DISTANCE mode the ratio window is instead the most recent stretch that
+ * holds FMS_DISTANCE_WINDOW_MM of expected extrusion, so slow perimeters and
+ * ironing see as many pulses per window as fast infill. It is built from
+ * periodic checkpoints of the cumulative totals and spans at least
+ * DISTANCE_MIN_SPAN_MS (telemetry arrives in chunks ahead of the sensor) and
+ * at most the checkpoint history.
+ *
+ * A short window (the newest SHORT_BUCKET_COUNT buckets of the same ring)
+ * is exposed alongside the long one, so a complete blockage shows up after
+ * about FMS_SHORT_WINDOW_MS instead of after most of the long window drains.
+ *
+ * The lag between a telemetry chunk and the pulses it causes is measured
+ * rather than assumed: each settled bucket updates a running cross-
+ * covariance of actual against expected at 0..MAX_LAG_BUCKETS of delay, and
+ * its peak is the lag once the correlation there is clearly real (rho >=
+ * 0.5), so uncorrelated noise leaves the windows unshifted. The time windows then compare expected extrusion
+ * that many buckets older with the newest actual, so both sides describe
+ * the same filament.
+ *
+ * Between TotalExtrusion chunks the expected series would otherwise sit
+ * flat while pulses keep landing. The time windows add a provisional amount
+ * extrapolated from the rate over at least the last second of chunks,
+ * scaled by any PrintSpeedPct change since. Frames that report no new
+ * extrusion keep it going (the printer reports in ~1s chunks, polled
+ * faster); a retraction, FMS_EXTRAPOLATE_MAX_MS without a frame (telemetry
+ * stopped) or FMS_EXTRAPOLATE_CHUNK_MAX_MS without a chunk (extrusion
+ * stopped) ends it. It never enters the buckets: the next chunk replaces
+ * it with the real delta, so the totals stay exact. When the windows are lag-shifted the
+ * newest expected bucket is not compared anyway, and nothing is added.
+ *
+ * A retraction lowers TotalExtrusion, and the un-retract raises it again
+ * without new filament reaching the sensor. The amount retracted is kept
+ * as a debt that forward moves pay off first, so only extrusion past the
+ * pre-retraction position is expected (up to FMS_MAX_RETRACT_DEBT_MM).
+ *
+ * Alongside the counts, the period between consecutive edges gives an
+ * instantaneous velocity that does not need the window to fill. With ~3mm
+ * per pulse this is the only usable flow signal at 1mm/s.
+ *
+ * BucketMs / WindowMs fix the window geometry at compile time. When BucketMs
+ * and the bucket count are powers of two, bucket and slot math reduce to
+ * shifts and masks; other geometries use division by a constant. RAM grows
+ * with WindowMs / BucketMs (see sizeof()).
  */
-class FilamentMotionSensor
+template <unsigned long BucketMs, unsigned long WindowMs>
+class FilamentMotionSensorT
 {
    public:
-    FilamentMotionSensor();
+    static const unsigned long BUCKET_SIZE_MS = BucketMs;
+    static const unsigned long WINDOW_SIZE_MS = WindowMs;
+    static const int           BUCKET_COUNT   = (int) (WindowMs / BucketMs);
+
+    static_assert(BucketMs > 0 && WindowMs % BucketMs == 0,
+                  "Window must be a whole number of buckets");
+    static_assert(WindowMs / BucketMs >= 2, "Window needs at least two buckets");
+
+    // Short window (hard jams), newest buckets of the same ring
+    static const int           SHORT_BUCKET_COUNT = (int) ((FMS_SHORT_WINDOW_MS + BucketMs / 2) / BucketMs);
+    static const unsigned long SHORT_WINDOW_MS    = SHORT_BUCKET_COUNT * BucketMs;
+    static_assert(SHORT_BUCKET_COUNT >= 1, "Short window needs at least one bucket");
+    static_assert(SHORT_BUCKET_COUNT < BUCKET_COUNT, "Short window must be shorter than the window");
+
+    // Distance-domain window
+    static const int32_t       DISTANCE_WINDOW_UM   = FMS_DISTANCE_WINDOW_MM * FlowUnits::UM_PER_MM;
+    static const unsigned long DISTANCE_MIN_SPAN_MS = 3000;   // Covers SDCP reporting lag
+    static const unsigned long CHECKPOINT_PERIOD_MS = 1000;
+    static const int           CHECKPOINT_SLOTS     = 64;     // 64s of history
+
+    // Edge velocity
+    static const unsigned long EDGE_STALL_PERIODS   = FMS_EDGE_STALL_PERIODS;
+
+    // Lag estimation. Bounded so the shifted short window and the oldest
+    // correlated bucket both stay inside the ring.
+    static const int           LAG_SETTLE_BUCKETS   = 1;      // Late edges land before a bucket is correlated
+    static const int           MAX_LAG_BUCKETS      =
+        ((int) (FMS_MAX_LAG_MS / BucketMs) < BUCKET_COUNT - SHORT_BUCKET_COUNT - 1)
+            ? (int) (FMS_MAX_LAG_MS / BucketMs)
+            : BUCKET_COUNT - SHORT_BUCKET_COUNT - 1;
+    static const unsigned long LAG_MIN_SAMPLES      = 40;     // Active buckets before the estimate is used
+    static const int           LAG_MIN_CORRELATION_PERMILLE = 500;
+    static_assert(LAG_SETTLE_BUCKETS <= SHORT_BUCKET_COUNT, "Correlated buckets must stay inside the ring");
+
+    // Extrapolation between telemetry frames
+    static const unsigned long EXTRAPOLATE_MAX_MS          = FMS_EXTRAPOLATE_MAX_MS;
+    static const unsigned long EXTRAPOLATE_CHUNK_MAX_MS    = FMS_EXTRAPOLATE_CHUNK_MAX_MS;
+    static const unsigned long EXTRAPOLATE_MIN_INTERVAL_MS = 100;   // Shortest span a rate is taken over
+    static const unsigned long EXTRAPOLATE_RATE_SPAN_MS    = 1000;  // Rate spans at least this much chunk history
+    static const int           CHUNK_HISTORY               = 8;
+
+    // Retraction accounting
+    static const int32_t       MAX_RETRACT_DEBT_UM = FMS_MAX_RETRACT_DEBT_MM * FlowUnits::UM_PER_MM;
+
+    FilamentMotionSensorT();
 
     void reset();
 
-    // Telemetry Update
+    // Mode used by getWindowSnapshot() and the float getters. Both windows
+    // are always maintained, so switching takes effect immediately.
+    void       setWindowMode(WindowMode mode) { windowMode = mode; }
+    WindowMode getWindowMode() const { return windowMode; }
+
+    // Telemetry Update (integer micrometres; float overload converts)
+    void updateExpectedPositionUm(int32_t totalExtrusionUm);
     void updateExpectedPosition(float totalExtrusionMm);
+    // Printer speed override (percent) as last reported; 0 = unknown
+    void setPrintSpeedPct(int pct) { printSpeedPct = pct; }
+    // Expected extrusion extrapolated since the last TotalExtrusion chunk (um)
+    int32_t getExtrapolatedExpectedUm(unsigned long now) const;
 
     // Pulse Update
+    void addSensorPulseUm(int32_t umPerPulse);
     void addSensorPulse(float mmPerPulse);
+    // Pulse captured at a known edge time (ms). Lands in the bucket it actually
+    // happened in; edges older than the window only count toward the total.
+    void addSensorPulseAtUm(int32_t umPerPulse, unsigned long pulseTimeMs);
+    void addSensorPulseAt(float mmPerPulse, unsigned long pulseTimeMs);
 
     // Analysis
+    // Single O(1) query for all window figures at a caller-supplied time.
+    // Time must not go backwards between calls or the window is rebuilt.
+    WindowSnapshot getWindowSnapshot(unsigned long now);
+    WindowSnapshot getTimeWindowSnapshot(unsigned long now);
+    // Newest SHORT_BUCKET_COUNT buckets; rates are over the full short span
+    WindowSnapshot getShortWindowSnapshot(unsigned long now);
+    // Distances cover the distance window; rates still describe the time
+    // window so callers can tell whether extrusion is happening right now.
+    WindowSnapshot getDistanceWindowSnapshot(unsigned long now);
+
+    /**
+     * Velocity from the period between the last two edges, capped by the
+     * time since the newest edge so it decays as soon as edges stop.
+     * Returns 0 (stalled) once no edge has arrived for EDGE_STALL_PERIODS
+     * expected pulse periods at the short-window commanded rate, and -1
+     * while there is no estimate yet (fewer than two edge times) or the
+     * pulse source has no edge timestamps.
+     */
+    int32_t getEdgeVelocityUmPerSec(unsigned long now);
+
+    // Pulses carry their real edge times (false: they are stamped when the
+    // count is read, and edge velocity would only measure the loop)
+    void setEdgeTimestamps(bool available) { edgeTimestamps = available; }
+
+    /**
+     * Measured planner-to-extruder lag the time windows are shifted by (ms,
+     * a whole number of buckets). 0 until enough flow has been correlated.
+     * Survives reset(): it belongs to the printer, not the print.
+     */
+    unsigned long getLagMs() const { return (unsigned long) lagBuckets * BucketMs; }
+
+    // Float (mm, mm/s) views for UI and legacy callers
     float getDeficit();
     float getExpectedDistance();
     float getSensorDistance();
     void getWindowedRates(float &expectedRate, float &actualRate);
 
+    // Retracted filament not yet re-advanced (um)
+    int32_t getRetractDebtUm() const { return retractDebtUm; }
+
     // State Queries
     bool isInitialized() const;
     bool isWithinGracePeriod(unsigned long gracePeriodMs) const;
     float getFlowRatio();
 
    private:
-    // Tracking Constants
-    static const int           BUCKET_SIZE_MS = 250;
-    static const int           WINDOW_SIZE_MS = 5000;
-    static const int           BUCKET_COUNT   = WINDOW_SIZE_MS / BUCKET_SIZE_MS; // 20
-
-    // Independent Circular Buffers
-    float         expectedBuckets[BUCKET_COUNT];
-    float         actualBuckets[BUCKET_COUNT];
+    // Geometry helpers (folded at compile time)
+    static constexpr bool isPowerOfTwo(unsigned long v) { return v != 0 && (v & (v - 1)) == 0; }
+    static constexpr unsigned log2Floor(unsigned long v) { return v <= 1 ? 0 : 1 + log2Floor(v >> 1); }
+
+    static const bool          BUCKET_IS_POW2 = isPowerOfTwo(BucketMs);
+    static const bool          COUNT_IS_POW2  = isPowerOfTwo(WindowMs / BucketMs);
+    static const unsigned      BUCKET_SHIFT   = log2Floor(BucketMs);
+    static const unsigned long UNUSED_BUCKET  = ~0UL;  // Slot never written since reset
+
+    static unsigned long bucketNumber(unsigned long timeMs)
+    {
+        return BUCKET_IS_POW2 ? (timeMs >> BUCKET_SHIFT) : (timeMs / BucketMs);
+    }
+    static unsigned long bucketStartFor(unsigned long timeMs)
+    {
+        return BUCKET_IS_POW2 ? (timeMs & ~(BucketMs - 1)) : (timeMs / BucketMs) * BucketMs;
+    }
+    static int slotFor(unsigned long bucketNum)
+    {
+        return (int) (COUNT_IS_POW2 ? (bucketNum & (unsigned long) (BUCKET_COUNT - 1))
+                                    : (bucketNum % (unsigned long) BUCKET_COUNT));
+    }
+    // um over a whole number of buckets -> um/s
+    static int32_t ratePerSecond(int32_t um, int buckets)
+    {
+        if (1000 % BucketMs == 0)
+        {
+            return um * (int32_t) (1000 / BucketMs) / buckets;
+        }
+        return (int32_t) ((int64_t) um * 1000 / ((int64_t) buckets * BucketMs));
+    }
+
+    // Independent Circular Buffers (micrometres)
+    int32_t       expectedBuckets[BUCKET_COUNT];
+    int32_t       actualBuckets[BUCKET_COUNT];
     unsigned long bucketTimestamps[BUCKET_COUNT]; // For stale data clearing
+    bool          bucketInWindow[BUCKET_COUNT];   // Bucket is included in running totals
+
+    // Running window totals (kept in sync on bucket write and eviction)
+    int32_t       windowExpectedUm;
+    int32_t       windowActualUm;
+    int           windowBucketCount;
+    unsigned long windowNowMs;            // Time the running totals are valid for
 
     // State
     bool          initialized;
@@ -53,18 +291,81 @@ class FilamentMotionSensor
 
     // Pulse Tracking (Global/Monotonic for Dropout Recovery)
     unsigned long lastSensorPulseMs;
-    float         totalSensorMm;          // Monotonic total of all pulses since reset
-    float         sensorMmAtLastUpdate;   // Snapshot of totalSensorMm at last telemetry update
+    int32_t       totalSensorUm;          // Monotonic total of all pulses since reset
+    int32_t       sensorUmAtLastUpdate;   // Snapshot of totalSensorUm at last telemetry update
 
     // Telemetry Tracking
-    float         lastTotalExtrusionMm;   // Last known absolute extrusion from SDCP
-    float         preInitActualMm;        // Buffer pulses before init
+    int32_t       lastTotalExtrusionUm;   // Last known absolute extrusion from SDCP
+    int32_t       retractDebtUm;          // Retracted filament the next forward moves re-advance
+    int32_t       extrapolationRateUmPerSec;  // Rate over the recent chunks (0 = none)
+    int           extrapolationSpeedPct;  // PrintSpeedPct that rate was measured at
+    unsigned long lastChunkMs;            // Last frame that advanced TotalExtrusion
+
+    // Recent chunks (cumulative expectedTotalUm) the extrapolation rate spans
+    struct Chunk
+    {
+        unsigned long timeMs;
+        int32_t       expectedUm;
+    };
+    Chunk         chunks[CHUNK_HISTORY];
+    int           chunkHead;              // Newest chunk
+    int           chunkCount;
+    int           printSpeedPct;
+    int32_t       preInitActualUm;        // Buffer pulses before init
     unsigned long preInitPulseCount;
 
+    // Edge period tracking
+    unsigned long lastEdgeMs;
+    unsigned long lastEdgePeriodMs;       // 0 until two distinct edge times
+    int32_t       lastEdgeUm;             // Distance of the newest edge (0 = none)
+    bool          edgeTimestamps;         // See setEdgeTimestamps(); kept across reset()
+
+    // Distance-domain window (cumulative checkpoints)
+    struct Checkpoint
+    {
+        unsigned long timeMs;
+        int32_t       expectedUm;
+        int32_t       actualUm;
+    };
+    WindowMode    windowMode;
+    int32_t       expectedTotalUm;        // Monotonic sum of forward expected deltas
+    Checkpoint    checkpoints[CHECKPOINT_SLOTS];
+    unsigned long checkpointSeq;          // Checkpoints written since reset
+    unsigned long windowStartSeq;         // Checkpoint the distance window starts at
+    unsigned long nextCheckpointMs;
+
+    // Lag estimation (EWMA bucket means and cross-covariance, um and um^2)
+    int32_t       lagMeanExpectedUm;
+    int32_t       lagMeanActualUm;
+    int64_t       lagVarianceExpected;
+    int64_t       lagVarianceActual;
+    int64_t       lagCovariance[MAX_LAG_BUCKETS + 1];
+    unsigned long lagNextBucket;          // Next bucket number to correlate
+    unsigned long lagSamples;             // Active buckets correlated so far
+    int           lagBuckets;             // Current estimate
+
     // Helpers
-    int           getCurrentBucketIndex();
-    void          sumWindow(float &outExpected, float &outActual);
-    void          clearStaleBuckets(unsigned long currentTime);
+    int           getBucketIndexFor(unsigned long timeMs);
+    // Oldest bucket start still inside (now - WINDOW_SIZE_MS, now]. Half-open so
+    // a full window is exactly BUCKET_COUNT buckets and a slot being recycled
+    // for the current bucket is never counted twice.
+    static unsigned long windowCutoff(unsigned long now)
+    {
+        return (now < WINDOW_SIZE_MS) ? 0 : (now - WINDOW_SIZE_MS + 1);  // Prevent underflow
+    }
+    void          advanceWindow(unsigned long now);
+    void          rebuildWindow(unsigned long now);
+    void          evictBucket(int index);
+    void          admitBucket(int index);
+    void          recordCheckpoint(unsigned long now);
+    void          recordEdge(int32_t umPerPulse, unsigned long edgeMs);
+    void          correlateLag(unsigned long now);
+    int32_t       bucketExpectedUm(unsigned long bucketNum) const;
+    int32_t       bucketActualUm(unsigned long bucketNum) const;
 };
 
-#endif  // FILAMENT_MOTION_SENSOR_H
\ No newline at end of file
+// Geometry used by the firmware. Member definitions live in
+// FilamentMotionSensor.cpp, which explicitly instantiates this one.
+typedef FilamentMotionSensorT<FMS_BUCKET_MS, FMS_WINDOW_MS> FilamentMotionSensor;
+
+#endif  // FILAMENT_MOTION_SENSOR_H
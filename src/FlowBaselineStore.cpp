@@ -0,0 +1,119 @@
+#include "FlowBaselineStore.h"
+
+#include <ArduinoJson.h>
+#include <LittleFS.h>
+
+#include "Logger.h"
+#include "SDCPStatusParser.h"
+
+namespace
+{
+    constexpr const char kBaselinePath[] = "/flow_baselines.json";
+
+    // {"entries":[{"file","mean","sigma","samples"} x MAX_ENTRIES]}, each
+    // filename up to SDCP_FILENAME_MAX bytes with its terminator, plus the
+    // key names when a read copies them
+    constexpr size_t BASELINE_JSON_CAPACITY =
+        JSON_OBJECT_SIZE(1) + JSON_ARRAY_SIZE(FlowBaselineStore::MAX_ENTRIES) +
+        FlowBaselineStore::MAX_ENTRIES * (JSON_OBJECT_SIZE(4) + SDCP_FILENAME_MAX) +
+        sizeof("entries") + sizeof("file") + sizeof("mean") + sizeof("sigma") +
+        sizeof("samples");
+}
+
+bool FlowBaselineStore::load(const String& key, FlowBaseline& baseline)
+{
+    if (key.length() == 0)
+    {
+        return false;
+    }
+
+    File file = LittleFS.open(kBaselinePath, "r");
+    if (!file)
+    {
+        return false;
+    }
+
+    DynamicJsonDocument doc(BASELINE_JSON_CAPACITY);
+    DeserializationError error = deserializeJson(doc, file);
+    file.close();
+    if (error)
+    {
+        logger.log("Flow baseline file unreadable, ignoring it");
+        return false;
+    }
+
+    for (JsonObjectConst entry : doc["entries"].as<JsonArrayConst>())
+    {
+        if (key == entry["file"].as<const char*>())
+        {
+            baseline.meanPermille  = entry["mean"] | 0;
+            baseline.sigmaPermille = entry["sigma"] | 0;
+            baseline.samples       = entry["samples"] | 0;
+            return baseline.samples > 0;
+        }
+    }
+    return false;
+}
+
+bool FlowBaselineStore::save(const String& key, const FlowBaseline& baseline)
+{
+    if (key.length() == 0 || baseline.samples == 0)
+    {
+        return false;
+    }
+
+    DynamicJsonDocument existing(BASELINE_JSON_CAPACITY);
+    File file = LittleFS.open(kBaselinePath, "r");
+    if (file)
+    {
+        if (deserializeJson(existing, file))
+        {
+            existing.clear();
+        }
+        file.close();
+    }
+
+    // Newest first; the entry for this key moves to the front. A file
+    // written with longer names than fit now loses its oldest entries.
+    DynamicJsonDocument doc(BASELINE_JSON_CAPACITY);
+    size_t keep = MAX_ENTRIES;
+    do
+    {
+        doc.clear();
+        JsonArray entries = doc.createNestedArray("entries");
+        JsonObject entry = entries.createNestedObject();
+        entry["file"]    = key;
+        entry["mean"]    = baseline.meanPermille;
+        entry["sigma"]   = baseline.sigmaPermille;
+        entry["samples"] = baseline.samples;
+
+        for (JsonObjectConst old : existing["entries"].as<JsonArrayConst>())
+        {
+            if (entries.size() >= keep)
+            {
+                break;
+            }
+            if (key == old["file"].as<const char*>())
+            {
+                continue;
+            }
+            entries.add(old);
+        }
+    } while (doc.overflowed() && --keep > 0);
+
+    if (keep == 0)
+    {
+        logger.log("Flow baseline entry too large to store");
+        return false;
+    }
+
+    file = LittleFS.open(kBaselinePath, "w");
+    if (!file)
+    {
+        logger.log("Failed to open flow baseline file for writing");
+        return false;
+    }
+    bool written = serializeJson(doc, file) > 0;
+    file.close();
+    return written;
+}
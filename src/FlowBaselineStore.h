@@ -0,0 +1,31 @@
+#ifndef FLOW_BASELINE_STORE_H
+#define FLOW_BASELINE_STORE_H
+
+#include <Arduino.h>
+
+#include "JamDetector.h"
+
+/**
+ * Learned healthy pass-ratio baselines kept in LittleFS per print file, so
+ * a reprint of the same file (same printer, usually the same filament)
+ * starts with its adaptive threshold already tuned. Holds the most
+ * recently used MAX_ENTRIES files; the oldest is dropped first.
+ */
+class FlowBaselineStore
+{
+  public:
+    static const int MAX_ENTRIES = 12;
+
+    /**
+     * Look up the baseline stored for key (the print filename).
+     * @return false if there is none or the file cannot be read.
+     */
+    bool load(const String& key, FlowBaseline& baseline);
+
+    /**
+     * Store (or replace) the baseline for key as the most recent entry.
+     */
+    bool save(const String& key, const FlowBaseline& baseline);
+};
+
+#endif  // FLOW_BASELINE_STORE_H
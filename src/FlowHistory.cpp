@@ -0,0 +1,280 @@
+#include "FlowHistory.h"
+
+#include <new>
+
+#include "FlowRatioEstimator.h"
+
+namespace
+{
+    uint16_t saturateU16(unsigned long value)
+    {
+        return value > 65535UL ? 65535 : (uint16_t) value;
+    }
+
+    int16_t clampI16(int32_t value)
+    {
+        if (value > 32767) return 32767;
+        if (value < -32768) return -32768;
+        return (int16_t) value;
+    }
+
+    // Replayed clock starts here so the detector never sees time 0,
+    // which it treats as "not evaluated yet"
+    constexpr unsigned long REPLAY_START_MS = 1000;
+}
+
+FlowHistory::FlowHistory(int requestedCapacity)
+{
+    capacity = requestedCapacity > 0 ? requestedCapacity : 0;
+    recorded = 0;
+    samples  = capacity > 0 ? new (std::nothrow) FlowHistorySample[capacity] : nullptr;
+    if (!samples && capacity > 0)
+    {
+        capacity = requestedCapacity / 4;
+        samples  = capacity > 0 ? new (std::nothrow) FlowHistorySample[capacity] : nullptr;
+        if (!samples)
+        {
+            capacity = 0;
+        }
+    }
+    clear();
+}
+
+FlowHistory::~FlowHistory()
+{
+    delete[] samples;
+}
+
+void FlowHistory::clear()
+{
+    head                 = 0;
+    count                = 0;
+    lastTimeMs           = 0;
+    lastPulseCount       = 0;
+    hasLast              = false;
+    lastRecordedPrinting = false;
+    pendingFlags         = 0;
+    baseExpectedUm       = 0;
+    baseActualUm         = 0;
+    recordedExpectedUm   = 0;
+    recordedActualUm     = 0;
+}
+
+void FlowHistory::markReset()
+{
+    pendingFlags |= FLAG_RESET;
+}
+
+void FlowHistory::markResume()
+{
+    pendingFlags |= FLAG_RESUME;
+}
+
+void FlowHistory::record(int32_t       expectedUm,
+                         int32_t       actualUm,
+                         unsigned long movementPulseCount,
+                         bool          isPrinting,
+                         bool          hasTelemetry,
+                         unsigned long currentTimeMs,
+                         unsigned long printStartTimeMs,
+                         int32_t       expectedRateUmPerSec,
+                         int32_t       actualRateUmPerSec,
+                         int32_t       shortExpectedRateUmPerSec,
+                         int32_t       shortActualRateUmPerSec,
+                         int32_t       edgeVelocityUmPerSec,
+                         const FlowEstimate* flowEstimate)
+{
+    // Deltas run from the last evaluation, recorded or not, so a skipped
+    // idle stretch replays with the same elapsed times as it ran
+    unsigned long dtMs       = hasLast ? currentTimeMs - lastTimeMs : 0;
+    unsigned long pulseDelta = (hasLast && movementPulseCount >= lastPulseCount)
+                                   ? movementPulseCount - lastPulseCount
+                                   : 0;  // Count restarts with the print
+    lastTimeMs     = currentTimeMs;
+    lastPulseCount = movementPulseCount;
+    hasLast        = true;
+
+    bool active = isPrinting && hasTelemetry;
+    if (capacity == 0 || (!active && !lastRecordedPrinting && pendingFlags == 0))
+    {
+        return;
+    }
+    lastRecordedPrinting = active;
+
+    FlowHistorySample& sample = samples[head];
+    if (count == capacity)
+    {
+        // The oldest sample is overwritten; fold it into the base
+        baseExpectedUm += sample.expectedDeltaUm;
+        baseActualUm   += sample.actualDeltaUm;
+    }
+    sample.expectedDeltaUm   = clampI16(expectedUm - recordedExpectedUm);
+    sample.actualDeltaUm     = clampI16(actualUm - recordedActualUm);
+    recordedExpectedUm      += sample.expectedDeltaUm;
+    recordedActualUm        += sample.actualDeltaUm;
+    sample.dtMs              = saturateU16(dtMs);
+    sample.sinceStartMs      = saturateU16(currentTimeMs - printStartTimeMs);
+    sample.pulseDelta        = saturateU16(pulseDelta);
+    sample.expectedRate      = clampI16(expectedRateUmPerSec);
+    sample.actualRate        = clampI16(actualRateUmPerSec);
+    sample.shortExpectedRate = clampI16(shortExpectedRateUmPerSec);
+    sample.shortActualRate   = clampI16(shortActualRateUmPerSec);
+
+    uint8_t flags = pendingFlags;
+    pendingFlags  = 0;
+    if (isPrinting) flags |= FLAG_PRINTING;
+    if (hasTelemetry) flags |= FLAG_TELEMETRY;
+    if (edgeVelocityUmPerSec == 0) flags |= FLAG_EDGE_STALL;
+    if (edgeVelocityUmPerSec != -1) flags |= FLAG_EDGE_KNOWN;
+    if (flowEstimate != nullptr && flowEstimate->valid)
+    {
+        flags |= FLAG_FLOW_VALID;
+        sample.flowExpectedRate  = clampI16(flowEstimate->expectedRateUmPerSec);
+        sample.flowActualRate    = clampI16(flowEstimate->actualRateUmPerSec);
+        sample.flowRatioPermille = clampI16(flowEstimate->ratioPermille);
+        sample.flowSigmaPermille = clampI16(flowEstimate->ratioSigmaPermille);
+    }
+    else
+    {
+        sample.flowExpectedRate  = 0;
+        sample.flowActualRate    = 0;
+        sample.flowRatioPermille = 0;
+        sample.flowSigmaPermille = 0;
+    }
+    sample.flags = flags;
+
+    head = (head + 1) % capacity;
+    if (count < capacity) count++;
+    recorded++;
+}
+
+void FlowHistory::beginReplay(const JamConfig& config, FlowReplayCursor& cursor,
+                              FlowReplayResult& result) const
+{
+    result.active          = false;
+    result.done            = false;
+    result.samples         = 0;
+    result.printingSamples = 0;
+    result.spanMs          = 0;
+    result.elapsedUs       = 0;
+    result.maxStepUs       = 0;
+    result.trips           = 0;
+    result.eventCount      = 0;
+
+    cursor.detector.setQuiet(true);
+    cursor.detector.reset(REPLAY_START_MS);
+    cursor.config          = config;
+    cursor.timeMs          = REPLAY_START_MS;
+    cursor.pulseCount      = 0;
+    cursor.expectedUm      = baseExpectedUm;
+    cursor.actualUm        = baseActualUm;
+    cursor.wasJammed       = false;
+    cursor.first           = (head - count + capacity) % (capacity > 0 ? capacity : 1);
+    cursor.next            = 0;
+    cursor.total           = count;
+    cursor.recordedAtStart = recorded;
+}
+
+bool FlowHistory::stepReplay(FlowReplayCursor& cursor, FlowReplayResult& result, int maxSamples) const
+{
+    uint32_t startUs = micros();
+
+    // Samples recorded since the start push the oldest ones out once the
+    // ring is full; stop before reading one that is gone
+    uint32_t added  = recorded - cursor.recordedAtStart;
+    int64_t  lost   = (int64_t) cursor.total + added - capacity;
+    int      usable = (lost > cursor.next) ? cursor.next : cursor.total;
+
+    int end = cursor.next + maxSamples;
+    if (end > usable) end = usable;
+
+    for (; cursor.next < end; cursor.next++)
+    {
+        const FlowHistorySample& sample = samples[(cursor.first + cursor.next) % capacity];
+        if (cursor.next > 0)
+        {
+            cursor.timeMs     += sample.dtMs;
+            cursor.pulseCount += sample.pulseDelta;
+        }
+        cursor.expectedUm += sample.expectedDeltaUm;
+        cursor.actualUm   += sample.actualDeltaUm;
+
+        if (sample.flags & FLAG_RESET)
+        {
+            cursor.detector.reset(cursor.timeMs);
+        }
+        if (sample.flags & FLAG_RESUME)
+        {
+            cursor.detector.onResume(cursor.timeMs, cursor.pulseCount, 0.0f);
+        }
+
+        FlowEstimate estimate = {(sample.flags & FLAG_FLOW_VALID) != 0,
+                                 sample.flowExpectedRate, sample.flowActualRate,
+                                 sample.flowRatioPermille, sample.flowSigmaPermille};
+        int32_t edgeVelocity = (sample.flags & FLAG_EDGE_STALL)   ? 0
+                               : (sample.flags & FLAG_EDGE_KNOWN) ? 1
+                                                                  : -1;
+
+        bool printing  = (sample.flags & FLAG_PRINTING) != 0;
+        bool telemetry = (sample.flags & FLAG_TELEMETRY) != 0;
+        JamState state = cursor.detector.updateUm(
+            cursor.expectedUm, cursor.actualUm, cursor.pulseCount, printing, telemetry,
+            cursor.timeMs, cursor.timeMs - sample.sinceStartMs, cursor.config,
+            sample.expectedRate, sample.actualRate,
+            sample.shortExpectedRate, sample.shortActualRate,
+            edgeVelocity, &estimate);
+
+        if (printing && telemetry)
+        {
+            result.printingSamples++;
+        }
+
+        uint32_t atMs = cursor.timeMs - REPLAY_START_MS;
+        if (state.jammed && !cursor.wasJammed)
+        {
+            result.trips++;
+            if (result.eventCount < FLOW_REPLAY_MAX_EVENTS)
+            {
+                FlowReplayEvent& event = result.events[result.eventCount++];
+                event.atMs      = atMs;
+                event.clearedMs = 0;
+                event.hard      = state.hardJamTriggered;
+                event.code      = state.tripCode;
+                event.passRatio = state.passRatio;
+            }
+        }
+        else if (!state.jammed && cursor.wasJammed && result.eventCount > 0)
+        {
+            FlowReplayEvent& event = result.events[result.eventCount - 1];
+            if (event.clearedMs == 0)
+            {
+                event.clearedMs = atMs - event.atMs;
+            }
+        }
+        cursor.wasJammed = state.jammed;
+        result.samples++;
+    }
+
+    bool finished = cursor.next >= usable;
+    if (finished)
+    {
+        result.spanMs = cursor.timeMs - REPLAY_START_MS;
+        for (int i = 0; i < result.eventCount; i++)
+        {
+            result.events[i].ageMs = result.spanMs - result.events[i].atMs;
+        }
+        result.done = true;
+    }
+
+    uint32_t stepUs = micros() - startUs;
+    result.elapsedUs += stepUs;
+    if (stepUs > result.maxStepUs) result.maxStepUs = stepUs;
+    return finished;
+}
+
+void FlowHistory::replay(const JamConfig& config, FlowReplayResult& result) const
+{
+    FlowReplayCursor cursor;
+    beginReplay(config, cursor, result);
+    stepReplay(cursor, result, cursor.total);
+}
@@ -0,0 +1,195 @@
+#ifndef FLOW_HISTORY_H
+#define FLOW_HISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "JamDetector.h"
+
+// Evaluations kept for replay: 2 minutes of printing at the 4Hz detector
+// rate (~13KB). Boards with heap to spare can raise it in platformio.ini.
+#ifndef FLOW_HISTORY_SAMPLES
+#define FLOW_HISTORY_SAMPLES 480
+#endif
+
+// Samples one FlowHistory::stepReplay() call from loop() replays
+#ifndef FLOW_REPLAY_SAMPLES_PER_STEP
+#define FLOW_REPLAY_SAMPLES_PER_STEP 64
+#endif
+
+// Trip events kept in one replay result; later trips are only counted
+#define FLOW_REPLAY_MAX_EVENTS 16
+
+/**
+ * One JamDetector evaluation, packed to 28 bytes. Times, pulse counts and
+ * windowed distances are deltas from the previous sample; rates are
+ * clamped to int16 um/s, which covers any real extrusion speed (32 mm/s of
+ * filament). A window moves by well under 32mm per evaluation; a larger
+ * jump is carried into the following samples.
+ */
+struct FlowHistorySample
+{
+    int16_t  expectedDeltaUm;     // Change in the windowed expected distance
+    int16_t  actualDeltaUm;       // Change in the windowed actual distance
+    uint16_t dtMs;                // Since the previous sample (saturates)
+    uint16_t sinceStartMs;        // Since print start (saturates; only grace reads it)
+    uint16_t pulseDelta;          // Movement pulses since the previous sample
+    int16_t  expectedRate;        // Windowed rates (um/s)
+    int16_t  actualRate;
+    int16_t  shortExpectedRate;
+    int16_t  shortActualRate;
+    int16_t  flowExpectedRate;    // Kalman estimate (um/s, permille)
+    int16_t  flowActualRate;
+    int16_t  flowRatioPermille;
+    int16_t  flowSigmaPermille;
+    uint8_t  flags;               // FlowHistory::FLAG_*
+};
+
+/**
+ * One jam onset seen during a replay.
+ */
+struct FlowReplayEvent
+{
+    uint32_t atMs;       // Since the first replayed sample
+    uint32_t ageMs;      // Before the newest sample
+    uint32_t clearedMs;  // How long it stayed jammed; 0 = still jammed at the end
+    bool     hard;       // Hard (true) or soft jam
+    TripCode code;
+    float    passRatio;
+};
+
+/**
+ * Trip timeline of the last replay.
+ */
+struct FlowReplayResult
+{
+    bool            active;      // Requested, not yet run
+    bool            done;        // At least one replay has finished
+    uint16_t        samples;     // Evaluations replayed
+    uint16_t        printingSamples;
+    uint32_t        spanMs;      // Print time covered by the replay
+    uint32_t        elapsedUs;   // Cost of the replay itself, all steps
+    uint32_t        maxStepUs;   // Slowest single step
+    uint16_t        trips;       // All onsets, including any past the event list
+    uint8_t         eventCount;
+    FlowReplayEvent events[FLOW_REPLAY_MAX_EVENTS];
+};
+
+/**
+ * A replay in progress: the fresh detector and where it has got to, so
+ * the ring can be replayed a few samples per loop() pass.
+ */
+struct FlowReplayCursor
+{
+    JamDetector   detector;
+    JamConfig     config;
+    unsigned long timeMs;
+    unsigned long pulseCount;
+    int32_t       expectedUm;
+    int32_t       actualUm;
+    bool          wasJammed;
+    int           first;            // Ring slot of the oldest sample at the start
+    int           next;             // Samples replayed so far
+    int           total;            // Samples kept at the start
+    uint32_t      recordedAtStart;  // FlowHistory::recorded at the start
+};
+
+/**
+ * Ring of the inputs the active JamDetector was evaluated on, so recent
+ * flow can be replayed through a fresh detector with a candidate JamConfig
+ * ("with these thresholds, would the last 2 minutes have tripped?").
+ *
+ * Only printing evaluations are kept; the first idle one after printing is
+ * recorded so the replayed detector drops to idle too, and the rest are
+ * skipped so a long pause does not push the print out of the ring. Print
+ * starts and resumes are flagged on the next sample and replayed as
+ * reset()/onResume().
+ */
+class FlowHistory
+{
+  public:
+    static const uint8_t FLAG_PRINTING   = 0x01;
+    static const uint8_t FLAG_TELEMETRY  = 0x02;
+    static const uint8_t FLAG_FLOW_VALID = 0x04;
+    static const uint8_t FLAG_EDGE_STALL = 0x08;  // Edge velocity was 0
+    static const uint8_t FLAG_EDGE_KNOWN = 0x10;  // Edge velocity was not -1
+    static const uint8_t FLAG_RESET      = 0x20;
+    static const uint8_t FLAG_RESUME     = 0x40;
+
+    /**
+     * @param capacity Samples to allocate; falls back to a quarter of it
+     *                 (and then none) if the heap cannot spare it.
+     */
+    explicit FlowHistory(int capacity = FLOW_HISTORY_SAMPLES);
+    ~FlowHistory();
+
+    FlowHistory(const FlowHistory &)            = delete;
+    FlowHistory &operator=(const FlowHistory &) = delete;
+
+    /**
+     * Record the inputs of one JamDetector::updateUm() call.
+     */
+    void record(int32_t       expectedUm,
+                int32_t       actualUm,
+                unsigned long movementPulseCount,
+                bool          isPrinting,
+                bool          hasTelemetry,
+                unsigned long currentTimeMs,
+                unsigned long printStartTimeMs,
+                int32_t       expectedRateUmPerSec,
+                int32_t       actualRateUmPerSec,
+                int32_t       shortExpectedRateUmPerSec,
+                int32_t       shortActualRateUmPerSec,
+                int32_t       edgeVelocityUmPerSec,
+                const FlowEstimate* flowEstimate);
+
+    /**
+     * The active detector was reset (print start/end) or resumed; applied
+     * to the next recorded sample.
+     */
+    void markReset();
+    void markResume();
+
+    void clear();
+
+    /**
+     * Start running every kept sample through a fresh, quiet JamDetector
+     * with config. stepReplay() then replays up to maxSamples per call and
+     * returns true once result holds the trip timeline. Samples recorded
+     * meanwhile are left out; if the ring overwrites one not yet replayed,
+     * the replay ends early with what it covered.
+     */
+    void beginReplay(const JamConfig& config, FlowReplayCursor& cursor, FlowReplayResult& result) const;
+    bool stepReplay(FlowReplayCursor& cursor, FlowReplayResult& result, int maxSamples) const;
+
+    /**
+     * Whole replay in one call.
+     */
+    void replay(const JamConfig& config, FlowReplayResult& result) const;
+
+    int getCount() const { return count; }
+    int getCapacity() const { return capacity; }
+    size_t getAllocatedBytes() const { return (size_t) capacity * sizeof(FlowHistorySample); }
+
+  private:
+    FlowHistorySample *samples;
+    int                capacity;
+    int                head;   // Next slot to write
+    int                count;
+    uint32_t           recorded;  // Samples ever written; replay detects overwrites
+
+    // Windowed distances before the oldest kept sample, and as of the
+    // newest; replay rebuilds each sample's totals from these
+    int32_t       baseExpectedUm;
+    int32_t       baseActualUm;
+    int32_t       recordedExpectedUm;
+    int32_t       recordedActualUm;
+
+    unsigned long lastTimeMs;
+    unsigned long lastPulseCount;
+    bool          hasLast;
+    bool          lastRecordedPrinting;
+    uint8_t       pendingFlags;
+};
+
+#endif  // FLOW_HISTORY_H
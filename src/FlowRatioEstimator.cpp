@@ -0,0 +1,191 @@
+#include "FlowRatioEstimator.h"
+
+using namespace FlowUnits;
+
+namespace
+{
+    // Process noise: white acceleration spectral density (um^2/s^3). Sets
+    // how fast the velocity estimates follow a real change in flow.
+    constexpr int64_t ACCEL_NOISE_UM2_S3        = 250000;  // ~0.5mm/s of drift per sqrt(s)
+
+    // Telemetry totals are exact but arrive in ~1s chunks behind the nozzle
+    constexpr int64_t EXPECTED_MEASUREMENT_VAR  = 1500LL * 1500LL;
+    // Sensor position is known to one pulse: quantization plus edge jitter
+    constexpr int64_t QUANTIZATION_VAR_DIVISOR  = 6;
+
+    // A fresh track knows nothing about velocity
+    constexpr int64_t INITIAL_VELOCITY_VAR      = 10000LL * 10000LL;
+
+    // Variance caps keep every product inside int64 (p01^2 <= 1e18)
+    constexpr int64_t MAX_VARIANCE              = 1000000000LL;
+    constexpr unsigned long MAX_PREDICT_MS      = 2000;
+
+    // A jump this large is a counter reset, not motion: restart the track
+    constexpr int64_t MAX_INNOVATION_UM         = 100000;
+
+    // Same gate the jam detector uses for "really extruding"
+    constexpr int32_t MIN_RATIO_RATE_UM_S       = 400;
+    constexpr int32_t MAX_RATIO_PERMILLE        = 1500;
+
+    inline int64_t clampVariance(int64_t v)
+    {
+        if (v < 0) return 0;
+        return v > MAX_VARIANCE ? MAX_VARIANCE : v;
+    }
+
+    inline int64_t clampCovariance(int64_t v)
+    {
+        if (v < -MAX_VARIANCE) return -MAX_VARIANCE;
+        return v > MAX_VARIANCE ? MAX_VARIANCE : v;
+    }
+}
+
+FlowKalmanTrack::FlowKalmanTrack()
+{
+    reset(EXPECTED_MEASUREMENT_VAR);
+}
+
+void FlowKalmanTrack::reset(int64_t measurementVarUm2)
+{
+    positionUm       = 0;
+    velocityUmPerSec = 0;
+    p00              = 0;
+    p01              = 0;
+    p11              = 0;
+    measurementVar   = measurementVarUm2 > 0 ? measurementVarUm2 : 1;
+    lastMs           = 0;
+    initialized      = false;
+}
+
+void FlowKalmanTrack::predict(unsigned long dtMs)
+{
+    if (dtMs == 0)
+    {
+        return;
+    }
+    if (dtMs > MAX_PREDICT_MS)
+    {
+        dtMs = MAX_PREDICT_MS;
+    }
+    int64_t d = (int64_t) dtMs;
+
+    positionUm += velocityUmPerSec * d / 1000;
+
+    // P = F P F' + Q with F = [1 dt; 0 1] and white-acceleration Q
+    int64_t q11 = ACCEL_NOISE_UM2_S3 * d / 1000;
+    int64_t q01 = q11 * d / 2000;
+    int64_t q00 = q01 * d * 2 / 3000;
+
+    p00 = clampVariance(p00 + 2 * p01 * d / 1000 + p11 * d * d / 1000000 + q00);
+    p01 = clampCovariance(p01 + p11 * d / 1000 + q01);
+    p11 = clampVariance(p11 + q11);
+}
+
+void FlowKalmanTrack::observe(int32_t position, unsigned long timeMs)
+{
+    if (initialized)
+    {
+        long sinceLast = (long) (timeMs - lastMs);
+        if (sinceLast > 0)
+        {
+            predict((unsigned long) sinceLast);
+            lastMs = timeMs;
+        }
+
+        int64_t innovation = (int64_t) position - positionUm;
+        if (innovation <= MAX_INNOVATION_UM && innovation >= -MAX_INNOVATION_UM)
+        {
+            int64_t s = p00 + measurementVar;
+
+            positionUm       += p00 * innovation / s;
+            velocityUmPerSec += p01 * innovation / s;
+
+            // P = (I - K H) P, written out for the 2x2 case
+            int64_t newP11 = p11 - (p01 * p01) / s;
+            p00 = clampVariance(p00 * measurementVar / s);
+            p01 = clampCovariance(p01 * measurementVar / s);
+            p11 = clampVariance(newP11);
+            return;
+        }
+    }
+
+    positionUm       = position;
+    velocityUmPerSec = 0;
+    p00              = measurementVar;
+    p01              = 0;
+    p11              = INITIAL_VELOCITY_VAR;
+    lastMs           = timeMs;
+    initialized      = true;
+}
+
+int64_t FlowKalmanTrack::getVelocityVarianceAt(unsigned long nowMs) const
+{
+    long sinceLast = (long) (nowMs - lastMs);
+    if (sinceLast <= 0)
+    {
+        return p11;
+    }
+    if ((unsigned long) sinceLast > MAX_PREDICT_MS)
+    {
+        sinceLast = MAX_PREDICT_MS;
+    }
+    return clampVariance(p11 + ACCEL_NOISE_UM2_S3 * sinceLast / 1000);
+}
+
+FlowRatioEstimator::FlowRatioEstimator()
+{
+    reset(2880);
+}
+
+void FlowRatioEstimator::reset(int32_t umPerPulse)
+{
+    if (umPerPulse <= 0)
+    {
+        umPerPulse = 2880;
+    }
+    expected.reset(EXPECTED_MEASUREMENT_VAR);
+    actual.reset((int64_t) umPerPulse * umPerPulse / QUANTIZATION_VAR_DIVISOR);
+}
+
+void FlowRatioEstimator::addExpectedUm(int32_t totalExpectedUm, unsigned long timeMs)
+{
+    expected.observe(totalExpectedUm, timeMs);
+}
+
+void FlowRatioEstimator::addActualUm(int32_t totalActualUm, unsigned long timeMs)
+{
+    actual.observe(totalActualUm, timeMs);
+}
+
+FlowEstimate FlowRatioEstimator::getEstimate(unsigned long nowMs) const
+{
+    FlowEstimate estimate = {false, 0, 0, PERMILLE_ONE, 0};
+    if (!expected.isInitialized() || !actual.isInitialized())
+    {
+        return estimate;
+    }
+
+    int32_t expectedRate = expected.getVelocityUmPerSec();
+    int32_t actualRate   = actual.getVelocityUmPerSec();
+    if (actualRate < 0) actualRate = 0;
+    estimate.expectedRateUmPerSec = expectedRate < 0 ? 0 : expectedRate;
+    estimate.actualRateUmPerSec   = actualRate;
+    if (expectedRate < MIN_RATIO_RATE_UM_S)
+    {
+        return estimate;
+    }
+
+    int32_t ratio = (int32_t) ((int64_t) actualRate * PERMILLE_ONE / expectedRate);
+    if (ratio > MAX_RATIO_PERMILLE) ratio = MAX_RATIO_PERMILLE;
+
+    // First-order propagation: var(a/e) ~= (var(a) + r^2 var(e)) / e^2
+    int64_t variance = actual.getVelocityVarianceAt(nowMs) +
+                       (int64_t) ratio * ratio * expected.getVelocityVarianceAt(nowMs) /
+                           ((int64_t) PERMILLE_ONE * PERMILLE_ONE);
+    int64_t sigma = (int64_t) isqrt64((uint64_t) variance) * PERMILLE_ONE / expectedRate;
+
+    estimate.valid              = true;
+    estimate.ratioPermille      = ratio;
+    estimate.ratioSigmaPermille = sigma > MAX_RATIO_PERMILLE ? MAX_RATIO_PERMILLE : (int32_t) sigma;
+    return estimate;
+}
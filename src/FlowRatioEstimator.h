@@ -0,0 +1,106 @@
+#ifndef FLOW_RATIO_ESTIMATOR_H
+#define FLOW_RATIO_ESTIMATOR_H
+
+#include <stdint.h>
+
+#include "FlowUnits.h"
+
+/**
+ * Smoothed flow ratio with a confidence band, taken at one instant.
+ */
+struct FlowEstimate
+{
+    bool    valid;                 // Both tracks running and enough commanded flow for a ratio
+    int32_t expectedRateUmPerSec;  // Filtered commanded velocity
+    int32_t actualRateUmPerSec;    // Filtered sensor velocity
+    int32_t ratioPermille;         // actual / expected velocity
+    int32_t ratioSigmaPermille;    // One standard deviation of ratioPermille
+};
+
+/**
+ * Constant-velocity Kalman filter over one filament position stream.
+ *
+ * State is position (um) and velocity (um/s); covariances are kept in
+ * um^2, um^2/s and (um/s)^2 in int64 so an update is a handful of integer
+ * multiplies and three divides, with no floats on the C3.
+ */
+class FlowKalmanTrack
+{
+  public:
+    FlowKalmanTrack();
+
+    /**
+     * Forget everything; the next observe() starts the track at rest.
+     * @param measurementVarUm2 Position measurement variance (um^2).
+     */
+    void reset(int64_t measurementVarUm2);
+
+    /**
+     * Fold in a position measurement taken at timeMs. Measurements that go
+     * backwards in time are applied without a predict step.
+     */
+    void observe(int32_t positionUm, unsigned long timeMs);
+
+    bool isInitialized() const { return initialized; }
+
+    int32_t getVelocityUmPerSec() const { return (int32_t) velocityUmPerSec; }
+
+    /**
+     * Velocity variance ((um/s)^2) extrapolated to nowMs.
+     */
+    int64_t getVelocityVarianceAt(unsigned long nowMs) const;
+
+  private:
+    int64_t       positionUm;
+    int64_t       velocityUmPerSec;
+    int64_t       p00;  // position variance (um^2)
+    int64_t       p01;  // position/velocity covariance (um^2/s)
+    int64_t       p11;  // velocity variance ((um/s)^2)
+    int64_t       measurementVar;
+    unsigned long lastMs;
+    bool          initialized;
+
+    void predict(unsigned long dtMs);
+};
+
+/**
+ * Flow ratio from two Kalman tracks: the SDCP TotalExtrusion telemetry and
+ * the cumulative sensor position. Each track is updated when its own data
+ * arrives, so the slow, jittery telemetry and the quantized pulse stream
+ * are each weighted by their own noise, and the ratio carries a band that
+ * is wide while little has been seen and narrows as evidence builds up.
+ * Every call is O(1).
+ */
+class FlowRatioEstimator
+{
+  public:
+    FlowRatioEstimator();
+
+    /**
+     * Restart both tracks (print start, resume).
+     * @param umPerPulse Sensor resolution, sets the pulse quantization noise.
+     */
+    void reset(int32_t umPerPulse);
+
+    /**
+     * New cumulative commanded extrusion from telemetry.
+     */
+    void addExpectedUm(int32_t totalExpectedUm, unsigned long timeMs);
+
+    /**
+     * Current cumulative sensor position. Call on every evaluation, not only
+     * when pulses arrive: an unchanged position is evidence of no motion.
+     */
+    void addActualUm(int32_t totalActualUm, unsigned long timeMs);
+
+    /**
+     * Ratio of the filtered velocities as of nowMs.
+     */
+    FlowEstimate getEstimate(unsigned long nowMs) const;
+
+  private:
+    FlowKalmanTrack expected;
+    FlowKalmanTrack actual;
+};
+
+#endif  // FLOW_RATIO_ESTIMATOR_H
@@ -0,0 +1,65 @@
+#ifndef FLOW_UNITS_H
+#define FLOW_UNITS_H
+
+#include <stdint.h>
+
+/**
+ * Fixed-point units for the motion/jam pipeline.
+ *
+ * The ESP32-C3 has no FPU, so the hot path works in integers:
+ *   - distances in micrometres (int32_t, +/-2147 m; a 1 kg spool is ~330 m)
+ *   - rates in micrometres per second
+ *   - ratios in permille (1000 = 1.0)
+ * Floats only appear at the settings / JSON / UI boundary.
+ */
+namespace FlowUnits {
+    constexpr int32_t UM_PER_MM      = 1000;
+    constexpr int32_t PERMILLE_ONE   = 1000;
+
+    inline int32_t mmToUm(float mm)
+    {
+        return (int32_t) (mm >= 0.0f ? mm * UM_PER_MM + 0.5f : mm * UM_PER_MM - 0.5f);
+    }
+
+    inline float umToMm(int32_t um)
+    {
+        return (float) um / (float) UM_PER_MM;
+    }
+
+    inline int32_t ratioToPermille(float ratio)
+    {
+        return (int32_t) (ratio * PERMILLE_ONE + 0.5f);
+    }
+
+    inline float permilleToRatio(int32_t permille)
+    {
+        return (float) permille / (float) PERMILLE_ONE;
+    }
+
+    // Integer square root (floor), for spreads of int64 variances
+    inline uint32_t isqrt64(uint64_t v)
+    {
+        uint64_t result = 0;
+        uint64_t bit    = 1ULL << 62;
+        while (bit > v)
+        {
+            bit >>= 2;
+        }
+        while (bit != 0)
+        {
+            if (v >= result + bit)
+            {
+                v -= result + bit;
+                result = (result >> 1) + bit;
+            }
+            else
+            {
+                result >>= 1;
+            }
+            bit >>= 2;
+        }
+        return (uint32_t) result;
+    }
+}
+
+#endif  // FLOW_UNITS_H
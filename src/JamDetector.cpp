@@ -1,39 +1,117 @@
 #include "JamDetector.h"
 #include "Logger.h"
+#include "PoissonTable.h"
 #include "SettingsManager.h"
 
+using namespace FlowUnits;
+
 // Global singletons (provided elsewhere)
 
 namespace
 {
-    // Minimum windowed distance before we even try to declare a jam.
-    constexpr float MIN_HARD_WINDOW_MM       = 10.0f;
-    constexpr float MIN_SOFT_WINDOW_MM       = 8.0f;
-    constexpr float MIN_SOFT_DEFICIT_MM      = 4.0f;
-
-    // For rate-based detection (mm/s)
-    constexpr float MIN_EXPECTED_RATE_MM_S   = 0.4f;   // below this we consider it not really extruding
-    constexpr float MIN_RATE_FOR_RATIO_MM_S  = 0.2f;   // below this we just treat ratio as 1.0
-    constexpr float MIN_ACTUAL_RATE_MM_S     = 0.05f;  // basically no movement
-
-    constexpr float HARD_RATE_RATIO          = 0.25f;  // hard jam if sensor < 25% of expected
-    constexpr float HARD_RECOVERY_RATIO      = 0.75f;  // recovery once >= 75% of expected rate
-
-    // Smoothed "how bad is the deficit" purely for UI
-    constexpr float RATIO_SMOOTHING_ALPHA    = 0.08f;
-
-    // Resume grace: disable detection until we have moved enough again
-    constexpr float         RESUME_GRACE_15MM_THRESHOLD = 15.0f;  // ~15mm expected extrusion after resume
-    constexpr unsigned long RESUME_MIN_PULSES           = 5;      // or a few pulses, whichever comes first
+    // Minimum windowed distance before we even try to declare a jam (um).
+    constexpr int32_t MIN_HARD_WINDOW_UM       = 10000;
+    constexpr int32_t MIN_SOFT_WINDOW_UM       = 8000;
+    constexpr int32_t MIN_SOFT_DEFICIT_UM      = 4000;
+
+    // For rate-based detection (um/s)
+    constexpr int32_t MIN_EXPECTED_RATE_UM_S   = 400;   // below this we consider it not really extruding
+    constexpr int32_t MIN_RATE_FOR_RATIO_UM_S  = 200;   // below this we just treat ratio as 1.0
+    constexpr int32_t MIN_ACTUAL_RATE_UM_S     = 50;    // basically no movement
+    constexpr int32_t LOW_SPEED_RATE_UM_S      = 1000;  // diagnostic low-speed band
+    constexpr int32_t MAX_RATE_UM_S            = 1000000;  // keeps rate * 1000 inside int32
+
+    // Distance window: the window always holds enough extrusion for a ratio,
+    // so the rate gate only has to tell "extruding" from "stopped"
+    constexpr int32_t MIN_DISTANCE_MODE_RATE_UM_S = 50;
+
+    // Ratios in permille (1000 = 1.0)
+    constexpr int32_t HARD_RATE_PERMILLE       = 250;   // hard jam if sensor < 25% of expected
+    constexpr int32_t HARD_RECOVERY_PERMILLE   = 750;   // recovery once >= 75% of expected rate
+    constexpr int32_t MAX_PASS_PERMILLE        = 1500;
+
+    // Kalman ratio source: judge the ratio this many sigmas above its
+    // estimate, so a trip needs low flow even on the generous reading
+    constexpr int32_t KALMAN_BAND_SIGMAS       = 1;
+
+    // Sequential (CUSUM) soft jams. The deficit a healthy print shows (lag,
+    // mm/pulse calibration) is learned as a slow baseline while in control;
+    // deficits up to the allowance above it drain the statistic, anything
+    // beyond adds up until it matches the timer's evidence at the threshold
+    constexpr int32_t CUSUM_ALLOWANCE_PERMILLE    = 100;
+    constexpr int32_t CUSUM_MIN_DRIFT_PERMILLE    = 50;     // keeps the limit positive for lax thresholds
+    constexpr int32_t CUSUM_BASELINE_TAU_MS       = 60000;
+    constexpr int32_t CUSUM_MAX_BASELINE_PERMILLE = 250;    // never learn a real clog as normal
+
+    // Adaptive soft threshold: learn the healthy pass ratio (EWMA over
+    // about a minute of extrusion, a plain average until then) and judge
+    // against mean - k sigma once it has seen this many evaluations. It
+    // only ever tightens the configured threshold, never past the cap.
+    constexpr uint16_t ADAPTIVE_EWMA_SAMPLES      = 256;
+    constexpr uint16_t ADAPTIVE_MIN_SAMPLES       = 240;    // ~60s extruding at 4Hz
+    constexpr int32_t  ADAPTIVE_SIGMAS            = 4;
+    constexpr int32_t  ADAPTIVE_MAX_PERMILLE      = 900;
+
+    // Time-to-jam: the fitted deficit line is extrapolated at most this far
+    // ahead, and a trip due within the warning horizon raises jamWarning
+    constexpr int32_t TREND_MAX_PREDICT_MS = 60000;
+    constexpr int32_t TREND_WARNING_MS     = 10000;
+
+    // Smoothed "how bad is the deficit" purely for UI (alpha = 0.08)
+    constexpr int32_t RATIO_SMOOTHING_ALPHA_PERMILLE = 80;
+
+    // Grace ends early once flow has been seen to track the commands:
+    // this many consecutive healthy evaluations (~2s at 4Hz) and at least
+    // this much filament through the sensor since grace began
+    constexpr uint8_t       GRACE_HEALTHY_EVALS         = 8;
+    constexpr int32_t       GRACE_HEALTHY_PERMILLE      = 750;    // same bar as hard jam recovery
+    constexpr int32_t       GRACE_MIN_ACTUAL_UM         = 10000;
+
+    // Resume grace also ends once enough extrusion was commanded to judge
+    constexpr int32_t       RESUME_GRACE_15MM_UM        = 15000;  // ~15mm expected extrusion after resume
 
     // We do not let dt explode; caps keep rates reasonably stable
     constexpr unsigned long MAX_EVAL_INTERVAL_MS        = 1000;
     constexpr unsigned long DEFAULT_EVAL_INTERVAL_MS    = 1000;
     constexpr bool          USE_WINDOWED_RATE_SAMPLES   = true;
+
+    /**
+     * ln P(K <= k | lambda) in milli-nats for the observed pulse count k,
+     * where lambda is the pulse count a healthy sensor would have produced.
+     * lambda is floored to the table grid, which only ever makes a window
+     * look more probable. Returns false when lambda is past the table: the
+     * window then holds enough pulses for the ratio rules on their own.
+     */
+    inline bool lowCountLogLikelihood(int32_t expectedUm, int32_t actualUm,
+                                      int32_t umPerPulse, int32_t& logLikelihoodMilli)
+    {
+        if (umPerPulse <= 0 || expectedUm < 0)
+        {
+            return false;
+        }
+        int32_t row = (int32_t)((int64_t)expectedUm * PoissonTable::STEPS_PER_PULSE / umPerPulse);
+        if (row >= PoissonTable::LAMBDA_ROWS)
+        {
+            return false;
+        }
+        int32_t k = (actualUm > 0) ? actualUm / umPerPulse : 0;
+        logLikelihoodMilli = (k < PoissonTable::MAX_K) ? PoissonTable::LOG_CDF_MILLI[row][k] : 0;
+        return true;
+    }
+
+    inline bool isExtruding(int32_t expectedRate, const JamConfig& config)
+    {
+        if (config.windowMode == WindowMode::DISTANCE)
+        {
+            return expectedRate >= MIN_DISTANCE_MODE_RATE_UM_S;
+        }
+        return expectedRate >= MIN_EXPECTED_RATE_UM_S;
+    }
 }
 
 JamDetector::JamDetector()
 {
+    quiet = false;
     reset(0);
 }
 
@@ -53,19 +131,191 @@ void JamDetector::reset(unsigned long currentTimeMs)
     state.graceState           = GraceState::IDLE;
     state.graceActive          = false;
     state.tripCode             = TripCode::NONE;
+    state.logLikelihood        = 0.0f;
+    state.softThreshold        = 0.0f;
+    clearTrend();
 
     hardJamAccumulatedMs       = 0;
     softJamAccumulatedMs       = 0;
+    softCusumPermilleMs        = 0;
+    softBaselineMicro          = 0;
     lastEvalMs                 = 0;
     lastPulseCount             = 0;
-    resumeGracePulseBaseline   = 0;
-    resumeGraceActualBaseline  = 0.0f;
+    gracePulseBaseline         = 0;
+    graceHealthyEvals          = 0;
+    resumeGraceActualBaselineUm = 0;
     resumeGraceStartTimeMs     = 0;
-    prevExpectedDistance       = 0.0f;
-    prevActualDistance         = 0.0f;
+    prevExpectedUm             = 0;
+    prevActualUm               = 0;
     jamPauseRequested          = false;
     wasInGrace                 = false;
-    smoothedDeficitRatio       = 0.0f;
+    boundedRatio               = false;
+    smoothedDeficitPermille    = 0;
+    healthyMeanMicro           = 0;
+    healthyVarianceMilli       = 0;
+    healthySamples             = 0;
+}
+
+void JamDetector::clearTrend()
+{
+    trendHead          = 0;
+    trendCount         = 0;
+    trendSumY          = 0;
+    trendSumXY         = 0;
+    state.deficitTrend = 0.0f;
+    state.timeToJamMs  = -1;
+    state.jamWarning   = false;
+}
+
+void JamDetector::addTrendSample(int32_t deficitPermille, unsigned long currentTimeMs)
+{
+    if (trendCount == TREND_SAMPLES)
+    {
+        // The oldest drops out and every other sample moves one x closer
+        int32_t oldest = trendDeficit[trendHead];
+        trendSumXY -= trendSumY - oldest;
+        trendSumY  -= oldest;
+        trendCount--;
+    }
+    trendSumXY += (int32_t) trendCount * deficitPermille;
+    trendSumY  += deficitPermille;
+
+    trendDeficit[trendHead] = (int16_t) deficitPermille;
+    trendTimeMs[trendHead]  = currentTimeMs;
+    trendHead = (trendHead + 1) % TREND_SAMPLES;
+    trendCount++;
+}
+
+void JamDetector::predictTrip(bool allowHard, bool allowSoft, const JamConfig& config)
+{
+    state.deficitTrend = 0.0f;
+    state.timeToJamMs  = -1;
+    state.jamWarning   = false;
+    if (state.jammed)
+    {
+        state.timeToJamMs = 0;
+        return;
+    }
+
+    // Least-squares line through the full window: slope per evaluation,
+    // scaled to time by the window's mean interval (permille x 1000 units)
+    bool    fitted     = false;
+    int64_t slopeMilli = 0;  // per second
+    int64_t nowMilli   = 0;  // fitted deficit at the newest sample
+    if (trendCount == TREND_SAMPLES)
+    {
+        const int64_t n    = TREND_SAMPLES;
+        const int64_t sumX = n * (n - 1) / 2;
+        const int64_t sumXX = (n - 1) * n * (2 * n - 1) / 6;
+        unsigned long spanMs = trendTimeMs[(trendHead + TREND_SAMPLES - 1) % TREND_SAMPLES] -
+                               trendTimeMs[trendHead];
+        if (spanMs > 0)
+        {
+            int64_t perEval = (n * trendSumXY - sumX * trendSumY) * 1000 / (n * sumXX - sumX * sumX);
+            slopeMilli = perEval * (n - 1) * 1000 / (int64_t) spanMs;
+            nowMilli   = (int64_t) trendSumY * 1000 / n + perEval * (n - 1) / 2;
+            fitted     = true;
+            state.deficitTrend = (float) slopeMilli / 1000000.0f;
+        }
+    }
+
+    // Time for the fitted deficit to reach a trip level, then for the
+    // accumulator to fill from where it stands
+    int64_t best = -1;
+    auto consider = [&](int32_t levelPermille, int64_t remainingMs) {
+        if (remainingMs < 0) remainingMs = 0;
+        int64_t crossMs;
+        if (nowMilli >= (int64_t) levelPermille * 1000)
+        {
+            crossMs = 0;
+        }
+        else if (slopeMilli > 0)
+        {
+            crossMs = ((int64_t) levelPermille * 1000 - nowMilli) * 1000 / slopeMilli;
+        }
+        else
+        {
+            return;
+        }
+        if (best < 0 || crossMs + remainingMs < best) best = crossMs + remainingMs;
+    };
+
+    if (allowHard)
+    {
+        // A hard condition already building runs out on its own
+        if (hardJamAccumulatedMs > 0)
+        {
+            best = config.hardJamTimeMs - hardJamAccumulatedMs;
+        }
+        if (fitted)
+        {
+            consider(PERMILLE_ONE - HARD_RATE_PERMILLE, config.hardJamTimeMs - hardJamAccumulatedMs);
+        }
+    }
+    if (allowSoft && fitted)
+    {
+        // At the threshold deficit the CUSUM fills in softJamTimeMs, like the timer
+        int32_t thresholdPermille = (config.softJamAlgorithm == SoftJamAlgorithm::CUSUM)
+                                        ? ratioToPermille(config.ratioThreshold)
+                                        : softThresholdPermille(config);
+        int64_t remainingMs =
+            (int64_t) config.softJamTimeMs - (int64_t) (state.softJamPercent * config.softJamTimeMs / 100.0f);
+        consider(PERMILLE_ONE - thresholdPermille, remainingMs);
+    }
+
+    if (best < 0 || best > TREND_MAX_PREDICT_MS)
+    {
+        return;
+    }
+    state.timeToJamMs = (int32_t) best;
+    state.jamWarning  = best <= TREND_WARNING_MS;
+}
+
+FlowBaseline JamDetector::getBaseline() const
+{
+    FlowBaseline baseline;
+    baseline.meanPermille  = healthyMeanMicro / 1000;
+    baseline.sigmaPermille = (int32_t) isqrt64((uint64_t) (healthyVarianceMilli / 1000));
+    baseline.samples       = healthySamples;
+    return baseline;
+}
+
+void JamDetector::setBaseline(const FlowBaseline& baseline)
+{
+    if (baseline.samples == 0 || baseline.meanPermille <= 0)
+    {
+        return;
+    }
+    healthyMeanMicro     = baseline.meanPermille * 1000;
+    healthyVarianceMilli = (int64_t) baseline.sigmaPermille * baseline.sigmaPermille * 1000;
+    healthySamples       = baseline.samples;
+}
+
+void JamDetector::learnHealthyRatio(int32_t passPermille)
+{
+    if (healthySamples < UINT16_MAX) healthySamples++;
+    uint16_t divisor = healthySamples < ADAPTIVE_EWMA_SAMPLES ? healthySamples : ADAPTIVE_EWMA_SAMPLES;
+
+    // EWMA variance with alpha = 1/divisor: var = (1 - a)(var + a d^2),
+    // d taken from the old mean, so the first sample adds none
+    int32_t diffMicro = passPermille * 1000 - healthyMeanMicro;
+    healthyMeanMicro += diffMicro / divisor;
+    int64_t squareMilli = (int64_t) diffMicro * diffMicro / 1000;
+    healthyVarianceMilli += (squareMilli - squareMilli / divisor - healthyVarianceMilli) / divisor;
+}
+
+int32_t JamDetector::softThresholdPermille(const JamConfig& config) const
+{
+    int32_t configured = ratioToPermille(config.ratioThreshold);
+    if (!config.adaptiveThreshold || healthySamples < ADAPTIVE_MIN_SAMPLES)
+    {
+        return configured;
+    }
+
+    FlowBaseline baseline = getBaseline();
+    int32_t learned = baseline.meanPermille - ADAPTIVE_SIGMAS * baseline.sigmaPermille;
+    if (learned > ADAPTIVE_MAX_PERMILLE) learned = ADAPTIVE_MAX_PERMILLE;
+    return learned > configured ? learned : configured;
 }
 
 void JamDetector::onResume(unsigned long currentTimeMs,
@@ -75,26 +325,55 @@ void JamDetector::onResume(unsigned long currentTimeMs,
     state.graceState  = GraceState::RESUME_GRACE;
     state.graceActive = true;
 
-    resumeGracePulseBaseline  = currentPulseCount;
-    resumeGraceActualBaseline = currentActualMm;
+    gracePulseBaseline        = currentPulseCount;
+    graceHealthyEvals         = 0;
+    resumeGraceActualBaselineUm = mmToUm(currentActualMm);
     resumeGraceStartTimeMs    = currentTimeMs;
 
     // Clear existing jam accumulation so we do not instantly re-trigger
     hardJamAccumulatedMs   = 0;
     softJamAccumulatedMs   = 0;
+    softCusumPermilleMs    = 0;
     state.hardJamPercent   = 0.0f;
     state.softJamPercent   = 0.0f;
     state.jammed           = false;
     state.hardJamTriggered = false;
     state.softJamTriggered = false;
+    clearTrend();
 
     // Clear pause request flag so future jams can be detected
     jamPauseRequested = false;
 }
 
+bool JamDetector::graceFlowSettled(int32_t       expectedRate,
+                                   int32_t       passPermille,
+                                   unsigned long movementPulseCount,
+                                   const JamConfig& config)
+{
+    // Idle evaluations (heating, travel) carry no evidence either way
+    if (isExtruding(expectedRate, config))
+    {
+        if (passPermille >= GRACE_HEALTHY_PERMILLE)
+        {
+            if (graceHealthyEvals < GRACE_HEALTHY_EVALS) graceHealthyEvals++;
+        }
+        else
+        {
+            graceHealthyEvals = 0;
+        }
+    }
+
+    int32_t umPerPulse = config.umPerPulse > 0 ? config.umPerPulse : 1;
+    bool enoughMovement =
+        (movementPulseCount - gracePulseBaseline) >= (unsigned long) ((GRACE_MIN_ACTUAL_UM + umPerPulse - 1) / umPerPulse);
+    return enoughMovement && graceHealthyEvals >= GRACE_HEALTHY_EVALS;
+}
+
 bool JamDetector::evaluateGraceState(unsigned long currentTimeMs,
                                      unsigned long printStartTimeMs,
-                                     float         expectedDistance,
+                                     int32_t       expectedUm,
+                                     int32_t       expectedRate,
+                                     int32_t       passPermille,
                                      unsigned long movementPulseCount,
                                      const JamConfig& config)
 {
@@ -107,15 +386,17 @@ bool JamDetector::evaluateGraceState(unsigned long currentTimeMs,
         case GraceState::START_GRACE:
         {
             unsigned long sinceStart = currentTimeMs - printStartTimeMs;
+            bool settled = graceFlowSettled(expectedRate, passPermille, movementPulseCount, config);
 
-            // Grace period after print start
-            if (sinceStart < config.graceTimeMs)
+            // Grace after print start, until flow is seen to track the
+            // commands; graceTimeMs caps it for a print that starts jammed
+            if (!settled && sinceStart < config.graceTimeMs)
             {
                 state.graceActive = true;
                 return true;
             }
 
-            // Enough time has passed; go active
+            // Flow settled or time ran out; go active
             state.graceState  = GraceState::ACTIVE;
             state.graceActive = false;
             return false;
@@ -123,13 +404,14 @@ bool JamDetector::evaluateGraceState(unsigned long currentTimeMs,
 
         case GraceState::RESUME_GRACE:
         {
-            // Conditions to exit resume grace: enough pulses, enough expected distance, or timeout
-            bool enoughPulses   = (movementPulseCount >= resumeGracePulseBaseline + RESUME_MIN_PULSES);
-            bool enoughExpected = (expectedDistance >= RESUME_GRACE_15MM_THRESHOLD);
+            // Conditions to exit resume grace: healthy flow as at print
+            // start, enough expected distance to judge, or timeout
+            bool settled        = graceFlowSettled(expectedRate, passPermille, movementPulseCount, config);
+            bool enoughExpected = (expectedUm >= RESUME_GRACE_15MM_UM);
             unsigned long sinceResume = currentTimeMs - resumeGraceStartTimeMs;
             bool timeExceeded  = (sinceResume >= config.graceTimeMs);
 
-            if (!enoughPulses && !enoughExpected && !timeExceeded)
+            if (!settled && !enoughExpected && !timeExceeded)
             {
                 state.graceActive = true;
                 return true;  // stay in grace
@@ -154,30 +436,44 @@ bool JamDetector::evaluateGraceState(unsigned long currentTimeMs,
     return false;
 }
 
-bool JamDetector::evaluateHardJam(float         expectedDistance,
-                                  float         passRatio,
-                                  float         expectedRate,
-                                  float         actualRate,
+bool JamDetector::evaluateHardJam(int32_t       expectedUm,
+                                  int32_t       passPermille,
+                                  int32_t       expectedRate,
+                                  int32_t       actualRate,
+                                  bool          edgeStalled,
+                                  bool          lowCount,
+                                  bool          countImprobable,
                                   unsigned long elapsedMs,
                                   const JamConfig& config)
 {
     // Hard jam if:
     //  - we are really extruding
     //  - window has enough distance to be meaningful
-    //  - sensor rate is tiny
+    //  - sensor rate is tiny (time window only; a distance window or a
+    //    Kalman upper bound below the ratio already means barely moving)
     //  - rate ratio is very low
-    bool extrudingNow = (expectedRate >= MIN_EXPECTED_RATE_MM_S);
-
-    bool hardCondition =
-        extrudingNow &&
-        (expectedDistance >= MIN_HARD_WINDOW_MM) &&
-        (actualRate < MIN_ACTUAL_RATE_MM_S) &&
-        (passRatio < HARD_RATE_RATIO);
-
-    // Detect low-speed edge case for diagnostics
-    bool lowSpeedEdgeCase = extrudingNow && 
-                            (expectedRate < 1.0f) && 
-                            (actualRate < MIN_ACTUAL_RATE_MM_S);
+    // When the long window expects only a few pulses, how improbable its
+    // pulse count is also qualifies. It sees a slow partial jam the rate
+    // test misses, but it needs the long window to drain, so it stands
+    // beside the short-window rate test rather than in place of it.
+    // Or, at any speed, the sensor has gone several expected pulse periods
+    // without an edge. That is the evidence the minimum window distance
+    // stands in for, and at 1mm/s it arrives long before the window fills.
+    bool distanceMode = (config.windowMode == WindowMode::DISTANCE);
+    bool extrudingNow = isExtruding(expectedRate, config);
+
+    bool rateCondition =
+        (distanceMode || boundedRatio || actualRate < MIN_ACTUAL_RATE_UM_S) &&
+        (passPermille < HARD_RATE_PERMILLE);
+    bool windowCondition =
+        (expectedUm >= MIN_HARD_WINDOW_UM) &&
+        (rateCondition || countImprobable);
+    bool hardCondition = extrudingNow && (windowCondition || edgeStalled);
+
+    // Detect low-speed edge case for diagnostics (a time-window artefact)
+    bool lowSpeedEdgeCase = !distanceMode && extrudingNow && 
+                            (expectedRate < LOW_SPEED_RATE_UM_S) && 
+                            (actualRate < MIN_ACTUAL_RATE_UM_S);
 
     if (hardCondition)
     {
@@ -187,37 +483,56 @@ bool JamDetector::evaluateHardJam(float         expectedDistance,
             hardJamAccumulatedMs = config.hardJamTimeMs;
         }
 
-        // Diagnostic logging for hard jam conditions
-        if (settingsManager.getVerboseLogging())
+        // Classify the condition (diagnostic logging when verbose)
+        bool verbose = !quiet && settingsManager.getVerboseLogging();
+        if (!windowCondition)
         {
-            if (actualRate < MIN_ACTUAL_RATE_MM_S)
-            {
-                state.tripCode = TripCode::HARD_ZERO_FLOW;
+            state.tripCode = TripCode::HARD_EDGE_STALL;
+            if (verbose)
+                logger.logf("JAM_DEBUG: hard_cond=1 type=EDGE_STALL exp_rate=%.3f act_rate=%.3f pass=%.2f exp_dist=%.1f accum_ms=%u",
+                            umToMm(expectedRate), umToMm(actualRate), permilleToRatio(passPermille),
+                            umToMm(expectedUm), hardJamAccumulatedMs);
+        }
+        else if (!rateCondition)
+        {
+            state.tripCode = TripCode::HARD_LOW_COUNT;
+            if (verbose)
+                logger.logf("JAM_DEBUG: hard_cond=1 type=LOW_COUNT exp_rate=%.3f act_rate=%.3f loglik=%.2f exp_dist=%.1f accum_ms=%u",
+                            umToMm(expectedRate), umToMm(actualRate), state.logLikelihood,
+                            umToMm(expectedUm), hardJamAccumulatedMs);
+        }
+        else if (actualRate < MIN_ACTUAL_RATE_UM_S)
+        {
+            state.tripCode = TripCode::HARD_ZERO_FLOW;
+            if (verbose)
                 logger.logf("JAM_DEBUG: hard_cond=1 type=ZERO_FLOW exp_rate=%.3f act_rate=%.3f pass=%.2f exp_dist=%.1f accum_ms=%u",
-                            expectedRate, actualRate, passRatio, expectedDistance, hardJamAccumulatedMs);
-            }
-            else
-            {
-                state.tripCode = TripCode::HARD_RATE_RATIO;
+                            umToMm(expectedRate), umToMm(actualRate), permilleToRatio(passPermille),
+                            umToMm(expectedUm), hardJamAccumulatedMs);
+        }
+        else
+        {
+            state.tripCode = TripCode::HARD_RATE_RATIO;
+            if (verbose)
                 logger.logf("JAM_DEBUG: hard_cond=1 type=RATE_RATIO exp_rate=%.3f act_rate=%.3f pass=%.2f exp_dist=%.1f accum_ms=%u",
-                            expectedRate, actualRate, passRatio, expectedDistance, hardJamAccumulatedMs);
-            }
+                            umToMm(expectedRate), umToMm(actualRate), permilleToRatio(passPermille),
+                            umToMm(expectedUm), hardJamAccumulatedMs);
         }
     }
     else
     {
         // Recovery: once we are back to good flow, clear
-        if (passRatio >= HARD_RECOVERY_RATIO || !extrudingNow)
+        if (passPermille >= HARD_RECOVERY_PERMILLE || !extrudingNow)
         {
             hardJamAccumulatedMs = 0;
         }
 
         // Log low-speed edge cases for analysis (even when not triggering jam)
-        if (lowSpeedEdgeCase && settingsManager.getVerboseLogging())
+        if (lowSpeedEdgeCase && !quiet && settingsManager.getVerboseLogging())
         {
             state.tripCode = TripCode::LOW_SPEED_ANOMALY;
             logger.logf("LOW_SPEED_TRIP: exp_rate=%.3f act_rate=%.3f pass=%.2f accum_ms=%u (not triggering - pass_ratio ok)",
-                        expectedRate, actualRate, passRatio, hardJamAccumulatedMs);
+                        umToMm(expectedRate), umToMm(actualRate), permilleToRatio(passPermille),
+                        hardJamAccumulatedMs);
         }
     }
 
@@ -235,24 +550,31 @@ bool JamDetector::evaluateHardJam(float         expectedDistance,
     return (hardJamAccumulatedMs >= config.hardJamTimeMs);
 }
 
-bool JamDetector::evaluateSoftJam(float         expectedDistance,
-                                  float         deficit,
-                                  float         passRatio,
-                                  float         expectedRate,
-                                  float         actualRate,
+bool JamDetector::evaluateSoftJam(int32_t       expectedUm,
+                                  int32_t       deficitUm,
+                                  int32_t       passPermille,
+                                  int32_t       expectedRate,
+                                  int32_t       actualRate,
                                   unsigned long elapsedMs,
                                   const JamConfig& config)
 {
     (void)actualRate;  // not strictly needed, but kept for future tuning
 
-    bool extrudingNow = (expectedRate >= MIN_EXPECTED_RATE_MM_S);
+    if (config.softJamAlgorithm == SoftJamAlgorithm::CUSUM)
+    {
+        return evaluateSoftJamCusum(expectedUm, deficitUm, passPermille, expectedRate,
+                                    elapsedMs, config);
+    }
+
+    bool extrudingNow = isExtruding(expectedRate, config);
+    int32_t thresholdPermille = softThresholdPermille(config);
 
     // Soft jam: we are extruding, deficit is slowly growing, and ratio is below threshold
     bool softCondition =
         extrudingNow &&
-        (expectedDistance >= MIN_SOFT_WINDOW_MM) &&
-        (deficit >= MIN_SOFT_DEFICIT_MM) &&
-        (passRatio < config.ratioThreshold);
+        (expectedUm >= MIN_SOFT_WINDOW_UM) &&
+        (deficitUm >= MIN_SOFT_DEFICIT_UM) &&
+        (passPermille < thresholdPermille);
 
     if (softCondition)
     {
@@ -263,11 +585,12 @@ bool JamDetector::evaluateSoftJam(float         expectedDistance,
         }
 
         // Diagnostic logging for soft jam conditions
-        if (settingsManager.getVerboseLogging())
+        state.tripCode = TripCode::SOFT_UNDER_EXT;
+        if (!quiet && settingsManager.getVerboseLogging())
         {
-            state.tripCode = TripCode::SOFT_UNDER_EXT;
             logger.logf("JAM_DEBUG: soft_cond=1 type=UNDER_EXT exp_rate=%.3f act_rate=%.3f pass=%.2f deficit=%.2f accum_ms=%u",
-                        expectedRate, actualRate, passRatio, deficit, softJamAccumulatedMs);
+                        umToMm(expectedRate), umToMm(actualRate), permilleToRatio(passPermille),
+                        umToMm(deficitUm), softJamAccumulatedMs);
         }
     }
     else
@@ -288,7 +611,7 @@ bool JamDetector::evaluateSoftJam(float         expectedDistance,
                 softJamAccumulatedMs = 0;
             }
         }
-        else if (passRatio >= config.ratioThreshold)
+        else if (passPermille >= thresholdPermille)
         {
             // Flow is healthy (above threshold) - decay at 1x rate
             if (softJamAccumulatedMs > elapsedMs)
@@ -318,6 +641,68 @@ bool JamDetector::evaluateSoftJam(float         expectedDistance,
     return (softJamAccumulatedMs >= config.softJamTimeMs);
 }
 
+bool JamDetector::evaluateSoftJamCusum(int32_t       expectedUm,
+                                       int32_t       deficitUm,
+                                       int32_t       passPermille,
+                                       int32_t       expectedRate,
+                                       unsigned long elapsedMs,
+                                       const JamConfig& config)
+{
+    // One-sided CUSUM over the per-evaluation deficit above baseline:
+    // S += (d - b - k) * dt, floored at zero. A sustained extra deficit D
+    // trips after h / (D - k) seconds, so small deficits the timer never
+    // sees still trip, and big ones trip sooner. h is chosen so a deficit
+    // right at the ratio threshold trips in softJamTimeMs, like the timer.
+    int32_t thresholdDeficit = PERMILLE_ONE - ratioToPermille(config.ratioThreshold);
+    int32_t drift = thresholdDeficit - CUSUM_ALLOWANCE_PERMILLE;
+    if (drift < CUSUM_MIN_DRIFT_PERMILLE) drift = CUSUM_MIN_DRIFT_PERMILLE;
+    int32_t limit = drift * (int32_t)config.softJamTimeMs;  // permille-ms
+
+    // The baseline learns from every meaningful window while nothing is
+    // accumulating. A window with less missing than a pulse or two of lag
+    // counts as no extra deficit.
+    bool windowValid = isExtruding(expectedRate, config) && (expectedUm >= MIN_SOFT_WINDOW_UM);
+    int32_t baselinePermille = softBaselineMicro / 1000;
+    int32_t deficitPermille  = windowValid ? (PERMILLE_ONE - passPermille) : baselinePermille;
+
+    if (windowValid && softCusumPermilleMs == 0)
+    {
+        int64_t step = ((int64_t)deficitPermille * 1000 - softBaselineMicro) * (int64_t)elapsedMs /
+                       CUSUM_BASELINE_TAU_MS;
+        softBaselineMicro += (int32_t)step;
+        if (softBaselineMicro > CUSUM_MAX_BASELINE_PERMILLE * 1000) softBaselineMicro = CUSUM_MAX_BASELINE_PERMILLE * 1000;
+        if (softBaselineMicro < -CUSUM_MAX_BASELINE_PERMILLE * 1000) softBaselineMicro = -CUSUM_MAX_BASELINE_PERMILLE * 1000;
+    }
+
+    bool sampleValid = windowValid && (deficitUm >= MIN_SOFT_DEFICIT_UM);
+    if (!sampleValid)
+    {
+        deficitPermille = baselinePermille;
+    }
+
+    softCusumPermilleMs += (deficitPermille - baselinePermille - CUSUM_ALLOWANCE_PERMILLE) * (int32_t)elapsedMs;
+    if (softCusumPermilleMs < 0) softCusumPermilleMs = 0;
+    if (softCusumPermilleMs > limit) softCusumPermilleMs = limit;
+
+    if (sampleValid && deficitPermille - baselinePermille > CUSUM_ALLOWANCE_PERMILLE)
+    {
+        state.tripCode = TripCode::SOFT_UNDER_EXT;
+    }
+    if (sampleValid && deficitPermille - baselinePermille > CUSUM_ALLOWANCE_PERMILLE &&
+        !quiet && settingsManager.getVerboseLogging())
+    {
+        logger.logf("JAM_DEBUG: soft_cond=1 type=CUSUM exp_rate=%.3f pass=%.2f baseline=%.2f deficit=%.2f cusum=%.1f%%",
+                    umToMm(expectedRate), permilleToRatio(passPermille),
+                    permilleToRatio(baselinePermille), umToMm(deficitUm),
+                    100.0f * (float)softCusumPermilleMs / (float)limit);
+    }
+
+    state.softJamPercent = (limit > 0)
+                               ? 100.0f * (float)softCusumPermilleMs / (float)limit
+                               : 0.0f;
+    return limit > 0 && softCusumPermilleMs >= limit;
+}
+
 JamState JamDetector::update(float         expectedDistance,
                              float         actualDistance,
                              unsigned long movementPulseCount,
@@ -328,6 +713,33 @@ JamState JamDetector::update(float         expectedDistance,
                              const JamConfig& config,
                              float         windowedExpectedRateMmPerSec,
                              float         windowedActualRateMmPerSec)
+{
+    return updateUm(mmToUm(expectedDistance),
+                    mmToUm(actualDistance),
+                    movementPulseCount,
+                    isPrinting,
+                    hasTelemetry,
+                    currentTimeMs,
+                    printStartTimeMs,
+                    config,
+                    mmToUm(windowedExpectedRateMmPerSec),
+                    mmToUm(windowedActualRateMmPerSec));
+}
+
+JamState JamDetector::updateUm(int32_t       expectedUm,
+                               int32_t       actualUm,
+                               unsigned long movementPulseCount,
+                               bool          isPrinting,
+                               bool          hasTelemetry,
+                               unsigned long currentTimeMs,
+                               unsigned long printStartTimeMs,
+                               const JamConfig& config,
+                               int32_t       windowedExpectedRateUmPerSec,
+                               int32_t       windowedActualRateUmPerSec,
+                               int32_t       shortExpectedRateUmPerSec,
+                               int32_t       shortActualRateUmPerSec,
+                               int32_t       edgeVelocityUmPerSec,
+                               const FlowEstimate* flowEstimate)
 {
     // If not printing or no telemetry, reset to idle-ish state
     if (!isPrinting || !hasTelemetry)
@@ -341,11 +753,13 @@ JamState JamDetector::update(float         expectedDistance,
             state.softJamTriggered = false;
             hardJamAccumulatedMs   = 0;
             softJamAccumulatedMs   = 0;
+            softCusumPermilleMs    = 0;
+            clearTrend();
         }
 
         lastEvalMs               = currentTimeMs;
-        prevExpectedDistance     = expectedDistance;
-        prevActualDistance       = actualDistance;
+        prevExpectedUm           = expectedUm;
+        prevActualUm             = actualUm;
         state.expectedRateMmPerSec = 0.0f;
         state.actualRateMmPerSec   = 0.0f;
         wasInGrace               = false;
@@ -372,80 +786,142 @@ JamState JamDetector::update(float         expectedDistance,
     }
     lastEvalMs = currentTimeMs;
 
-    float expectedRate = 0.0f;
-    float actualRate   = 0.0f;
+    int32_t expectedRate = 0;
+    int32_t actualRate   = 0;
 
     if (!USE_WINDOWED_RATE_SAMPLES)
     {
         // First derivative: compute rates from windowed distances
-        float dtSec = static_cast<float>(elapsedMs) / 1000.0f;
-        float dExp  = expectedDistance - prevExpectedDistance;
-        float dAct  = actualDistance   - prevActualDistance;
+        int32_t dExp = expectedUm - prevExpectedUm;
+        int32_t dAct = actualUm   - prevActualUm;
 
         // Handle retractions / window resets: treat negative deltas as zero flow
-        if (dExp < 0.0f) dExp = 0.0f;
-        if (dAct < 0.0f) dAct = 0.0f;
-
-        expectedRate = (dtSec > 0.0f) ? (dExp / dtSec) : 0.0f;  // mm/s
-        actualRate   = (dtSec > 0.0f) ? (dAct / dtSec) : 0.0f;  // mm/s
+        if (dExp < 0) dExp = 0;
+        if (dAct < 0) dAct = 0;
 
-        prevExpectedDistance = expectedDistance;
-        prevActualDistance   = actualDistance;
+        expectedRate = (int32_t)((int64_t)dExp * 1000 / (int64_t)elapsedMs);  // um/s
+        actualRate   = (int32_t)((int64_t)dAct * 1000 / (int64_t)elapsedMs);  // um/s
     }
     else
     {
-        expectedRate        = windowedExpectedRateMmPerSec;
-        actualRate          = windowedActualRateMmPerSec;
-        prevExpectedDistance = expectedDistance;
-        prevActualDistance   = actualDistance;
+        expectedRate = windowedExpectedRateUmPerSec;
+        actualRate   = windowedActualRateUmPerSec;
     }
+    prevExpectedUm = expectedUm;
+    prevActualUm   = actualUm;
+
+    if (expectedRate < 0) expectedRate = 0;
+    if (actualRate < 0) actualRate = 0;
+    if (expectedRate > MAX_RATE_UM_S) expectedRate = MAX_RATE_UM_S;
+    if (actualRate > MAX_RATE_UM_S) actualRate = MAX_RATE_UM_S;
 
     // Expose rates for callers / logging
-    state.expectedRateMmPerSec = expectedRate;
-    state.actualRateMmPerSec   = actualRate;
+    state.expectedRateMmPerSec = umToMm(expectedRate);
+    state.actualRateMmPerSec   = umToMm(actualRate);
 
-    // Rate-based pass ratio
-    float passRatio;
-    if (expectedRate > MIN_RATE_FOR_RATIO_MM_S)
+    // Pass ratio: over the last N mm in distance mode, rate-based otherwise
+    int32_t passPermille;
+    if (config.windowMode == WindowMode::DISTANCE)
+    {
+        passPermille = (expectedUm > UM_PER_MM)
+                           ? (int32_t)((int64_t)actualUm * PERMILLE_ONE / expectedUm)
+                           : PERMILLE_ONE;
+    }
+    else if (expectedRate > MIN_RATE_FOR_RATIO_UM_S)
     {
         // expectedRate is guaranteed > 0 here
-        passRatio = actualRate / expectedRate;
+        passPermille = actualRate * PERMILLE_ONE / expectedRate;
     }
     else
     {
         // When flow is tiny, treat as OK to avoid noise on drip moves
-        passRatio = 1.0f;
+        passPermille = PERMILLE_ONE;
+    }
+
+    if (passPermille > MAX_PASS_PERMILLE) passPermille = MAX_PASS_PERMILLE;
+
+    // Hard jams look at the short window so a blockage does not have to
+    // drain the long one first. Extrusion gating and the minimum window
+    // distance stay on the long window, and a short window without enough
+    // commanded flow (e.g. between telemetry chunks) falls back to it.
+    int32_t hardPassPermille = passPermille;
+    int32_t hardActualRate   = actualRate;
+    if (config.windowMode == WindowMode::TIME && shortExpectedRateUmPerSec > MIN_RATE_FOR_RATIO_UM_S)
+    {
+        int32_t shortExpected = shortExpectedRateUmPerSec;
+        int32_t shortActual   = shortActualRateUmPerSec;
+        if (shortExpected > MAX_RATE_UM_S) shortExpected = MAX_RATE_UM_S;
+        if (shortActual < 0) shortActual = 0;
+        if (shortActual > MAX_RATE_UM_S) shortActual = MAX_RATE_UM_S;
+
+        hardActualRate   = shortActual;
+        hardPassPermille = shortActual * PERMILLE_ONE / shortExpected;
+        if (hardPassPermille > MAX_PASS_PERMILLE) hardPassPermille = MAX_PASS_PERMILLE;
     }
 
-    if (passRatio < 0.0f) passRatio = 0.0f;
-    if (passRatio > 1.5f) passRatio = 1.5f;
+    // A Kalman estimate replaces both window ratios. Its band already
+    // carries the pulse quantization the short window and the count
+    // likelihood work around, so both rules take its upper edge instead.
+    boundedRatio = (config.windowMode == WindowMode::TIME) &&
+                   (config.ratioSource == FlowRatioSource::KALMAN) &&
+                   flowEstimate != nullptr && flowEstimate->valid;
+    if (boundedRatio)
+    {
+        expectedRate = flowEstimate->expectedRateUmPerSec;
+        actualRate   = flowEstimate->actualRateUmPerSec;
+        if (expectedRate > MAX_RATE_UM_S) expectedRate = MAX_RATE_UM_S;
+        if (actualRate > MAX_RATE_UM_S) actualRate = MAX_RATE_UM_S;
+        state.expectedRateMmPerSec = umToMm(expectedRate);
+        state.actualRateMmPerSec   = umToMm(actualRate);
+
+        passPermille = flowEstimate->ratioPermille +
+                       KALMAN_BAND_SIGMAS * flowEstimate->ratioSigmaPermille;
+        if (passPermille > MAX_PASS_PERMILLE) passPermille = MAX_PASS_PERMILLE;
+        hardPassPermille = passPermille;
+        hardActualRate   = actualRate;
+    }
 
     // Distance-based deficit (still useful for UI + soft jam gating)
-    float deficit = expectedDistance - actualDistance;
-    if (deficit < 0.0f) deficit = 0.0f;
+    int32_t deficitUm = expectedUm - actualUm;
+    if (deficitUm < 0) deficitUm = 0;
 
     // For UI: smooth a deficit ratio (distance-based) so the graph is not jumpy
-    float deficitRatioValue =
-        (expectedDistance > 1.0f) ? (deficit / expectedDistance) : 0.0f;
-    smoothedDeficitRatio =
-        RATIO_SMOOTHING_ALPHA * deficitRatioValue +
-        (1.0f - RATIO_SMOOTHING_ALPHA) * smoothedDeficitRatio;
+    int32_t deficitPermille =
+        (expectedUm > UM_PER_MM) ? (int32_t)((int64_t)deficitUm * PERMILLE_ONE / expectedUm) : 0;
+    smoothedDeficitPermille +=
+        (deficitPermille - smoothedDeficitPermille) * RATIO_SMOOTHING_ALPHA_PERMILLE / PERMILLE_ONE;
+
+    // A time window at low flow holds only a handful of pulses, so a zero
+    // rate is often just quantization. Ask how likely the count is under
+    // healthy flow instead; windows past the table are unaffected. The
+    // distance window always expects a full N mm and needs no such check.
+    int32_t logLikelihoodMilli = 0;
+    bool lowCount = (config.windowMode == WindowMode::TIME) && !boundedRatio &&
+                    lowCountLogLikelihood(expectedUm, actualUm, config.umPerPulse, logLikelihoodMilli);
+    bool countImprobable =
+        lowCount && logLikelihoodMilli < -(int32_t)(config.likelihoodThreshold * 1000.0f);
+    state.logLikelihood = (float)logLikelihoodMilli / 1000.0f;
 
     // Update state metrics exposed externally
-    state.passRatio = passRatio;   // rate-based
-    state.deficit   = deficit;     // windowed (distance-based)
+    state.passRatio     = permilleToRatio(passPermille);
+    state.deficit       = umToMm(deficitUm);              // windowed (distance-based)
+    state.softThreshold = permilleToRatio(softThresholdPermille(config));
 
     // Initialize grace state at print start if needed
     if (state.graceState == GraceState::IDLE)
     {
-        state.graceState  = GraceState::START_GRACE;
-        state.graceActive = true;
+        state.graceState   = GraceState::START_GRACE;
+        state.graceActive  = true;
+        gracePulseBaseline = movementPulseCount;
+        graceHealthyEvals  = 0;
     }
 
     // Evaluate grace; if active, suppress jam accumulation completely
     bool graceActive = evaluateGraceState(currentTimeMs,
                                           printStartTimeMs,
-                                          expectedDistance,
+                                          expectedUm,
+                                          expectedRate,
+                                          passPermille,
                                           movementPulseCount,
                                           config);
 
@@ -453,11 +929,13 @@ JamState JamDetector::update(float         expectedDistance,
     {
         hardJamAccumulatedMs   = 0;
         softJamAccumulatedMs   = 0;
+        softCusumPermilleMs    = 0;
         state.hardJamPercent   = 0.0f;
         state.softJamPercent   = 0.0f;
         state.jammed           = false;
         state.hardJamTriggered = false;
         state.softJamTriggered = false;
+        clearTrend();
 
         wasInGrace = true;
         return state;
@@ -470,10 +948,13 @@ JamState JamDetector::update(float         expectedDistance,
     if (allowHard)
     {
         state.hardJamTriggered =
-            evaluateHardJam(expectedDistance,
-                            passRatio,
+            evaluateHardJam(expectedUm,
+                            hardPassPermille,
                             expectedRate,
-                            actualRate,
+                            hardActualRate,
+                            edgeVelocityUmPerSec == 0,
+                            lowCount,
+                            countImprobable,
                             elapsedMs,
                             config);
     }
@@ -487,9 +968,9 @@ JamState JamDetector::update(float         expectedDistance,
     if (allowSoft)
     {
         state.softJamTriggered =
-            evaluateSoftJam(expectedDistance,
-                            deficit,
-                            passRatio,
+            evaluateSoftJam(expectedUm,
+                            deficitUm,
+                            passPermille,
                             expectedRate,
                             actualRate,
                             elapsedMs,
@@ -498,6 +979,7 @@ JamState JamDetector::update(float         expectedDistance,
     else
     {
         softJamAccumulatedMs   = 0;
+        softCusumPermilleMs    = 0;
         state.softJamPercent   = 0.0f;
         state.softJamTriggered = false;
     }
@@ -505,8 +987,35 @@ JamState JamDetector::update(float         expectedDistance,
     bool wasJammed = state.jammed;
     state.jammed   = state.hardJamTriggered || state.softJamTriggered;
 
+    // Healthy means extruding a meaningful window with nothing building up
+    if (!state.jammed && isExtruding(expectedRate, config) && expectedUm >= MIN_SOFT_WINDOW_UM &&
+        hardJamAccumulatedMs == 0 && softJamAccumulatedMs == 0 && softCusumPermilleMs == 0)
+    {
+        learnHealthyRatio(passPermille);
+    }
+
+    // Only extruding windows say anything about the deficit; a gap in them
+    // (travel, layer change) starts the fit over
+    if (isExtruding(expectedRate, config) && expectedUm >= MIN_SOFT_WINDOW_UM)
+    {
+        int32_t flowDeficitPermille = PERMILLE_ONE - passPermille;
+        addTrendSample(flowDeficitPermille, currentTimeMs);
+    }
+    else
+    {
+        clearTrend();
+    }
+    bool wasWarning = state.jamWarning;
+    predictTrip(allowHard, allowSoft, config);
+    if (state.jamWarning && !wasWarning && !quiet && settingsManager.getVerboseLogging())
+    {
+        logger.logf("JAM_DEBUG: jam predicted in %.1fs (deficit trend %+.3f/s, pass=%.2f)",
+                    (float) state.timeToJamMs / 1000.0f, state.deficitTrend,
+                    permilleToRatio(passPermille));
+    }
+
     // Logging on jam transitions (kept conservative to avoid spam)
-    if (state.jammed && !wasJammed && settingsManager.getVerboseLogging())
+    if (state.jammed && !wasJammed && !quiet && settingsManager.getVerboseLogging())
     {
         const char* jamType = "soft";
         if (state.hardJamTriggered && state.softJamTriggered)
@@ -523,14 +1032,14 @@ JamState JamDetector::update(float         expectedDistance,
             "win_exp=%.2f win_sns=%.2f deficit=%.2f "
             "rate_exp=%.3f rate_sns=%.3f pass=%.2f",
             jamType,
-            expectedDistance,
-            actualDistance,
-            deficit,
-            expectedRate,
-            actualRate,
-            passRatio);
-    }
-    else if (!state.jammed && wasJammed && !jamPauseRequested)
+            umToMm(expectedUm),
+            umToMm(actualUm),
+            umToMm(deficitUm),
+            umToMm(expectedRate),
+            umToMm(actualRate),
+            permilleToRatio(passPermille));
+    }
+    else if (!state.jammed && wasJammed && !jamPauseRequested && !quiet)
     {
         logger.log("Filament flow resumed");
     }
@@ -6,12 +6,16 @@
 
 #include <Arduino.h>
 
+#include "FilamentMotionSensor.h"
+#include "FlowRatioEstimator.h"
+#include "FlowUnits.h"
+
 // Grace period states for jam detection
 enum class GraceState : uint8_t
 {
     IDLE = 0,      // Not printing, no detection
-    START_GRACE,   // Print just started, time-based grace active
-    RESUME_GRACE,  // Resumed after pause, waiting for movement
+    START_GRACE,   // Print just started, waiting for healthy flow (graceTimeMs cap)
+    RESUME_GRACE,  // Resumed after pause, waiting for healthy flow or movement
     ACTIVE,        // Actively detecting jams
     JAMMED         // Jam detected and latched
 };
@@ -24,6 +28,20 @@ enum class DetectionMode : uint8_t
     SOFT_ONLY = 2   // Only soft jam detection is active
 };
 
+// Soft jam decision rule
+enum class SoftJamAlgorithm : uint8_t
+{
+    TIMER = 0,  // Accumulate time while the pass ratio is below threshold
+    CUSUM = 1   // Sequential: accumulate deficit beyond an allowance (CUSUM)
+};
+
+// Where the pass ratio comes from in TIME mode
+enum class FlowRatioSource : uint8_t
+{
+    WINDOW = 0,  // Window rates (long window for soft, short window for hard)
+    KALMAN = 1   // FlowRatioEstimator, judged on the upper edge of its band
+};
+
 // Trip classification codes for debugging and diagnostics
 enum class TripCode : uint8_t
 {
@@ -32,6 +50,8 @@ enum class TripCode : uint8_t
     HARD_RATE_RATIO   = 2,   // Hard: rate ratio below threshold
     SOFT_UNDER_EXT    = 3,   // Soft: sustained under-extrusion
     LOW_SPEED_ANOMALY = 4,   // Diagnostic: low expected rate edge case
+    HARD_EDGE_STALL   = 5,   // Hard: no sensor edge for several expected periods
+    HARD_LOW_COUNT    = 6,   // Hard: pulse count improbable for a low-count window
 };
 
 // Jam detection result
@@ -42,13 +62,27 @@ struct JamState
     bool       softJamTriggered;     // True if soft jam (sustained under-extrusion)
     float      hardJamPercent;       // Hard jam progress (0-100%)
     float      softJamPercent;       // Soft jam progress (0-100%)
-    float      passRatio;            // Current pass ratio (actual/expected), rate-based
+    float      passRatio;            // Current pass ratio (actual/expected), rate-based in TIME mode
     float      deficit;              // Current deficit in mm (windowed)
     float      expectedRateMmPerSec; // Derived expected flow rate (mm/s)
     float      actualRateMmPerSec;   // Derived sensor flow rate (mm/s)
     GraceState graceState;           // Current grace period state
     bool       graceActive;          // True if any grace is active
     TripCode   tripCode;             // Current trip classification (for debugging)
+    float      logLikelihood;        // ln P(pulse count | healthy flow) for low-count windows, else 0
+    float      softThreshold;        // Soft pass-ratio threshold in effect (learned or configured)
+    float      deficitTrend;         // Fitted flow deficit slope (fraction of expected per second)
+    int32_t    timeToJamMs;          // Predicted time until a trip (ms): 0 = jammed, -1 = none in sight
+    bool       jamWarning;           // A trip is predicted within the warning horizon
+};
+
+// Healthy pass-ratio statistics a JamDetector has learned, in a form that
+// can be stored between prints
+struct FlowBaseline
+{
+    int32_t  meanPermille;   // EWMA mean pass ratio while healthy
+    int32_t  sigmaPermille;  // EWMA standard deviation
+    uint16_t samples;        // Healthy evaluations behind it (saturates)
 };
 
 // Configuration for jam detection (stored separately to save RAM)
@@ -58,8 +92,14 @@ struct JamConfig
     float        hardJamMm;        // Hard jam window threshold (mm)
     uint16_t     softJamTimeMs;    // Soft jam accumulation time (ms)
     uint16_t     hardJamTimeMs;    // Hard jam accumulation time (ms)
-    uint16_t     graceTimeMs;      // Grace period after print start and resume (ms)
+    uint16_t     graceTimeMs;      // Longest grace after print start and resume (ms)
     DetectionMode detectionMode = DetectionMode::BOTH;
+    WindowMode   windowMode    = WindowMode::TIME;  // Must match the sensor feeding update()
+    float        likelihoodThreshold = 4.5f;  // Low-count windows trip below ln P = -threshold (nats)
+    int32_t      umPerPulse    = 2880;        // Sensor resolution for the pulse-count likelihood
+    SoftJamAlgorithm softJamAlgorithm = SoftJamAlgorithm::TIMER;
+    FlowRatioSource  ratioSource      = FlowRatioSource::WINDOW;
+    bool         adaptiveThreshold = false;   // Timer soft jams use max(ratioThreshold, learned mean - k sigma)
 };
 
 /**
@@ -90,7 +130,40 @@ public:
                   float         currentActualMm);
 
     /**
-     * Update jam detection state.
+     * Update jam detection state (integer hot path).
+     * @param expectedUm          Windowed expected distance (um).
+     * @param actualUm            Windowed actual distance (um).
+     * @param expectedRateUmPerSec Windowed expected rate (um/s).
+     * @param actualRateUmPerSec  Windowed actual rate (um/s).
+     * @param shortExpectedRateUmPerSec Short-window expected rate (um/s), or -1.
+     * @param shortActualRateUmPerSec   Short-window actual rate (um/s), or -1.
+     * @param edgeVelocityUmPerSec      Inter-edge velocity (um/s): 0 = stalled, -1 = unknown.
+     * Hard jams are judged on the short window when one is supplied (TIME
+     * mode only), and an edge stall counts as a hard jam condition in either
+     * mode. In TIME mode a window expecting only a few pulses also counts
+     * as hard when its pulse count is improbable (config.likelihoodThreshold),
+     * alongside the rate rule. Remaining parameters as for update(). JamState is still reported
+     * in mm.
+     * @param flowEstimate Kalman flow estimate, used in TIME mode when
+     *                     config.ratioSource is KALMAN and it is valid.
+     */
+    JamState updateUm(int32_t            expectedUm,
+                      int32_t            actualUm,
+                      unsigned long      movementPulseCount,
+                      bool               isPrinting,
+                      bool               hasTelemetry,
+                      unsigned long      currentTimeMs,
+                      unsigned long      printStartTimeMs,
+                      const JamConfig&   config,
+                      int32_t            expectedRateUmPerSec,
+                      int32_t            actualRateUmPerSec,
+                      int32_t            shortExpectedRateUmPerSec = -1,
+                      int32_t            shortActualRateUmPerSec   = -1,
+                      int32_t            edgeVelocityUmPerSec      = -1,
+                      const FlowEstimate* flowEstimate             = nullptr);
+
+    /**
+     * Update jam detection state (float wrapper around updateUm()).
      * @param expectedDistance    Windowed expected distance (mm).
      * @param actualDistance      Windowed actual distance (mm).
      * @param movementPulseCount  Total pulse count.
@@ -132,6 +205,24 @@ public:
      */
     void clearPauseRequest() { jamPauseRequested = false; }
 
+    /**
+     * Silence all logging, e.g. for shadow detectors evaluated alongside
+     * the active one. Survives reset().
+     */
+    void setQuiet(bool enabled) { quiet = enabled; }
+
+    /**
+     * Healthy pass-ratio statistics learned so far (reset() clears them).
+     * samples stays 0 until the first healthy evaluation.
+     */
+    FlowBaseline getBaseline() const;
+
+    /**
+     * Start from statistics learned on an earlier print, e.g. after reset()
+     * at print start; learning carries on from there.
+     */
+    void setBaseline(const FlowBaseline& baseline);
+
 private:
     // Current state
     JamState state;
@@ -140,50 +231,103 @@ private:
     uint16_t hardJamAccumulatedMs;
     uint16_t softJamAccumulatedMs;
 
+    // CUSUM soft jam statistic (permille of deficit x ms) and the healthy
+    // deficit it is measured against (permille x 1000)
+    int32_t softCusumPermilleMs;
+    int32_t softBaselineMicro;
+
     // Last evaluation time (for delta calculations)
     unsigned long lastEvalMs;
 
     // Last pulse count (for diagnostics and resume grace)
     unsigned long lastPulseCount;
 
-    // Resume grace tracking
-    unsigned long resumeGracePulseBaseline;
-    float         resumeGraceActualBaseline;
+    // Grace tracking: pulses when grace began and the current run of
+    // healthy evaluations that ends it early
+    unsigned long gracePulseBaseline;
+    uint8_t       graceHealthyEvals;
+    int32_t       resumeGraceActualBaselineUm;
     unsigned long resumeGraceStartTimeMs;
 
-    // Previous windowed distances (for rate derivation)
-    float prevExpectedDistance;
-    float prevActualDistance;
+    // Previous windowed distances in um (for rate derivation)
+    int32_t prevExpectedUm;
+    int32_t prevActualUm;
 
     // Flags (bit fields to save RAM)
     bool jamPauseRequested : 1;
     bool wasInGrace        : 1;  // Track grace transitions for logging
+    bool boundedRatio      : 1;  // Pass ratio is a Kalman upper bound this update
+    bool quiet             : 1;  // Never logs (shadow detectors)
+
+    // Smoothed deficit ratio for display (EWMA, permille)
+    int32_t smoothedDeficitPermille;
+
+    // Pass ratio while healthy (EWMA): mean in permille x 1000, variance
+    // in permille^2 x 1000, and how many evaluations fed them
+    int32_t  healthyMeanMicro;
+    int64_t  healthyVarianceMilli;
+    uint16_t healthySamples;
 
-    // Smoothed deficit ratio for display (EWMA)
-    float smoothedDeficitRatio;
+    // Learn from one evaluation of healthy flow
+    void learnHealthyRatio(int32_t passPermille);
+    // Soft pass-ratio threshold in effect (permille)
+    int32_t softThresholdPermille(const JamConfig& config) const;
+
+    // Flow deficit (permille) over the last TREND_SAMPLES extruding
+    // evaluations, with running sums for a sliding least-squares line:
+    // sum of y and sum of x * y, x counting evaluations from the oldest
+    static const uint8_t TREND_SAMPLES = 16;  // 4s at 4Hz
+    int16_t       trendDeficit[TREND_SAMPLES];
+    unsigned long trendTimeMs[TREND_SAMPLES];
+    uint8_t       trendHead;
+    uint8_t       trendCount;
+    int32_t       trendSumY;
+    int32_t       trendSumXY;
+
+    void clearTrend();
+    void addTrendSample(int32_t deficitPermille, unsigned long currentTimeMs);
+    // Extrapolate the fit and the accumulators to the next trip
+    void predictTrip(bool allowHard, bool allowSoft, const JamConfig& config);
 
     // Grace period helper
     bool evaluateGraceState(unsigned long currentTimeMs,
                             unsigned long printStartTimeMs,
-                            float         expectedDistance,
+                            int32_t       expectedUm,
+                            int32_t       expectedRate,
+                            int32_t       passPermille,
                             unsigned long movementPulseCount,
                             const JamConfig& config);
+    // Flow has looked healthy for long enough to trust the detector
+    bool graceFlowSettled(int32_t       expectedRate,
+                          int32_t       passPermille,
+                          unsigned long movementPulseCount,
+                          const JamConfig& config);
 
-    // Jam condition evaluators (rate-based)
-    bool evaluateHardJam(float          expectedDistance,
-                         float          passRatio,
-                         float          expectedRate,
-                         float          actualRate,
+    // Jam condition evaluators (rate-based, um / um/s / permille)
+    bool evaluateHardJam(int32_t        expectedUm,
+                         int32_t        passPermille,
+                         int32_t        expectedRate,
+                         int32_t        actualRate,
+                         bool           edgeStalled,
+                         bool           lowCount,
+                         bool           countImprobable,
                          unsigned long  elapsedMs,
                          const JamConfig& config);
 
-    bool evaluateSoftJam(float          expectedDistance,
-                         float          deficit,
-                         float          passRatio,
-                         float          expectedRate,
-                         float          actualRate,
+    bool evaluateSoftJam(int32_t        expectedUm,
+                         int32_t        deficitUm,
+                         int32_t        passPermille,
+                         int32_t        expectedRate,
+                         int32_t        actualRate,
                          unsigned long  elapsedMs,
                          const JamConfig& config);
+
+    bool evaluateSoftJamCusum(int32_t        expectedUm,
+                              int32_t        deficitUm,
+                              int32_t        passPermille,
+                              int32_t        expectedRate,
+                              unsigned long  elapsedMs,
+                              const JamConfig& config);
 };
 
 #endif  // JAM_DETECTOR_IFACE_H
@@ -0,0 +1,50 @@
+// This file is generated by tools/gen_poisson_table.py. Do not edit.
+#ifndef POISSON_TABLE_H
+#define POISSON_TABLE_H
+
+#include <stdint.h>
+
+// ln P(K <= k | lambda) in milli-nats, lambda = row / STEPS_PER_PULSE
+namespace PoissonTable {
+    constexpr int32_t STEPS_PER_PULSE = 4;
+    constexpr int32_t LAMBDA_ROWS     = 33;
+    constexpr int32_t MAX_K           = 12;
+
+    static const int16_t LOG_CDF_MILLI[LAMBDA_ROWS][MAX_K] = {
+        {     0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0,      0},  // lambda 0.00
+        {  -250,    -27,     -2,      0,      0,      0,      0,      0,      0,      0,      0,      0},  // lambda 0.25
+        {  -500,    -95,    -14,     -2,      0,      0,      0,      0,      0,      0,      0,      0},  // lambda 0.50
+        {  -750,   -190,    -41,     -7,     -1,      0,      0,      0,      0,      0,      0,      0},  // lambda 0.75
+        { -1000,   -307,    -84,    -19,     -4,     -1,      0,      0,      0,      0,      0,      0},  // lambda 1.00
+        { -1250,   -439,   -141,    -39,     -9,     -2,      0,      0,      0,      0,      0,      0},  // lambda 1.25
+        { -1500,   -584,   -212,    -68,    -19,     -4,     -1,      0,      0,      0,      0,      0},  // lambda 1.50
+        { -1750,   -738,   -296,   -106,    -33,     -9,     -2,      0,      0,      0,      0,      0},  // lambda 1.75
+        { -2000,   -901,   -391,   -154,    -54,    -17,     -5,     -1,      0,      0,      0,      0},  // lambda 2.00
+        { -2250,  -1071,   -495,   -211,    -81,    -28,     -8,     -2,     -1,      0,      0,      0},  // lambda 2.25
+        { -2500,  -1247,   -609,   -278,   -115,    -43,    -14,     -4,     -1,      0,      0,      0},  // lambda 2.50
+        { -2750,  -1428,   -731,   -352,   -156,    -63,    -23,     -7,     -2,     -1,      0,      0},  // lambda 2.75
+        { -3000,  -1614,   -860,   -435,   -204,    -88,    -34,    -12,     -4,     -1,      0,      0},  // lambda 3.00
+        { -3250,  -1803,   -995,   -525,   -259,   -118,    -49,    -18,     -6,     -2,     -1,      0},  // lambda 3.25
+        { -3500,  -1996,  -1137,   -622,   -321,   -154,    -68,    -27,    -10,     -3,     -1,      0},  // lambda 3.50
+        { -3750,  -2192,  -1283,   -726,   -389,   -195,    -90,    -38,    -15,     -5,     -2,     -1},  // lambda 3.75
+        { -4000,  -2391,  -1435,   -836,   -464,   -242,   -117,    -52,    -22,     -8,     -3,     -1},  // lambda 4.00
+        { -4250,  -2592,  -1591,   -951,   -545,   -294,   -149,    -70,    -30,    -12,     -4,     -2},  // lambda 4.25
+        { -4500,  -2795,  -1751,  -1072,   -631,   -352,   -185,    -91,    -41,    -17,     -7,     -2},  // lambda 4.50
+        { -4750,  -3001,  -1915,  -1198,   -723,   -416,   -226,   -115,    -54,    -24,    -10,     -4},  // lambda 4.75
+        { -5000,  -3208,  -2082,  -1328,   -820,   -485,   -272,   -143,    -71,    -32,    -14,     -5},  // lambda 5.00
+        { -5250,  -3417,  -2253,  -1462,   -922,   -558,   -322,   -175,    -90,    -43,    -19,     -8},  // lambda 5.25
+        { -5500,  -3628,  -2426,  -1601,  -1029,   -637,   -377,   -211,   -112,    -55,    -26,    -11},  // lambda 5.50
+        { -5750,  -3840,  -2602,  -1743,  -1140,   -720,   -436,   -252,   -137,    -70,    -34,    -15},  // lambda 5.75
+        { -6000,  -4054,  -2781,  -1889,  -1255,   -808,   -500,   -296,   -166,    -88,    -44,    -20},  // lambda 6.00
+        { -6250,  -4269,  -2962,  -2038,  -1374,   -900,   -569,   -344,   -198,   -108,    -55,    -27},  // lambda 6.25
+        { -6500,  -4485,  -3146,  -2191,  -1498,   -997,   -641,   -396,   -234,   -131,    -69,    -34},  // lambda 6.50
+        { -6750,  -4702,  -3331,  -2346,  -1624,  -1097,   -718,   -453,   -273,   -157,    -85,    -44},  // lambda 6.75
+        { -7000,  -4921,  -3519,  -2504,  -1755,  -1202,   -799,   -513,   -316,   -186,   -104,    -55},  // lambda 7.00
+        { -7250,  -5140,  -3708,  -2665,  -1888,  -1310,   -884,   -577,   -362,   -218,   -125,    -68},  // lambda 7.25
+        { -7500,  -5360,  -3899,  -2828,  -2024,  -1421,   -972,   -645,   -413,   -253,   -148,    -83},  // lambda 7.50
+        { -7750,  -5581,  -4092,  -2993,  -2164,  -1536,  -1065,   -717,   -466,   -292,   -174,   -100},  // lambda 7.75
+        { -8000,  -5803,  -4286,  -3161,  -2306,  -1654,  -1160,   -792,   -523,   -333,   -203,   -119},  // lambda 8.00
+    };
+}
+
+#endif  // POISSON_TABLE_H
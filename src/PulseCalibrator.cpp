@@ -0,0 +1,109 @@
+#include "PulseCalibrator.h"
+
+#include <math.h>
+
+namespace
+{
+    // Memory of about 1 / (1 - lambda) = 200 segments (~10m of filament)
+    constexpr float FORGETTING = 0.995f;
+
+    // Large initial P: the first segment all but replaces the configured value
+    constexpr float INITIAL_GAIN = 1.0f;
+
+    // Residual variance is averaged over the first segments, then an EWMA
+    constexpr uint16_t RESIDUAL_EWMA_SEGMENTS = 32;
+
+    // Converged once the 95% interval is within this fraction of the estimate
+    constexpr float CONVERGED_CI_FRACTION = 0.02f;
+    constexpr float CI_95_SIGMAS          = 1.96f;
+}
+
+PulseCalibrator::PulseCalibrator()
+{
+    reset(2880);
+}
+
+void PulseCalibrator::reset(int32_t configuredUmPerPulse)
+{
+    estimate           = (float) configuredUmPerPulse;
+    gain               = INITIAL_GAIN;
+    residualVar        = 0.0f;
+    segments           = 0;
+    segmentOpen        = false;
+    segmentStartUm     = 0;
+    segmentStartPulses = 0;
+}
+
+void PulseCalibrator::update(int32_t totalExpectedUm, unsigned long totalPulses, bool healthy)
+{
+    // Restart on unhealthy flow or when the totals went backwards (retraction,
+    // tracking reset); the next healthy call opens a fresh segment
+    if (!healthy || (segmentOpen && (totalExpectedUm < segmentStartUm || totalPulses < segmentStartPulses)))
+    {
+        segmentOpen = false;
+    }
+    if (!healthy)
+    {
+        return;
+    }
+    if (!segmentOpen)
+    {
+        segmentOpen        = true;
+        segmentStartUm     = totalExpectedUm;
+        segmentStartPulses = totalPulses;
+        return;
+    }
+
+    int32_t expectedUm = totalExpectedUm - segmentStartUm;
+    if (expectedUm < SEGMENT_UM)
+    {
+        return;
+    }
+
+    unsigned long pulses = totalPulses - segmentStartPulses;
+    if (pulses > 0)
+    {
+        addSegment((float) pulses, (float) expectedUm);
+    }
+    segmentStartUm     = totalExpectedUm;
+    segmentStartPulses = totalPulses;
+}
+
+void PulseCalibrator::addSegment(float pulses, float expectedUm)
+{
+    // Scalar RLS: y = theta * x with forgetting
+    float residual   = expectedUm - estimate * pulses;
+    float innovation = 1.0f + gain * pulses * pulses;
+    float k          = gain * pulses / innovation;
+    estimate        += k * residual;
+    gain             = (gain - k * pulses * gain) / FORGETTING;
+
+    if (segments < UINT16_MAX) segments++;
+
+    // The first residual is against the configured value, not the fit
+    if (segments > 1)
+    {
+        uint16_t n      = segments - 1;
+        float    weight = 1.0f / (float) (n < RESIDUAL_EWMA_SEGMENTS ? n : RESIDUAL_EWMA_SEGMENTS);
+        residualVar    += (residual * residual / innovation - residualVar) * weight;
+    }
+}
+
+PulseCalibration PulseCalibrator::getCalibration() const
+{
+    PulseCalibration calibration;
+    calibration.umPerPulse   = estimate;
+    calibration.ciUmPerPulse = (segments > 1) ? CI_95_SIGMAS * sqrtf(residualVar * gain) : 0.0f;
+    calibration.segments     = segments;
+    calibration.converged    = segments >= MIN_SEGMENTS &&
+                               calibration.ciUmPerPulse <= CONVERGED_CI_FRACTION * estimate &&
+                               estimate >= (float) MIN_UM_PER_PULSE &&
+                               estimate <= (float) MAX_UM_PER_PULSE;
+    return calibration;
+}
+
+int32_t PulseCalibrator::getConvergedUmPerPulse() const
+{
+    PulseCalibration calibration = getCalibration();
+    return calibration.converged ? (int32_t) lroundf(calibration.umPerPulse) : 0;
+}
@@ -0,0 +1,72 @@
+#ifndef PULSE_CALIBRATOR_H
+#define PULSE_CALIBRATOR_H
+
+#include <stdint.h>
+
+/**
+ * Sensor resolution estimate with its 95% confidence interval.
+ */
+struct PulseCalibration
+{
+    float    umPerPulse;      // Current estimate
+    float    ciUmPerPulse;    // 95% confidence half-width
+    uint16_t segments;        // Healthy segments folded in this print
+    bool     converged;       // Narrow enough to drive the live pipeline
+};
+
+/**
+ * Online calibration of movement_mm_per_pulse from healthy extrusion.
+ *
+ * Commanded extrusion and sensor pulses are cut into segments of about
+ * SEGMENT_UM commanded filament, and each segment is one observation of
+ * expectedUm = umPerPulse * pulses for a scalar recursive least-squares
+ * fit with slow forgetting. Segments are contiguous, so the constant lag
+ * between command and sensor cancels instead of biasing the fit, and a
+ * segment is dropped whenever the caller reports unhealthy flow (grace,
+ * jam building up, retraction), so clogs never teach it anything.
+ *
+ * Runs once per segment (every few seconds), so floats are fine here.
+ */
+class PulseCalibrator
+{
+  public:
+    static const int32_t  SEGMENT_UM       = 50000;  // ~17 pulses at the 2.88mm sensor spec
+    static const uint16_t MIN_SEGMENTS     = 12;     // ~600mm of healthy extrusion
+    static const int32_t  MIN_UM_PER_PULSE = 2500;   // Plausible range for the SFS 2.0
+    static const int32_t  MAX_UM_PER_PULSE = 3500;
+
+    PulseCalibrator();
+
+    /**
+     * Start a print from the configured value, with no confidence in it.
+     */
+    void reset(int32_t configuredUmPerPulse);
+
+    /**
+     * Feed the cumulative commanded extrusion and pulse count (call on each
+     * detector evaluation).
+     * @param healthy False drops the segment in progress.
+     */
+    void update(int32_t totalExpectedUm, unsigned long totalPulses, bool healthy);
+
+    PulseCalibration getCalibration() const;
+
+    /**
+     * Converged estimate rounded to whole um, or 0 if not converged.
+     */
+    int32_t getConvergedUmPerPulse() const;
+
+  private:
+    float    estimate;        // um per pulse
+    float    gain;            // RLS P, in (um/pulse)^2 per unit residual variance
+    float    residualVar;     // One-step residual variance (um^2)
+    uint16_t segments;
+
+    bool          segmentOpen;
+    int32_t       segmentStartUm;
+    unsigned long segmentStartPulses;
+
+    void addSegment(float pulses, float expectedUm);
+};
+
+#endif  // PULSE_CALIBRATOR_H
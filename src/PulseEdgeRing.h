@@ -0,0 +1,86 @@
+#ifndef PULSE_EDGE_RING_H
+#define PULSE_EDGE_RING_H
+
+#include <atomic>
+#include <stdint.h>
+
+/**
+ * PulseEdgeRing - Lock-free single-producer/single-consumer edge timestamp queue
+ *
+ * The movement sensor ISR pushes one microsecond timestamp per rising edge and
+ * the main loop drains them, so each pulse can be attributed to the moment it
+ * actually happened rather than the moment the loop got around to reading it.
+ *
+ * Producer (ISR) only writes head, consumer (loop) only writes tail. When the
+ * ring is full the edge is dropped and counted in overflowCount(); callers keep
+ * a separate total edge counter so a dropped timestamp never loses the pulse.
+ *
+ * Capacity must be a power of two.
+ */
+template <uint32_t Capacity>
+class PulseEdgeRing
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "PulseEdgeRing capacity must be a power of two");
+
+   public:
+    PulseEdgeRing() : head(0), tail(0), overflows(0) {}
+
+    // Producer side (ISR context). Returns false if the edge was dropped.
+    inline bool push(uint32_t timestampUs)
+    {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        uint32_t t = tail.load(std::memory_order_acquire);
+        if ((h - t) >= Capacity)
+        {
+            overflows.store(overflows.load(std::memory_order_relaxed) + 1,
+                            std::memory_order_relaxed);
+            return false;
+        }
+        slots[h & MASK] = timestampUs;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side (main loop). Returns false when empty.
+    inline bool pop(uint32_t &timestampUs)
+    {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        uint32_t h = head.load(std::memory_order_acquire);
+        if (t == h)
+        {
+            return false;
+        }
+        timestampUs = slots[t & MASK];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: discard everything currently queued
+    inline void clear()
+    {
+        tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    inline uint32_t size() const
+    {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    inline uint32_t overflowCount() const
+    {
+        return overflows.load(std::memory_order_relaxed);
+    }
+
+    static constexpr uint32_t capacity() { return Capacity; }
+
+   private:
+    static constexpr uint32_t MASK = Capacity - 1;
+
+    volatile uint32_t     slots[Capacity];
+    std::atomic<uint32_t> head;       // Next slot the producer writes
+    std::atomic<uint32_t> tail;       // Next slot the consumer reads
+    std::atomic<uint32_t> overflows;  // Edges dropped because the ring was full
+};
+
+#endif  // PULSE_EDGE_RING_H
@@ -0,0 +1,151 @@
+#include "PulseSource.h"
+
+#if PULSE_SOURCE_HAS_PCNT
+#include <driver/pcnt.h>
+#endif
+
+uint32_t PulseSource::takeNewPulses()
+{
+    uint32_t current = readCount();
+    uint32_t delta   = current - lastTakenCount;
+    lastTakenCount   = current;
+    return delta;
+}
+
+void PulseSource::syncCount()
+{
+    lastTakenCount = readCount();
+    discardEdgeTimestamps();
+}
+
+unsigned long PulseSource::nextEdgeTimeMs(unsigned long nowMs, uint32_t nowUs)
+{
+    uint32_t edgeUs = 0;
+    if (!popEdgeTimestamp(edgeUs))
+    {
+        return nowMs;
+    }
+    // Age in the microsecond domain so micros() wraparound is harmless
+    return nowMs - ((nowUs - edgeUs) / 1000UL);
+}
+
+PulseSource &PulseSource::selectForPin(int pin)
+{
+#if PULSE_SOURCE_HAS_PCNT
+    static PcntPulseSource pcntSource;
+    if (pcntSource.begin(pin))
+    {
+        return pcntSource;
+    }
+#endif
+    static GpioIsrPulseSource gpioSource;
+    gpioSource.begin(pin);
+    return gpioSource;
+}
+
+// ============================================================================
+// GPIO INTERRUPT BACKEND
+// ============================================================================
+volatile uint32_t GpioIsrPulseSource::isrCount = 0;
+PulseEdgeRing<GpioIsrPulseSource::EDGE_RING_CAPACITY> GpioIsrPulseSource::edgeRing;
+
+bool GpioIsrPulseSource::begin(int pin)
+{
+    // Rising edge trigger: counts each time sensor goes LOW→HIGH
+    pinMode(pin, INPUT);
+    attachInterrupt(digitalPinToInterrupt(pin), GpioIsrPulseSource::onEdgeISR, RISING);
+    lastTakenCount = isrCount;
+    edgeRing.clear();
+    return true;
+}
+
+uint32_t GpioIsrPulseSource::readCount()
+{
+    return isrCount;
+}
+
+bool GpioIsrPulseSource::popEdgeTimestamp(uint32_t &timestampUs)
+{
+    return edgeRing.pop(timestampUs);
+}
+
+void GpioIsrPulseSource::discardEdgeTimestamps()
+{
+    edgeRing.clear();
+}
+
+uint32_t GpioIsrPulseSource::getEdgeOverflows() const
+{
+    return edgeRing.overflowCount();
+}
+
+// Execution time: ~2-3 microseconds (very fast, safe for ISR). The counter
+// guarantees no pulses are dropped; the ring lets the loop attribute each
+// pulse to when it actually happened.
+void IRAM_ATTR GpioIsrPulseSource::onEdgeISR()
+{
+    isrCount = isrCount + 1;
+    edgeRing.push((uint32_t) micros());
+}
+
+// ============================================================================
+// PCNT BACKEND
+// ============================================================================
+#if PULSE_SOURCE_HAS_PCNT
+bool PcntPulseSource::begin(int pin)
+{
+    pcnt_config_t config = {};
+    config.pulse_gpio_num = pin;
+    config.ctrl_gpio_num  = PCNT_PIN_NOT_USED;
+    config.channel        = PCNT_CHANNEL_0;
+    config.unit           = PCNT_UNIT_0;
+    config.pos_mode       = PCNT_COUNT_INC;  // Rising edge, same as the ISR backend
+    config.neg_mode       = PCNT_COUNT_DIS;
+    config.lctrl_mode     = PCNT_MODE_KEEP;
+    config.hctrl_mode     = PCNT_MODE_KEEP;
+    config.counter_h_lim  = PCNT_HIGH_LIMIT;
+    config.counter_l_lim  = 0;
+
+    if (pcnt_unit_config(&config) != ESP_OK)
+    {
+        return false;
+    }
+
+    pcnt_set_filter_value(PCNT_UNIT_0, GLITCH_FILTER_APB_CYCLES);
+    pcnt_filter_enable(PCNT_UNIT_0);
+    pcnt_counter_pause(PCNT_UNIT_0);
+    pcnt_counter_clear(PCNT_UNIT_0);
+    pcnt_counter_resume(PCNT_UNIT_0);
+
+    started        = true;
+    lastRaw        = 0;
+    total          = 0;
+    lastTakenCount = 0;
+    return true;
+}
+
+uint32_t PcntPulseSource::readCount()
+{
+    if (!started)
+    {
+        return total;
+    }
+
+    int16_t raw = 0;
+    if (pcnt_get_counter_value(PCNT_UNIT_0, &raw) != ESP_OK)
+    {
+        return total;
+    }
+
+    // The hardware counter resets to 0 on reaching h_lim, so fold the
+    // 16-bit value into a 32-bit total. Needs one read per 32k edges.
+    int32_t delta = (int32_t) raw - (int32_t) lastRaw;
+    if (delta < 0)
+    {
+        delta += PCNT_HIGH_LIMIT;
+    }
+    lastRaw = raw;
+    total  += (uint32_t) delta;
+    return total;
+}
+#endif
@@ -0,0 +1,129 @@
+#ifndef PULSE_SOURCE_H
+#define PULSE_SOURCE_H
+
+#include <Arduino.h>
+
+#include "PulseEdgeRing.h"
+
+// PCNT is present on ESP32/S2/S3 but not on the C3. It cannot timestamp
+// edges, which edge velocity and per-edge window placement rely on, so the
+// GPIO interrupt is the default everywhere. Define PULSE_SOURCE_USE_PCNT in
+// a board's build_flags to count in PCNT instead.
+#if defined(ESP_PLATFORM) && defined(PULSE_SOURCE_USE_PCNT)
+#include <soc/soc_caps.h>
+#if defined(SOC_PCNT_SUPPORTED) && SOC_PCNT_SUPPORTED
+#define PULSE_SOURCE_HAS_PCNT 1
+#endif
+#endif
+#ifndef PULSE_SOURCE_HAS_PCNT
+#define PULSE_SOURCE_HAS_PCNT 0
+#endif
+
+/**
+ * PulseSource - Where movement sensor edges come from
+ *
+ * Backends expose a monotonic edge count and, where the hardware allows it,
+ * per-edge timestamps. The main loop only talks to this interface, so the
+ * same pulse handling runs on interrupt-driven boards, PCNT boards and in
+ * host tests (see test/mocks/MockPulseSource.h).
+ */
+class PulseSource
+{
+   public:
+    virtual ~PulseSource() {}
+
+    /**
+     * Attach the backend to a GPIO.
+     *
+     * @param pin GPIO carrying the movement sensor signal
+     * @return true if the backend is counting
+     */
+    virtual bool begin(int pin) = 0;
+
+    // Monotonic count of edges since begin() (wraps at 2^32)
+    virtual uint32_t readCount() = 0;
+
+    // Oldest unread edge time in micros(). Backends without per-edge timing
+    // always return false and callers attribute pulses to the read time.
+    virtual bool popEdgeTimestamp(uint32_t &/*timestampUs*/) { return false; }
+    virtual void discardEdgeTimestamps() {}
+    virtual uint32_t getEdgeOverflows() const { return 0; }
+    // Whether popEdgeTimestamp() can ever return an edge time
+    virtual bool hasEdgeTimestamps() const { return false; }
+
+    virtual const char *getName() const = 0;
+
+    // Number of edges since the previous call
+    uint32_t takeNewPulses();
+
+    // Drop everything counted so far (used while tracking is frozen)
+    void syncCount();
+
+    /**
+     * Edge time in millis() domain for the next pulse being processed.
+     * Falls back to nowMs when no timestamp is queued for it.
+     *
+     * @param nowMs millis() captured at drain time
+     * @param nowUs micros() captured at drain time
+     */
+    unsigned long nextEdgeTimeMs(unsigned long nowMs, uint32_t nowUs);
+
+    /**
+     * Pick the backend for this build. PCNT when PULSE_SOURCE_USE_PCNT is
+     * set and the chip has it; otherwise, or if it fails to start, the GPIO
+     * interrupt backend.
+     */
+    static PulseSource &selectForPin(int pin);
+
+   protected:
+    uint32_t lastTakenCount = 0;
+};
+
+/**
+ * Counts rising edges with a GPIO interrupt and records a timestamp per edge.
+ * Works on every chip; costs one interrupt per edge.
+ */
+class GpioIsrPulseSource : public PulseSource
+{
+   public:
+    static constexpr uint32_t EDGE_RING_CAPACITY = 64;
+
+    bool     begin(int pin) override;
+    uint32_t readCount() override;
+    bool     popEdgeTimestamp(uint32_t &timestampUs) override;
+    void     discardEdgeTimestamps() override;
+    uint32_t getEdgeOverflows() const override;
+    bool     hasEdgeTimestamps() const override { return true; }
+    const char *getName() const override { return "GPIO interrupt"; }
+
+    static void IRAM_ATTR onEdgeISR();
+
+   private:
+    static volatile uint32_t                    isrCount;
+    static PulseEdgeRing<EDGE_RING_CAPACITY>    edgeRing;
+};
+
+#if PULSE_SOURCE_HAS_PCNT
+/**
+ * Counts rising edges in the PCNT peripheral with its glitch filter enabled.
+ * Zero CPU cost per edge and immune to interrupt-disable windows, but the
+ * hardware does not timestamp individual edges.
+ */
+class PcntPulseSource : public PulseSource
+{
+   public:
+    bool     begin(int pin) override;
+    uint32_t readCount() override;
+    const char *getName() const override { return "PCNT"; }
+
+   private:
+    static constexpr int16_t  PCNT_HIGH_LIMIT          = 32767;
+    static constexpr uint16_t GLITCH_FILTER_APB_CYCLES = 1023;  // ~12.8us at 80MHz (hardware max)
+
+    bool     started  = false;
+    int16_t  lastRaw  = 0;
+    uint32_t total    = 0;
+};
+#endif
+
+#endif  // PULSE_SOURCE_H
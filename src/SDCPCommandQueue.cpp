@@ -0,0 +1,215 @@
+#include "SDCPCommandQueue.h"
+
+#include <string.h>
+
+SDCPCommandQueue::SDCPCommandQueue()
+{
+    clear();
+}
+
+void SDCPCommandQueue::clear()
+{
+    queueCount = 0;
+    for (InFlight &entry : inFlight)
+    {
+        entry.used = false;
+    }
+}
+
+bool SDCPCommandQueue::enqueue(int command, const SdcpCommandPolicy &policy)
+{
+    for (uint8_t i = 0; i < queueCount; i++)
+    {
+        if (queue[i].command == command)
+        {
+            return true;
+        }
+    }
+
+    SdcpQueuedCommand entry;
+    entry.command  = command;
+    entry.policy   = policy;
+    entry.attempts = 0;
+    return push(entry);
+}
+
+bool SDCPCommandQueue::push(const SdcpQueuedCommand &entry)
+{
+    if (queueCount >= SDCP_COMMAND_QUEUE_SIZE)
+    {
+        // Make room by dropping the newest of the lowest-priority entries
+        uint8_t lowest = 0;
+        for (uint8_t i = 1; i < queueCount; i++)
+        {
+            if (queue[i].policy.priority <= queue[lowest].policy.priority)
+            {
+                lowest = i;
+            }
+        }
+        if (queue[lowest].policy.priority >= entry.policy.priority)
+        {
+            return false;
+        }
+        removeQueued(lowest);
+    }
+    queue[queueCount++] = entry;
+    return true;
+}
+
+void SDCPCommandQueue::removeQueued(uint8_t index)
+{
+    for (uint8_t i = index; i + 1 < queueCount; i++)
+    {
+        queue[i] = queue[i + 1];
+    }
+    queueCount--;
+}
+
+void SDCPCommandQueue::cancel(int command)
+{
+    for (uint8_t i = 0; i < queueCount;)
+    {
+        if (queue[i].command == command)
+        {
+            removeQueued(i);
+        }
+        else
+        {
+            i++;
+        }
+    }
+    for (InFlight &entry : inFlight)
+    {
+        if (entry.used && entry.sent.command == command)
+        {
+            entry.used = false;
+        }
+    }
+}
+
+bool SDCPCommandQueue::next(SdcpQueuedCommand &out)
+{
+    if (queueCount == 0)
+    {
+        return false;
+    }
+    uint8_t best = 0;
+    for (uint8_t i = 1; i < queueCount; i++)
+    {
+        if (queue[i].policy.priority > queue[best].policy.priority)
+        {
+            best = i;
+        }
+    }
+    out = queue[best];
+    removeQueued(best);
+    return true;
+}
+
+void SDCPCommandQueue::markSent(const SdcpQueuedCommand &sent, const char *requestId,
+                                unsigned long now)
+{
+    if (!sent.policy.waitForAck)
+    {
+        return;
+    }
+
+    InFlight *slot = nullptr;
+    for (InFlight &entry : inFlight)
+    {
+        if (!entry.used)
+        {
+            slot = &entry;
+            break;
+        }
+    }
+    if (slot == nullptr)
+    {
+        // Full: stop tracking the lowest-priority, oldest request
+        slot = &inFlight[0];
+        for (InFlight &entry : inFlight)
+        {
+            if (entry.sent.policy.priority < slot->sent.policy.priority ||
+                (entry.sent.policy.priority == slot->sent.policy.priority &&
+                 (int32_t) (entry.sentMs - slot->sentMs) < 0))
+            {
+                slot = &entry;
+            }
+        }
+    }
+
+    slot->used  = true;
+    slot->sent  = sent;
+    slot->sent.attempts++;
+    slot->sentMs = now;
+    strncpy(slot->requestId, requestId != nullptr ? requestId : "", SDCP_REQUEST_ID_LENGTH);
+    slot->requestId[SDCP_REQUEST_ID_LENGTH] = '\0';
+}
+
+bool SDCPCommandQueue::acknowledge(int command, const char *requestId)
+{
+    if (requestId == nullptr)
+    {
+        return false;
+    }
+    for (InFlight &entry : inFlight)
+    {
+        if (entry.used && entry.sent.command == command && strcmp(entry.requestId, requestId) == 0)
+        {
+            entry.used = false;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SDCPCommandQueue::expireNext(unsigned long now, SdcpCommandTimeout &out)
+{
+    for (InFlight &entry : inFlight)
+    {
+        // 32-bit difference, like millis(), so wrap is handled on any host
+        if (!entry.used || (uint32_t) (now - entry.sentMs) < entry.sent.policy.ackTimeoutMs)
+        {
+            continue;
+        }
+        entry.used   = false;
+        out.command  = entry.sent.command;
+        out.attempts = entry.sent.attempts;
+
+        // A retry goes out with a fresh RequestID, so a late ack for this
+        // attempt no longer matches anything
+        out.retrying = entry.sent.attempts < entry.sent.policy.maxAttempts &&
+                       !isPending(entry.sent.command) && push(entry.sent);
+        return true;
+    }
+    return false;
+}
+
+bool SDCPCommandQueue::isPending(int command) const
+{
+    for (uint8_t i = 0; i < queueCount; i++)
+    {
+        if (queue[i].command == command)
+        {
+            return true;
+        }
+    }
+    for (const InFlight &entry : inFlight)
+    {
+        if (entry.used && entry.sent.command == command)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint8_t SDCPCommandQueue::inFlightCount() const
+{
+    uint8_t count = 0;
+    for (const InFlight &entry : inFlight)
+    {
+        if (entry.used) count++;
+    }
+    return count;
+}
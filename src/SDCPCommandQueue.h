@@ -0,0 +1,136 @@
+#ifndef SDCP_COMMAND_QUEUE_H
+#define SDCP_COMMAND_QUEUE_H
+
+#include <stdint.h>
+
+#include "SDCPCommandTemplate.h"
+
+// Commands waiting to be sent, and ack-tracked commands awaiting their ack
+#ifndef SDCP_COMMAND_QUEUE_SIZE
+#define SDCP_COMMAND_QUEUE_SIZE 4
+#endif
+#ifndef SDCP_MAX_IN_FLIGHT
+#define SDCP_MAX_IN_FLIGHT 4
+#endif
+
+/**
+ * Send order: higher first. Safety commands must never wait behind polls.
+ */
+enum SdcpCommandPriority : uint8_t
+{
+    SDCP_PRIORITY_STATUS   = 0,
+    SDCP_PRIORITY_CONTROL  = 1,  // Continue and other non-urgent commands
+    SDCP_PRIORITY_PAUSE    = 2,
+};
+
+/**
+ * How a command is sent and retried (chosen per command by the caller).
+ */
+struct SdcpCommandPolicy
+{
+    SdcpCommandPriority priority;
+    bool                waitForAck;
+    uint16_t            ackTimeoutMs;   // Per attempt
+    uint8_t             maxAttempts;    // Including the first send
+};
+
+struct SdcpQueuedCommand
+{
+    int               command;
+    SdcpCommandPolicy policy;
+    uint8_t           attempts;         // Sends so far (retries carry it)
+};
+
+/**
+ * An ack that did not arrive in time.
+ */
+struct SdcpCommandTimeout
+{
+    int     command;
+    uint8_t attempts;
+    bool    retrying;                   // Re-queued; false means given up
+};
+
+/**
+ * Bounded priority send queue plus a table of in-flight requests keyed by
+ * RequestID.
+ *
+ * Any number of ack-tracked commands may be outstanding at once, so a pause
+ * never waits for a continue's ack. next() always returns the highest
+ * priority command first, and a full queue or table makes room by
+ * dropping its lowest-priority entry rather than the new one, so
+ * jam-to-pause latency stays one send regardless of what is in flight.
+ * Timed-out requests are re-queued until their policy's attempts run out.
+ *
+ * Owns no transport: the caller sends what next() returns and reports it
+ * with markSent(). No allocation, no Arduino dependency.
+ */
+class SDCPCommandQueue
+{
+  public:
+    SDCPCommandQueue();
+
+    void clear();
+
+    /**
+     * Queue a command. The same command already queued is not duplicated.
+     * @return false if it was dropped because everything queued outranks it.
+     */
+    bool enqueue(int command, const SdcpCommandPolicy &policy);
+
+    /**
+     * Drop a command from the queue and stop waiting for its ack, e.g. a
+     * continue superseded by a pause.
+     */
+    void cancel(int command);
+
+    /**
+     * Pop the highest-priority queued command (oldest first within a level).
+     */
+    bool next(SdcpQueuedCommand &out);
+
+    /**
+     * Record a send of a command returned by next(). Ack-tracked commands
+     * enter the in-flight table; a full table evicts its lowest-priority,
+     * oldest entry.
+     */
+    void markSent(const SdcpQueuedCommand &sent, const char *requestId, unsigned long now);
+
+    /**
+     * Match an ack against the in-flight table.
+     * @return true if it completed an outstanding request.
+     */
+    bool acknowledge(int command, const char *requestId);
+
+    /**
+     * Report one in-flight request whose ack timed out, re-queueing it if it
+     * has attempts left. Call until it returns false.
+     */
+    bool expireNext(unsigned long now, SdcpCommandTimeout &out);
+
+    /**
+     * True if the command is queued or awaiting its ack.
+     */
+    bool isPending(int command) const;
+
+    uint8_t queuedCount() const { return queueCount; }
+    uint8_t inFlightCount() const;
+
+  private:
+    struct InFlight
+    {
+        bool              used;
+        SdcpQueuedCommand sent;
+        unsigned long     sentMs;
+        char              requestId[SDCP_REQUEST_ID_LENGTH + 1];
+    };
+
+    SdcpQueuedCommand queue[SDCP_COMMAND_QUEUE_SIZE];  // Oldest first
+    uint8_t           queueCount;
+    InFlight          inFlight[SDCP_MAX_IN_FLIGHT];
+
+    bool push(const SdcpQueuedCommand &entry);
+    void removeQueued(uint8_t index);
+};
+
+#endif  // SDCP_COMMAND_QUEUE_H
@@ -0,0 +1,190 @@
+#include "SDCPCommandTemplate.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace
+{
+    // Bounded writer into a render buffer
+    struct FrameWriter
+    {
+        char  *out;
+        size_t size;
+        size_t length;
+        bool   overflow;
+
+        void put(const char *data, size_t count)
+        {
+            if (overflow || length + count > size)
+            {
+                overflow = true;
+                return;
+            }
+            memcpy(out + length, data, count);
+            length += count;
+        }
+
+        void putUnsigned(unsigned long value)
+        {
+            char   digits[20];
+            size_t start = sizeof(digits);
+            do
+            {
+                digits[--start] = (char) ('0' + value % 10);
+                value /= 10;
+            } while (value > 0);
+            put(digits + start, sizeof(digits) - start);
+        }
+
+        void putInt(int value)
+        {
+            if (value < 0)
+            {
+                put("-", 1);
+                putUnsigned(0UL - (unsigned long) value);
+                return;
+            }
+            putUnsigned((unsigned long) value);
+        }
+    };
+
+    // MainboardIDs are hex; anything that would need escaping is refused
+    bool isPlainJsonText(const char *s)
+    {
+        for (; *s != '\0'; s++)
+        {
+            if (*s == '"' || *s == '\\' || (unsigned char) *s < 0x20)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+SDCPCommandTemplate::SDCPCommandTemplate()
+    : textLength(0), fieldCount(0), encoded(false), command(-1)
+{
+    text[0]        = '\0';
+    mainboardId[0] = '\0';
+}
+
+bool SDCPCommandTemplate::append(const char *literal)
+{
+    size_t count = strlen(literal);
+    if (textLength + count >= TEXT_MAX)
+    {
+        return false;
+    }
+    memcpy(text + textLength, literal, count + 1);
+    textLength += count;
+    return true;
+}
+
+bool SDCPCommandTemplate::markField(Field kind)
+{
+    if (fieldCount >= FIELD_COUNT)
+    {
+        return false;
+    }
+    fieldOffset[fieldCount] = textLength;
+    fieldKind[fieldCount]   = kind;
+    fieldCount++;
+    return true;
+}
+
+bool SDCPCommandTemplate::encode(int commandCode, const char *mainboard)
+{
+    encoded    = false;
+    textLength = 0;
+    fieldCount = 0;
+
+    if (mainboard == nullptr)
+    {
+        mainboard = "";
+    }
+    if (strlen(mainboard) >= sizeof(mainboardId) || !isPlainJsonText(mainboard))
+    {
+        return false;
+    }
+
+    // Same member order as SDCPProtocol::buildCommandMessage
+    char cmd[12];
+    snprintf(cmd, sizeof(cmd), "%d", commandCode);
+    bool ok = append("{\"Id\":\"") && markField(FIELD_REQUEST_ID) &&
+              append("\",\"Data\":{\"Cmd\":") && append(cmd) &&
+              append(",\"RequestID\":\"") && markField(FIELD_REQUEST_ID) &&
+              append("\",\"MainboardID\":\"") && append(mainboard) &&
+              append("\",\"TimeStamp\":") && markField(FIELD_TIMESTAMP) &&
+              append(",\"From\":0,\"Data\":{},\"PrintStatus\":") && markField(FIELD_PRINT_STATUS) &&
+              append(",\"CurrentStatus\":[") && markField(FIELD_CURRENT_STATUS) &&
+              append("]}");
+    if (ok && mainboard[0] != '\0')
+    {
+        ok = append(",\"Topic\":\"sdcp/request/") && append(mainboard) && append("\"");
+    }
+    ok = ok && append("}");
+    if (!ok)
+    {
+        return false;
+    }
+
+    command = commandCode;
+    strcpy(mainboardId, mainboard);
+    encoded = true;
+    return true;
+}
+
+bool SDCPCommandTemplate::matches(int commandCode, const char *mainboard) const
+{
+    return encoded && command == commandCode &&
+           strcmp(mainboardId, mainboard != nullptr ? mainboard : "") == 0;
+}
+
+size_t SDCPCommandTemplate::render(char *out, size_t outSize, const char *requestId,
+                                   unsigned long timestamp, int printStatus,
+                                   uint8_t machineStatusMask) const
+{
+    if (!encoded || out == nullptr || requestId == nullptr)
+    {
+        return 0;
+    }
+
+    FrameWriter writer = {out, outSize, 0, false};
+    size_t      copied = 0;
+    for (uint8_t i = 0; i < fieldCount; i++)
+    {
+        writer.put(text + copied, fieldOffset[i] - copied);
+        copied = fieldOffset[i];
+
+        switch (fieldKind[i])
+        {
+            case FIELD_REQUEST_ID:
+                writer.put(requestId, strnlen(requestId, SDCP_REQUEST_ID_LENGTH));
+                break;
+            case FIELD_TIMESTAMP:
+                writer.putUnsigned(timestamp);
+                break;
+            case FIELD_PRINT_STATUS:
+                writer.putInt(printStatus);
+                break;
+            case FIELD_CURRENT_STATUS:
+            {
+                bool first = true;
+                for (int s = 0; s <= 4; ++s)
+                {
+                    if ((machineStatusMask & (1 << s)) != 0)
+                    {
+                        if (!first) writer.put(",", 1);
+                        writer.putInt(s);
+                        first = false;
+                    }
+                }
+                break;
+            }
+        }
+    }
+    writer.put(text + copied, textLength - copied);
+
+    return writer.overflow ? 0 : writer.length;
+}
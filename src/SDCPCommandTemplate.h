@@ -0,0 +1,74 @@
+#ifndef SDCP_COMMAND_TEMPLATE_H
+#define SDCP_COMMAND_TEMPLATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Longest MainboardID a template accepts (including the NUL)
+#ifndef SDCP_MAINBOARD_ID_MAX
+#define SDCP_MAINBOARD_ID_MAX 40
+#endif
+
+// RequestID: a UUID without dashes
+#define SDCP_REQUEST_ID_LENGTH 32
+
+/**
+ * Pre-encoded SDCP command frame.
+ *
+ * encode() writes everything that stays the same between sends (command,
+ * MainboardID, Topic) once and records where the per-send fields go.
+ * render() then copies the template into a caller buffer and fills in the
+ * RequestID, TimeStamp, PrintStatus and CurrentStatus, byte for byte the
+ * payload SDCPProtocol::buildCommandMessage serializes, without touching
+ * the heap.
+ */
+class SDCPCommandTemplate
+{
+  public:
+    // Largest frame render() can produce
+    static const size_t MAX_FRAME_LENGTH = 360;
+
+    SDCPCommandTemplate();
+
+    /**
+     * @return false if the MainboardID is too long or needs JSON escaping.
+     */
+    bool encode(int command, const char *mainboardId);
+
+    bool matches(int command, const char *mainboardId) const;
+
+    /**
+     * Write the frame to out (not NUL-terminated).
+     * @param requestId SDCP_REQUEST_ID_LENGTH hex characters
+     * @return frame length, or 0 if not encoded or out is too small.
+     */
+    size_t render(char *out, size_t outSize, const char *requestId, unsigned long timestamp,
+                  int printStatus, uint8_t machineStatusMask) const;
+
+  private:
+    enum Field : uint8_t
+    {
+        FIELD_REQUEST_ID,
+        FIELD_TIMESTAMP,
+        FIELD_PRINT_STATUS,
+        FIELD_CURRENT_STATUS,
+    };
+
+    static const uint8_t FIELD_COUNT  = 5;  // RequestID appears twice
+    static const size_t  TEXT_MAX     = 256;
+
+    char     text[TEXT_MAX];                // Frame minus the per-send fields
+    uint16_t textLength;
+    uint16_t fieldOffset[FIELD_COUNT];      // Insertion points, ascending
+    Field    fieldKind[FIELD_COUNT];
+    uint8_t  fieldCount;
+
+    bool encoded;
+    int  command;
+    char mainboardId[SDCP_MAINBOARD_ID_MAX];
+
+    bool append(const char *literal);
+    bool markField(Field kind);
+};
+
+#endif  // SDCP_COMMAND_TEMPLATE_H
@@ -0,0 +1,236 @@
+#include "SDCPLatencyTracker.h"
+
+#include <string.h>
+
+const uint16_t SDCPLatencyTracker::RTT_BUCKET_MS[SDCP_LATENCY_BUCKETS - 1] = {
+    25, 50, 100, 200, 400, 800, 1600};
+const uint16_t SDCPLatencyTracker::AGE_BUCKET_MS[SDCP_LATENCY_BUCKETS - 1] = {
+    100, 200, 300, 500, 750, 1000, 2000};
+
+void SdcpLatencyHistogram::clear()
+{
+    memset(counts, 0, sizeof(counts));
+    samples = 0;
+    maxMs   = 0;
+    lastMs  = 0;
+    sumMs   = 0;
+}
+
+void SdcpLatencyHistogram::record(uint32_t ms, const uint16_t *bounds)
+{
+    uint8_t bucket = 0;
+    while (bucket < SDCP_LATENCY_BUCKETS - 1 && ms > bounds[bucket])
+    {
+        bucket++;
+    }
+    counts[bucket]++;
+    samples++;
+    sumMs += ms;
+    lastMs = ms;
+    if (ms > maxMs) maxMs = ms;
+}
+
+uint32_t SdcpLatencyHistogram::meanMs() const
+{
+    return samples > 0 ? (uint32_t) (sumMs / samples) : 0;
+}
+
+uint32_t SdcpLatencyHistogram::percentileMs(uint8_t percent, const uint16_t *bounds) const
+{
+    if (samples == 0)
+    {
+        return 0;
+    }
+    // Smallest bucket covering at least percent of the samples
+    uint64_t needed = ((uint64_t) samples * percent + 99) / 100;
+    uint64_t seen   = 0;
+    for (uint8_t bucket = 0; bucket < SDCP_LATENCY_BUCKETS - 1; bucket++)
+    {
+        seen += counts[bucket];
+        if (seen >= needed && seen > 0)
+        {
+            return bounds[bucket] < maxMs ? bounds[bucket] : maxMs;
+        }
+    }
+    return maxMs;
+}
+
+SDCPLatencyTracker::SDCPLatencyTracker()
+{
+    reset();
+}
+
+void SDCPLatencyTracker::reset()
+{
+    for (Pending &entry : pending)
+    {
+        entry.used = false;
+    }
+    memset(&report, 0, sizeof(report));
+    report.rtt.clear();
+    report.telemetryAge.clear();
+    haveFrame     = false;
+    lastSampleMs  = 0;
+    haveTimeStamp = false;
+    lastTimeStamp = 0;
+}
+
+void SDCPLatencyTracker::release(Pending &entry)
+{
+    if (!entry.answered)
+    {
+        report.dropped++;
+    }
+    entry.used = false;
+}
+
+SDCPLatencyTracker::Pending *SDCPLatencyTracker::oldest(bool unansweredOnly)
+{
+    Pending *found = nullptr;
+    for (Pending &entry : pending)
+    {
+        if (!entry.used || (unansweredOnly && entry.answered))
+        {
+            continue;
+        }
+        if (found == nullptr || (int32_t) (entry.sentMs - found->sentMs) < 0)
+        {
+            found = &entry;
+        }
+    }
+    return found;
+}
+
+uint8_t SDCPLatencyTracker::countPending() const
+{
+    uint8_t count = 0;
+    for (const Pending &entry : pending)
+    {
+        if (entry.used && !entry.answered) count++;
+    }
+    return count;
+}
+
+void SDCPLatencyTracker::onRequestSent(const char *requestId, unsigned long now)
+{
+    Pending *slot = nullptr;
+    for (Pending &entry : pending)
+    {
+        if (!entry.used)
+        {
+            slot = &entry;
+            break;
+        }
+    }
+    if (slot == nullptr)
+    {
+        slot = oldest(false);
+        release(*slot);
+    }
+
+    slot->used     = true;
+    slot->acked    = false;
+    slot->answered = false;
+    slot->sentMs   = now;
+    strncpy(slot->requestId, requestId != nullptr ? requestId : "", SDCP_REQUEST_ID_LENGTH);
+    slot->requestId[SDCP_REQUEST_ID_LENGTH] = '\0';
+
+    report.requests++;
+    report.pending = countPending();
+}
+
+bool SDCPLatencyTracker::onAck(const char *requestId, unsigned long now)
+{
+    if (requestId == nullptr || requestId[0] == '\0')
+    {
+        return false;
+    }
+    for (Pending &entry : pending)
+    {
+        if (!entry.used || entry.acked || strcmp(entry.requestId, requestId) != 0)
+        {
+            continue;
+        }
+        entry.acked = true;
+        report.acks++;
+        report.rtt.record((uint32_t) (now - entry.sentMs), RTT_BUCKET_MS);
+        if (entry.answered)
+        {
+            entry.used = false;
+        }
+        return true;
+    }
+    return false;
+}
+
+void SDCPLatencyTracker::onStatusFrame(bool hasTimeStamp, uint32_t printerTimeStamp,
+                                       unsigned long now)
+{
+    if (hasTimeStamp)
+    {
+        if (haveTimeStamp && printerTimeStamp < lastTimeStamp)
+        {
+            report.outOfOrder++;
+        }
+        haveTimeStamp = true;
+        lastTimeStamp = printerTimeStamp;
+    }
+
+    Pending *request = oldest(true);
+    if (request == nullptr)
+    {
+        report.unsolicited++;
+        lastSampleMs = now - report.rtt.lastMs / 2;
+    }
+    else
+    {
+        uint32_t sinceSent = (uint32_t) (now - request->sentMs);
+        report.frames++;
+        if (sinceSent > LATE_MS)
+        {
+            report.late++;
+        }
+        lastSampleMs      = now - sinceSent / 2;
+        request->answered = true;
+        if (request->acked)
+        {
+            request->used = false;
+        }
+    }
+    haveFrame      = true;
+    report.pending = countPending();
+}
+
+void SDCPLatencyTracker::onTelemetryUsed(unsigned long now)
+{
+    if (!haveFrame)
+    {
+        return;
+    }
+    report.telemetryAge.record((uint32_t) (now - lastSampleMs), AGE_BUCKET_MS);
+}
+
+void SDCPLatencyTracker::expire(unsigned long now)
+{
+    for (Pending &entry : pending)
+    {
+        // 32-bit difference, like millis(), so wrap is handled on any host
+        if (entry.used && (uint32_t) (now - entry.sentMs) >= DROP_MS)
+        {
+            release(entry);
+        }
+    }
+    report.pending = countPending();
+}
+
+void SDCPLatencyTracker::onDisconnect()
+{
+    for (Pending &entry : pending)
+    {
+        if (entry.used)
+        {
+            release(entry);
+        }
+    }
+    report.pending = 0;
+}
@@ -0,0 +1,135 @@
+#ifndef SDCP_LATENCY_TRACKER_H
+#define SDCP_LATENCY_TRACKER_H
+
+#include <stdint.h>
+
+#include "SDCPCommandTemplate.h"
+
+// Status requests remembered until their ack and status frame arrive
+#ifndef SDCP_LATENCY_PENDING
+#define SDCP_LATENCY_PENDING 8
+#endif
+
+// Histogram buckets, the last one open-ended
+#define SDCP_LATENCY_BUCKETS 8
+
+/**
+ * Fixed-bucket latency histogram. Bucket i counts samples up to
+ * bounds[i] ms; the last bucket everything above.
+ */
+struct SdcpLatencyHistogram
+{
+    uint32_t counts[SDCP_LATENCY_BUCKETS];
+    uint32_t samples;
+    uint32_t maxMs;
+    uint32_t lastMs;
+    uint64_t sumMs;
+
+    void     clear();
+    void     record(uint32_t ms, const uint16_t *bounds);
+    uint32_t meanMs() const;
+    /**
+     * Upper bound of the bucket holding the given percentile (0-100), or
+     * maxMs when it falls in the open-ended bucket.
+     */
+    uint32_t percentileMs(uint8_t percent, const uint16_t *bounds) const;
+};
+
+/**
+ * Copy of the tracker's state, safe to hand to the web task.
+ */
+struct SdcpLatencyReport
+{
+    SdcpLatencyHistogram rtt;           // Status request to its ack, matched by RequestID
+    SdcpLatencyHistogram telemetryAge;  // Age of the TotalExtrusion each detector update uses
+    uint32_t requests;
+    uint32_t acks;
+    uint32_t frames;                    // Status frames that answered a request
+    uint32_t unsolicited;               // Status frames with no request outstanding
+    uint32_t late;                      // Answered after LATE_MS
+    uint32_t dropped;                   // Requests no status frame answered
+    uint32_t outOfOrder;                // Printer TimeStamp older than the previous frame's
+    uint8_t  pending;
+};
+
+/**
+ * Round-trip and telemetry freshness bookkeeping for SDCP status polls.
+ *
+ * Each status request is remembered with its RequestID. The printer's ack
+ * carries the same RequestID, which gives an exact RTT. The status push
+ * itself carries no RequestID, so it answers the oldest unanswered request
+ * (the printer serves them in order). The printer sampled it somewhere
+ * between that request and its arrival, so half the round trip is added to
+ * its age. Frames with no request outstanding take half the last RTT.
+ *
+ * A request with no frame after DROP_MS, or pushed out of a full table, is
+ * dropped. A frame later than LATE_MS is late: by then the sensor has
+ * stopped extrapolating expected flow and the detector saw a flat line.
+ *
+ * No allocation, no Arduino dependency.
+ */
+class SDCPLatencyTracker
+{
+  public:
+    static const uint16_t RTT_BUCKET_MS[SDCP_LATENCY_BUCKETS - 1];
+    static const uint16_t AGE_BUCKET_MS[SDCP_LATENCY_BUCKETS - 1];
+    static const uint16_t LATE_MS = 1000;  // FMS_EXTRAPOLATE_MAX_MS
+    static const uint16_t DROP_MS = 5000;
+
+    SDCPLatencyTracker();
+
+    void reset();
+
+    void onRequestSent(const char *requestId, unsigned long now);
+
+    /**
+     * @return true if the ack matched an outstanding status request.
+     */
+    bool onAck(const char *requestId, unsigned long now);
+
+    /**
+     * A status frame arrived. printerTimeStamp is only used for ordering.
+     */
+    void onStatusFrame(bool hasTimeStamp, uint32_t printerTimeStamp, unsigned long now);
+
+    /**
+     * The detector consumed telemetry; records how old it is.
+     */
+    void onTelemetryUsed(unsigned long now);
+
+    /**
+     * Drop requests older than DROP_MS. Call from the transport loop.
+     */
+    void expire(unsigned long now);
+
+    /**
+     * Connection lost: nothing outstanding will be answered.
+     */
+    void onDisconnect();
+
+    SdcpLatencyReport getReport() const { return report; }
+
+  private:
+    struct Pending
+    {
+        bool          used;
+        bool          acked;
+        bool          answered;
+        unsigned long sentMs;
+        char          requestId[SDCP_REQUEST_ID_LENGTH + 1];
+    };
+
+    Pending           pending[SDCP_LATENCY_PENDING];
+    SdcpLatencyReport report;
+
+    bool          haveFrame;
+    unsigned long lastSampleMs;     // Estimated printer time of the last frame
+    bool          haveTimeStamp;
+    uint32_t      lastTimeStamp;
+
+    void     release(Pending &entry);
+    Pending *oldest(bool unansweredOnly);
+    uint8_t  countPending() const;
+};
+
+#endif  // SDCP_LATENCY_TRACKER_H
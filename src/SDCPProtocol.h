@@ -14,6 +14,9 @@ namespace SDCPKeys {
 // SDCP protocol timing constants
 namespace SDCPTiming {
     constexpr unsigned long ACK_TIMEOUT_MS = 5000;
+    constexpr uint16_t      PAUSE_ACK_TIMEOUT_MS = 2000;   // Per attempt; pause retries sooner
+    constexpr uint8_t       PAUSE_MAX_ATTEMPTS = 3;
+    constexpr uint8_t       CONTINUE_MAX_ATTEMPTS = 2;
     constexpr unsigned int  EXPECTED_FILAMENT_SAMPLE_MS = 1000;
     constexpr unsigned int  EXPECTED_FILAMENT_STALE_MS = 1000;
     constexpr unsigned int  SDCP_LOSS_TIMEOUT_MS = 10000;
@@ -0,0 +1,549 @@
+#include "SDCPStatusParser.h"
+
+#include <string.h>
+
+namespace
+{
+    // Deepest nesting a skipped value may have
+    constexpr int MAX_SKIP_DEPTH = 16;
+
+    // Keys we look up are short; anything longer cannot match and is cut
+    constexpr size_t KEY_MAX = 48;
+
+    // Digits kept in a number's mantissa (fits int64); the rest only scale
+    constexpr int MAX_MANTISSA_DIGITS = 18;
+
+    // Same key as SDCPKeys::TOTAL_EXTRUSION_HEX (some firmware variants)
+    const char TOTAL_EXTRUSION_HEX_KEY[] = "54 6F 74 61 6C 45 78 74 72 75 73 69 6F 6E 00";
+
+    struct PrintInfoIntField
+    {
+        const char *key;
+        int SdcpStatusFrame::*field;
+    };
+
+    const PrintInfoIntField PRINT_INFO_INT_FIELDS[] = {
+        {"Status", &SdcpStatusFrame::printStatus},
+        {"CurrentLayer", &SdcpStatusFrame::currentLayer},
+        {"TotalLayer", &SdcpStatusFrame::totalLayer},
+        {"Progress", &SdcpStatusFrame::progress},
+        {"CurrentTicks", &SdcpStatusFrame::currentTicks},
+        {"TotalTicks", &SdcpStatusFrame::totalTicks},
+        {"PrintSpeedPct", &SdcpStatusFrame::printSpeedPct},
+    };
+
+    /**
+     * Bounded cursor over the payload. Every read checks end, so the frame
+     * does not need a terminating NUL.
+     */
+    struct StatusCursor
+    {
+        const char *p;
+        const char *end;
+
+        void skipSpace()
+        {
+            while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+            {
+                p++;
+            }
+        }
+
+        char peek()
+        {
+            skipSpace();
+            return p < end ? *p : '\0';
+        }
+
+        bool consume(char c)
+        {
+            if (peek() != c)
+            {
+                return false;
+            }
+            p++;
+            return true;
+        }
+
+        bool consumeWord(const char *word)
+        {
+            size_t length = strlen(word);
+            skipSpace();
+            if ((size_t) (end - p) < length || memcmp(p, word, length) != 0)
+            {
+                return false;
+            }
+            p += length;
+            return true;
+        }
+
+        // Append a code point as UTF-8 if it fits
+        static void putUtf8(char *out, size_t cap, size_t &n, uint32_t cp)
+        {
+            char   bytes[4];
+            size_t count;
+            if (cp < 0x80)
+            {
+                bytes[0] = (char) cp;
+                count    = 1;
+            }
+            else if (cp < 0x800)
+            {
+                bytes[0] = (char) (0xC0 | (cp >> 6));
+                bytes[1] = (char) (0x80 | (cp & 0x3F));
+                count    = 2;
+            }
+            else if (cp < 0x10000)
+            {
+                bytes[0] = (char) (0xE0 | (cp >> 12));
+                bytes[1] = (char) (0x80 | ((cp >> 6) & 0x3F));
+                bytes[2] = (char) (0x80 | (cp & 0x3F));
+                count    = 3;
+            }
+            else
+            {
+                bytes[0] = (char) (0xF0 | (cp >> 18));
+                bytes[1] = (char) (0x80 | ((cp >> 12) & 0x3F));
+                bytes[2] = (char) (0x80 | ((cp >> 6) & 0x3F));
+                bytes[3] = (char) (0x80 | (cp & 0x3F));
+                count    = 4;
+            }
+            // Never split a character when truncating
+            if (out != nullptr && n + count < cap)
+            {
+                memcpy(out + n, bytes, count);
+                n += count;
+            }
+        }
+
+        bool readHex4(uint32_t &value)
+        {
+            if (end - p < 4)
+            {
+                return false;
+            }
+            value = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                char c = *p++;
+                value <<= 4;
+                if (c >= '0' && c <= '9') value |= (uint32_t) (c - '0');
+                else if (c >= 'a' && c <= 'f') value |= (uint32_t) (c - 'a' + 10);
+                else if (c >= 'A' && c <= 'F') value |= (uint32_t) (c - 'A' + 10);
+                else return false;
+            }
+            return true;
+        }
+
+        /**
+         * Decode a string into out (NUL-terminated, truncated to cap), or
+         * just skip it when out is null.
+         */
+        bool readString(char *out, size_t cap)
+        {
+            if (!consume('"'))
+            {
+                return false;
+            }
+            size_t n = 0;
+            while (p < end)
+            {
+                char c = *p++;
+                if (c == '"')
+                {
+                    if (out != nullptr && cap > 0) out[n] = '\0';
+                    return true;
+                }
+                if (c != '\\')
+                {
+                    if (out != nullptr && n + 1 < cap) out[n++] = c;
+                    continue;
+                }
+                if (p >= end)
+                {
+                    return false;
+                }
+                char escaped = *p++;
+                uint32_t cp;
+                switch (escaped)
+                {
+                    case '"': cp = '"'; break;
+                    case '\\': cp = '\\'; break;
+                    case '/': cp = '/'; break;
+                    case 'b': cp = '\b'; break;
+                    case 'f': cp = '\f'; break;
+                    case 'n': cp = '\n'; break;
+                    case 'r': cp = '\r'; break;
+                    case 't': cp = '\t'; break;
+                    case 'u':
+                    {
+                        if (!readHex4(cp))
+                        {
+                            return false;
+                        }
+                        // Surrogate pair
+                        uint32_t low;
+                        if (cp >= 0xD800 && cp < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u')
+                        {
+                            p += 2;
+                            if (!readHex4(low))
+                            {
+                                return false;
+                            }
+                            if (low >= 0xDC00 && low < 0xE000)
+                            {
+                                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                            }
+                        }
+                        break;
+                    }
+                    default:
+                        return false;
+                }
+                putUtf8(out, cap, n, cp);
+            }
+            return false;
+        }
+
+        /**
+         * JSON number. The mantissa is integer, so the only floating point
+         * is the final scaling.
+         */
+        bool readNumber(double &value)
+        {
+            skipSpace();
+            bool negative = (p < end && *p == '-');
+            if (negative) p++;
+
+            int64_t mantissa = 0;
+            int     digits   = 0;
+            int     exp10    = 0;
+            bool    any      = false;
+            while (p < end && *p >= '0' && *p <= '9')
+            {
+                if (digits < MAX_MANTISSA_DIGITS)
+                {
+                    mantissa = mantissa * 10 + (*p - '0');
+                    if (mantissa > 0) digits++;
+                }
+                else
+                {
+                    exp10++;
+                }
+                p++;
+                any = true;
+            }
+            if (p < end && *p == '.')
+            {
+                p++;
+                while (p < end && *p >= '0' && *p <= '9')
+                {
+                    if (digits < MAX_MANTISSA_DIGITS)
+                    {
+                        mantissa = mantissa * 10 + (*p - '0');
+                        if (mantissa > 0) digits++;
+                        exp10--;
+                    }
+                    p++;
+                    any = true;
+                }
+            }
+            if (!any)
+            {
+                return false;
+            }
+            if (p < end && (*p == 'e' || *p == 'E'))
+            {
+                p++;
+                bool expNegative = false;
+                if (p < end && (*p == '+' || *p == '-'))
+                {
+                    expNegative = (*p == '-');
+                    p++;
+                }
+                int exponent = 0;
+                bool expDigits = false;
+                while (p < end && *p >= '0' && *p <= '9')
+                {
+                    if (exponent < 400) exponent = exponent * 10 + (*p - '0');
+                    p++;
+                    expDigits = true;
+                }
+                if (!expDigits)
+                {
+                    return false;
+                }
+                exp10 += expNegative ? -exponent : exponent;
+            }
+
+            double scale = 1.0;
+            for (int e = exp10 < 0 ? -exp10 : exp10; e > 0; e--)
+            {
+                scale *= 10.0;
+            }
+            value = exp10 < 0 ? (double) mantissa / scale : (double) mantissa * scale;
+            if (negative) value = -value;
+            return true;
+        }
+
+        // Number, or 0 for null (ArduinoJson's default); false if neither
+        bool readNumberOrNull(double &value)
+        {
+            if (peek() == 'n')
+            {
+                value = 0.0;
+                return consumeWord("null");
+            }
+            return readNumber(value);
+        }
+
+        bool skipValue(int depth)
+        {
+            if (depth > MAX_SKIP_DEPTH)
+            {
+                return false;
+            }
+            switch (peek())
+            {
+                case '{':
+                    p++;
+                    if (consume('}')) return true;
+                    do
+                    {
+                        if (!readString(nullptr, 0) || !consume(':') || !skipValue(depth + 1))
+                        {
+                            return false;
+                        }
+                    } while (consume(','));
+                    return consume('}');
+                case '[':
+                    p++;
+                    if (consume(']')) return true;
+                    do
+                    {
+                        if (!skipValue(depth + 1))
+                        {
+                            return false;
+                        }
+                    } while (consume(','));
+                    return consume(']');
+                case '"':
+                    return readString(nullptr, 0);
+                case 't':
+                    return consumeWord("true");
+                case 'f':
+                    return consumeWord("false");
+                case 'n':
+                    return consumeWord("null");
+                default:
+                {
+                    double ignored;
+                    return readNumber(ignored);
+                }
+            }
+        }
+
+        /**
+         * Walk the members of an object, calling onMember(key) positioned
+         * at each value; onMember must consume the value.
+         */
+        template <typename OnMember>
+        bool forEachMember(OnMember onMember)
+        {
+            if (!consume('{'))
+            {
+                return false;
+            }
+            if (consume('}'))
+            {
+                return true;
+            }
+            do
+            {
+                char key[KEY_MAX];
+                if (!readString(key, sizeof(key)) || !consume(':') || !onMember(key))
+                {
+                    return false;
+                }
+            } while (consume(','));
+            return consume('}');
+        }
+    };
+
+    bool parsePrintInfo(StatusCursor &cursor, SdcpStatusFrame &frame)
+    {
+        bool   hasHexTotal = false;
+        double hexTotal    = 0.0;
+
+        bool ok = cursor.forEachMember([&](const char *key) {
+            for (const PrintInfoIntField &intField : PRINT_INFO_INT_FIELDS)
+            {
+                if (strcmp(key, intField.key) == 0)
+                {
+                    double value;
+                    if (cursor.peek() == '"' || cursor.peek() == '{' || cursor.peek() == '[')
+                    {
+                        return cursor.skipValue(0);
+                    }
+                    if (!cursor.readNumberOrNull(value))
+                    {
+                        return cursor.skipValue(0);
+                    }
+                    frame.*(intField.field) = (int) value;
+                    return true;
+                }
+            }
+
+            bool total    = strcmp(key, "TotalExtrusion") == 0;
+            bool hexTotalKey = !total && strcmp(key, TOTAL_EXTRUSION_HEX_KEY) == 0;
+            if (total || hexTotalKey)
+            {
+                char next = cursor.peek();
+                if (next != '-' && (next < '0' || next > '9'))
+                {
+                    return cursor.skipValue(0);  // null: not reported
+                }
+                double value;
+                if (!cursor.readNumber(value))
+                {
+                    return false;
+                }
+                if (total)
+                {
+                    frame.hasTotalExtrusion = true;
+                    frame.totalExtrusion    = (float) value;
+                }
+                else
+                {
+                    hasHexTotal = true;
+                    hexTotal    = value;
+                }
+                return true;
+            }
+
+            if (strcmp(key, "TaskId") == 0 && cursor.peek() == '"')
+            {
+                frame.hasTaskId = true;
+                return cursor.readString(frame.taskId, sizeof(frame.taskId));
+            }
+            if (strcmp(key, "Filename") == 0 && cursor.peek() == '"')
+            {
+                frame.hasFilename = true;
+                return cursor.readString(frame.filename, sizeof(frame.filename));
+            }
+            return cursor.skipValue(0);
+        });
+
+        // The plain key wins when a frame carries both
+        if (ok && !frame.hasTotalExtrusion && hasHexTotal)
+        {
+            frame.hasTotalExtrusion = true;
+            frame.totalExtrusion    = (float) hexTotal;
+        }
+        return ok;
+    }
+
+    bool parseMachineStatuses(StatusCursor &cursor, SdcpStatusFrame &frame)
+    {
+        cursor.p++;  // '['
+        frame.hasMachineStatuses = true;
+        if (cursor.consume(']'))
+        {
+            return true;
+        }
+        do
+        {
+            double value;
+            if (!cursor.readNumberOrNull(value))
+            {
+                return false;
+            }
+            if (frame.machineStatusCount < SDCP_MAX_MACHINE_STATUSES)
+            {
+                frame.machineStatuses[frame.machineStatusCount++] = (int) value;
+            }
+        } while (cursor.consume(','));
+        return cursor.consume(']');
+    }
+
+    // "x,y,z": Z is whatever follows the second comma
+    void parseCurrentZ(const char *coords, SdcpStatusFrame &frame)
+    {
+        const char *firstComma  = strchr(coords, ',');
+        const char *secondComma = firstComma ? strchr(firstComma + 1, ',') : nullptr;
+        if (secondComma == nullptr)
+        {
+            return;
+        }
+        StatusCursor zCursor = {secondComma + 1, coords + strlen(coords)};
+        double       z       = 0.0;
+        frame.hasCurrentZ    = true;
+        frame.currentZ       = zCursor.readNumber(z) ? (float) z : 0.0f;
+    }
+
+    bool parseStatus(StatusCursor &cursor, SdcpStatusFrame &frame)
+    {
+        return cursor.forEachMember([&](const char *key) {
+            char next = cursor.peek();
+            if (strcmp(key, "CurrentStatus") == 0 && next == '[')
+            {
+                return parseMachineStatuses(cursor, frame);
+            }
+            if (strcmp(key, "CurrenCoord") == 0 && next == '"')
+            {
+                char coords[64];
+                if (!cursor.readString(coords, sizeof(coords)))
+                {
+                    return false;
+                }
+                parseCurrentZ(coords, frame);
+                return true;
+            }
+            if (strcmp(key, "PrintInfo") == 0 && next == '{')
+            {
+                frame.hasPrintInfo = true;
+                return parsePrintInfo(cursor, frame);
+            }
+            return cursor.skipValue(0);
+        });
+    }
+}
+
+bool SDCPStatusParser::parse(const char *json, size_t length, SdcpStatusFrame &frame)
+{
+    frame = SdcpStatusFrame();
+    if (json == nullptr)
+    {
+        return false;
+    }
+
+    StatusCursor cursor = {json, json + length};
+    bool         hasId   = false;
+    bool         hasData = false;
+
+    bool ok = cursor.forEachMember([&](const char *key) {
+        if (strcmp(key, "Status") == 0 && cursor.peek() == '{')
+        {
+            frame.hasStatus = true;
+            return parseStatus(cursor, frame);
+        }
+        char next = cursor.peek();
+        if (strcmp(key, "TimeStamp") == 0 && (next == '-' || (next >= '0' && next <= '9')))
+        {
+            double value;
+            if (!cursor.readNumber(value))
+            {
+                return false;
+            }
+            frame.hasTimeStamp = value >= 0.0 && value <= 4294967295.0;
+            frame.timeStamp    = frame.hasTimeStamp ? (uint32_t) value : 0;
+            return true;
+        }
+        if (strcmp(key, "Id") == 0) hasId = true;
+        if (strcmp(key, "Data") == 0) hasData = true;
+        return cursor.skipValue(0);
+    });
+
+    frame.isCommandResponse = hasId && hasData;
+    return ok;
+}
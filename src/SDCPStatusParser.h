@@ -0,0 +1,74 @@
+#ifndef SDCP_STATUS_PARSER_H
+#define SDCP_STATUS_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Longest TaskId / Filename kept from a status frame (including the NUL);
+// longer values are truncated, which still compares consistently
+#ifndef SDCP_TASK_ID_MAX
+#define SDCP_TASK_ID_MAX 48
+#endif
+#ifndef SDCP_FILENAME_MAX
+#define SDCP_FILENAME_MAX 128
+#endif
+
+// Machine statuses kept from Status.CurrentStatus
+#define SDCP_MAX_MACHINE_STATUSES 5
+
+/**
+ * The fields ElegooCC consumes from an SDCP status frame. Numbers missing
+ * or null read as 0, like ArduinoJson's defaults; the has* flags say
+ * whether the optional ones were there.
+ */
+struct SdcpStatusFrame
+{
+    bool isCommandResponse;   // Top-level "Id" and "Data": an ack, not status
+    bool hasStatus;           // Top-level "Status" object
+    bool     hasTimeStamp;
+    uint32_t timeStamp;       // Printer clock when it sent the frame (Unix seconds)
+
+    bool    hasMachineStatuses;
+    uint8_t machineStatusCount;
+    int     machineStatuses[SDCP_MAX_MACHINE_STATUSES];
+
+    bool  hasCurrentZ;        // Third value of Status.CurrenCoord ("x,y,z")
+    float currentZ;
+
+    bool  hasPrintInfo;
+    int   printStatus;
+    int   currentLayer;
+    int   totalLayer;
+    int   progress;
+    int   currentTicks;
+    int   totalTicks;
+    int   printSpeedPct;
+    bool  hasTotalExtrusion;  // TotalExtrusion, or its hex-encoded key
+    float totalExtrusion;     // mm
+    bool  hasTaskId;
+    char  taskId[SDCP_TASK_ID_MAX];       // "" when missing or null
+    bool  hasFilename;
+    char  filename[SDCP_FILENAME_MAX];    // "" when missing or null
+};
+
+/**
+ * Single-pass scanner for SDCP status frames.
+ *
+ * Walks the payload once and materializes only the fields above into a
+ * caller-owned SdcpStatusFrame; everything else (temperatures, fans,
+ * lights) is skipped without being stored. Nothing is allocated, so the
+ * 4Hz status stream no longer churns the heap with a full document and
+ * String temporaries. Command responses are only recognized here and are
+ * left to ArduinoJson.
+ */
+class SDCPStatusParser
+{
+  public:
+    /**
+     * Parse one websocket text frame (need not be NUL-terminated).
+     * @return false if the payload is not a well-formed JSON object.
+     */
+    static bool parse(const char *json, size_t length, SdcpStatusFrame &frame);
+};
+
+#endif  // SDCP_STATUS_PARSER_H
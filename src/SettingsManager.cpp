@@ -95,9 +95,18 @@ static const SettingField kSettingFields[] = {
     makeIntField("detection_hard_jam_time_ms",
                  offsetof(user_settings, detection_hard_jam_time_ms), 3000),
     makeIntField("detection_mode", offsetof(user_settings, detection_mode), 0),
+    makeIntField("detection_window_mode", offsetof(user_settings, detection_window_mode), 0),
+    makeFloatField("detection_likelihood_threshold",
+                   offsetof(user_settings, detection_likelihood_threshold), 4.5f),
+    makeIntField("detection_soft_algorithm", offsetof(user_settings, detection_soft_algorithm), 0),
+    makeIntField("detection_ratio_source", offsetof(user_settings, detection_ratio_source), 0),
+    makeBoolField("detection_adaptive_threshold",
+                  offsetof(user_settings, detection_adaptive_threshold), false),
     makeIntField("sdcp_loss_behavior", offsetof(user_settings, sdcp_loss_behavior), 2),
     makeIntField("flow_telemetry_stale_ms", offsetof(user_settings, flow_telemetry_stale_ms), 1500),
     makeIntField("ui_refresh_interval_ms", offsetof(user_settings, ui_refresh_interval_ms), 1000),
+    makeIntField("status_poll_min_ms", offsetof(user_settings, status_poll_min_ms), 100),
+    makeIntField("status_poll_max_ms", offsetof(user_settings, status_poll_max_ms), 750),
     makeIntField("log_level", offsetof(user_settings, log_level), 0),
     makeBoolField("suppress_pause_commands", offsetof(user_settings, suppress_pause_commands),
                   false),
@@ -243,9 +252,16 @@ SettingsManager::SettingsManager()
     settings.detection_soft_jam_time_ms = 10000;  // 10 seconds to signal slow clog
     settings.detection_hard_jam_time_ms = 3000;   // 3 seconds of negligible flow
     settings.detection_mode = 0;                  // 0 = both hard + soft detection
+    settings.detection_window_mode = 0;           // 0 = time window
+    settings.detection_likelihood_threshold = 4.5f;  // ~1% chance for healthy flow
+    settings.detection_soft_algorithm = 0;        // 0 = timer
+    settings.detection_ratio_source   = 0;        // 0 = window rates
+    settings.detection_adaptive_threshold = false;
     settings.sdcp_loss_behavior         = 2;
     settings.flow_telemetry_stale_ms    = 1500;
     settings.ui_refresh_interval_ms     = 1000;
+    settings.status_poll_min_ms         = 100;
+    settings.status_poll_max_ms         = 750;
     settings.log_level                  = 0;      // Default to Normal logging
     settings.suppress_pause_commands    = false;  // Pause commands enabled by default
     settings.movement_mm_per_pulse      = 3.055f;  // Calibrated sensor value
@@ -322,6 +338,30 @@ bool SettingsManager::load()
         settings.detection_mode = 2;
     }
 
+    if (settings.detection_window_mode < 0 || settings.detection_window_mode > 1)
+    {
+        settings.detection_window_mode = 0;
+    }
+
+    if (settings.detection_likelihood_threshold < 1.0f)
+    {
+        settings.detection_likelihood_threshold = 1.0f;
+    }
+    else if (settings.detection_likelihood_threshold > 20.0f)
+    {
+        settings.detection_likelihood_threshold = 20.0f;
+    }
+
+    if (settings.detection_soft_algorithm < 0 || settings.detection_soft_algorithm > 1)
+    {
+        settings.detection_soft_algorithm = 0;
+    }
+
+    if (settings.detection_ratio_source < 0 || settings.detection_ratio_source > 1)
+    {
+        settings.detection_ratio_source = 0;
+    }
+
     // Update logger with loaded log level
     logger.setLogLevel(static_cast<LogLevel>(settings.log_level));
 
@@ -433,6 +473,31 @@ int SettingsManager::getDetectionMode()
     return getSettings().detection_mode;
 }
 
+int SettingsManager::getDetectionWindowMode()
+{
+    return getSettings().detection_window_mode;
+}
+
+float SettingsManager::getDetectionLikelihoodThreshold()
+{
+    return getSettings().detection_likelihood_threshold;
+}
+
+int SettingsManager::getDetectionSoftAlgorithm()
+{
+    return getSettings().detection_soft_algorithm;
+}
+
+int SettingsManager::getDetectionRatioSource()
+{
+    return getSettings().detection_ratio_source;
+}
+
+bool SettingsManager::getDetectionAdaptiveThreshold()
+{
+    return getSettings().detection_adaptive_threshold;
+}
+
 int SettingsManager::getSdcpLossBehavior()
 {
     return getSettings().sdcp_loss_behavior;
@@ -448,6 +513,16 @@ int SettingsManager::getUiRefreshIntervalMs()
     return getSettings().ui_refresh_interval_ms;
 }
 
+int SettingsManager::getStatusPollMinMs()
+{
+    return getSettings().status_poll_min_ms;
+}
+
+int SettingsManager::getStatusPollMaxMs()
+{
+    return getSettings().status_poll_max_ms;
+}
+
 int SettingsManager::getLogLevel()
 {
     return getSettings().log_level;
@@ -622,6 +697,61 @@ void SettingsManager::setDetectionMode(int mode)
     settings.detection_mode = mode;
 }
 
+void SettingsManager::setDetectionWindowMode(int mode)
+{
+    if (!isLoaded)
+        load();
+    if (mode < 0 || mode > 1)
+    {
+        mode = 0;
+    }
+    settings.detection_window_mode = mode;
+}
+
+void SettingsManager::setDetectionLikelihoodThreshold(float nats)
+{
+    if (!isLoaded)
+        load();
+    if (nats < 1.0f)
+    {
+        nats = 1.0f;
+    }
+    else if (nats > 20.0f)
+    {
+        nats = 20.0f;
+    }
+    settings.detection_likelihood_threshold = nats;
+}
+
+void SettingsManager::setDetectionSoftAlgorithm(int algorithm)
+{
+    if (!isLoaded)
+        load();
+    if (algorithm < 0 || algorithm > 1)
+    {
+        algorithm = 0;
+    }
+    settings.detection_soft_algorithm = algorithm;
+}
+
+void SettingsManager::setDetectionRatioSource(int source)
+{
+    if (!isLoaded)
+        load();
+    if (source < 0 || source > 1)
+    {
+        source = 0;
+    }
+    settings.detection_ratio_source = source;
+}
+
+void SettingsManager::setDetectionAdaptiveThreshold(bool enabled)
+{
+    if (!isLoaded)
+        load();
+    settings.detection_adaptive_threshold = enabled;
+}
+
 void SettingsManager::setSdcpLossBehavior(int behavior)
 {
     if (!isLoaded)
@@ -643,6 +773,20 @@ void SettingsManager::setUiRefreshIntervalMs(int intervalMs)
     settings.ui_refresh_interval_ms = intervalMs;
 }
 
+void SettingsManager::setStatusPollMinMs(int intervalMs)
+{
+    if (!isLoaded)
+        load();
+    settings.status_poll_min_ms = intervalMs;
+}
+
+void SettingsManager::setStatusPollMaxMs(int intervalMs)
+{
+    if (!isLoaded)
+        load();
+    settings.status_poll_max_ms = intervalMs;
+}
+
 void SettingsManager::setLogLevel(int level)
 {
     if (!isLoaded)
@@ -19,9 +19,16 @@ struct user_settings
       int    detection_soft_jam_time_ms;   // Soft jam: how long ratio must stay bad (ms, e.g., 3000 = 3 sec)
       int    detection_hard_jam_time_ms;   // Hard jam: how long zero movement required (ms, e.g., 2000 = 2 sec)
       int    detection_mode;               // 0=Soft+Hard, 1=Hard only, 2=Soft only
+      int    detection_window_mode;        // 0=Last 5s (time), 1=Last N mm (distance)
+      float  detection_likelihood_threshold; // Low-count hard jam: trip below ln P = -threshold (nats)
+      int    detection_soft_algorithm;     // 0=Timer, 1=Sequential (CUSUM)
+      int    detection_ratio_source;       // 0=Window rates, 1=Kalman estimate
+      bool   detection_adaptive_threshold; // Tighten the soft threshold to the learned healthy ratio
       int    sdcp_loss_behavior;
     int    flow_telemetry_stale_ms;
     int    ui_refresh_interval_ms;
+    int    status_poll_min_ms;        // Fastest printer status poll while printing
+    int    status_poll_max_ms;        // Slowest printer status poll while printing
     int    log_level;                 // 0=Normal, 1=Verbose, 2=Pin Values
     bool   suppress_pause_commands;   // Suppress pause/cancel commands (for testing/development)
     float  movement_mm_per_pulse;
@@ -69,9 +76,16 @@ class SettingsManager
       int    getDetectionSoftJamTimeMs();     // Soft jam duration threshold
       int    getDetectionHardJamTimeMs();     // Hard jam duration threshold
       int    getDetectionMode();              // Detection mode selector (0=both,1=hard,2=soft)
+      int    getDetectionWindowMode();        // Window mode selector (0=time,1=distance)
+      float  getDetectionLikelihoodThreshold(); // Low-count likelihood threshold (nats)
+      int    getDetectionSoftAlgorithm();     // Soft jam rule (0=timer,1=CUSUM)
+      int    getDetectionRatioSource();       // Pass ratio source (0=window,1=Kalman)
+      bool   getDetectionAdaptiveThreshold(); // Learned soft threshold per print file
     int    getSdcpLossBehavior();
     int    getFlowTelemetryStaleMs();
     int    getUiRefreshIntervalMs();
+    int    getStatusPollMinMs();
+    int    getStatusPollMaxMs();
     int    getLogLevel();                      // Get current log level (0-2)
     bool   getSuppressPauseCommands();         // Get pause command suppression state
     bool   getVerboseLogging();                // Returns true if log level >= 1
@@ -96,9 +110,16 @@ class SettingsManager
       void setDetectionSoftJamTimeMs(int timeMs);        // Soft jam duration setter
       void setDetectionHardJamTimeMs(int timeMs);        // Hard jam duration setter
       void setDetectionMode(int mode);                    // Detection mode selector
+      void setDetectionWindowMode(int mode);              // Window mode selector
+      void setDetectionLikelihoodThreshold(float nats);   // Low-count likelihood threshold
+      void setDetectionSoftAlgorithm(int algorithm);      // Soft jam rule selector
+      void setDetectionRatioSource(int source);           // Pass ratio source selector
+      void setDetectionAdaptiveThreshold(bool enabled);   // Learned soft threshold on/off
     void setSdcpLossBehavior(int behavior);
     void setFlowTelemetryStaleMs(int staleMs);
     void setUiRefreshIntervalMs(int intervalMs);
+    void setStatusPollMinMs(int intervalMs);
+    void setStatusPollMaxMs(int intervalMs);
     void setLogLevel(int level);                   // Set log level (0-2), updates logger
     void setSuppressPauseCommands(bool suppress);  // Set pause command suppression
     void setMovementMmPerPulse(float mmPerPulse);
@@ -0,0 +1,230 @@
+#include "ShadowJamBank.h"
+
+#include "Logger.h"
+
+namespace
+{
+    // How each shadow differs from the active config. Algorithm and ratio
+    // source variants flip whatever is active, so they always show the
+    // road not taken.
+    struct ShadowVariant
+    {
+        const char* name;
+        float       ratioDelta;      // Added to ratioThreshold
+        uint8_t     timePercent;     // Scales soft and hard accumulation times
+        bool        flipSoftAlgorithm;
+        bool        flipRatioSource;
+    };
+
+    const ShadowVariant kVariants[] = {
+        {"strict", 0.10f, 75, false, false},
+        {"lax", -0.10f, 150, false, false},
+        {"alt_soft", 0.0f, 100, true, false},
+        {"alt_ratio", 0.0f, 100, false, true},
+    };
+    constexpr int VARIANT_COUNT = sizeof(kVariants) / sizeof(kVariants[0]);
+
+    constexpr float SHADOW_MIN_RATIO = 0.05f;
+    constexpr float SHADOW_MAX_RATIO = 0.95f;
+
+    uint16_t scaleTimeMs(uint16_t timeMs, uint8_t percent)
+    {
+        uint32_t scaled = (uint32_t) timeMs * percent / 100;
+        return scaled > 65535 ? 65535 : (uint16_t) scaled;
+    }
+}
+
+static_assert(SHADOW_BANK_SIZE >= 0 && SHADOW_BANK_SIZE <= VARIANT_COUNT,
+              "SHADOW_BANK_SIZE cannot exceed the number of variants");
+
+ShadowJamBank::ShadowJamBank()
+{
+    JamConfig defaults = {};
+    defaults.ratioThreshold = 0.25f;
+    defaults.hardJamMm      = 5.0f;
+    defaults.softJamTimeMs  = 10000;
+    defaults.hardJamTimeMs  = 5000;
+    defaults.graceTimeMs    = 18000;
+
+    for (int i = 0; i < SIZE; i++)
+    {
+        detectors[i].setQuiet(true);
+    }
+    configure(defaults);
+    reset(0);
+    clearResults();
+}
+
+void ShadowJamBank::configure(const JamConfig& active)
+{
+    for (int i = 0; i < SIZE; i++)
+    {
+        const ShadowVariant& variant = kVariants[i];
+        JamConfig            config  = active;
+
+        config.ratioThreshold += variant.ratioDelta;
+        if (config.ratioThreshold < SHADOW_MIN_RATIO) config.ratioThreshold = SHADOW_MIN_RATIO;
+        if (config.ratioThreshold > SHADOW_MAX_RATIO) config.ratioThreshold = SHADOW_MAX_RATIO;
+        config.softJamTimeMs = scaleTimeMs(active.softJamTimeMs, variant.timePercent);
+        config.hardJamTimeMs = scaleTimeMs(active.hardJamTimeMs, variant.timePercent);
+        if (variant.flipSoftAlgorithm)
+        {
+            config.softJamAlgorithm = (active.softJamAlgorithm == SoftJamAlgorithm::TIMER)
+                                          ? SoftJamAlgorithm::CUSUM
+                                          : SoftJamAlgorithm::TIMER;
+        }
+        if (variant.flipRatioSource)
+        {
+            config.ratioSource = (active.ratioSource == FlowRatioSource::WINDOW)
+                                     ? FlowRatioSource::KALMAN
+                                     : FlowRatioSource::WINDOW;
+        }
+
+        configs[i]                = config;
+        results[i].name           = variant.name;
+        results[i].ratioThreshold = config.ratioThreshold;
+        results[i].softJamTimeMs  = config.softJamTimeMs;
+        results[i].hardJamTimeMs  = config.hardJamTimeMs;
+    }
+}
+
+void ShadowJamBank::reset(unsigned long currentTimeMs)
+{
+    for (int i = 0; i < SIZE; i++)
+    {
+        detectors[i].reset(currentTimeMs);
+        results[i].jammed = false;
+    }
+    activeJammed = false;
+}
+
+void ShadowJamBank::clearResults()
+{
+    for (int i = 0; i < SIZE; i++)
+    {
+        results[i].trips              = 0;
+        results[i].firstTripMs        = 0;
+        results[i].firstTripHard      = false;
+        results[i].firstTripCode      = TripCode::NONE;
+        results[i].firstTripPassRatio = 0.0f;
+        results[i].jammed             = false;
+    }
+    activeTrips       = 0;
+    activeFirstTripMs = 0;
+    activeJammed      = false;
+    overBudgetLogged  = false;
+    evaluations       = 0;
+    lastUpdateUs      = 0;
+    maxUpdateUs       = 0;
+}
+
+void ShadowJamBank::onResume(unsigned long currentTimeMs,
+                             unsigned long currentPulseCount,
+                             float         currentActualMm)
+{
+    for (int i = 0; i < SIZE; i++)
+    {
+        detectors[i].onResume(currentTimeMs, currentPulseCount, currentActualMm);
+        results[i].jammed = false;
+    }
+    activeJammed = false;
+}
+
+void ShadowJamBank::update(const JamState& active,
+                           int32_t       expectedUm,
+                           int32_t       actualUm,
+                           unsigned long movementPulseCount,
+                           bool          isPrinting,
+                           bool          hasTelemetry,
+                           unsigned long currentTimeMs,
+                           unsigned long printStartTimeMs,
+                           int32_t       expectedRateUmPerSec,
+                           int32_t       actualRateUmPerSec,
+                           int32_t       shortExpectedRateUmPerSec,
+                           int32_t       shortActualRateUmPerSec,
+                           int32_t       edgeVelocityUmPerSec,
+                           const FlowEstimate* flowEstimate)
+{
+    uint32_t startUs = micros();
+    unsigned long sincePrintStart = currentTimeMs - printStartTimeMs;
+
+    if (active.jammed && !activeJammed)
+    {
+        activeTrips++;
+        if (activeFirstTripMs == 0) activeFirstTripMs = sincePrintStart ? sincePrintStart : 1;
+    }
+    activeJammed = active.jammed;
+
+    for (int i = 0; i < SIZE; i++)
+    {
+        JamState state = detectors[i].updateUm(
+            expectedUm, actualUm, movementPulseCount, isPrinting, hasTelemetry,
+            currentTimeMs, printStartTimeMs, configs[i],
+            expectedRateUmPerSec, actualRateUmPerSec,
+            shortExpectedRateUmPerSec, shortActualRateUmPerSec,
+            edgeVelocityUmPerSec, flowEstimate);
+
+        ShadowResult& result = results[i];
+        if (state.jammed && !result.jammed)
+        {
+            result.trips++;
+            if (result.firstTripMs == 0)
+            {
+                result.firstTripMs        = sincePrintStart ? sincePrintStart : 1;
+                result.firstTripHard      = state.hardJamTriggered;
+                result.firstTripCode      = state.tripCode;
+                result.firstTripPassRatio = state.passRatio;
+            }
+        }
+        result.jammed = state.jammed;
+    }
+
+    evaluations++;
+    lastUpdateUs = micros() - startUs;
+    if (lastUpdateUs > maxUpdateUs) maxUpdateUs = lastUpdateUs;
+    if (lastUpdateUs > UPDATE_BUDGET_US && !overBudgetLogged)
+    {
+        overBudgetLogged = true;
+        logger.logf("Shadow detectors over CPU budget: %luus > %luus per evaluation",
+                    (unsigned long) lastUpdateUs, (unsigned long) UPDATE_BUDGET_US);
+    }
+}
+
+ShadowBankReport ShadowJamBank::getReport() const
+{
+    ShadowBankReport report;
+    report.count = SIZE;
+    for (int i = 0; i < SIZE; i++)
+    {
+        report.results[i] = results[i];
+    }
+    report.activeTrips       = activeTrips;
+    report.activeFirstTripMs = activeFirstTripMs;
+    report.evaluations       = evaluations;
+    report.lastUpdateUs      = lastUpdateUs;
+    report.maxUpdateUs       = maxUpdateUs;
+    report.budgetUs          = UPDATE_BUDGET_US;
+    report.ramBytes          = sizeof(ShadowJamBank);
+    return report;
+}
+
+void ShadowJamBank::logSummary() const
+{
+    if (SIZE == 0 || evaluations == 0)
+    {
+        return;
+    }
+
+    logger.logf("Shadow summary: active trips=%u first=%lums evals=%lu max=%luus ram=%uB",
+                (unsigned) activeTrips, activeFirstTripMs, evaluations,
+                (unsigned long) maxUpdateUs, (unsigned) sizeof(ShadowJamBank));
+    for (int i = 0; i < SIZE; i++)
+    {
+        const ShadowResult& result = results[i];
+        logger.logf("Shadow %s: ratio_thr=%.2f soft_time=%u hard_time=%u trips=%u first=%lums %s code=%d pass=%.2f",
+                    result.name, result.ratioThreshold, (unsigned) result.softJamTimeMs,
+                    (unsigned) result.hardJamTimeMs, (unsigned) result.trips, result.firstTripMs,
+                    result.trips == 0 ? "-" : (result.firstTripHard ? "hard" : "soft"),
+                    (int) result.firstTripCode, result.firstTripPassRatio);
+    }
+}
@@ -0,0 +1,132 @@
+#ifndef SHADOW_JAM_BANK_H
+#define SHADOW_JAM_BANK_H
+
+#include <stdint.h>
+
+#include "JamDetector.h"
+
+// Number of shadow detectors (one per variant below, at most 4); 0 compiles
+// the bank down to bookkeeping only
+#ifndef SHADOW_BANK_SIZE
+#define SHADOW_BANK_SIZE 4
+#endif
+
+/**
+ * What one shadow detector would have done during the current print.
+ */
+struct ShadowResult
+{
+    const char*   name;                // Variant name, e.g. "strict"
+    float         ratioThreshold;      // Effective config, for the report
+    uint16_t      softJamTimeMs;
+    uint16_t      hardJamTimeMs;
+    uint16_t      trips;               // Jam onsets this print
+    unsigned long firstTripMs;         // Since print start; 0 = never tripped
+    bool          firstTripHard;       // Hard (true) or soft jam
+    TripCode      firstTripCode;       // Condition behind the first trip
+    float         firstTripPassRatio;  // Pass ratio at the first trip
+    bool          jammed;              // Would be jammed right now
+};
+
+/**
+ * Copy of the bank's results and its own cost, safe to hand to the web task.
+ */
+struct ShadowBankReport
+{
+    uint8_t       count;
+    ShadowResult  results[SHADOW_BANK_SIZE > 0 ? SHADOW_BANK_SIZE : 1];
+    uint16_t      activeTrips;         // The real detector, for comparison
+    unsigned long activeFirstTripMs;
+    unsigned long evaluations;
+    uint32_t      lastUpdateUs;
+    uint32_t      maxUpdateUs;
+    uint32_t      budgetUs;
+    uint32_t      ramBytes;
+};
+
+/**
+ * Fixed bank of extra JamDetectors evaluated on the same window snapshot as
+ * the active one, each with a variant of the active JamConfig (stricter,
+ * laxer, the other soft algorithm, the other ratio source). They are quiet
+ * and never pause: each only records when and why it would have tripped,
+ * so thresholds can be tuned against real prints without risking them.
+ *
+ * RAM is fixed at compile time (SHADOW_BANK_RAM_BUDGET) and every update
+ * times itself against UPDATE_BUDGET_US.
+ */
+class ShadowJamBank
+{
+  public:
+    static const int      SIZE                   = SHADOW_BANK_SIZE;
+    static const uint32_t UPDATE_BUDGET_US       = 2000;  // Per 4Hz evaluation, whole bank
+
+    ShadowJamBank();
+
+    /**
+     * Derive the variant configs from the active one (settings change).
+     */
+    void configure(const JamConfig& active);
+
+    /**
+     * Restart the detectors (print start/end); results are kept until
+     * clearResults() so the last print can still be inspected.
+     */
+    void reset(unsigned long currentTimeMs);
+
+    /**
+     * Forget the previous print's results (new print).
+     */
+    void clearResults();
+
+    /**
+     * Mirror a real pause/resume so shadows get the same resume grace.
+     */
+    void onResume(unsigned long currentTimeMs,
+                  unsigned long currentPulseCount,
+                  float         currentActualMm);
+
+    /**
+     * Evaluate every shadow on the inputs the active detector just used.
+     * @param active State the active detector returned for these inputs.
+     */
+    void update(const JamState& active,
+                int32_t       expectedUm,
+                int32_t       actualUm,
+                unsigned long movementPulseCount,
+                bool          isPrinting,
+                bool          hasTelemetry,
+                unsigned long currentTimeMs,
+                unsigned long printStartTimeMs,
+                int32_t       expectedRateUmPerSec,
+                int32_t       actualRateUmPerSec,
+                int32_t       shortExpectedRateUmPerSec,
+                int32_t       shortActualRateUmPerSec,
+                int32_t       edgeVelocityUmPerSec,
+                const FlowEstimate* flowEstimate);
+
+    ShadowBankReport getReport() const;
+
+    /**
+     * One line per shadow for the per-print summary log.
+     */
+    void logSummary() const;
+
+  private:
+    JamDetector   detectors[SIZE > 0 ? SIZE : 1];
+    JamConfig     configs[SIZE > 0 ? SIZE : 1];
+    ShadowResult  results[SIZE > 0 ? SIZE : 1];
+
+    uint16_t      activeTrips;
+    unsigned long activeFirstTripMs;
+    bool          activeJammed;
+    bool          overBudgetLogged;
+    unsigned long evaluations;
+    uint32_t      lastUpdateUs;
+    uint32_t      maxUpdateUs;
+};
+
+// Four detectors with their configs fit comfortably in this
+#define SHADOW_BANK_RAM_BUDGET 2048
+static_assert(sizeof(ShadowJamBank) <= SHADOW_BANK_RAM_BUDGET, "Shadow bank exceeds its RAM budget");
+
+#endif  // SHADOW_JAM_BANK_H
@@ -0,0 +1,162 @@
+#include "StatusPollScheduler.h"
+
+namespace
+{
+    // Pass-ratio EWMA weight per update (about 2s at 4Hz)
+    const float RATIO_ALPHA = 0.125f;
+
+    // Pass-ratio standard deviation that starts / saturates urgency. Steady
+    // extrusion on a 2.88mm/pulse sensor sits below the floor.
+    const float SIGMA_QUIET = 0.05f;
+    const float SIGMA_LOUD  = 0.25f;
+
+    // Accumulator rise per update that counts as climbing (percent)
+    const float JAM_RISING_PERCENT = 0.5f;
+
+    // Largest relative slowdown per update
+    const float RELAX_STEP = 1.25f;
+
+    // Longer gaps between updates are a pause, not printing time
+    const uint32_t MAX_UPDATE_GAP_MS = 1000;
+
+    const float FRAME_COST_ALPHA = 0.125f;
+
+    float clamp01(float value)
+    {
+        if (value < 0.0f) return 0.0f;
+        if (value > 1.0f) return 1.0f;
+        return value;
+    }
+}
+
+StatusPollScheduler::StatusPollScheduler() : intervalMs(BASELINE_INTERVAL_MS)
+{
+    configure(BASELINE_INTERVAL_MS, BASELINE_INTERVAL_MS);
+    reset();
+}
+
+void StatusPollScheduler::configure(int minMs, int maxMs)
+{
+    if (minMs < MIN_INTERVAL_LIMIT_MS) minMs = MIN_INTERVAL_LIMIT_MS;
+    if (minMs > MAX_INTERVAL_LIMIT_MS) minMs = MAX_INTERVAL_LIMIT_MS;
+    if (maxMs > MAX_INTERVAL_LIMIT_MS) maxMs = MAX_INTERVAL_LIMIT_MS;
+    if (maxMs < minMs) maxMs = minMs;
+
+    minIntervalMs = (uint16_t) minMs;
+    maxIntervalMs = (uint16_t) maxMs;
+    if (intervalMs < minIntervalMs) intervalMs = minIntervalMs;
+    if (intervalMs > maxIntervalMs) intervalMs = maxIntervalMs;
+}
+
+void StatusPollScheduler::reset()
+{
+    intervalMs = minIntervalMs;
+
+    haveSample     = false;
+    ratioMean      = 1.0f;
+    ratioVar       = 0.0f;
+    lastJamPercent = 0.0f;
+
+    haveUpdate    = false;
+    lastUpdateMs  = 0;
+    printingMs    = 0;
+    polls         = 0;
+    frameCostUs   = 0.0f;
+    haveFrameCost = false;
+}
+
+void StatusPollScheduler::update(float passRatio, float hardJamPercent, float softJamPercent,
+                                 bool graceActive, unsigned long now)
+{
+    if (haveUpdate)
+    {
+        uint32_t gapMs = (uint32_t) (now - lastUpdateMs);
+        printingMs += gapMs < MAX_UPDATE_GAP_MS ? gapMs : MAX_UPDATE_GAP_MS;
+    }
+    haveUpdate   = true;
+    lastUpdateMs = now;
+
+    // Grace re-baselines flow; get it fresh frames
+    float urgency = graceActive ? 1.0f : 0.0f;
+
+    // A climbing accumulator wants the fastest rate; one that is holding
+    // or draining scales with how full it is
+    float jamPercent = hardJamPercent > softJamPercent ? hardJamPercent : softJamPercent;
+    float jamUrgency = jamPercent - lastJamPercent >= JAM_RISING_PERCENT ? 1.0f
+                                                                       : clamp01(jamPercent / 100.0f);
+    lastJamPercent = jamPercent;
+    if (jamUrgency > urgency) urgency = jamUrgency;
+
+    // Noisy flow: the detector is closer to the edge than the mean says.
+    // Variance is only tracked outside grace, where the ratio means something.
+    if (!graceActive)
+    {
+        if (!haveSample)
+        {
+            ratioMean  = passRatio;
+            ratioVar   = 0.0f;
+            haveSample = true;
+        }
+        else
+        {
+            float delta = passRatio - ratioMean;
+            ratioMean += RATIO_ALPHA * delta;
+            ratioVar = (1.0f - RATIO_ALPHA) * (ratioVar + RATIO_ALPHA * delta * delta);
+        }
+        // Compare variances to avoid a sqrt
+        float varUrgency = 0.0f;
+        if (ratioVar > SIGMA_QUIET * SIGMA_QUIET)
+        {
+            varUrgency = clamp01((ratioVar - SIGMA_QUIET * SIGMA_QUIET) /
+                                 (SIGMA_LOUD * SIGMA_LOUD - SIGMA_QUIET * SIGMA_QUIET));
+        }
+        if (varUrgency > urgency) urgency = varUrgency;
+    }
+
+    float target = maxIntervalMs - urgency * (float) (maxIntervalMs - minIntervalMs);
+    float relaxed = intervalMs * RELAX_STEP;
+    if (target > relaxed) target = relaxed;
+    if (target < minIntervalMs) target = minIntervalMs;
+    if (target > maxIntervalMs) target = maxIntervalMs;
+    intervalMs = (uint16_t) (target + 0.5f);
+}
+
+void StatusPollScheduler::onPollSent()
+{
+    polls++;
+}
+
+void StatusPollScheduler::onFrameHandled(uint32_t costUs)
+{
+    if (!haveFrameCost)
+    {
+        frameCostUs   = (float) costUs;
+        haveFrameCost = true;
+        return;
+    }
+    frameCostUs += FRAME_COST_ALPHA * ((float) costUs - frameCostUs);
+}
+
+StatusPollMetrics StatusPollScheduler::getMetrics() const
+{
+    StatusPollMetrics metrics;
+    metrics.intervalMs  = intervalMs;
+    metrics.polls       = polls;
+    metrics.frameCostUs = (uint32_t) (frameCostUs + 0.5f);
+    metrics.printingMs  = printingMs;
+
+    uint32_t baseline  = printingMs / BASELINE_INTERVAL_MS;
+    metrics.pollsSaved = baseline > polls ? baseline - polls : 0;
+
+    if (printingMs == 0)
+    {
+        metrics.achievedHz       = 0.0f;
+        metrics.cpuSavedUsPerSec = 0;
+        return metrics;
+    }
+    metrics.achievedHz = polls * 1000.0f / printingMs;
+
+    float savedHz = 1000.0f / BASELINE_INTERVAL_MS - metrics.achievedHz;
+    metrics.cpuSavedUsPerSec = savedHz > 0.0f ? (uint32_t) (savedHz * frameCostUs + 0.5f) : 0;
+    return metrics;
+}
@@ -0,0 +1,93 @@
+#ifndef STATUS_POLL_SCHEDULER_H
+#define STATUS_POLL_SCHEDULER_H
+
+#include <stdint.h>
+
+/**
+ * How the adaptive poll rate is doing this print.
+ */
+struct StatusPollMetrics
+{
+    uint16_t intervalMs;          // Current target interval
+    float    achievedHz;          // Polls per second of printing
+    uint32_t polls;               // Status polls sent while printing
+    uint32_t pollsSaved;          // Against the fixed BASELINE_INTERVAL_MS schedule
+    uint32_t frameCostUs;         // Average parse + handle time per status frame
+    uint32_t cpuSavedUsPerSec;    // Frame handling avoided per second of printing
+    uint32_t printingMs;          // Time the rates are measured over
+};
+
+/**
+ * Status poll interval for an active print, between a configured minimum
+ * and maximum.
+ *
+ * Each detector update scores how much a fresh frame is worth right now:
+ * grace (flow being re-baselined), a climbing hard or soft jam
+ * accumulator, and the pass-ratio variance. The most urgent wins. The
+ * interval drops to the target at once and relaxes by at most a quarter
+ * per update, so steady infill polls at the maximum and a building jam
+ * at the minimum within one update.
+ *
+ * Runs at the 4Hz detector rate, so floats are fine here.
+ */
+class StatusPollScheduler
+{
+  public:
+    static const uint16_t BASELINE_INTERVAL_MS = 250;   // The fixed active rate this replaces
+    static const uint16_t MIN_INTERVAL_LIMIT_MS = 50;
+    // Frames arrive an interval plus the round trip (and WiFi jitter) apart,
+    // and expected flow is only extrapolated FMS_EXTRAPOLATE_MAX_MS past a
+    // frame, so the slowest interval leaves this much margin below it
+    static const uint16_t ROUND_TRIP_MARGIN_MS  = 250;
+    static const uint16_t MAX_INTERVAL_LIMIT_MS = 750;
+
+    StatusPollScheduler();
+
+    /**
+     * Set the bounds, clamped to the limits above. Takes effect at once.
+     */
+    void configure(int minIntervalMs, int maxIntervalMs);
+
+    /**
+     * Start a print at the fastest rate.
+     */
+    void reset();
+
+    /**
+     * Feed the detector state after each update while printing. The time
+     * between updates (capped, so pauses do not count) is the printing time
+     * the metrics are measured over.
+     */
+    void update(float passRatio, float hardJamPercent, float softJamPercent, bool graceActive,
+                unsigned long now);
+
+    uint16_t getIntervalMs() const { return intervalMs; }
+
+    void onPollSent();
+
+    /**
+     * Time spent parsing and handling one status frame.
+     */
+    void onFrameHandled(uint32_t costUs);
+
+    StatusPollMetrics getMetrics() const;
+
+  private:
+    uint16_t minIntervalMs;
+    uint16_t maxIntervalMs;
+    uint16_t intervalMs;
+
+    bool          haveSample;
+    float         ratioMean;      // EWMA of the pass ratio
+    float         ratioVar;       // EWMA of its squared deviation
+    float         lastJamPercent; // max(hard, soft) at the previous update
+
+    bool          haveUpdate;
+    unsigned long lastUpdateMs;
+    uint32_t      printingMs;
+    uint32_t      polls;
+    float         frameCostUs;
+    bool          haveFrameCost;
+};
+
+#endif  // STATUS_POLL_SCHEDULER_H
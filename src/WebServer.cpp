@@ -18,6 +18,9 @@ constexpr const char kRouteTestPause[]        = "/test_pause";
 constexpr const char kRouteTestResume[]       = "/test_resume";
 constexpr const char kRouteDiscoverPrinter[]  = "/discover_printer";
 constexpr const char kRouteSensorStatus[]     = "/sensor_status";
+constexpr const char kRouteShadowDetectors[]  = "/api/shadow_detectors";
+constexpr const char kRouteSdcpLatency[]      = "/api/sdcp_latency";
+constexpr const char kRouteFlowReplay[]       = "/api/flow_replay";
 constexpr const char kRouteLogsText[]         = "/api/logs_text";
 constexpr const char kRouteLogsLive[]         = "/api/logs_live";
 constexpr const char kRouteLogsClear[]        = "/api/logs/clear";
@@ -32,6 +35,62 @@ constexpr const char kRouteFavicon[]          = "/favicon.ico";
 constexpr const char kRouteRoot[]             = "/";
 constexpr const char kLiteIndexPath[]         = "/lite/index.htm";
 constexpr const char kRouteReset[]            = "/api/reset";
+
+// Summary plus raw buckets; bucket i counts samples up to boundsMs[i], the
+// last one everything above
+void addLatencyHistogram(JsonObject out, const SdcpLatencyHistogram &histogram,
+                         const uint16_t *bounds)
+{
+    out["samples"] = histogram.samples;
+    out["meanMs"]  = histogram.meanMs();
+    out["p50Ms"]   = histogram.percentileMs(50, bounds);
+    out["p95Ms"]   = histogram.percentileMs(95, bounds);
+    out["maxMs"]   = histogram.maxMs;
+    out["lastMs"]  = histogram.lastMs;
+    JsonArray boundsMs = out.createNestedArray("boundsMs");
+    for (uint8_t i = 0; i < SDCP_LATENCY_BUCKETS - 1; i++)
+    {
+        boundsMs.add(bounds[i]);
+    }
+    JsonArray counts = out.createNestedArray("counts");
+    for (uint8_t i = 0; i < SDCP_LATENCY_BUCKETS; i++)
+    {
+        counts.add(histogram.counts[i]);
+    }
+}
+
+// Optional numeric override for /api/flow_replay. True if key is present
+// and within [minValue, maxValue]; a present but bad value sets badKey.
+bool readReplayInt(JsonObject obj, const char *key, long minValue, long maxValue, long &value,
+                   const char *&badKey)
+{
+    if (!obj.containsKey(key))
+        return false;
+    JsonVariant variant = obj[key];
+    if (!variant.is<long>() || variant.as<long>() < minValue || variant.as<long>() > maxValue)
+    {
+        badKey = key;
+        return false;
+    }
+    value = variant.as<long>();
+    return true;
+}
+
+bool readReplayFloat(JsonObject obj, const char *key, float minValue, float maxValue, float &value,
+                     const char *&badKey)
+{
+    if (!obj.containsKey(key))
+        return false;
+    JsonVariant variant = obj[key];
+    // The negated test also rejects NaN
+    if (!variant.is<float>() || !(variant.as<float>() >= minValue && variant.as<float>() <= maxValue))
+    {
+        badKey = key;
+        return false;
+    }
+    value = variant.as<float>();
+    return true;
+}
 }  // namespace
 
 // External reference to firmware version from main.cpp
@@ -154,12 +213,26 @@ void WebServer::begin()
                 settingsManager.setDetectionHardJamTimeMs(jsonObj["detection_hard_jam_time_ms"].as<int>());
             if (jsonObj.containsKey("detection_mode"))
                 settingsManager.setDetectionMode(jsonObj["detection_mode"].as<int>());
+            if (jsonObj.containsKey("detection_window_mode"))
+                settingsManager.setDetectionWindowMode(jsonObj["detection_window_mode"].as<int>());
+            if (jsonObj.containsKey("detection_likelihood_threshold"))
+                settingsManager.setDetectionLikelihoodThreshold(jsonObj["detection_likelihood_threshold"].as<float>());
+            if (jsonObj.containsKey("detection_soft_algorithm"))
+                settingsManager.setDetectionSoftAlgorithm(jsonObj["detection_soft_algorithm"].as<int>());
+            if (jsonObj.containsKey("detection_ratio_source"))
+                settingsManager.setDetectionRatioSource(jsonObj["detection_ratio_source"].as<int>());
+            if (jsonObj.containsKey("detection_adaptive_threshold"))
+                settingsManager.setDetectionAdaptiveThreshold(jsonObj["detection_adaptive_threshold"].as<bool>());
             if (jsonObj.containsKey("sdcp_loss_behavior"))
                 settingsManager.setSdcpLossBehavior(jsonObj["sdcp_loss_behavior"].as<int>());
             if (jsonObj.containsKey("flow_telemetry_stale_ms"))
                 settingsManager.setFlowTelemetryStaleMs(jsonObj["flow_telemetry_stale_ms"].as<int>());
             if (jsonObj.containsKey("ui_refresh_interval_ms"))
                 settingsManager.setUiRefreshIntervalMs(jsonObj["ui_refresh_interval_ms"].as<int>());
+            if (jsonObj.containsKey("status_poll_min_ms"))
+                settingsManager.setStatusPollMinMs(jsonObj["status_poll_min_ms"].as<int>());
+            if (jsonObj.containsKey("status_poll_max_ms"))
+                settingsManager.setStatusPollMaxMs(jsonObj["status_poll_max_ms"].as<int>());
             if (jsonObj.containsKey("suppress_pause_commands"))
                 settingsManager.setSuppressPauseCommands(jsonObj["suppress_pause_commands"].as<bool>());
             if (jsonObj.containsKey("log_level"))
@@ -266,15 +339,16 @@ void WebServer::begin()
               {
                   printer_info_t elegooStatus = elegooCC.getCurrentInformation();
 
-                  // JSON allocation: 576 bytes heap (was 768 bytes)
-                  // Measured actual: ~480 bytes (83% utilization, 17% margin)
-                  // Last measured: 2025-11-26
+                  // JSON allocation: 1152 bytes heap (was 576 bytes; flow lag,
+                  // soft threshold, calibration, jam prediction, poll rate and
+                  // edge overflow fields added, ~52 members at 16 bytes plus
+                  // copied strings)
                   // See: .claude/hardcoded-allocations.md for maintenance notes
-                  DynamicJsonDocument jsonDoc(576);
+                  DynamicJsonDocument jsonDoc(1152);
                   buildStatusJson(jsonDoc, elegooStatus);
 
                   String jsonResponse;
-                  jsonResponse.reserve(576);  // Pre-allocate to prevent fragmentation
+                  jsonResponse.reserve(1152);  // Pre-allocate to prevent fragmentation
                   serializeJson(jsonDoc, jsonResponse);
 
                   // Pin Values level: Check if approaching allocation limit
@@ -282,10 +356,10 @@ void WebServer::begin()
                   {
                       size_t actualSize = measureJson(jsonDoc);
                       static bool logged = false;
-                      if (!logged && actualSize > 490)  // >85% of 576 bytes
+                      if (!logged && actualSize > 980)  // >85% of 1152 bytes
                       {
-                          logger.logf(LOG_PIN_VALUES, "WebServer sensor_status JSON size: %zu / 576 bytes (%.1f%%)",
-                                     actualSize, (actualSize * 100.0f / 576.0f));
+                          logger.logf(LOG_PIN_VALUES, "WebServer sensor_status JSON size: %zu / 1152 bytes (%.1f%%)",
+                                     actualSize, (actualSize * 100.0f / 1152.0f));
                           logged = true;  // Only log once per session
                       }
                   }
@@ -293,6 +367,161 @@ void WebServer::begin()
                   request->send(200, "application/json", jsonResponse);
               });
 
+    // Shadow detector bank: what alternative jam configs would have done
+    server.on(kRouteShadowDetectors, HTTP_GET,
+              [this](AsyncWebServerRequest *request)
+              {
+                  ShadowBankReport report = elegooCC.getShadowReport();
+
+                  // ~180 bytes per detector plus the header fields
+                  DynamicJsonDocument jsonDoc(1536);
+                  JsonObject active = jsonDoc.createNestedObject("active");
+                  active["trips"]       = report.activeTrips;
+                  active["firstTripMs"] = (uint32_t) report.activeFirstTripMs;
+
+                  JsonObject cost = jsonDoc.createNestedObject("cost");
+                  cost["evaluations"]  = (uint32_t) report.evaluations;
+                  cost["lastUpdateUs"] = report.lastUpdateUs;
+                  cost["maxUpdateUs"]  = report.maxUpdateUs;
+                  cost["budgetUs"]     = report.budgetUs;
+                  cost["ramBytes"]     = report.ramBytes;
+
+                  JsonArray detectors = jsonDoc.createNestedArray("detectors");
+                  for (int i = 0; i < report.count; i++)
+                  {
+                      const ShadowResult &result = report.results[i];
+                      JsonObject detector = detectors.createNestedObject();
+                      detector["name"]           = result.name;
+                      detector["ratioThreshold"] = result.ratioThreshold;
+                      detector["softJamTimeMs"]  = result.softJamTimeMs;
+                      detector["hardJamTimeMs"]  = result.hardJamTimeMs;
+                      detector["trips"]          = result.trips;
+                      detector["firstTripMs"]    = (uint32_t) result.firstTripMs;
+                      if (result.trips > 0)
+                      {
+                          detector["firstTripType"]      = result.firstTripHard ? "hard" : "soft";
+                          detector["firstTripCode"]      = (int) result.firstTripCode;
+                          detector["firstTripPassRatio"] = result.firstTripPassRatio;
+                      }
+                      detector["jammed"] = result.jammed;
+                  }
+
+                  String jsonResponse;
+                  serializeJson(jsonDoc, jsonResponse);
+                  request->send(200, "application/json", jsonResponse);
+              });
+
+    // SDCP status poll round trips and telemetry freshness since boot
+    server.on(kRouteSdcpLatency, HTTP_GET,
+              [](AsyncWebServerRequest *request)
+              {
+                  SdcpLatencyReport report = elegooCC.getLatencyReport();
+
+                  // ~60 members at 16 bytes: two histograms plus the counters
+                  DynamicJsonDocument jsonDoc(1280);
+                  jsonDoc["requests"]    = report.requests;
+                  jsonDoc["acks"]        = report.acks;
+                  jsonDoc["frames"]      = report.frames;
+                  jsonDoc["unsolicited"] = report.unsolicited;
+                  jsonDoc["late"]        = report.late;
+                  jsonDoc["dropped"]     = report.dropped;
+                  jsonDoc["outOfOrder"]  = report.outOfOrder;
+                  jsonDoc["pending"]     = report.pending;
+                  jsonDoc["lateMs"]      = SDCPLatencyTracker::LATE_MS;
+                  addLatencyHistogram(jsonDoc.createNestedObject("rtt"), report.rtt,
+                                      SDCPLatencyTracker::RTT_BUCKET_MS);
+                  addLatencyHistogram(jsonDoc.createNestedObject("telemetryAge"),
+                                      report.telemetryAge, SDCPLatencyTracker::AGE_BUCKET_MS);
+
+                  String jsonResponse;
+                  serializeJson(jsonDoc, jsonResponse);
+                  request->send(200, "application/json", jsonResponse);
+              });
+
+    // POST /api/flow_replay - Replay recent flow history with a candidate
+    // config: the active one, overridden by any detection_* keys present
+    // (same names and units as /update_settings). Runs in the main loop.
+    server.addHandler(new AsyncCallbackJsonWebHandler(
+        kRouteFlowReplay,
+        [](AsyncWebServerRequest *request, JsonVariant &json)
+        {
+            JsonObject  jsonObj = json.as<JsonObject>();
+            JamConfig   config  = elegooCC.getJamConfig();
+            const char *badKey  = nullptr;
+            long        number;
+            float       real;
+
+            // Same ranges as the settings; times must fit the detector's uint16 fields
+            if (readReplayInt(jsonObj, "detection_ratio_threshold", 1, 100, number, badKey))
+                config.ratioThreshold = number / 100.0f;
+            if (readReplayFloat(jsonObj, "detection_hard_jam_mm", 0.1f, 1000.0f, real, badKey))
+                config.hardJamMm = real;
+            if (readReplayInt(jsonObj, "detection_soft_jam_time_ms", 1, 65535, number, badKey))
+                config.softJamTimeMs = (uint16_t) number;
+            if (readReplayInt(jsonObj, "detection_hard_jam_time_ms", 1, 65535, number, badKey))
+                config.hardJamTimeMs = (uint16_t) number;
+            if (readReplayInt(jsonObj, "detection_grace_period_ms", 0, 65535, number, badKey))
+                config.graceTimeMs = (uint16_t) number;
+            if (readReplayInt(jsonObj, "detection_mode", 0, 2, number, badKey))
+                config.detectionMode = static_cast<DetectionMode>(number);
+            if (readReplayFloat(jsonObj, "detection_likelihood_threshold", 1.0f, 20.0f, real, badKey))
+                config.likelihoodThreshold = real;
+            if (readReplayInt(jsonObj, "detection_soft_algorithm", 0, 1, number, badKey))
+                config.softJamAlgorithm = static_cast<SoftJamAlgorithm>(number);
+            if (readReplayInt(jsonObj, "detection_ratio_source", 0, 1, number, badKey))
+                config.ratioSource = static_cast<FlowRatioSource>(number);
+            // The recorded windows fix the window mode; it cannot be replayed differently
+
+            if (badKey != nullptr)
+            {
+                String error = String("{\"error\":\"Invalid ") + badKey + "\"}";
+                request->send(400, "application/json", error);
+                return;
+            }
+
+            if (!elegooCC.requestReplay(config))
+            {
+                request->send(200, "application/json", "{\"active\":true}");
+                return;
+            }
+            request->send(200, "application/json", "{\"started\":true}");
+        }));
+
+    // GET /api/flow_replay - Poll the trip timeline of the last replay
+    server.on(kRouteFlowReplay, HTTP_GET,
+              [](AsyncWebServerRequest *request)
+              {
+                  FlowReplayResult result = elegooCC.getReplayResult();
+
+                  // ~130 bytes per event plus the header fields
+                  DynamicJsonDocument jsonDoc(2560);
+                  jsonDoc["active"]          = result.active;
+                  jsonDoc["done"]            = result.done;
+                  jsonDoc["samples"]         = result.samples;
+                  jsonDoc["printingSamples"] = result.printingSamples;
+                  jsonDoc["spanMs"]          = result.spanMs;
+                  jsonDoc["elapsedUs"]       = result.elapsedUs;
+                  jsonDoc["maxStepUs"]       = result.maxStepUs;
+                  jsonDoc["trips"]           = result.trips;
+
+                  JsonArray events = jsonDoc.createNestedArray("events");
+                  for (int i = 0; i < result.eventCount; i++)
+                  {
+                      const FlowReplayEvent &event = result.events[i];
+                      JsonObject e = events.createNestedObject();
+                      e["atMs"]      = event.atMs;
+                      e["ageMs"]     = event.ageMs;
+                      e["clearedMs"] = event.clearedMs;
+                      e["type"]      = event.hard ? "hard" : "soft";
+                      e["code"]      = (int) event.code;
+                      e["passRatio"] = event.passRatio;
+                  }
+
+                  String jsonResponse;
+                  serializeJson(jsonDoc, jsonResponse);
+                  request->send(200, "application/json", jsonResponse);
+              });
+
     // Logs endpoint (DISABLED - JSON serialization of 1024 entries exceeds 32KB buffer)
     // Use /api/logs_live or /api/logs_text instead
     // server.on("/api/logs", HTTP_GET,
@@ -536,16 +765,28 @@ void WebServer::buildStatusJson(DynamicJsonDocument &jsonDoc, const printer_info
     elegoo["deficitThresholdMm"]   = elegooStatus.deficitThresholdMm;
     elegoo["deficitRatio"]         = elegooStatus.deficitRatio;
     elegoo["passRatio"]            = elegooStatus.passRatio;
+    elegoo["softThreshold"]        = elegooStatus.softThreshold;
     elegoo["ratioThreshold"]       = settingsManager.getDetectionRatioThreshold();
     elegoo["hardJamPercent"]       = elegooStatus.hardJamPercent;
     elegoo["softJamPercent"]       = elegooStatus.softJamPercent;
+    elegoo["deficitTrend"]         = elegooStatus.deficitTrend;
+    elegoo["timeToJamMs"]          = elegooStatus.timeToJamMs;
+    elegoo["jamWarning"]           = elegooStatus.jamWarning;
     elegoo["movementPulses"]       = (uint32_t) elegooStatus.movementPulseCount;
+    elegoo["pulseEdgeOverflows"]   = elegooStatus.pulseEdgeOverflows;
     elegoo["uiRefreshIntervalMs"]  = settingsManager.getUiRefreshIntervalMs();
     elegoo["flowTelemetryStaleMs"] = settingsManager.getFlowTelemetryStaleMs();
     elegoo["graceActive"]          = elegooStatus.graceActive;
     elegoo["graceState"]           = elegooStatus.graceState;
     elegoo["expectedRateMmPerSec"] = elegooStatus.expectedRateMmPerSec;
     elegoo["actualRateMmPerSec"]   = elegooStatus.actualRateMmPerSec;
+    elegoo["flowLagMs"]            = (uint32_t) elegooStatus.flowLagMs;
+    elegoo["mmPerPulseEstimate"]   = elegooStatus.mmPerPulseEstimate;
+    elegoo["mmPerPulseCi"]         = elegooStatus.mmPerPulseCi;
+    elegoo["mmPerPulseConverged"]  = elegooStatus.mmPerPulseConverged;
+    elegoo["statusPollIntervalMs"] = elegooStatus.statusPollIntervalMs;
+    elegoo["statusPollHz"]         = elegooStatus.statusPollHz;
+    elegoo["statusCpuSavedUsPerSec"] = elegooStatus.statusCpuSavedUsPerSec;
     elegoo["runoutPausePending"]   = elegooStatus.runoutPausePending;
     elegoo["runoutPauseRemainingMm"] = elegooStatus.runoutPauseRemainingMm;
     elegoo["runoutPauseDelayMm"]   = elegooStatus.runoutPauseDelayMm;
@@ -555,14 +796,15 @@ void WebServer::buildStatusJson(DynamicJsonDocument &jsonDoc, const printer_info
 void WebServer::broadcastStatusUpdate()
 {
     printer_info_t elegooStatus = elegooCC.getCurrentInformation();
-    // JSON allocation: 576 bytes heap (was 768 bytes)
-    // Measured actual: ~480 bytes (83% utilization, 17% margin)
-    // Last measured: 2025-11-26
+    // JSON allocation: 1152 bytes heap (was 576 bytes; flow lag,
+    // soft threshold, calibration, jam prediction, poll rate and
+    // edge overflow fields added, ~52 members at 16 bytes plus
+    // copied strings)
     // See: .claude/hardcoded-allocations.md for maintenance notes
-    DynamicJsonDocument jsonDoc(576);
+    DynamicJsonDocument jsonDoc(1152);
     buildStatusJson(jsonDoc, elegooStatus);
     String payload;
-    payload.reserve(576);  // Pre-allocate to prevent fragmentation
+    payload.reserve(1152);  // Pre-allocate to prevent fragmentation
     serializeJson(jsonDoc, payload);
 
     // Pin Values level: Check if approaching allocation limit
@@ -570,10 +812,10 @@ void WebServer::broadcastStatusUpdate()
     {
         size_t actualSize = measureJson(jsonDoc);
         static bool logged = false;
-        if (!logged && actualSize > 490)  // >85% of 576 bytes
+        if (!logged && actualSize > 980)  // >85% of 1152 bytes
         {
-            logger.logf(LOG_PIN_VALUES, "WebServer broadcastStatusUpdate JSON size: %zu / 576 bytes (%.1f%%)",
-                       actualSize, (actualSize * 100.0f / 576.0f));
+            logger.logf(LOG_PIN_VALUES, "WebServer broadcastStatusUpdate JSON size: %zu / 1152 bytes (%.1f%%)",
+                       actualSize, (actualSize * 100.0f / 1152.0f));
             logged = true;  // Only log once per session
         }
     }
@@ -0,0 +1,177 @@
+/**
+ * Host Benchmark for the flow pipeline hot path
+ *
+ * Reports average cycles (TSC on x86, nanoseconds elsewhere) per call of the
+ * FilamentMotionSensor entry points that run on every main-loop iteration.
+ * Not part of the pass/fail suite; run manually:
+ *
+ *   g++ -std=c++17 -O2 -o bench_flow_pipeline bench_flow_pipeline.cpp -I. -I./mocks -I../src
+ *   ./bench_flow_pipeline
+ *
+ * Host CPUs have an FPU, so absolute numbers understate the soft-float cost
+ * on the ESP32-C3; compare runs against each other, not against the device.
+ */
+
+#include <chrono>
+#include <cstdio>
+
+// Define mock globals before including mocks
+unsigned long _mockMillis = 0;
+int testsPassed = 0;
+int testsFailed = 0;
+
+#include "mocks/Arduino.h"
+#include "mocks/test_mocks.h"
+
+#include "../src/FilamentMotionSensor.h"
+#include "../src/FilamentMotionSensor.cpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline unsigned long long benchNow() { return __rdtsc(); }
+static const char* BENCH_UNIT = "cycles";
+#else
+static inline unsigned long long benchNow()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+static const char* BENCH_UNIT = "ns";
+#endif
+
+static const int ITERATIONS = 200000;
+
+// Keep results observable so the optimizer cannot drop the calls
+static volatile float benchSink = 0.0f;
+
+static void report(const char* name, unsigned long long total)
+{
+    printf("  %-34s %8.1f %s/call\n", name, (double) total / ITERATIONS, BENCH_UNIT);
+}
+
+static void benchAddSensorPulse()
+{
+    resetMockTime();
+    setMockTime(10000);
+    FilamentMotionSensor sensor;
+    sensor.updateExpectedPosition(0.0f);
+
+    unsigned long long total = 0;
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        if ((i & 7) == 0) advanceTime(1);
+        unsigned long long start = benchNow();
+        sensor.addSensorPulse(2.88f);
+        total += benchNow() - start;
+    }
+    benchSink = sensor.getSensorDistance();
+    report("addSensorPulse", total);
+}
+
+static void benchAddSensorPulseUm()
+{
+    resetMockTime();
+    setMockTime(10000);
+    FilamentMotionSensor sensor;
+    sensor.updateExpectedPositionUm(0);
+
+    unsigned long long total = 0;
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        if ((i & 7) == 0) advanceTime(1);
+        unsigned long long start = benchNow();
+        sensor.addSensorPulseAtUm(2880, millis());
+        total += benchNow() - start;
+    }
+    benchSink = (float) sensor.getWindowSnapshot(millis()).actualUm;
+    report("addSensorPulseAtUm (firmware path)", total);
+}
+
+static void benchUpdateExpectedPosition()
+{
+    resetMockTime();
+    setMockTime(10000);
+    FilamentMotionSensor sensor;
+    sensor.updateExpectedPosition(0.0f);
+
+    float expected = 0.0f;
+    unsigned long long total = 0;
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        advanceTime(5);
+        expected += 0.15f;
+        unsigned long long start = benchNow();
+        sensor.updateExpectedPosition(expected);
+        total += benchNow() - start;
+    }
+    benchSink = sensor.getExpectedDistance();
+    report("updateExpectedPosition", total);
+}
+
+static void benchWindowQuery()
+{
+    resetMockTime();
+    setMockTime(10000);
+    FilamentMotionSensor sensor;
+    sensor.updateExpectedPosition(0.0f);
+
+    float expected = 0.0f;
+    unsigned long long total = 0;
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        advanceTime(1);
+        if ((i % 50) == 0)
+        {
+            expected += 1.5f;
+            sensor.updateExpectedPosition(expected);
+        }
+        if ((i % 100) == 0) sensor.addSensorPulse(2.88f);
+
+        unsigned long long start = benchNow();
+        float e = sensor.getExpectedDistance();
+        float a = sensor.getSensorDistance();
+        float er, ar;
+        sensor.getWindowedRates(er, ar);
+        total += benchNow() - start;
+        benchSink = e + a + er + ar;
+    }
+    report("window query (per loop iteration)", total);
+}
+
+static void benchWindowSnapshot()
+{
+    resetMockTime();
+    setMockTime(10000);
+    FilamentMotionSensor sensor;
+    sensor.updateExpectedPositionUm(0);
+
+    int32_t expected = 0;
+    unsigned long long total = 0;
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        advanceTime(1);
+        if ((i % 50) == 0)
+        {
+            expected += 1500;
+            sensor.updateExpectedPositionUm(expected);
+        }
+        if ((i % 100) == 0) sensor.addSensorPulseUm(2880);
+
+        unsigned long long start = benchNow();
+        WindowSnapshot snap = sensor.getWindowSnapshot(millis());
+        total += benchNow() - start;
+        benchSink = (float) (snap.expectedUm + snap.actualRateUmPerSec);
+    }
+    report("getWindowSnapshot (firmware path)", total);
+}
+
+int main()
+{
+    printf("Flow pipeline host benchmark (%d iterations)\n", ITERATIONS);
+    benchAddSensorPulse();
+    benchAddSensorPulseUm();
+    benchUpdateExpectedPosition();
+    benchWindowQuery();
+    benchWindowSnapshot();
+    return 0;
+}
@@ -0,0 +1,113 @@
+/**
+ * Host Benchmark for SDCP status frame parsing
+ *
+ * Replays the frames in fixtures/sdcp_status_frames.jsonl (one websocket
+ * payload per line) through SDCPStatusParser and reports the average parse
+ * time and heap bytes allocated per frame. Not part of the pass/fail suite;
+ * run manually from test/:
+ *
+ *   g++ -std=c++17 -O2 -o bench_sdcp_parse bench_sdcp_parse.cpp -I../src
+ *   ./bench_sdcp_parse [frames.jsonl]
+ *
+ * Allocations are counted through the global operator new; the parser is
+ * expected to report 0 bytes per frame.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../src/SDCPStatusParser.cpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline unsigned long long benchNow() { return __rdtsc(); }
+static const char* BENCH_UNIT = "cycles";
+#else
+static inline unsigned long long benchNow()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+static const char* BENCH_UNIT = "ns";
+#endif
+
+static const int ITERATIONS = 20000;
+
+static unsigned long long allocatedBytes = 0;
+static unsigned long long allocationCount = 0;
+
+void* operator new(size_t size)
+{
+    allocatedBytes += size;
+    allocationCount++;
+    void* p = malloc(size ? size : 1);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+// Keep results observable so the optimizer cannot drop the calls
+static volatile int benchSink = 0;
+
+int main(int argc, char** argv)
+{
+    const char* path = argc > 1 ? argv[1] : "fixtures/sdcp_status_frames.jsonl";
+    std::ifstream in(path);
+    if (!in)
+    {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return 1;
+    }
+
+    std::vector<std::string> frames;
+    size_t totalBytes = 0;
+    for (std::string line; std::getline(in, line);)
+    {
+        if (line.empty()) continue;
+        totalBytes += line.size();
+        frames.push_back(line);
+    }
+    if (frames.empty())
+    {
+        fprintf(stderr, "No frames in %s\n", path);
+        return 1;
+    }
+
+    printf("SDCP status parse host benchmark (%zu frames, avg %zu bytes, %d passes)\n",
+           frames.size(), totalBytes / frames.size(), ITERATIONS);
+
+    SdcpStatusFrame frame;
+    int failures = 0;
+    unsigned long long total = 0;
+    unsigned long long bytesBefore = allocatedBytes;
+    unsigned long long countBefore = allocationCount;
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        for (const std::string& payload : frames)
+        {
+            unsigned long long start = benchNow();
+            bool ok = SDCPStatusParser::parse(payload.data(), payload.size(), frame);
+            total += benchNow() - start;
+            if (!ok) failures++;
+            benchSink = frame.printStatus + frame.machineStatusCount;
+        }
+    }
+
+    double parsed = (double) ITERATIONS * frames.size();
+    printf("  %-34s %8.1f %s/frame\n", "SDCPStatusParser::parse", total / parsed, BENCH_UNIT);
+    printf("  %-34s %8.1f bytes/frame (%.2f allocations)\n", "heap allocated",
+           (allocatedBytes - bytesBefore) / parsed, (allocationCount - countBefore) / parsed);
+    if (failures > 0)
+    {
+        printf("  %d parse failures\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -198,6 +198,7 @@ declare -a CPP_TESTS=(
     "test_sdcp_protocol:SDCPProtocol Unit Tests"
     "test_additional_edge_cases:Additional Edge Cases"
     "test_filament_motion_sensor:FilamentMotionSensor Unit Tests"
+    "test_pulse_source:PulseSource Unit Tests"
     "test_elegoo_cc:ElegooCC Unit Tests"
     "test_settings_manager:SettingsManager Unit Tests"
     "test_logger:Logger Unit Tests"
@@ -0,0 +1,53 @@
+#ifndef MOCK_PULSE_SOURCE_H
+#define MOCK_PULSE_SOURCE_H
+
+/**
+ * Mock PulseSource for unit tests
+ * Edges are injected directly; optional per-edge timestamps emulate the
+ * GPIO backend, untimed pulses emulate PCNT.
+ */
+
+#include <deque>
+
+#include "../../src/PulseSource.h"
+
+class MockPulseSource : public PulseSource {
+public:
+    bool begin(int pin) override {
+        attachedPin = pin;
+        return true;
+    }
+
+    uint32_t readCount() override { return count; }
+
+    bool popEdgeTimestamp(uint32_t& timestampUs) override {
+        if (edges.empty()) return false;
+        timestampUs = edges.front();
+        edges.pop_front();
+        return true;
+    }
+
+    void discardEdgeTimestamps() override { edges.clear(); }
+
+    bool hasEdgeTimestamps() const override { return timestamped; }
+
+    const char* getName() const override { return "mock"; }
+
+    // Edge with a timestamp (GPIO-style)
+    void injectEdge(uint32_t timestampUs) {
+        count++;
+        edges.push_back(timestampUs);
+    }
+
+    // Edges without timestamps (PCNT-style)
+    void injectUntimedPulses(uint32_t pulses) { count += pulses; }
+
+    int attachedPin = -1;
+    bool timestamped = true;  // false emulates PCNT for hasEdgeTimestamps()
+
+private:
+    uint32_t count = 0;
+    std::deque<uint32_t> edges;
+};
+
+#endif  // MOCK_PULSE_SOURCE_H
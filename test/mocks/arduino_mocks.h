@@ -296,6 +296,26 @@ inline void digitalWrite(int pin, int value) {}
 inline int analogRead(int pin) { return 0; }
 inline void analogWrite(int pin, int value) {}
 
+// Interrupt functions. The last attached handler can be fired from tests
+// with triggerMockInterrupt() to simulate an edge.
+#define RISING  0x01
+#define FALLING 0x02
+#define CHANGE  0x03
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+typedef void (*voidFuncPtr)(void);
+inline voidFuncPtr& _mockInterruptHandler() {
+    static voidFuncPtr handler = nullptr;
+    return handler;
+}
+inline int digitalPinToInterrupt(int pin) { return pin; }
+inline void attachInterrupt(int interrupt, voidFuncPtr isr, int mode) { _mockInterruptHandler() = isr; }
+inline void detachInterrupt(int interrupt) { _mockInterruptHandler() = nullptr; }
+inline void triggerMockInterrupt() {
+    if (_mockInterruptHandler()) _mockInterruptHandler()();
+}
+
 // Random functions
 inline long random(long max) { return rand() % max; }
 inline long random(long min, long max) { return min + (rand() % (max - min)); }
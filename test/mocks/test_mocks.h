@@ -25,10 +25,23 @@ extern int testsFailed;
 // Mock time management
 extern unsigned long _mockMillis;
 
-inline unsigned long millis() { return _mockMillis; }
+// Milliseconds added after every millis() read (0 = frozen clock), for
+// code that must not assume two reads agree
+inline unsigned long& mockMillisStep() {
+    static unsigned long step = 0;
+    return step;
+}
+
+inline unsigned long millis() {
+    unsigned long now = _mockMillis;
+    _mockMillis += mockMillisStep();
+    return now;
+}
+inline unsigned long micros() { return _mockMillis * 1000UL; }
 
 inline void resetMockTime() {
     _mockMillis = 0;
+    mockMillisStep() = 0;
 }
 
 inline void advanceTime(unsigned long ms) {
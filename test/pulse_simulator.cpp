@@ -38,6 +38,8 @@ static float gHardJamPercent = 0.0f;
 static float gSoftJamPercent = 0.0f;
 static unsigned long gHardJamAccumMs = 0;
 static unsigned long gSoftJamAccumMs = 0;
+// Judge hard jams on the short window like the firmware (off = long window only)
+static bool gUseShortHardWindow = true;
 
 void resetJamSimState() {
     gHardJamPercent = 0.0f;
@@ -103,9 +105,9 @@ const int HARD_JAM_TIME_MS = TEST_HARD_JAM_TIME_MS;
 #endif
 const int GRACE_PERIOD_MS = TEST_GRACE_PERIOD_MS;
 
-// Tracking window matches FilamentMotionSensor::WINDOW_SIZE_MS (5000ms with 250ms buckets)
+// Tracking window of the firmware geometry (FMS_WINDOW_MS, 5000ms by default)
 // Used to calculate test iterations needed to fill the sliding window before jam detection
-const int TRACKING_WINDOW_MS = 5000;
+const int TRACKING_WINDOW_MS = (int) FilamentMotionSensor::WINDOW_SIZE_MS;
 
 #ifndef TEST_RESUME_GRACE_MIN_MOVEMENT_MM
 #define TEST_RESUME_GRACE_MIN_MOVEMENT_MM 1.0f
@@ -159,7 +161,8 @@ void logStateRow(const std::string& label, float expected, float actual, float d
                << (jammed ? 1 : 0) << "\n";
 }
 
-void logFrameState(FilamentMotionSensor& sensor, const std::string& label, bool jammed) {
+template <typename Sensor>
+void logFrameState(Sensor& sensor, const std::string& label, bool jammed) {
     if (!gLogEnabled) return;
     float expected = sensor.getExpectedDistance();
     float actual = sensor.getSensorDistance();
@@ -170,9 +173,11 @@ void logFrameState(FilamentMotionSensor& sensor, const std::string& label, bool
     logStateRow(label, expected, actual, deficit, ratio, hardPercent, softPercent, jammed);
 }
 
-bool checkJam(FilamentMotionSensor& sensor);
+template <typename Sensor>
+bool checkJam(Sensor& sensor);
 
-bool checkJamAndLog(FilamentMotionSensor& sensor, const std::string& label) {
+template <typename Sensor>
+bool checkJamAndLog(Sensor& sensor, const std::string& label) {
     bool jammed = checkJam(sensor);
     logFrameState(sensor, label, jammed);
     return jammed;
@@ -540,7 +545,8 @@ void advanceTime(int ms) {
 }
 
 // Helper: Check jam detection (simulator-side implementation)
-bool checkJam(FilamentMotionSensor& sensor) {
+template <typename Sensor>
+bool checkJam(Sensor& sensor) {
     // Grace period: ignore potential jams until after GRACE_PERIOD_MS
     if (_mockMillis < static_cast<unsigned long>(GRACE_PERIOD_MS)) {
         resetJamSimState();
@@ -558,8 +564,17 @@ bool checkJam(FilamentMotionSensor& sensor) {
         ratio = 0.0f;
     }
 
+    // Hard jams use the short window when it holds enough commanded flow
+    float hardRatio = ratio;
+    if (gUseShortHardWindow && sensor.getWindowMode() == WindowMode::TIME) {
+        WindowSnapshot shortWindow = sensor.getShortWindowSnapshot(_mockMillis);
+        if (shortWindow.expectedUm > 200) {
+            hardRatio = (float) shortWindow.actualUm / (float) shortWindow.expectedUm;
+        }
+    }
+
     const float HARD_PASS_RATIO_THRESHOLD = 0.35f;
-    bool hardCondition = (expected >= HARD_JAM_MM) && (ratio < HARD_PASS_RATIO_THRESHOLD);
+    bool hardCondition = (expected >= HARD_JAM_MM) && (hardRatio < HARD_PASS_RATIO_THRESHOLD);
 
     if (hardCondition) {
         gHardJamAccumMs += CHECK_INTERVAL_MS;
@@ -567,7 +582,7 @@ bool checkJam(FilamentMotionSensor& sensor) {
         if (gHardJamAccumMs > static_cast<unsigned long>(HARD_JAM_TIME_MS)) {
             gHardJamAccumMs = HARD_JAM_TIME_MS;
         }
-    } else if (ratio >= HARD_PASS_RATIO_THRESHOLD) {
+    } else if (hardRatio >= HARD_PASS_RATIO_THRESHOLD) {
         gHardJamAccumMs = 0;
     }
 
@@ -604,12 +619,14 @@ bool checkJam(FilamentMotionSensor& sensor) {
 }
 
 // Helper: Simulate extrusion command from SDCP
-void simulateExtrusion(FilamentMotionSensor& sensor, float deltaExtrusionMm, float currentTotalMm) {
+template <typename Sensor>
+void simulateExtrusion(Sensor& sensor, float deltaExtrusionMm, float currentTotalMm) {
     sensor.updateExpectedPosition(currentTotalMm);
 }
 
 // Helper: Simulate sensor pulses (multiple pulses for large movements)
-void simulateSensorPulses(FilamentMotionSensor& sensor, float totalMm, float flowRate = 1.0f) {
+template <typename Sensor>
+void simulateSensorPulses(Sensor& sensor, float totalMm, float flowRate = 1.0f) {
     float actualMm = totalMm * flowRate;
     int pulseCount = static_cast<int>(actualMm / MM_PER_PULSE);
     for (int i = 0; i < pulseCount; i++) {
@@ -640,7 +657,8 @@ void recordTest(const std::string& name, bool passed, const std::string& details
 }
 
 // Helper: Print sensor state (console only, logging handled elsewhere)
-void printState(FilamentMotionSensor& sensor, const std::string& label, bool jammed = false) {
+template <typename Sensor>
+void printState(Sensor& sensor, const std::string& label, bool jammed = false) {
     float expected = sensor.getExpectedDistance();
     float actual = sensor.getSensorDistance();
     float deficit = sensor.getDeficit();
@@ -655,6 +673,43 @@ void printState(FilamentMotionSensor& sensor, const std::string& label, bool jam
               << "\n";
 }
 
+static const WindowMode WINDOW_MODES[] = {WindowMode::TIME, WindowMode::DISTANCE};
+
+const char* windowModeName(WindowMode mode) {
+    return (mode == WindowMode::DISTANCE) ? "distance" : "time";
+}
+
+// Helper: keep commanding extrusion with a silent sensor until the simulator
+// trips. Returns seconds to detect, or -1 if nothing trips within maxSec.
+template <typename Sensor>
+int measureJamDetection(Sensor& sensor, float& totalExtrusion, float mmPerSec, int maxSec,
+                        const std::string& labelPrefix) {
+    for (int sec = 0; sec < maxSec; sec++) {
+        totalExtrusion += mmPerSec;
+        simulateExtrusion(sensor, mmPerSec, totalExtrusion);
+        advanceTime(CHECK_INTERVAL_MS);
+        if (checkJamAndLog(sensor, labelPrefix + " T+" + std::to_string(sec + 1) + "s")) {
+            return sec + 1;
+        }
+    }
+    return -1;
+}
+
+// Helper: print time-to-detect (and filament lost) for each window mode
+void reportTimeToDetect(const std::string& scenario, const int detectSec[2], float mmPerSec) {
+    std::cout << "  time-to-detect (" << scenario << ", " << std::fixed << std::setprecision(1)
+              << mmPerSec << "mm/s):";
+    for (int m = 0; m < 2; m++) {
+        std::cout << "  " << windowModeName(WINDOW_MODES[m]) << "=";
+        if (detectSec[m] < 0) {
+            std::cout << "none";
+        } else {
+            std::cout << detectSec[m] << "s/" << (detectSec[m] * mmPerSec) << "mm";
+        }
+    }
+    std::cout << "\n";
+}
+
 //=============================================================================
 // TEST 1: Normal Healthy Print
 //=============================================================================
@@ -699,54 +754,64 @@ void testNormalPrinting() {
 void testHardJam() {
     printTestHeader("Test 2: Hard Jam Detection (Complete Blockage)");
 
-    FilamentMotionSensor sensor;
-    sensor.reset();
-    _mockMillis = 0;
-    resetJamSimState();
-
-    float totalExtrusion = 0.0f;
-
-    // Normal printing for 5 seconds
-    for (int sec = 0; sec < 5; sec++) {
-        float deltaExtrusion = 20.0f;
-        totalExtrusion += deltaExtrusion;
-        simulateExtrusion(sensor, deltaExtrusion, totalExtrusion);
-        simulateSensorPulses(sensor, deltaExtrusion, 1.0f);
-        advanceTime(CHECK_INTERVAL_MS);
-    }
+    int detectSec[2] = {-1, -1};
+    for (int m = 0; m < 2; m++) {
+        const WindowMode mode = WINDOW_MODES[m];
+        const std::string tag = (mode == WindowMode::TIME) ? "" : "[distance] ";
+        FilamentMotionSensor sensor;
+        sensor.setWindowMode(mode);
+        sensor.reset();
+        _mockMillis = 0;
+        resetJamSimState();
 
-    bool healthyJam = checkJamAndLog(sensor, "Before jam (healthy)");
-    printState(sensor, "Before jam (healthy)", healthyJam);
+        float totalExtrusion = 0.0f;
 
-    // Hard jam: extrusion commands but NO sensor pulses
-    int jamDetectionSec = -1;
-    bool detectedBeforeWindow = false;
-    const int expectedHardDetectionSec = HARD_JAM_TIME_MS / CHECK_INTERVAL_MS;
+        // Normal printing for 5 seconds
+        for (int sec = 0; sec < 5; sec++) {
+            float deltaExtrusion = 20.0f;
+            totalExtrusion += deltaExtrusion;
+            simulateExtrusion(sensor, deltaExtrusion, totalExtrusion);
+            simulateSensorPulses(sensor, deltaExtrusion, 1.0f);
+            advanceTime(CHECK_INTERVAL_MS);
+        }
 
-    for (int sec = 0; sec < expectedHardDetectionSec + 4; sec++) {
-        float deltaExtrusion = 20.0f;
-        totalExtrusion += deltaExtrusion;
-        simulateExtrusion(sensor, deltaExtrusion, totalExtrusion);
-        // NO sensor pulses - complete blockage
-        advanceTime(CHECK_INTERVAL_MS);
+        bool healthyJam = checkJamAndLog(sensor, tag + "Before jam (healthy)");
+        printState(sensor, tag + "Before jam (healthy)", healthyJam);
+
+        // Hard jam: extrusion commands but NO sensor pulses
+        int jamDetectionSec = -1;
+        bool detectedBeforeWindow = false;
+        const int expectedHardDetectionSec = HARD_JAM_TIME_MS / CHECK_INTERVAL_MS;
+
+        for (int sec = 0; sec < expectedHardDetectionSec + 4; sec++) {
+            float deltaExtrusion = 20.0f;
+            totalExtrusion += deltaExtrusion;
+            simulateExtrusion(sensor, deltaExtrusion, totalExtrusion);
+            // NO sensor pulses - complete blockage
+            advanceTime(CHECK_INTERVAL_MS);
+
+            std::string label = tag + "Hard jam T+" + std::to_string(sec + 1) + "s";
+            bool jammed = checkJamAndLog(sensor, label);
+            if (jammed && jamDetectionSec == -1) {
+                jamDetectionSec = sec + 1;
+            }
+            if (jammed && sec + 1 < expectedHardDetectionSec) {
+                detectedBeforeWindow = true;
+            }
 
-        std::string label = "Hard jam T+" + std::to_string(sec + 1) + "s";
-        bool jammed = checkJamAndLog(sensor, label);
-        if (jammed && jamDetectionSec == -1) {
-            jamDetectionSec = sec + 1;
-        }
-        if (jammed && sec + 1 < expectedHardDetectionSec) {
-            detectedBeforeWindow = true;
+            printState(sensor, label, jammed);
         }
 
-        printState(sensor, label, jammed);
+        bool detectedInWindow = jamDetectionSec >= expectedHardDetectionSec &&
+                                 jamDetectionSec <= expectedHardDetectionSec + 4;
+        std::string modeSuffix = (mode == WindowMode::TIME) ? "" : " (distance window)";
+        recordTest("Hard jam detected within configured window" + modeSuffix, jamDetectionSec >= 0 && detectedInWindow,
+                   jamDetectionSec >= 0 ? "Detected at T+" + std::to_string(jamDetectionSec) + "s" : "Not detected");
+        recordTest("Hard jam not detected before window time" + modeSuffix, !detectedBeforeWindow);
+        detectSec[m] = jamDetectionSec;
     }
 
-    bool detectedInWindow = jamDetectionSec >= expectedHardDetectionSec &&
-                             jamDetectionSec <= expectedHardDetectionSec + 4;
-    recordTest("Hard jam detected within configured window", jamDetectionSec >= 0 && detectedInWindow,
-               jamDetectionSec >= 0 ? "Detected at T+" + std::to_string(jamDetectionSec) + "s" : "Not detected");
-    recordTest("Hard jam not detected before window time", !detectedBeforeWindow);
+    reportTimeToDetect("hard jam", detectSec, 20.0f);
 }
 
 //=============================================================================
@@ -822,63 +887,76 @@ void testSoftJam() {
 void testSparseInfill() {
     printTestHeader("Test 4: Sparse Infill (Travel Moves)");
 
-    FilamentMotionSensor sensor;
-    sensor.reset();
-    _mockMillis = 0;
-    resetJamSimState();
+    int detectSec[2] = {-1, -1};
+    for (int m = 0; m < 2; m++) {
+        const WindowMode mode = WINDOW_MODES[m];
+        const std::string tag = (mode == WindowMode::TIME) ? "" : "[distance] ";
+        FilamentMotionSensor sensor;
+        sensor.setWindowMode(mode);
+        sensor.reset();
+        _mockMillis = 0;
+        resetJamSimState();
 
-    float totalExtrusion = 0.0f;
-    bool falsePositive = false;
+        float totalExtrusion = 0.0f;
+        bool falsePositive = false;
 
-    // Normal printing
-    for (int sec = 0; sec < 3; sec++) {
-        float deltaExtrusion = 20.0f;
-        totalExtrusion += deltaExtrusion;
-        simulateExtrusion(sensor, deltaExtrusion, totalExtrusion);
-        simulateSensorPulses(sensor, deltaExtrusion, 1.0f);
-        advanceTime(CHECK_INTERVAL_MS);
-    }
+        // Normal printing
+        for (int sec = 0; sec < 3; sec++) {
+            float deltaExtrusion = 20.0f;
+            totalExtrusion += deltaExtrusion;
+            simulateExtrusion(sensor, deltaExtrusion, totalExtrusion);
+            simulateSensorPulses(sensor, deltaExtrusion, 1.0f);
+            advanceTime(CHECK_INTERVAL_MS);
+        }
 
-    bool beforeSparse = checkJamAndLog(sensor, "Before sparse infill");
-    printState(sensor, "Before sparse infill", beforeSparse);
+        bool beforeSparse = checkJamAndLog(sensor, tag + "Before sparse infill");
+        printState(sensor, tag + "Before sparse infill", beforeSparse);
 
-    // Sparse infill: 10 seconds of travel with minimal extrusion
-    for (int sec = 0; sec < 10; sec++) {
-        // No telemetry updates during travel
-        advanceTime(CHECK_INTERVAL_MS);
+        // Sparse infill: 10 seconds of travel with minimal extrusion
+        for (int sec = 0; sec < 10; sec++) {
+            // No telemetry updates during travel
+            advanceTime(CHECK_INTERVAL_MS);
 
-        std::string label = "Travel T+" + std::to_string(sec + 1) + "s";
-        bool jammed = checkJamAndLog(sensor, label);
-        if (jammed) {
-            falsePositive = true;
-            printState(sensor, label, jammed);
+            std::string label = tag + "Travel T+" + std::to_string(sec + 1) + "s";
+            bool jammed = checkJamAndLog(sensor, label);
+            if (jammed) {
+                falsePositive = true;
+                printState(sensor, label, jammed);
+            }
         }
-    }
 
-    // Resume normal printing after telemetry gap
-    for (int sec = 0; sec < 3; sec++) {
-        float deltaExtrusion = 20.0f;
-        totalExtrusion += deltaExtrusion;
-        simulateExtrusion(sensor, deltaExtrusion, totalExtrusion);
+        // Resume normal printing after telemetry gap
+        for (int sec = 0; sec < 3; sec++) {
+            float deltaExtrusion = 20.0f;
+            totalExtrusion += deltaExtrusion;
+            simulateExtrusion(sensor, deltaExtrusion, totalExtrusion);
 
-        // Grace period: wait 500ms for sensor to catch up
-        if (sec == 0) advanceTime(500);
+            // Grace period: wait 500ms for sensor to catch up
+            if (sec == 0) advanceTime(500);
 
-        simulateSensorPulses(sensor, deltaExtrusion, 1.0f);
-        advanceTime(CHECK_INTERVAL_MS - (sec == 0 ? 500 : 0));
+            simulateSensorPulses(sensor, deltaExtrusion, 1.0f);
+            advanceTime(CHECK_INTERVAL_MS - (sec == 0 ? 500 : 0));
 
-        std::string label = "After gap T+" + std::to_string(sec + 1) + "s";
-        bool jammed = checkJamAndLog(sensor, label);
-        if (jammed) {
-            falsePositive = true;
-            printState(sensor, label, jammed);
+            std::string label = tag + "After gap T+" + std::to_string(sec + 1) + "s";
+            bool jammed = checkJamAndLog(sensor, label);
+            if (jammed) {
+                falsePositive = true;
+                printState(sensor, label, jammed);
+            }
         }
-    }
 
-    bool afterResumeJam = checkJamAndLog(sensor, "After resume");
-    printState(sensor, "After resume", afterResumeJam);
+        bool afterResumeJam = checkJamAndLog(sensor, tag + "After resume");
+        printState(sensor, tag + "After resume", afterResumeJam);
+
+        std::string modeSuffix = (mode == WindowMode::TIME) ? "" : " (distance window)";
+        recordTest("No false positives during sparse infill" + modeSuffix, !falsePositive);
 
-    recordTest("No false positives during sparse infill", !falsePositive);
+        // Sparse infill lines that then stop feeding
+        detectSec[m] = measureJamDetection(sensor, totalExtrusion, 8.0f, 60, tag + "Infill jam");
+        recordTest("Jam after sparse infill detected" + modeSuffix, detectSec[m] > 0);
+    }
+
+    reportTimeToDetect("sparse infill jam", detectSec, 8.0f);
 }
 
 //=============================================================================
@@ -937,6 +1015,72 @@ void testRetractions() {
     }
 
     recordTest("No false positives after retraction", !falsePositive);
+
+    // Retraction-heavy printing (short travels between small islands): half
+    // the telemetry frames land mid-retraction. The un-retract re-advances
+    // TotalExtrusion without new filament at the sensor, so it must not
+    // count as expected flow or the ratio sags by the retract share.
+    const float mmPerSec = 6.0f;
+    const float retractMm = 1.5f;
+    for (int m = 0; m < 2; m++) {
+        const WindowMode mode = WINDOW_MODES[m];
+        const std::string tag = (mode == WindowMode::TIME) ? "" : "[distance] ";
+        float ratioMean[2] = {0.0f, 0.0f};
+        float ratioMin[2] = {0.0f, 0.0f};
+        bool heavyJam = false;
+        for (int run = 0; run < 2; run++) {
+            const float retract = (run == 0) ? 0.0f : retractMm;
+            FilamentMotionSensor heavy;
+            heavy.setWindowMode(mode);
+            heavy.reset();
+            _mockMillis = 0;
+            resetJamSimState();
+
+            float total = 0.0f;
+            float pendingSensorMm = 0.0f;
+            float ratioSum = 0.0f;
+            int ratioCount = 0;
+            ratioMin[run] = 10.0f;
+            for (int sec = 0; sec < 40; sec++) {
+                // Un-retract, then new extrusion; the sensor sees only the latter
+                total += (sec > 0 ? retract : 0.0f) + mmPerSec;
+                simulateExtrusion(heavy, mmPerSec, total);
+                pendingSensorMm += mmPerSec;
+                while (pendingSensorMm >= MM_PER_PULSE) {
+                    heavy.addSensorPulse(MM_PER_PULSE);
+                    pendingSensorMm -= MM_PER_PULSE;
+                }
+
+                // Judged as each chunk lands: its pulses are simulated in one
+                // batch with it, so later in the second the extrapolated next
+                // chunk would have no pulses to match
+                bool jammed = checkJamAndLog(heavy, tag + "Retract-heavy T+" + std::to_string(sec + 1) + "s");
+                if (jammed && run == 1) heavyJam = true;
+                if (sec >= 10) {
+                    float ratio = heavy.getFlowRatio();
+                    ratioSum += ratio;
+                    ratioCount++;
+                    if (ratio < ratioMin[run]) ratioMin[run] = ratio;
+                }
+                advanceTime(CHECK_INTERVAL_MS / 2);
+
+                // Retract before the travel move; a frame reports it
+                total -= retract;
+                simulateExtrusion(heavy, -retract, total);
+                advanceTime(CHECK_INTERVAL_MS / 2);
+            }
+            ratioMean[run] = ratioSum / ratioCount;
+            printState(heavy, tag + (run == 0 ? "No retractions" : "Retract-heavy"), false);
+        }
+
+        std::cout << "  " << tag << "mean ratio without retractions=" << std::fixed << std::setprecision(3)
+                  << ratioMean[0] << " with " << retractMm << "mm retractions=" << ratioMean[1]
+                  << " (min " << ratioMin[1] << ")\n";
+        std::string modeSuffix = (mode == WindowMode::TIME) ? "" : " (distance window)";
+        recordTest("No false positives during retraction-heavy printing" + modeSuffix, !heavyJam);
+        recordTest("Ratio flat through retract/unretract cycles" + modeSuffix,
+                   std::fabs(ratioMean[1] - ratioMean[0]) < 0.03f && ratioMin[1] > 0.85f);
+    }
 }
 
 //=============================================================================
@@ -945,36 +1089,49 @@ void testRetractions() {
 void testIroningLowFlow() {
     printTestHeader("Test 6: Ironing / Low-Flow Handling");
 
-    FilamentMotionSensor sensor;
-    sensor.reset();
-    _mockMillis = 0;
-    resetJamSimState();
+    int detectSec[2] = {-1, -1};
+    for (int m = 0; m < 2; m++) {
+        const WindowMode mode = WINDOW_MODES[m];
+        const std::string tag = (mode == WindowMode::TIME) ? "" : "[distance] ";
+        FilamentMotionSensor sensor;
+        sensor.setWindowMode(mode);
+        sensor.reset();
+        _mockMillis = 0;
+        resetJamSimState();
 
-    float totalExtrusion = 0.0f;
-    bool falsePositive = false;
+        float totalExtrusion = 0.0f;
+        bool falsePositive = false;
+
+      // Simulate repeated low-flow micro-movements (iron-like passes)
+      for (int sec = 0; sec < 20; sec++) {
+          float deltaExtrusion = 0.2f;
+          totalExtrusion += deltaExtrusion;
+          simulateExtrusion(sensor, deltaExtrusion, totalExtrusion);
 
-  // Simulate repeated low-flow micro-movements (iron-like passes)
-  for (int sec = 0; sec < 20; sec++) {
-      float deltaExtrusion = 0.2f;
-      totalExtrusion += deltaExtrusion;
-      simulateExtrusion(sensor, deltaExtrusion, totalExtrusion);
+          // Sensor reports matching micro-movement
+          sensor.addSensorPulse(deltaExtrusion);
 
-      // Sensor reports matching micro-movement
-      sensor.addSensorPulse(deltaExtrusion);
+          advanceTime(CHECK_INTERVAL_MS);
+
+          std::string label = tag + "Ironing T+" + std::to_string(sec + 1) + "s";
+          bool jammed = checkJamAndLog(sensor, label);
+          if (jammed) {
+              falsePositive = true;
+          }
+          printState(sensor, label, jammed);
+        }
 
-      advanceTime(CHECK_INTERVAL_MS);
+        bool afterIroningJam = checkJamAndLog(sensor, tag + "After ironing pattern");
+        printState(sensor, tag + "After ironing pattern", afterIroningJam);
+        std::string modeSuffix = (mode == WindowMode::TIME) ? "" : " (distance window)";
+        recordTest("Ironing/low-flow pattern does not trigger jam" + modeSuffix, !falsePositive);
 
-      std::string label = "Ironing T+" + std::to_string(sec + 1) + "s";
-      bool jammed = checkJamAndLog(sensor, label);
-      if (jammed) {
-          falsePositive = true;
-      }
-      printState(sensor, label, jammed);
+        // Ironing pass that stops feeding; reported only, slow flow is the case
+        // the time window handles worst
+        detectSec[m] = measureJamDetection(sensor, totalExtrusion, 0.2f, 120, tag + "Ironing jam");
     }
 
-    bool afterIroningJam = checkJamAndLog(sensor, "After ironing pattern");
-    printState(sensor, "After ironing pattern", afterIroningJam);
-    recordTest("Ironing/low-flow pattern does not trigger jam", !falsePositive);
+    reportTimeToDetect("ironing jam", detectSec, 0.2f);
 }
 
 //=============================================================================
@@ -1353,8 +1510,11 @@ void testRealLogReplay() {
 //=============================================================================
 // TEST 15: Hard Jam Timing Verification
 //=============================================================================
-void testHardJamTiming() {
-    printTestHeader("Test 15: Hard Jam Timing Verification");
+// Runs warmup then a 0% flow jam and verifies accumulator behaviour.
+// Returns seconds from jam onset to trip, or -1 if it never trips.
+int runHardJamTiming(bool useShortWindow) {
+    const std::string suffix = useShortWindow ? "" : " (long window only)";
+    gUseShortHardWindow = useShortWindow;
 
     FilamentMotionSensor sensor;
     sensor.reset();
@@ -1377,9 +1537,8 @@ void testHardJamTiming() {
     // Monitor accumulator. It should only start increasing once the window average drops.
     // Once it starts increasing, it should take exactly HARD_JAM_TIME_MS to trigger.
     
-    bool jamDetected = false;
+    int tripSec = -1;
     unsigned long lastAccum = 0;
-    int accumSteps = 0;
     
     // Run for enough time to clear window + jam time + margin
     int maxSteps = (TRACKING_WINDOW_MS / CHECK_INTERVAL_MS) + (HARD_JAM_TIME_MS / CHECK_INTERVAL_MS) + 5;
@@ -1396,28 +1555,26 @@ void testHardJamTiming() {
         if (gHardJamAccumMs > 0) {
             if (lastAccum == 0) {
                 // Just started accumulating
-                std::cout << "  Hard Jam accumulation started at step " << i+1 << "\n";
+                std::cout << "  Hard Jam accumulation started at step " << i+1 << suffix << "\n";
             }
             
             // Verify accumulator increases monotonically
             if (gHardJamAccumMs < lastAccum) {
-                recordTest("Hard jam accumulator reset unexpectedly", false);
+                recordTest("Hard jam accumulator reset unexpectedly" + suffix, false);
             }
             
             // Check for early trigger
             if (jammed && gHardJamAccumMs < static_cast<unsigned long>(HARD_JAM_TIME_MS)) {
-                 recordTest("Hard jam triggered before accumulator full", false, 
+                 recordTest("Hard jam triggered before accumulator full" + suffix, false, 
                             "Accum=" + std::to_string(gHardJamAccumMs));
             }
-            
-            accumSteps++;
         }
         
         if (jammed) {
-            jamDetected = true;
+            tripSec = i + 1;
             // Verify we are at or above the limit
             bool limitReached = gHardJamAccumMs >= static_cast<unsigned long>(HARD_JAM_TIME_MS);
-            recordTest("Hard jam detected at limit", limitReached, 
+            recordTest("Hard jam detected at limit" + suffix, limitReached, 
                        "Accum=" + std::to_string(gHardJamAccumMs) + " Limit=" + std::to_string(HARD_JAM_TIME_MS));
             break;
         }
@@ -1425,9 +1582,26 @@ void testHardJamTiming() {
         lastAccum = gHardJamAccumMs;
     }
     
-    if (!jamDetected) {
-        recordTest("Hard jam never detected", false);
+    if (tripSec < 0) {
+        recordTest("Hard jam never detected" + suffix, false);
     }
+    gUseShortHardWindow = true;
+    return tripSec;
+}
+
+void testHardJamTiming() {
+    printTestHeader("Test 15: Hard Jam Timing Verification");
+
+    // Benchmark: onset->trip latency with the short hard-jam window against
+    // the long window alone
+    int longOnlySec = runHardJamTiming(false);
+    int shortSec    = runHardJamTiming(true);
+
+    std::cout << "  onset->trip latency: long window " << longOnlySec << "s, short window "
+              << shortSec << "s (hard jam time " << HARD_JAM_TIME_MS / 1000 << "s)\n";
+    recordTest("Short window lowers hard jam onset->trip latency",
+               shortSec > 0 && longOnlySec > 0 && shortSec < longOnlySec,
+               "short=" + std::to_string(shortSec) + "s long=" + std::to_string(longOnlySec) + "s");
 }
 
 //=============================================================================
@@ -1493,6 +1667,83 @@ void testSoftJamTiming() {
     }
 }
 
+//=============================================================================
+// TEST 18: Window Geometry Matrix (detection latency vs RAM)
+//=============================================================================
+struct GeometryRow {
+    std::string name;
+    size_t ramBytes;
+    bool falsePositive;
+    int hardDetectSec;  // -1 if not detected
+    int softDetectSec;
+};
+
+// Runs healthy, hard jam and soft jam (35% flow) against one geometry.
+// Jam timings are measured from the first bad second.
+template <typename Sensor>
+GeometryRow runGeometryScenarios(const std::string& name) {
+    GeometryRow row = {name, sizeof(Sensor), false, -1, -1};
+    const int warmupSec = 15;
+    const int maxJamSec = (TRACKING_WINDOW_MS * 2 + SOFT_JAM_TIME_MS) / CHECK_INTERVAL_MS + 5;
+
+    for (int scenario = 0; scenario < 3; scenario++) {
+        Sensor sensor;
+        _mockMillis = 0;
+        sensor.reset();
+        resetJamSimState();
+
+        float totalExtrusion = 0.0f;
+        for (int sec = 0; sec < warmupSec; sec++) {
+            totalExtrusion += 20.0f;
+            simulateExtrusion(sensor, 20.0f, totalExtrusion);
+            simulateSensorPulses(sensor, 20.0f, 1.0f);
+            advanceTime(CHECK_INTERVAL_MS);
+            if (checkJam(sensor)) row.falsePositive = true;
+        }
+
+        const float flow = (scenario == 0) ? 1.0f : (scenario == 1) ? 0.0f : 0.35f;
+        for (int sec = 0; sec < maxJamSec; sec++) {
+            totalExtrusion += 20.0f;
+            simulateExtrusion(sensor, 20.0f, totalExtrusion);
+            simulateSensorPulses(sensor, 20.0f, flow);
+            advanceTime(CHECK_INTERVAL_MS);
+            bool jammed = checkJam(sensor);
+            if (scenario == 0 && jammed) {
+                row.falsePositive = true;
+            }
+            if (jammed && scenario != 0) {
+                (scenario == 1 ? row.hardDetectSec : row.softDetectSec) = sec + 1;
+                break;
+            }
+        }
+    }
+    return row;
+}
+
+void testWindowGeometryMatrix() {
+    printTestHeader("Test 18: Window Geometry Matrix");
+
+    std::vector<GeometryRow> rows;
+    rows.push_back(runGeometryScenarios<FilamentMotionSensorT<250, 5000>>("250/5000"));
+    rows.push_back(runGeometryScenarios<FilamentMotionSensorT<256, 5120>>("256/5120"));
+    rows.push_back(runGeometryScenarios<FilamentMotionSensorT<256, 4096>>("256/4096"));
+    rows.push_back(runGeometryScenarios<FilamentMotionSensorT<128, 2048>>("128/2048"));
+    rows.push_back(runGeometryScenarios<FilamentMotionSensorT<500, 8000>>("500/8000"));
+
+    std::cout << "  bucket/window  ram    hard_jam  soft_jam  healthy\n";
+    for (const auto& row : rows) {
+        std::cout << "  " << std::left << std::setw(13) << row.name
+                  << std::setw(7) << (std::to_string(row.ramBytes) + "B")
+                  << std::setw(10) << (row.hardDetectSec >= 0 ? std::to_string(row.hardDetectSec) + "s" : "-")
+                  << std::setw(10) << (row.softDetectSec >= 0 ? std::to_string(row.softDetectSec) + "s" : "-")
+                  << (row.falsePositive ? "FALSE POSITIVE" : "ok") << "\n";
+    }
+    for (const auto& row : rows) {
+        recordTest("Geometry " + row.name + " detects hard and soft jams without false positives",
+                   !row.falsePositive && row.hardDetectSec > 0 && row.softDetectSec > 0);
+    }
+}
+
 //=============================================================================
 // TEST 13, 14 & 17: Replay logs from fixtures/logs_to_replay
 //=============================================================================
@@ -1561,6 +1812,7 @@ int main(int argc, char** argv) {
     testReplayLogFixtures();
     testHardJamTiming();
     testSoftJamTiming();
+    testWindowGeometryMatrix();
 
     // Summary
     int passed = 0;
@@ -341,13 +341,16 @@ void testIntegrationJamRecoveryWithResume() {
     assert(state.graceState == GraceState::RESUME_GRACE);
     assert(!state.jammed);  // Jam should clear
     
-    // Normal printing resumes
-    advanceTime(1000);
-    state = detector.update(
-        10.0f, 9.5f, 210,
-        true, true, _mockMillis, printStartTime,
-        config, 10.0f, 9.5f
-    );
+    // Normal printing resumes; a couple of seconds of healthy flow at 4Hz
+    // ends resume grace well before its 5s cap
+    for (int i = 1; i <= 8; i++) {
+        advanceTime(250);
+        state = detector.update(
+            10.0f, 9.5f, 200 + i,
+            true, true, _mockMillis, printStartTime,
+            config, 10.0f, 9.5f
+        );
+    }
     
     assert(state.graceState == GraceState::ACTIVE);
     assert(!state.jammed);
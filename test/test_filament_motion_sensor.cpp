@@ -26,6 +26,9 @@ int testsFailed = 0;
 // Include the actual implementation
 #include "../src/FilamentMotionSensor.h"
 #include "../src/FilamentMotionSensor.cpp"
+#include "../src/PulseEdgeRing.h"
+#include "../src/PulseCalibrator.h"
+#include "../src/PulseCalibrator.cpp"
 
 // Test: reset() clears all samples and state
 void testReset() {
@@ -262,6 +265,40 @@ void testRetractionClearsWindow() {
     TEST_PASS("Retraction (negative movement) clears window");
 }
 
+// Test: Un-retracted filament is not expected a second time
+void testRetractionDebt() {
+    TEST_SECTION("Retraction Debt");
+
+    resetMockTime();
+    FilamentMotionSensor sensor;
+    sensor.updateExpectedPosition(0.0f);
+
+    advanceTime(250);
+    sensor.updateExpectedPosition(10.0f);
+    TEST_ASSERT(floatEquals(sensor.getExpectedDistance(), 10.0f, 0.01f), "Forward move counts in full");
+
+    // Retract 2mm, then un-retract and extrude 3mm new
+    advanceTime(250);
+    sensor.updateExpectedPosition(8.0f);
+    TEST_ASSERT(sensor.getRetractDebtUm() == 2000, "Retraction becomes debt");
+    TEST_ASSERT(floatEquals(sensor.getExpectedDistance(), 10.0f, 0.01f), "Retraction leaves expected alone");
+
+    advanceTime(250);
+    sensor.updateExpectedPosition(13.0f);
+    TEST_ASSERT(sensor.getRetractDebtUm() == 0, "Un-retract pays the debt off");
+    TEST_ASSERT(floatEquals(sensor.getExpectedDistance(), 13.0f, 0.01f), "Only new filament is expected");
+
+    // An unload is far more than one retraction; the debt is capped
+    advanceTime(250);
+    sensor.updateExpectedPosition(-87.0f);
+    TEST_ASSERT(sensor.getRetractDebtUm() == FilamentMotionSensor::MAX_RETRACT_DEBT_UM, "Debt is capped");
+
+    sensor.reset();
+    TEST_ASSERT(sensor.getRetractDebtUm() == 0, "Reset clears the debt");
+
+    TEST_PASS("Retraction debt holds back the un-retract");
+}
+
 // Test: getFlowRatio() handles zero expected (no divide by zero)
 void testFlowRatioZeroDivision() {
     TEST_SECTION("Flow Ratio Zero Division Safety");
@@ -444,6 +481,844 @@ void testFlowRatioClamping() {
     TEST_PASS("Flow ratio clamping");
 }
 
+// Test: addSensorPulseAt() attributes pulses to the bucket of their edge time
+void testTimestampedPulseIngestion() {
+    TEST_SECTION("Timestamped Pulse Ingestion");
+
+    resetMockTime();
+    setMockTime(10000);
+    FilamentMotionSensor sensor;
+    sensor.updateExpectedPosition(0.0f);
+
+    // Pulses that happened 150ms ago are read after a loop stall
+    advanceTime(1000);
+    sensor.addSensorPulseAt(2.88f, 10850);
+    sensor.addSensorPulseAt(2.88f, 10900);
+    TEST_ASSERT(floatEquals(sensor.getSensorDistance(), 5.76f), "Stalled pulses should be in the window");
+
+    // Edges older than the window count toward the total but not the window
+    sensor.addSensorPulseAt(2.88f, 4000);
+    TEST_ASSERT(floatEquals(sensor.getSensorDistance(), 5.76f), "Edges older than window should be ignored");
+
+    // Future timestamps are clamped to now
+    sensor.addSensorPulseAt(2.88f, 20000);
+    TEST_ASSERT(floatEquals(sensor.getSensorDistance(), 8.64f), "Future edge should be clamped to now");
+
+    // Bucket of a late edge matches the bucket it occurred in: once that
+    // bucket ages out, the pulse leaves the window with it
+    advanceTime(4900);  // now = 15900, cutoff = 10900
+    float remaining = sensor.getSensorDistance();
+    TEST_ASSERT(floatEquals(remaining, 2.88f), "Edge-time bucket should age out on schedule");
+
+    TEST_PASS("addSensorPulseAt() ingests pulses at their true edge time");
+}
+
+// Test: a stalled loop no longer smears pulses into the read-time bucket
+void testLoopStallDoesNotSmearPulses() {
+    TEST_SECTION("Loop Stall Pulse Attribution");
+
+    resetMockTime();
+    setMockTime(20000);
+    FilamentMotionSensor stamped;
+    FilamentMotionSensor legacy;
+    stamped.updateExpectedPosition(0.0f);
+    legacy.updateExpectedPosition(0.0f);
+
+    // 4 pulses arrive at 20100..20400, but the loop only drains them at 25050
+    setMockTime(25050);
+    for (int i = 1; i <= 4; i++) {
+        stamped.addSensorPulseAt(2.88f, 20000 + i * 100);
+        legacy.addSensorPulse(2.88f);
+    }
+
+    // By 25300 the true edges have left the 5s window; legacy still holds them
+    setMockTime(25500);
+    TEST_ASSERT(stamped.getSensorDistance() < legacy.getSensorDistance(),
+                "Timestamped ingestion should age out stalled pulses on time");
+    TEST_ASSERT(floatEquals(stamped.getSensorDistance(), 0.0f), "All stalled edges should be outside window");
+
+    TEST_PASS("Loop stall does not smear pulses");
+}
+
+// Test: PulseEdgeRing SPSC behaviour and overflow counting
+void testPulseEdgeRing() {
+    TEST_SECTION("PulseEdgeRing SPSC Queue");
+
+    PulseEdgeRing<8> ring;
+    uint32_t ts = 0;
+
+    TEST_ASSERT(!ring.pop(ts), "Empty ring should not pop");
+    TEST_ASSERT(ring.size() == 0, "Empty ring size should be 0");
+
+    for (uint32_t i = 0; i < 8; i++) {
+        TEST_ASSERT(ring.push(1000 + i), "Push within capacity should succeed");
+    }
+    TEST_ASSERT(!ring.push(9999), "Push into full ring should fail");
+    TEST_ASSERT(ring.overflowCount() == 1, "Overflow should be counted");
+    TEST_ASSERT(ring.size() == 8, "Full ring size should equal capacity");
+
+    bool inOrder = true;
+    for (uint32_t i = 0; i < 8; i++) {
+        inOrder &= ring.pop(ts) && ts == 1000 + i;
+    }
+    TEST_ASSERT(inOrder, "Edges should pop in FIFO order");
+    TEST_ASSERT(!ring.pop(ts), "Drained ring should be empty");
+
+    // Wrap the indices many times
+    bool wrapOk = true;
+    for (uint32_t i = 0; i < 1000; i++) {
+        ring.push(i);
+        ring.push(i + 1);
+        wrapOk &= ring.pop(ts) && ts == i;
+        wrapOk &= ring.pop(ts) && ts == i + 1;
+    }
+    TEST_ASSERT(wrapOk, "Ring should survive index wraparound");
+
+    ring.push(1);
+    ring.push(2);
+    ring.clear();
+    TEST_ASSERT(ring.size() == 0 && !ring.pop(ts), "clear() should discard queued edges");
+    TEST_ASSERT(ring.overflowCount() == 1, "clear() should not reset overflow count");
+
+    TEST_PASS("PulseEdgeRing FIFO, wraparound and overflow accounting");
+}
+
+// Test: WindowSnapshot returns all figures for one instant
+void testWindowSnapshotConsistency() {
+    TEST_SECTION("WindowSnapshot Consistency");
+
+    resetMockTime();
+    setMockTime(10000);
+    FilamentMotionSensor sensor;
+
+    WindowSnapshot empty = sensor.getWindowSnapshot(millis());
+    TEST_ASSERT(empty.expectedUm == 0 && empty.validDurationMs == 0, "Uninitialized snapshot should be empty");
+
+    sensor.updateExpectedPosition(0.0f);
+    for (int i = 1; i <= 8; i++) {
+        advanceTime(250);
+        sensor.updateExpectedPosition(i * 2.0f);
+        if (i % 2 == 0) sensor.addSensorPulse(2.88f);
+    }
+
+    WindowSnapshot snap = sensor.getWindowSnapshot(millis());
+    TEST_ASSERT(floatEquals(FlowUnits::umToMm(snap.expectedUm), sensor.getExpectedDistance()), "Snapshot expected should match getter");
+    TEST_ASSERT(floatEquals(FlowUnits::umToMm(snap.actualUm), sensor.getSensorDistance()), "Snapshot actual should match getter");
+    TEST_ASSERT(snap.deficitUm == snap.expectedUm - snap.actualUm, "Deficit should be expected - actual");
+    TEST_ASSERT(snap.validDurationMs == 8 * 250, "Valid duration should cover the 8 written buckets");
+
+    float expRate, actRate;
+    sensor.getWindowedRates(expRate, actRate);
+    TEST_ASSERT(floatEquals(FlowUnits::umToMm(snap.expectedRateUmPerSec), expRate), "Snapshot expected rate should match getter");
+    TEST_ASSERT(floatEquals(FlowUnits::umToMm(snap.actualRateUmPerSec), actRate), "Snapshot actual rate should match getter");
+    TEST_ASSERT(snap.expectedRateUmPerSec == snap.expectedUm / 2, "Rate should use valid duration");
+
+    // Caller-supplied time ages buckets out without touching millis()
+    WindowSnapshot later = sensor.getWindowSnapshot(millis() + 6000);
+    TEST_ASSERT(later.expectedUm == 0 && later.actualUm == 0,
+                "Snapshot at a later time should see an empty window");
+
+    TEST_PASS("WindowSnapshot is consistent with the individual getters");
+}
+
+// Brute-force check of the incremental window over a long random run with
+// loop stalls. Reference is recomputed from raw pulse times every step.
+template <typename Sensor>
+bool runningTotalsMatchReference() {
+    const unsigned long B = Sensor::BUCKET_SIZE_MS;
+    const unsigned long W = Sensor::WINDOW_SIZE_MS;
+
+    resetMockTime();
+    setMockTime(7000);
+    Sensor sensor;
+    sensor.updateExpectedPosition(0.0f);
+
+    const int MAX_PULSES = 4000;
+    static unsigned long pulseTimes[MAX_PULSES];
+    int pulseCount = 0;
+    float totalExpected = 0.0f;
+    bool allMatch = true;
+    unsigned int seed = 12345;
+
+    for (int step = 0; step < 3000 && pulseCount < MAX_PULSES; step++) {
+        seed = seed * 1103515245u + 12345u;
+        unsigned long dt = 1 + (seed >> 16) % 180;
+        // Occasional loop stall
+        if ((seed >> 8) % 97 == 0) dt += 1500 + (seed >> 20) % 4000;
+        advanceTime(dt);
+
+        if ((seed >> 4) % 3 == 0) {
+            totalExpected += 1.5f;
+            sensor.updateExpectedPosition(totalExpected);
+        }
+        if ((seed >> 12) % 2 == 0) {
+            sensor.addSensorPulse(1.0f);
+            pulseTimes[pulseCount++] = millis();
+        }
+
+        unsigned long now = millis();
+        unsigned long cutoff = (now < W) ? 0 : now - W + 1;  // Window is (now - W, now]
+        float reference = 0.0f;
+        for (int i = 0; i < pulseCount; i++) {
+            unsigned long bucketStart = (pulseTimes[i] / B) * B;
+            if (bucketStart >= cutoff) reference += 1.0f;
+        }
+        if (!floatEquals(FlowUnits::umToMm(sensor.getWindowSnapshot(now).actualUm), reference, 0.01f)) {
+            allMatch = false;
+        }
+    }
+    return allMatch;
+}
+
+// Test: running totals match a brute-force reference over a long random run
+void testRunningTotalsMatchReference() {
+    TEST_SECTION("Running Totals Match Reference");
+
+    TEST_ASSERT(runningTotalsMatchReference<FilamentMotionSensor>(),
+                "Incremental window should match brute-force sum at every step");
+    TEST_PASS("Running totals match brute-force reference");
+}
+
+// Test: integer accounting stays exact deep into a long print
+void testLongPrintPrecision() {
+    TEST_SECTION("Long Print Precision");
+
+    resetMockTime();
+    setMockTime(10000);
+    FilamentMotionSensor sensor;
+
+    // Start 150m into the print; a float mm total only resolves ~8um here
+    int32_t totalUm = 150000000;
+    sensor.updateExpectedPositionUm(totalUm);
+
+    bool exact = true;
+    for (int i = 0; i < 2000; i++) {
+        advanceTime(50);
+        totalUm += 173;  // 3.46mm/s, not a multiple of any float step
+        sensor.updateExpectedPositionUm(totalUm);
+        if (i % 17 == 0) sensor.addSensorPulseUm(2880);
+
+        // Reference: every update whose bucket is still inside (now - 5000, now]
+        unsigned long now = millis();
+        unsigned long cutoff = now - 4999;
+        int32_t reference = 0;
+        for (int k = 0; k <= i; k++) {
+            unsigned long updateMs = 10000 + (unsigned long)(k + 1) * 50;
+            if ((updateMs / 250) * 250 >= cutoff) reference += 173;
+        }
+        WindowSnapshot snap = sensor.getWindowSnapshot(now);
+        if (snap.expectedUm != reference) exact = false;
+        if (snap.actualUm % 2880 != 0) exact = false;
+    }
+
+    TEST_ASSERT(exact, "Window totals should be exact multiples of the inputs");
+    TEST_PASS("Micrometre totals do not drift over a long print");
+}
+
+// Scenario matrix for one window geometry: bookkeeping, steady-flow rate and
+// how long a hard jam takes to show up in the window. Prints latency vs RAM.
+template <typename Sensor>
+void runGeometryScenarios(const char* name) {
+    const unsigned long B = Sensor::BUCKET_SIZE_MS;
+    const unsigned long W = Sensor::WINDOW_SIZE_MS;
+    bool ok = true;
+
+    if (!runningTotalsMatchReference<Sensor>()) {
+        std::cout << COLOR_RED << "FAIL: " << name << " running totals drifted from reference" << COLOR_RESET << std::endl;
+        ok = false;
+    }
+
+    // Steady 10mm/s in 50ms steps with a pulse every 0.5mm
+    resetMockTime();
+    setMockTime(20000);
+    Sensor sensor;
+    int32_t expectedUm = 0;
+    sensor.updateExpectedPositionUm(expectedUm);
+    for (unsigned long t = 0; t < 2 * W; t += 50) {
+        advanceTime(50);
+        expectedUm += 500;
+        sensor.updateExpectedPositionUm(expectedUm);
+        sensor.addSensorPulseUm(500);
+    }
+    WindowSnapshot steady = sensor.getWindowSnapshot(millis());
+    if (steady.expectedRateUmPerSec < 9000 || steady.expectedRateUmPerSec > 11000 ||
+        steady.validDurationMs != W) {
+        std::cout << COLOR_RED << "FAIL: " << name << " steady rate "
+                  << steady.expectedRateUmPerSec << "um/s over " << steady.validDurationMs << "ms"
+                  << COLOR_RESET << std::endl;
+        ok = false;
+    }
+
+    // Hard jam: telemetry keeps coming, pulses stop. Latency until the
+    // window ratio falls below 0.25 (the hard-jam rate ratio).
+    unsigned long jamStart = millis();
+    unsigned long detectedAfter = 0;
+    for (unsigned long t = 0; t < 2 * W && detectedAfter == 0; t += 50) {
+        advanceTime(50);
+        expectedUm += 500;
+        sensor.updateExpectedPositionUm(expectedUm);
+        WindowSnapshot snap = sensor.getWindowSnapshot(millis());
+        if (snap.actualUm * 4 < snap.expectedUm) {
+            detectedAfter = millis() - jamStart;
+        }
+    }
+    if (detectedAfter == 0 || detectedAfter > W) {
+        std::cout << COLOR_RED << "FAIL: " << name << " hard jam not visible within one window" << COLOR_RESET << std::endl;
+        ok = false;
+    }
+
+    std::cout << "  " << std::left << std::setw(12) << name
+              << " buckets=" << std::setw(3) << Sensor::BUCKET_COUNT
+              << " ram=" << sizeof(Sensor) << "B"
+              << " jam_visible_after=" << detectedAfter << "ms"
+              << " (bucket " << B << "ms, window " << W << "ms)" << std::endl;
+
+    TEST_ASSERT(ok, "Window geometry scenarios should pass");
+}
+
+// Test: same scenarios across several compile-time window geometries
+void testWindowGeometryMatrix() {
+    TEST_SECTION("Window Geometry Matrix");
+
+    runGeometryScenarios<FilamentMotionSensorT<250, 5000>>("250/5000");
+    runGeometryScenarios<FilamentMotionSensorT<256, 5120>>("256/5120");
+    runGeometryScenarios<FilamentMotionSensorT<256, 4096>>("256/4096");
+    runGeometryScenarios<FilamentMotionSensorT<128, 2048>>("128/2048");
+    runGeometryScenarios<FilamentMotionSensorT<500, 8000>>("500/8000");
+
+    TEST_PASS("All window geometries pass the scenario matrix");
+}
+
+// Feed steady extrusion at speedUmPerSec for seconds, pulses scaled by flow (permille)
+static void feedSteadyFlow(FilamentMotionSensor& sensor, int32_t& totalUm, int32_t& pulseCarryUm,
+                           int32_t speedUmPerSec, int32_t flowPermille, int seconds) {
+    for (int i = 0; i < seconds * 10; i++) {
+        advanceTime(100);
+        totalUm += speedUmPerSec / 10;
+        sensor.updateExpectedPositionUm(totalUm);
+        pulseCarryUm += speedUmPerSec / 10 * flowPermille / 1000;
+        while (pulseCarryUm >= 2880) {
+            sensor.addSensorPulseUm(2880);
+            pulseCarryUm -= 2880;
+        }
+    }
+}
+
+// Test: distance window holds the same extrusion at any speed
+void testDistanceWindowSpeedInvariance() {
+    TEST_SECTION("Distance Window Speed Invariance");
+
+    const int32_t speeds[] = {500, 4000};
+    int32_t jamTripUm[2] = {-1, -1};
+
+    for (int s = 0; s < 2; s++) {
+        resetMockTime();
+        setMockTime(10000);
+        FilamentMotionSensor sensor;
+        sensor.setWindowMode(WindowMode::DISTANCE);
+        int32_t totalUm = 0;
+        int32_t carryUm = 0;
+        sensor.updateExpectedPositionUm(totalUm);
+
+        feedSteadyFlow(sensor, totalUm, carryUm, speeds[s], 1000, 60);
+        WindowSnapshot snap = sensor.getWindowSnapshot(millis());
+        TEST_ASSERT(snap.expectedUm >= FilamentMotionSensor::DISTANCE_WINDOW_UM,
+                    "Distance window should hold at least N mm");
+        TEST_ASSERT(snap.expectedUm <= FilamentMotionSensor::DISTANCE_WINDOW_UM + speeds[s],
+                    "Distance window should not exceed N mm by more than one checkpoint");
+
+        // The time window only sees a fraction of that at slow speed
+        WindowSnapshot timeSnap = sensor.getTimeWindowSnapshot(millis());
+        if (speeds[s] == 500) {
+            TEST_ASSERT(timeSnap.expectedUm < 3000, "Time window should hold under 3mm at 0.5mm/s");
+        }
+
+        // Jam: count extrusion until the window ratio drops below 25%
+        int32_t jamStartUm = totalUm;
+        for (int sec = 0; sec < 120 && jamTripUm[s] < 0; sec++) {
+            feedSteadyFlow(sensor, totalUm, carryUm, speeds[s], 0, 1);
+            snap = sensor.getWindowSnapshot(millis());
+            if ((int64_t)snap.actualUm * 1000 < (int64_t)snap.expectedUm * 250) {
+                jamTripUm[s] = totalUm - jamStartUm;
+            }
+        }
+    }
+
+    TEST_ASSERT(jamTripUm[0] > 0 && jamTripUm[1] > 0, "Jam should trip at both speeds");
+    int32_t spread = jamTripUm[0] - jamTripUm[1];
+    if (spread < 0) spread = -spread;
+    TEST_ASSERT(spread <= 2880 + 4000, "Filament lost before tripping should not depend on speed");
+
+    TEST_PASS("Distance window trips after the same extrusion at 0.5 and 4 mm/s");
+}
+
+// Test: distance window spans telemetry lag and falls back to retained history
+void testDistanceWindowHistory() {
+    TEST_SECTION("Distance Window History");
+
+    resetMockTime();
+    setMockTime(10000);
+    FilamentMotionSensor sensor;
+    sensor.setWindowMode(WindowMode::DISTANCE);
+    int32_t totalUm = 0;
+    int32_t carryUm = 0;
+    sensor.updateExpectedPositionUm(totalUm);
+
+    // Fast infill: 20mm of extrusion takes 1s, the window still spans 3s
+    feedSteadyFlow(sensor, totalUm, carryUm, 20000, 1000, 10);
+    WindowSnapshot snap = sensor.getWindowSnapshot(millis());
+    TEST_ASSERT(snap.validDurationMs >= FilamentMotionSensor::DISTANCE_MIN_SPAN_MS,
+                "Window should span the minimum time at high speed");
+
+    // A late 10mm telemetry chunk lands next to the pulses it caused
+    for (int i = 0; i < 4; i++) {
+        advanceTime(250);
+        sensor.addSensorPulseUm(2500);
+    }
+    totalUm += 10000;
+    sensor.updateExpectedPositionUm(totalUm);
+    snap = sensor.getWindowSnapshot(millis());
+    TEST_ASSERT(snap.deficitUm < 2880, "Late telemetry chunk should not open a deficit");
+
+    // Long idle while the loop keeps polling: no checkpoint qualifies, so
+    // the window covers all retained history
+    for (int sec = 0; sec < 200; sec++) {
+        advanceTime(1000);
+        snap = sensor.getWindowSnapshot(millis());
+    }
+    TEST_ASSERT(snap.validDurationMs <= FilamentMotionSensor::CHECKPOINT_SLOTS *
+                                            FilamentMotionSensor::CHECKPOINT_PERIOD_MS + 1000,
+                "Window should not reach past retained history");
+    TEST_ASSERT(snap.expectedUm == 0, "Idle history should hold no extrusion");
+
+    // Mode switch only changes which window the getters report
+    sensor.setWindowMode(WindowMode::TIME);
+    TEST_ASSERT(sensor.getWindowMode() == WindowMode::TIME, "Mode should switch back to time");
+    sensor.reset();
+    TEST_ASSERT(sensor.getWindowMode() == WindowMode::TIME, "reset() should keep the window mode");
+    TEST_ASSERT(sensor.getDistanceWindowSnapshot(millis()).expectedUm == 0,
+                "reset() should clear distance history");
+
+    TEST_PASS("Distance window covers lag and bounded history");
+}
+
+// Test: short window sees a blockage long before the long window drains
+void testShortWindowSnapshot() {
+    TEST_SECTION("Short Window Snapshot");
+
+    resetMockTime();
+    setMockTime(10000);
+    FilamentMotionSensor sensor;
+    int32_t totalUm = 0;
+    int32_t carryUm = 0;
+    sensor.updateExpectedPositionUm(totalUm);
+
+    feedSteadyFlow(sensor, totalUm, carryUm, 10000, 1000, 10);
+    WindowSnapshot shortSnap = sensor.getShortWindowSnapshot(millis());
+    TEST_ASSERT(shortSnap.validDurationMs == FilamentMotionSensor::SHORT_WINDOW_MS,
+                "Short window should span SHORT_BUCKET_COUNT buckets");
+    // The newest bucket is still filling, so the rate may read up to one bucket low
+    const int32_t shortBuckets = FilamentMotionSensor::SHORT_BUCKET_COUNT;
+    TEST_ASSERT(shortSnap.expectedRateUmPerSec >= 10000 * (shortBuckets - 1) / shortBuckets &&
+                shortSnap.expectedRateUmPerSec <= 10000,
+                "Short window expected rate should match 10mm/s");
+
+    // Blockage: two seconds later the short window holds no pulses at all
+    feedSteadyFlow(sensor, totalUm, carryUm, 10000, 0, 2);
+    shortSnap = sensor.getShortWindowSnapshot(millis());
+    WindowSnapshot longSnap = sensor.getTimeWindowSnapshot(millis());
+    TEST_ASSERT(shortSnap.actualUm == 0, "Short window should be empty of pulses");
+    TEST_ASSERT(longSnap.actualRateUmPerSec > 4000, "Long window should still report flow");
+    TEST_ASSERT(shortSnap.expectedUm <= longSnap.expectedUm, "Short window is a subset of the long one");
+
+    TEST_PASS("Short window shares the bucket ring and reacts within its span");
+}
+
+// Test: inter-edge period velocity and stall timeout
+void testEdgeVelocityEstimator() {
+    TEST_SECTION("Edge Velocity Estimator");
+
+    resetMockTime();
+    setMockTime(10000);
+    FilamentMotionSensor sensor;
+    sensor.updateExpectedPositionUm(0);
+    TEST_ASSERT(sensor.getEdgeVelocityUmPerSec(millis()) == -1, "No estimate before any edge");
+
+    // 1mm/s with 2.88mm pulses: one edge every 2880ms, telemetry every 100ms
+    int32_t totalUm = 0;
+    bool noPeriodAfterOneEdge = false;
+    for (int i = 1; i <= 39; i++) {
+        advanceTime(100);
+        totalUm += 100;
+        sensor.updateExpectedPositionUm(totalUm);
+        if (i == 10) sensor.addSensorPulseAtUm(2880, 11000);
+        if (i == 20) noPeriodAfterOneEdge = (sensor.getEdgeVelocityUmPerSec(millis()) == -1);
+    }
+    TEST_ASSERT(noPeriodAfterOneEdge, "One edge time gives no period yet");
+    sensor.addSensorPulseAtUm(2880, 11000 + 2880);
+
+    int32_t v = sensor.getEdgeVelocityUmPerSec(millis());
+    TEST_ASSERT(v >= 990 && v <= 1010, "Period of 2880ms at 2.88mm/pulse should read 1mm/s");
+
+    // A second edge in the same drain (PCNT-style) must not produce a zero period
+    sensor.addSensorPulseAtUm(2880, 11000 + 2880);
+    TEST_ASSERT(sensor.getEdgeVelocityUmPerSec(millis()) == v, "Same-time edges keep the last period");
+
+    // Edges stop while extrusion continues: velocity decays, then stalls
+    unsigned long lastEdge = 11000 + 2880;
+    int stallAfterMs = -1;
+    int32_t previous = v;
+    bool monotonic = true;
+    for (int i = 1; i <= 150 && stallAfterMs < 0; i++) {
+        advanceTime(100);
+        totalUm += 100;
+        sensor.updateExpectedPositionUm(totalUm);
+        int32_t now = sensor.getEdgeVelocityUmPerSec(millis());
+        if (now > previous) monotonic = false;
+        previous = now;
+        if (now == 0) stallAfterMs = (int)(millis() - lastEdge);
+    }
+    TEST_ASSERT(monotonic, "Velocity should only decay while no edges arrive");
+    TEST_ASSERT(stallAfterMs > 0, "Velocity should stall without edges");
+    TEST_ASSERT(stallAfterMs <= (int)(FilamentMotionSensor::EDGE_STALL_PERIODS * 2880 * 115 / 100),
+                "Stall should follow EDGE_STALL_PERIODS expected periods");
+
+    // No commanded extrusion: silence is not a stall
+    advanceTime(5000);
+    TEST_ASSERT(sensor.getEdgeVelocityUmPerSec(millis()) > 0, "Idle extruder should not read as stalled");
+
+    TEST_PASS("Edge periods give velocity and a stall timeout");
+}
+
+// Test: planner-to-extruder lag is measured and the time windows shifted by it
+void testLagEstimation() {
+    TEST_SECTION("Lag Estimation");
+
+    resetMockTime();
+    setMockTime(10000);
+    FilamentMotionSensor sensor;
+    sensor.updateExpectedPositionUm(0);
+    TEST_ASSERT(sensor.getLagMs() == 0, "No lag before any data");
+
+    // Commanded rate steps between 2 and 12mm/s; the sensor sees the same
+    // flow 1000ms later in 0.5mm pulses
+    const unsigned long LAG_MS = 1000;
+    const int STEP_MS = 50;
+    const int LAG_STEPS = LAG_MS / STEP_MS;
+    static int32_t commanded[2400];
+    int32_t expectedUm = 0;
+    int32_t pendingUm = 0;
+    unsigned int seed = 4242;
+    int32_t rateUmPerSec = 5000;
+    int32_t worstShiftedError = 0;
+    for (int i = 0; i < 2400; i++) {
+        if (i % 40 == 0) {
+            seed = seed * 1103515245u + 12345u;
+            rateUmPerSec = 2000 + (int32_t)((seed >> 16) % 11) * 1000;
+        }
+        commanded[i] = rateUmPerSec * STEP_MS / 1000;
+        advanceTime(STEP_MS);
+        expectedUm += commanded[i];
+        sensor.updateExpectedPositionUm(expectedUm);
+        if (i >= LAG_STEPS) pendingUm += commanded[i - LAG_STEPS];
+        while (pendingUm >= 500) {
+            sensor.addSensorPulseUm(500);
+            pendingUm -= 500;
+        }
+
+        // Last minute: the lag is locked in, so the windows compare like with like
+        if (i >= 1200) {
+            WindowSnapshot snap = sensor.getWindowSnapshot(millis());
+            int32_t ratio = snap.actualUm * 1000 / snap.expectedUm;
+            int32_t error = ratio > 1000 ? ratio - 1000 : 1000 - ratio;
+            if (error > worstShiftedError) worstShiftedError = error;
+        }
+    }
+
+    std::cout << "  lag=" << sensor.getLagMs() << "ms worst shifted ratio error="
+              << worstShiftedError << " permille" << std::endl;
+    TEST_ASSERT(sensor.getLagMs() == LAG_MS, "Cross-covariance peak should sit at the injected lag");
+    TEST_ASSERT(worstShiftedError <= 150, "Shifted window ratio should stay near 1.0 across rate steps");
+
+    // The estimate is kept across a reset (print pause/resume, retraction)
+    sensor.reset();
+    TEST_ASSERT(sensor.getLagMs() == LAG_MS, "Lag estimate should survive reset()");
+
+    TEST_PASS("Lag is measured and compensated");
+}
+
+// Test: expected extrusion is extrapolated between telemetry frames and
+// reconciled exactly when the next frame arrives
+void testExpectedExtrapolation() {
+    TEST_SECTION("Expected Extrapolation");
+
+    resetMockTime();
+    setMockTime(10000);
+    FilamentMotionSensor sensor;
+    sensor.setPrintSpeedPct(100);
+    sensor.updateExpectedPositionUm(0);
+
+    // 5mm/s reported in late 1000ms frames; 0.5mm pulses land continuously,
+    // evaluated at 4Hz like the jam detector
+    int32_t expectedUm = 0;
+    int32_t realWindowUm = 0;
+    int32_t minRatio = 100000, maxRatio = 0;
+    int32_t minRawRatio = 100000, maxRawRatio = 0;
+    for (int i = 1; i <= 200; i++) {
+        advanceTime(50);
+        if (i % 2 == 0) sensor.addSensorPulseUm(500);
+        if (i % 20 == 0) {
+            expectedUm += 5000;
+            sensor.updateExpectedPositionUm(expectedUm);
+            realWindowUm = sensor.getWindowSnapshot(millis()).expectedUm;
+        }
+        if (i >= 120 && i % 5 == 0) {
+            WindowSnapshot snap = sensor.getShortWindowSnapshot(millis());
+            int32_t provisional = sensor.getExtrapolatedExpectedUm(millis());
+            int32_t raw = snap.expectedUm - provisional;
+            if (snap.expectedUm > 0) {
+                int32_t ratio = snap.actualUm * 1000 / snap.expectedUm;
+                if (ratio < minRatio) minRatio = ratio;
+                if (ratio > maxRatio) maxRatio = ratio;
+            }
+            if (raw > 0) {
+                int32_t ratio = snap.actualUm * 1000 / raw;
+                if (ratio < minRawRatio) minRawRatio = ratio;
+                if (ratio > maxRawRatio) maxRawRatio = ratio;
+            }
+        }
+    }
+    std::cout << "  short-window ratio " << minRatio << ".." << maxRatio
+              << " permille (frames only: " << minRawRatio << ".." << maxRawRatio << ")" << std::endl;
+    TEST_ASSERT(maxRatio - minRatio < maxRawRatio - minRawRatio,
+                "Extrapolation should flatten the ratio sawtooth between frames");
+
+    // Right after a frame the window holds exactly the reported totals
+    TEST_ASSERT(sensor.getExtrapolatedExpectedUm(millis()) == 0, "A frame replaces the provisional amount");
+    TEST_ASSERT(sensor.getWindowSnapshot(millis()).expectedUm == realWindowUm,
+                "Window total should equal the real deltas at a frame");
+
+    // Between frames it grows at the last rate, scaled by a speed override
+    advanceTime(400);
+    int32_t provisional = sensor.getExtrapolatedExpectedUm(millis());
+    TEST_ASSERT(provisional >= 1950 && provisional <= 2050, "400ms at 5mm/s extrapolates ~2mm");
+    sensor.setPrintSpeedPct(200);
+    TEST_ASSERT(sensor.getExtrapolatedExpectedUm(millis()) == provisional * 2,
+                "Doubling PrintSpeedPct doubles the extrapolated rate");
+    sensor.setPrintSpeedPct(100);
+
+    // Telemetry stops: nothing is invented once the frame is overdue
+    advanceTime(FilamentMotionSensor::EXTRAPOLATE_MAX_MS);
+    TEST_ASSERT(sensor.getExtrapolatedExpectedUm(millis()) == 0,
+                "Extrapolation should end EXTRAPOLATE_MAX_MS past the last frame");
+
+    // Frames without extrusion sit between chunks and keep the rate, until
+    // no chunk for EXTRAPOLATE_CHUNK_MAX_MS says extrusion has stopped
+    sensor.updateExpectedPositionUm(expectedUm);
+    advanceTime(100);
+    TEST_ASSERT(sensor.getExtrapolatedExpectedUm(millis()) > 0, "An unchanged frame keeps extrapolating");
+    advanceTime(FilamentMotionSensor::EXTRAPOLATE_CHUNK_MAX_MS);
+    sensor.updateExpectedPositionUm(expectedUm);
+    advanceTime(100);
+    TEST_ASSERT(sensor.getExtrapolatedExpectedUm(millis()) == 0, "No chunk for too long, nothing extrapolated");
+
+    // A retraction ends it at once
+    expectedUm += 1000;
+    sensor.updateExpectedPositionUm(expectedUm);
+    advanceTime(250);
+    expectedUm += 1000;
+    sensor.updateExpectedPositionUm(expectedUm);
+    advanceTime(100);
+    TEST_ASSERT(sensor.getExtrapolatedExpectedUm(millis()) > 0, "Chunks restart extrapolation");
+    expectedUm -= 500;
+    sensor.updateExpectedPositionUm(expectedUm);
+    advanceTime(100);
+    TEST_ASSERT(sensor.getExtrapolatedExpectedUm(millis()) == 0, "A retraction stops extrapolating");
+
+    TEST_PASS("Expected extrusion is extrapolated and reconciled");
+}
+
+void testChunkedTelemetryExtrapolation() {
+    TEST_SECTION("Extrapolation Through Chunked Telemetry");
+
+    // TotalExtrusion as polled at 250ms in fixtures/logs_to_replay/
+    // soft_detected.txt (Debug lines from 22:23:00): it advances in
+    // 0.5-1s chunks with unchanged frames between them
+    const int32_t frames[] = {
+        7450, 7450, 8470, 8470, 9830, 10890, 10890, 10890, 12100, 12100,
+        13430, 13430, 14900, 16500, 16500, 18240, 18240, 18240, 18240, 20110,
+        20110, 20110, 21090, 22110, 22110, 23160, 23160, 24250, 24250, 25370,
+        26520, 26520, 26520, 27700, 28920, 28920, 28920, 30170, 31460, 31460,
+        31460, 32780, 32780, 34130, 34130, 35510, 35510, 36930, 38390, 38390,
+        38390, 39870, 39870, 41390, 41390, 41390, 42940, 42940, 44530, 44530,
+        46150, 46150, 47800, 49490, 49490, 49490, 49490, 51210, 51210, 51210,
+        52960, 52960, 54740, 54740, 54740, 56560, 56560, 56560, 58420, 58420,
+        58420, 60300, 60300, 60300, 62220, 62220, 64180, 64180, 64180, 66160,
+        66160, 66160, 68170, 68170, 68170, 70180, 70180, 72180, 72180, 72180,
+        74190, 74190, 76200, 76200, 76200, 76200, 78210, 80210, 80210, 82220,
+        82220, 82220, 84210, 84210, 84210, 86160, 88080, 88080, 88080, 89970,
+    };
+    const int frameCount = (int) (sizeof(frames) / sizeof(frames[0]));
+
+    // The filament really moves smoothly through the chunk points; 0.25mm
+    // pulses keep quantization out of the ratio
+    int chunkFrame[frameCount];
+    int lastChunk = 0;
+    for (int i = 0; i < frameCount; i++) {
+        if (i > 0 && frames[i] != frames[i - 1]) lastChunk = i;
+        chunkFrame[i] = lastChunk;
+    }
+
+    resetMockTime();
+    setMockTime(10000);
+    FilamentMotionSensor sensor;
+    sensor.setPrintSpeedPct(100);
+    sensor.updateExpectedPositionUm(frames[0]);
+
+    int32_t realUm = frames[0];
+    int32_t pulsedUm = frames[0];
+    int32_t minRatio = 100000, maxRatio = 0;
+    int32_t minRawRatio = 100000, maxRawRatio = 0;
+    int flatEvaluations = 0;
+    int evaluations = 0;
+    for (int i = 1; i < frameCount; i++) {
+        // Where the smooth flow is by frame i: between the surrounding chunks
+        int next = i;
+        while (next < frameCount - 1 && frames[next] == frames[chunkFrame[i]]) next++;
+        for (int half = 0; half < 2; half++) {
+            advanceTime(125);
+            int from = chunkFrame[i - 1];
+            int32_t span = (next - from) * 2;
+            int32_t at = (i - 1 - from) * 2 + half + 1;
+            if (span > 0 && frames[next] > frames[from]) {
+                realUm = frames[from] + (frames[next] - frames[from]) * at / span;
+            }
+            while (pulsedUm + 250 <= realUm) {
+                pulsedUm += 250;
+                sensor.addSensorPulseUm(250);
+            }
+            if (half == 0 && i >= 12) {
+                // Between frames, as the 4Hz detector sees it
+                unsigned long now = millis();
+                WindowSnapshot snap = sensor.getShortWindowSnapshot(now);
+                int32_t provisional = sensor.getExtrapolatedExpectedUm(now);
+                int32_t raw = snap.expectedUm - provisional;
+                evaluations++;
+                if (provisional == 0) flatEvaluations++;
+                if (snap.expectedUm > 0) {
+                    int32_t ratio = snap.actualUm * 1000 / snap.expectedUm;
+                    if (ratio < minRatio) minRatio = ratio;
+                    if (ratio > maxRatio) maxRatio = ratio;
+                }
+                if (raw > 0) {
+                    int32_t ratio = snap.actualUm * 1000 / raw;
+                    if (ratio < minRawRatio) minRawRatio = ratio;
+                    if (ratio > maxRawRatio) maxRawRatio = ratio;
+                }
+            }
+        }
+        sensor.updateExpectedPositionUm(frames[i]);
+    }
+    std::cout << "  short-window ratio " << minRatio << ".." << maxRatio
+              << " permille (frames only: " << minRawRatio << ".." << maxRawRatio << "), "
+              << flatEvaluations << "/" << evaluations << " evaluations without extrapolation" << std::endl;
+    TEST_ASSERT(flatEvaluations == 0, "Unchanged frames should not stop extrapolation");
+    TEST_ASSERT(maxRatio - minRatio < (maxRawRatio - minRawRatio) * 2 / 3,
+                "Extrapolation should flatten the chunk sawtooth");
+    TEST_ASSERT(minRatio > 500 && maxRatio < 1300, "Extrapolated rate should track the real flow");
+
+    TEST_PASS("Chunked telemetry is extrapolated chunk to chunk");
+}
+
+void testPulseCalibration() {
+    TEST_SECTION("Online Pulse Calibration");
+
+    // The sensor really moves 3.10mm per pulse but is configured at 2.88;
+    // 5mm/s reported in 1s telemetry frames, pulses trail by 1s of lag,
+    // evaluated at 4Hz
+    PulseCalibrator calibrator;
+    calibrator.reset(2880);
+    const int32_t trueUmPerPulse = 3100;
+    int32_t expectedUm = 0;
+    int32_t convergedAtMm = 0;
+    for (int i = 1; i <= 4 * 240; i++) {
+        if (i % 4 == 0) expectedUm += 5000;
+        int32_t actualUm = i > 4 ? (i - 4) * 1250 : 0;
+        unsigned long pulses = (unsigned long) (actualUm / trueUmPerPulse);
+        calibrator.update(expectedUm, pulses, true);
+        if (convergedAtMm == 0 && calibrator.getCalibration().converged) convergedAtMm = expectedUm / 1000;
+    }
+    PulseCalibration calibration = calibrator.getCalibration();
+    std::cout << "  estimate " << calibration.umPerPulse << " +/- " << calibration.ciUmPerPulse
+              << " um/pulse, converged after " << convergedAtMm << "mm" << std::endl;
+    TEST_ASSERT(calibration.converged, "4 minutes of healthy extrusion should converge");
+    TEST_ASSERT(convergedAtMm > 0 && convergedAtMm <= 1000, "Should converge within the first metre");
+    TEST_ASSERT(std::fabs(calibration.umPerPulse - trueUmPerPulse) < 30.0f, "Estimate within 1% of the true value");
+    TEST_ASSERT(std::fabs(calibration.umPerPulse - trueUmPerPulse) <= calibration.ciUmPerPulse * 1.5f,
+                "Confidence interval should cover the true value");
+    TEST_ASSERT(calibrator.getConvergedUmPerPulse() == (int32_t) std::lround(calibration.umPerPulse),
+                "Converged value is the rounded estimate");
+
+    // A clog reported as unhealthy teaches it nothing
+    float before = calibration.umPerPulse;
+    unsigned long stuckPulses = (unsigned long) (240 * 5000 / trueUmPerPulse);
+    for (int i = 0; i < 80; i++) {
+        expectedUm += 1250;
+        calibrator.update(expectedUm, stuckPulses, false);
+    }
+    TEST_ASSERT(calibrator.getCalibration().umPerPulse == before, "Unhealthy flow must not move the estimate");
+
+    // Totals going backwards (retraction, tracking reset) only restart the segment
+    calibrator.update(expectedUm, stuckPulses, true);
+    calibrator.update(expectedUm - 50000, stuckPulses, true);
+    TEST_ASSERT(calibrator.getCalibration().umPerPulse == before, "A backwards step must not be a segment");
+
+    // A new print starts over from the configured value
+    calibrator.reset(2880);
+    calibration = calibrator.getCalibration();
+    TEST_ASSERT(!calibration.converged && calibration.segments == 0 && calibration.umPerPulse == 2880.0f,
+                "reset() starts from the configured value");
+    TEST_ASSERT(calibrator.getConvergedUmPerPulse() == 0, "Nothing to apply before convergence");
+
+    TEST_PASS("Online calibration converges on the true mm/pulse");
+}
+
+// Test: millis() moving on between reads inside one call (a bucket boundary
+// crossed mid-update) must not leave flow out of the window totals
+void testClockStepDuringUpdate() {
+    TEST_SECTION("Clock Step During Update");
+
+    resetMockTime();
+    setMockTime(10000);
+    FilamentMotionSensor sensor;
+    sensor.updateExpectedPositionUm(0);
+
+    const unsigned long BUCKET = FilamentMotionSensor::BUCKET_SIZE_MS;
+    int32_t expectedUm = 0;
+    int32_t actualUm = 0;
+    mockMillisStep() = 1;
+    for (int i = 1; i <= 8; i++) {
+        // First read one ms before a boundary, later reads past it
+        setMockTime(10000 + i * BUCKET - 1);
+        sensor.addSensorPulseUm(1000);
+        actualUm += 1000;
+        setMockTime(10000 + i * BUCKET - 1);
+        expectedUm += 1000;
+        sensor.updateExpectedPositionUm(expectedUm);
+    }
+    mockMillisStep() = 0;
+
+    unsigned long now = millis();
+    WindowSnapshot snap = sensor.getWindowSnapshot(now);
+    snap.expectedUm -= sensor.getExtrapolatedExpectedUm(now);  // provisional, not a bucket
+    std::cout << "  window expected " << snap.expectedUm << "um of " << expectedUm
+              << ", actual " << snap.actualUm << "um of " << actualUm << std::endl;
+    TEST_ASSERT(snap.expectedUm == expectedUm, "Expected flow should all be in the window");
+    TEST_ASSERT(snap.actualUm == actualUm, "Pulses should all be in the window");
+
+    TEST_PASS("One clock read per call keeps every bucket in the totals");
+}
+
 int main() {
     TEST_SUITE_BEGIN("FilamentMotionSensor Unit Test Suite");
 
@@ -454,6 +1329,7 @@ int main() {
     testWindowedRates();
     testPruneOldSamples();
     testRetractionClearsWindow();
+    testRetractionDebt();
     testFlowRatioZeroDivision();
     testGracePeriod();
     testSampleBufferWrap();
@@ -461,6 +1337,22 @@ int main() {
     testRapidSampleRates();
     testUninitializedState();
     testFlowRatioClamping();
+    testTimestampedPulseIngestion();
+    testLoopStallDoesNotSmearPulses();
+    testPulseEdgeRing();
+    testWindowSnapshotConsistency();
+    testRunningTotalsMatchReference();
+    testLongPrintPrecision();
+    testWindowGeometryMatrix();
+    testDistanceWindowSpeedInvariance();
+    testDistanceWindowHistory();
+    testShortWindowSnapshot();
+    testEdgeVelocityEstimator();
+    testLagEstimation();
+    testExpectedExtrapolation();
+    testChunkedTelemetryExtrapolation();
+    testPulseCalibration();
+    testClockStepDuringUpdate();
 
     TEST_SUITE_END();
 }
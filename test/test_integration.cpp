@@ -9,6 +9,9 @@
 #include <iomanip>
 #include <cassert>
 #include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
 
 // Define mock globals before including mocks
 unsigned long _mockMillis = 0;
@@ -63,6 +66,10 @@ MockSerial Serial;
 #include "../src/FilamentMotionSensor.cpp"
 #include "../src/JamDetector.h"
 #include "../src/JamDetector.cpp"
+#include "../src/FlowRatioEstimator.h"
+#include "../src/FlowRatioEstimator.cpp"
+#include "../src/StatusPollScheduler.h"
+#include "../src/StatusPollScheduler.cpp"
 
 /**
  * Integration test harness that wires together the real components
@@ -560,6 +567,599 @@ void testNotPrintingDoesNotAccumulate() {
     TEST_PASS("Not printing state does not accumulate jam");
 }
 
+// Runs 1mm/s printing with timed edges, then a blockage. Returns ms from jam
+// onset to a hard jam, or -1 if none within 30s.
+long lowSpeedHardJamLatency(bool useEdgeVelocity) {
+    resetMockTime();
+    IntegrationTestHarness harness;
+    harness.config.graceTimeMs = 0;
+    harness.config.hardJamTimeMs = 2000;
+    harness.config.detectionMode = DetectionMode::HARD_ONLY;
+
+    _mockMillis = 1000;
+    harness.startPrint();
+
+    int32_t totalUm = 0;
+    int32_t carryUm = 0;
+    long jamOnsetMs = -1;
+    for (int i = 0; i < 240; i++) {
+        advanceTime(250);
+        totalUm += 250;  // 1mm/s
+        harness.sensor.updateExpectedPositionUm(totalUm);
+
+        bool jammedFilament = (i >= 120);
+        if (jammedFilament && jamOnsetMs < 0) jamOnsetMs = (long)millis();
+        if (!jammedFilament) {
+            carryUm += 250;
+            if (carryUm >= 2880) {
+                carryUm -= 2880;
+                harness.sensor.addSensorPulseAtUm(2880, millis());
+                harness.pulseCount++;
+            }
+        }
+
+        unsigned long now = millis();
+        WindowSnapshot window = harness.sensor.getWindowSnapshot(now);
+        WindowSnapshot shortWindow = harness.sensor.getShortWindowSnapshot(now);
+        int32_t edgeVelocity = useEdgeVelocity ? harness.sensor.getEdgeVelocityUmPerSec(now) : -1;
+        JamState state = harness.detector.updateUm(
+            window.expectedUm, window.actualUm, harness.pulseCount, true, true, now,
+            harness.printStartTime, harness.config,
+            window.expectedRateUmPerSec, window.actualRateUmPerSec,
+            shortWindow.expectedRateUmPerSec, shortWindow.actualRateUmPerSec,
+            edgeVelocity);
+
+        if (state.hardJamTriggered) {
+            return jammedFilament ? (long)now - jamOnsetMs : 0;
+        }
+    }
+    return -1;
+}
+
+void testLowSpeedHardJamUsesEdgeVelocity() {
+    TEST_SECTION("Full Pipeline: Low-Speed Hard Jam via Edge Velocity");
+
+    long withoutVelocity = lowSpeedHardJamLatency(false);
+    long withVelocity    = lowSpeedHardJamLatency(true);
+    std::cout << "  1mm/s hard jam latency: window only "
+              << (withoutVelocity < 0 ? std::string("none") : std::to_string(withoutVelocity) + "ms")
+              << ", with edge velocity " << withVelocity << "ms\n";
+
+    TEST_ASSERT(withVelocity != 0, "Healthy 1mm/s printing must not trip");
+    TEST_ASSERT(withVelocity > 0, "Edge stall should catch a 1mm/s blockage");
+    TEST_ASSERT(withoutVelocity < 0 || withVelocity < withoutVelocity,
+                "Edge velocity should be faster than the count window");
+    // Stall after EDGE_STALL_PERIODS periods (plus up to one period of phase)
+    // and then the configured accumulation time
+    TEST_ASSERT(withVelocity <= (long)(FilamentMotionSensor::EDGE_STALL_PERIODS + 1) * 2880 + 2000 + 500,
+                "Low-speed hard jam should trip within a few pulse periods");
+
+    TEST_PASS("Edge velocity catches low-speed hard jams");
+}
+
+// First layer at 4mm/s with the default 18s start grace, evaluated at 4Hz.
+// The filament blocks jamAtMs after print start (0 = jammed from the
+// start). Returns ms from print start to a jam, or -1 if none within 40s.
+long firstLayerJamTripMs(unsigned long jamAtMs) {
+    resetMockTime();
+    IntegrationTestHarness harness;
+    harness.config.graceTimeMs = 18000;
+    harness.config.hardJamTimeMs = 2000;
+
+    _mockMillis = 1000;
+    harness.startPrint();
+
+    int32_t totalUm = 0;
+    int32_t carryUm = 0;
+    for (int i = 0; i < 160; i++) {
+        advanceTime(250);
+        unsigned long sinceStart = millis() - harness.printStartTime;
+        totalUm += 1000;  // 4mm/s
+        harness.sensor.updateExpectedPositionUm(totalUm);
+        if (jamAtMs == 0 || sinceStart < jamAtMs) {
+            carryUm += 1000;
+            while (carryUm >= 2880) {
+                carryUm -= 2880;
+                harness.sensor.addSensorPulseAtUm(2880, millis());
+                harness.pulseCount++;
+            }
+        }
+        if (jamAtMs == 0) carryUm = 0;
+
+        unsigned long now = millis();
+        WindowSnapshot window = harness.sensor.getWindowSnapshot(now);
+        WindowSnapshot shortWindow = harness.sensor.getShortWindowSnapshot(now);
+        JamState state = harness.detector.updateUm(
+            window.expectedUm, window.actualUm, harness.pulseCount, true, true, now,
+            harness.printStartTime, harness.config,
+            window.expectedRateUmPerSec, window.actualRateUmPerSec,
+            shortWindow.expectedRateUmPerSec, shortWindow.actualRateUmPerSec,
+            harness.sensor.getEdgeVelocityUmPerSec(now));
+        if (state.jammed) {
+            return (long)sinceStart;
+        }
+    }
+    return -1;
+}
+
+void testFirstLayerJamAdaptiveGrace() {
+    TEST_SECTION("Full Pipeline: First-Layer Jam with Adaptive Start Grace");
+
+    const unsigned long JAM_AT_MS = 6000;
+    long healthy     = firstLayerJamTripMs(40000);
+    long firstLayer  = firstLayerJamTripMs(JAM_AT_MS);
+    long jammedStart = firstLayerJamTripMs(0);
+    std::cout << "  first-layer jam at " << JAM_AT_MS << "ms: detected after "
+              << (firstLayer < 0 ? std::string("none") : std::to_string(firstLayer - (long)JAM_AT_MS) + "ms")
+              << " (fixed 18s grace: >= " << (18000 - (long)JAM_AT_MS) << "ms)"
+              << ", jammed from start: " << jammedStart << "ms\n";
+
+    TEST_ASSERT(healthy < 0, "Healthy first layer must not trip once grace ends early");
+    TEST_ASSERT(firstLayer > (long)JAM_AT_MS, "First-layer jam should be detected");
+    TEST_ASSERT(firstLayer < 18000, "Settled flow should end start grace before its 18s cap");
+    TEST_ASSERT(jammedStart >= 18000, "A print that never flows keeps grace until the cap");
+
+    TEST_PASS("Start grace ends on healthy flow and first-layer jams are caught");
+}
+
+// One logged 1Hz "Debug:" line from a firmware capture
+struct LoggedFlowSample {
+    float winExpMm;
+    float winSnsMm;
+    float sdcpExpMm;   // cumulative telemetry total
+    float cumulSnsMm;  // cumulative sensor distance
+    bool  grace;
+    long  timeMs;      // capture clock, lines within one second spread evenly
+};
+
+struct LoggedCapture {
+    std::vector<LoggedFlowSample> samples;
+    long firstJamSample;  // index of the first logged jam, -1 if none
+};
+
+static const long NO_TRIP = -1000000;
+
+static bool parseLoggedFloat(const std::string& line, const char* key, float& out) {
+    size_t pos = line.find(key);
+    if (pos == std::string::npos) return false;
+    out = std::strtof(line.c_str() + pos + strlen(key), nullptr);
+    return true;
+}
+
+static LoggedCapture loadLoggedCapture(const std::string& path) {
+    LoggedCapture capture;
+    capture.firstJamSample = -1;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.find("Filament jam detected") != std::string::npos && capture.firstJamSample < 0) {
+            capture.firstJamSample = (long)capture.samples.size();
+            continue;
+        }
+        LoggedFlowSample sample;
+        if (line.find("Debug:") == std::string::npos ||
+            !parseLoggedFloat(line, "win_exp=", sample.winExpMm) ||
+            !parseLoggedFloat(line, "win_sns=", sample.winSnsMm) ||
+            !parseLoggedFloat(line, "sdcp_exp=", sample.sdcpExpMm) ||
+            !parseLoggedFloat(line, "cumul_sns=", sample.cumulSnsMm)) {
+            continue;
+        }
+        sample.grace = line.find("grace=1") != std::string::npos;
+        // "MM.DD.YY-hh:mm:ss" prefix
+        size_t stamp = line.find('-');
+        int hh = 0, mm = 0, ss = 0;
+        if (stamp != std::string::npos &&
+            sscanf(line.c_str() + stamp + 1, "%d:%d:%d", &hh, &mm, &ss) == 3) {
+            sample.timeMs = ((long)hh * 3600 + mm * 60 + ss) * 1000;
+        } else {
+            sample.timeMs = capture.samples.empty() ? 0 : capture.samples.back().timeMs;
+        }
+        capture.samples.push_back(sample);
+    }
+
+    for (size_t i = 0; i < capture.samples.size();) {
+        size_t j = i;
+        while (j < capture.samples.size() && capture.samples[j].timeMs == capture.samples[i].timeMs) j++;
+        for (size_t k = i; k < j; k++) {
+            capture.samples[k].timeMs += (long)((k - i) * 1000 / (j - i));
+        }
+        i = j;
+    }
+    return capture;
+}
+
+// Replays a capture through JamDetector at 1Hz. Returns the first soft trip
+// in seconds relative to the first logged jam (NO_TRIP if none) and counts
+// soft trips ahead of that jam.
+static long replaySoftTrips(const LoggedCapture& capture, const JamConfig& config, int& tripsBeforeLog) {
+    JamDetector detector;
+    detector.reset(0);
+    tripsBeforeLog = 0;
+    long firstTrip = NO_TRIP;
+    bool wasTripped = false;
+    const int32_t windowSec = (int32_t)(FilamentMotionSensor::WINDOW_SIZE_MS / 1000);
+    long loggedJam = capture.firstJamSample >= 0 ? capture.firstJamSample : (long)capture.samples.size();
+
+    for (size_t i = 0; i < capture.samples.size(); i++) {
+        const LoggedFlowSample& s = capture.samples[i];
+        int32_t expectedUm = FlowUnits::mmToUm(s.winExpMm);
+        int32_t actualUm   = FlowUnits::mmToUm(s.winSnsMm);
+        JamState state = detector.updateUm(expectedUm, actualUm, 0, !s.grace, true,
+                                           1000 + i * 1000, 0, config,
+                                           expectedUm / windowSec, actualUm / windowSec);
+        if (state.softJamTriggered && !wasTripped) {
+            if (firstTrip == NO_TRIP) firstTrip = (long)i - loggedJam;
+            if ((long)i < loggedJam) tripsBeforeLog++;
+            detector.onResume(1000 + i * 1000, 0, 0.0f);  // the firmware pauses and resumes
+        }
+        wasTripped = state.softJamTriggered;
+    }
+    return firstTrip;
+}
+
+void testSoftAlgorithmsOnReplayFixtures() {
+    TEST_SECTION("Replay Fixtures: Soft Jam Timer vs CUSUM");
+
+    // The soft_* captures are induced under-extrusion (logged soft jams);
+    // the Benchy capture only ends in a hard jam, so its soft trips are the
+    // false-alarm side of the curve
+    const char* fixtures[] = {
+        "fixtures/logs_to_replay/soft_detected.txt",
+        "fixtures/logs_to_replay/soft_detected_but_no_rearm.txt",
+        "fixtures/logs_to_replay/both.txt",
+        "fixtures/logs_to_replay/esp32_crash_3dbenchy.txt",
+    };
+    const uint16_t softTimes[] = {5000, 10000, 20000};
+    const size_t BENCHY = 3;
+
+    JamConfig config;
+    config.graceTimeMs    = 0;
+    config.hardJamMm      = 5.0f;
+    config.hardJamTimeMs  = 3000;
+    config.ratioThreshold = 0.60f;  // as captured
+    config.detectionMode  = DetectionMode::SOFT_ONLY;
+
+    // Time-to-detect vs false alarms as the soft jam time scales the evidence needed
+    long detect[4][3][2];
+    int tripsBefore[4][3][2];
+    std::cout << "  fixture                          method  soft_ms  first trip (s vs log)  trips before log\n";
+    for (size_t f = 0; f < 4; f++) {
+        LoggedCapture capture = loadLoggedCapture(fixtures[f]);
+        TEST_ASSERT(!capture.samples.empty(), "Replay fixture should parse");
+        std::string name = std::string(fixtures[f]).substr(std::string(fixtures[f]).rfind('/') + 1);
+        for (size_t t = 0; t < 3; t++) {
+            for (int m = 0; m < 2; m++) {
+                config.softJamTimeMs    = softTimes[t];
+                config.softJamAlgorithm = m ? SoftJamAlgorithm::CUSUM : SoftJamAlgorithm::TIMER;
+                detect[f][t][m] = replaySoftTrips(capture, config, tripsBefore[f][t][m]);
+                std::cout << "  " << std::left << std::setw(33) << name
+                          << std::setw(8) << (m ? "cusum" : "timer")
+                          << std::setw(9) << softTimes[t]
+                          << std::setw(23) << (detect[f][t][m] == NO_TRIP ? std::string("none")
+                                                                        : std::to_string(detect[f][t][m]))
+                          << tripsBefore[f][t][m] << std::right << "\n";
+            }
+        }
+    }
+
+    // At the default 10s soft jam time
+    for (size_t f = 0; f < BENCHY; f++) {
+        long timer = detect[f][1][0] == NO_TRIP ? 1000000 : detect[f][1][0];
+        TEST_ASSERT(detect[f][1][1] != NO_TRIP && detect[f][1][1] <= timer,
+                    "CUSUM should catch induced under-extrusion no later than the timer");
+    }
+    TEST_ASSERT(tripsBefore[BENCHY][1][1] <= tripsBefore[BENCHY][0][0],
+                "CUSUM at 10s should false-alarm no more than the timer at 5s");
+
+    TEST_PASS("CUSUM soft jam detection replayed against captured logs");
+}
+
+// Replays a capture through JamDetector on its own clock with both ratio
+// sources available; config.ratioSource picks one. Returns the first jam
+// (hard or soft) in seconds relative to the first logged jam (NO_TRIP if
+// none) and counts jams ahead of that one.
+static long replayJamTrips(const LoggedCapture& capture, const JamConfig& config, int& tripsBeforeLog) {
+    JamDetector detector;
+    FlowRatioEstimator estimator;
+    detector.reset(0);
+    estimator.reset(config.umPerPulse);
+    tripsBeforeLog = 0;
+    long firstTrip = NO_TRIP;
+    bool wasTripped = false;
+    const int32_t windowSec = (int32_t)(FilamentMotionSensor::WINDOW_SIZE_MS / 1000);
+    const long startMs = capture.samples.empty() ? 0 : capture.samples[0].timeMs;
+    long loggedJamMs = capture.firstJamSample >= 0 && capture.firstJamSample < (long)capture.samples.size()
+                           ? capture.samples[capture.firstJamSample].timeMs
+                           : (capture.samples.empty() ? 0 : capture.samples.back().timeMs + 1000);
+
+    for (size_t i = 0; i < capture.samples.size(); i++) {
+        const LoggedFlowSample& s = capture.samples[i];
+        unsigned long now = 1000 + (unsigned long)(s.timeMs - startMs);
+        int32_t expectedUm = FlowUnits::mmToUm(s.winExpMm);
+        int32_t actualUm   = FlowUnits::mmToUm(s.winSnsMm);
+        estimator.addExpectedUm(FlowUnits::mmToUm(s.sdcpExpMm), now);
+        estimator.addActualUm(FlowUnits::mmToUm(s.cumulSnsMm), now);
+        FlowEstimate estimate = estimator.getEstimate(now);
+        JamState state = detector.updateUm(expectedUm, actualUm, 0, !s.grace, true,
+                                           now, 0, config,
+                                           expectedUm / windowSec, actualUm / windowSec,
+                                           -1, -1, -1, &estimate);
+        if (state.jammed && !wasTripped) {
+            long relative = (s.timeMs - loggedJamMs) / 1000;
+            if (firstTrip == NO_TRIP) firstTrip = relative;
+            if (s.timeMs < loggedJamMs) tripsBeforeLog++;
+            detector.onResume(now, 0, 0.0f);  // the firmware pauses and resumes
+            estimator.reset(config.umPerPulse);
+        }
+        wasTripped = state.jammed;
+    }
+    return firstTrip;
+}
+
+void testKalmanRatioOnReplayFixtures() {
+    TEST_SECTION("Replay Fixtures: Window vs Kalman Flow Ratio");
+
+    const char* fixtures[] = {
+        "fixtures/logs_to_replay/soft_detected.txt",
+        "fixtures/logs_to_replay/soft_detected_but_no_rearm.txt",
+        "fixtures/logs_to_replay/both.txt",
+        "fixtures/logs_to_replay/esp32_crash_3dbenchy.txt",
+    };
+    const uint16_t softTimes[] = {5000, 10000, 20000};
+    const size_t BENCHY = 3;
+
+    JamConfig config;
+    config.graceTimeMs    = 0;
+    config.hardJamMm      = 5.0f;
+    config.hardJamTimeMs  = 3000;
+    config.ratioThreshold = 0.60f;  // as captured
+
+    long detect[4][3][2];
+    int tripsBefore[4][3][2];
+    std::cout << "  fixture                          source  soft_ms  first jam (s vs log)   jams before log\n";
+    for (size_t f = 0; f < 4; f++) {
+        LoggedCapture capture = loadLoggedCapture(fixtures[f]);
+        TEST_ASSERT(!capture.samples.empty(), "Replay fixture should parse");
+        std::string name = std::string(fixtures[f]).substr(std::string(fixtures[f]).rfind('/') + 1);
+        for (size_t t = 0; t < 3; t++) {
+            for (int m = 0; m < 2; m++) {
+                config.softJamTimeMs = softTimes[t];
+                config.ratioSource   = m ? FlowRatioSource::KALMAN : FlowRatioSource::WINDOW;
+                detect[f][t][m] = replayJamTrips(capture, config, tripsBefore[f][t][m]);
+                std::cout << "  " << std::left << std::setw(33) << name
+                          << std::setw(8) << (m ? "kalman" : "window")
+                          << std::setw(9) << softTimes[t]
+                          << std::setw(23) << (detect[f][t][m] == NO_TRIP ? std::string("none")
+                                                                        : std::to_string(detect[f][t][m]))
+                          << tripsBefore[f][t][m] << std::right << "\n";
+            }
+        }
+    }
+
+    // At the default 10s soft jam time: every jam the window finds is found
+    // no later, and Benchy's clog is caught without extra false alarms
+    for (size_t f = 0; f < BENCHY; f++) {
+        if (detect[f][1][0] != NO_TRIP) {
+            TEST_ASSERT(detect[f][1][1] != NO_TRIP && detect[f][1][1] <= detect[f][1][0],
+                        "Kalman ratio should catch captured jams no later than the window");
+        }
+    }
+    TEST_ASSERT(detect[BENCHY][1][1] != NO_TRIP && detect[BENCHY][1][1] >= -5 && detect[BENCHY][1][1] <= 5,
+                "Kalman ratio should catch the Benchy clog within seconds of the logged jam");
+    TEST_ASSERT(tripsBefore[BENCHY][1][1] <= tripsBefore[BENCHY][1][0],
+                "Kalman ratio should false-alarm no more than the window");
+
+    TEST_PASS("Kalman flow ratio replayed against captured logs");
+}
+
+struct PollRateRun {
+    long  tripLatencyMs;  // jam onset to trip, -1 if none within 30s
+    float steadyHz;       // status polls per second before the jam
+};
+
+// 8mm/s printing polled like the firmware: a status request whenever the
+// interval has passed, its TotalExtrusion arriving 40ms later, pulses in
+// real time and the detector at 4Hz. After 40s the filament drops to
+// jamFlow of the commanded rate. adaptive = false polls at the fixed 250ms.
+PollRateRun pollRateJamRun(bool adaptive, float jamFlow) {
+    const unsigned long TICK_MS = 10;
+    const unsigned long RTT_MS = 40;
+    const unsigned long JAM_AT_MS = 40000;
+    const int32_t UM_PER_TICK = 80;  // 8mm/s
+
+    resetMockTime();
+    IntegrationTestHarness harness;
+    harness.config.graceTimeMs = 5000;
+    harness.config.hardJamTimeMs = 2000;
+    StatusPollScheduler scheduler;
+    scheduler.configure(100, 1000);
+
+    _mockMillis = 1000;
+    harness.startPrint();
+    scheduler.reset();
+
+    PollRateRun run = {-1, 0.0f};
+    int32_t totalUm = 0;
+    float carryUm = 0.0f;
+    unsigned long lastPollMs = 0;
+    unsigned long pendingReplyMs = 0;
+    unsigned long lastDetectMs = millis();
+    unsigned long steadyPolls = 0;
+    bool havePolled = false;
+
+    for (unsigned long t = 0; t < JAM_AT_MS + 30000; t += TICK_MS) {
+        advanceTime(TICK_MS);
+        unsigned long now = millis();
+        totalUm += UM_PER_TICK;
+        carryUm += (t < JAM_AT_MS ? 1.0f : jamFlow) * UM_PER_TICK;
+        while (carryUm >= 2880.0f) {
+            carryUm -= 2880.0f;
+            harness.sensor.addSensorPulseAtUm(2880, now);
+            harness.pulseCount++;
+        }
+
+        unsigned long interval = adaptive ? scheduler.getIntervalMs() : 250;
+        if (!havePolled || now - lastPollMs >= interval) {
+            havePolled = true;
+            lastPollMs = now;
+            pendingReplyMs = now + RTT_MS;
+            scheduler.onPollSent();
+            if (t < JAM_AT_MS) steadyPolls++;
+        }
+        if (pendingReplyMs != 0 && now >= pendingReplyMs) {
+            pendingReplyMs = 0;
+            harness.sensor.updateExpectedPositionUm(totalUm);
+        }
+
+        if (now - lastDetectMs >= 250) {
+            lastDetectMs = now;
+            WindowSnapshot window = harness.sensor.getWindowSnapshot(now);
+            WindowSnapshot shortWindow = harness.sensor.getShortWindowSnapshot(now);
+            JamState state = harness.detector.updateUm(
+                window.expectedUm, window.actualUm, harness.pulseCount, true, true, now,
+                harness.printStartTime, harness.config,
+                window.expectedRateUmPerSec, window.actualRateUmPerSec,
+                shortWindow.expectedRateUmPerSec, shortWindow.actualRateUmPerSec,
+                harness.sensor.getEdgeVelocityUmPerSec(now));
+            scheduler.update(state.passRatio, state.hardJamPercent, state.softJamPercent,
+                             state.graceActive, now);
+            if (state.jammed) {
+                run.tripLatencyMs = t < JAM_AT_MS ? 0 : (long)(t - JAM_AT_MS);
+                break;
+            }
+        }
+    }
+    run.steadyHz = steadyPolls * 1000.0f / JAM_AT_MS;
+    return run;
+}
+
+void testAdaptivePollRateKeepsDetectionLatency() {
+    TEST_SECTION("Full Pipeline: Adaptive Status Poll Rate");
+
+    const float flows[] = {0.0f, 0.35f};
+    const char* names[] = {"hard", "soft"};
+    for (int i = 0; i < 2; i++) {
+        PollRateRun fixed    = pollRateJamRun(false, flows[i]);
+        PollRateRun adaptive = pollRateJamRun(true, flows[i]);
+        std::cout << "  " << names[i] << " jam: fixed 250ms " << fixed.steadyHz << "Hz, "
+                  << fixed.tripLatencyMs << "ms; adaptive " << adaptive.steadyHz << "Hz, "
+                  << adaptive.tripLatencyMs << "ms\n";
+
+        TEST_ASSERT(fixed.tripLatencyMs > 0 && adaptive.tripLatencyMs > 0,
+                    "Both schedules should detect the jam, and not before it");
+        TEST_ASSERT(adaptive.steadyHz < fixed.steadyHz / 2,
+                    "Steady printing should poll at well under half the fixed rate");
+        TEST_ASSERT(adaptive.tripLatencyMs <= fixed.tripLatencyMs,
+                    "Detection latency should be unchanged or better");
+    }
+
+    StatusPollScheduler scheduler;
+    scheduler.configure(100, 700);
+    scheduler.reset();
+    TEST_ASSERT(scheduler.getIntervalMs() == 100, "A print starts at the fastest rate");
+    for (int i = 0; i < 40; i++) scheduler.update(1.0f, 0.0f, 0.0f, false, i * 250);
+    TEST_ASSERT(scheduler.getIntervalMs() == 700, "Steady flow relaxes to the slowest rate");
+    scheduler.update(0.9f, 5.0f, 0.0f, false, 10000);
+    TEST_ASSERT(scheduler.getIntervalMs() == 100, "A climbing accumulator polls fastest at once");
+    scheduler.update(1.0f, 5.0f, 0.0f, false, 10250);
+    TEST_ASSERT(scheduler.getIntervalMs() == 125, "Relaxing is gradual");
+    scheduler.update(1.0f, 0.0f, 0.0f, true, 10500);
+    TEST_ASSERT(scheduler.getIntervalMs() == 100, "Grace polls fastest");
+
+    scheduler.reset();
+    for (int i = 0; i < 40; i++) scheduler.update(i % 2 ? 1.3f : 0.7f, 0.0f, 0.0f, false, i * 250);
+    TEST_ASSERT(scheduler.getIntervalMs() < 400, "A noisy pass ratio keeps polling fast");
+
+    scheduler.configure(10, 5000);
+    TEST_ASSERT(scheduler.getIntervalMs() >= StatusPollScheduler::MIN_INTERVAL_LIMIT_MS &&
+                scheduler.getIntervalMs() <= StatusPollScheduler::MAX_INTERVAL_LIMIT_MS,
+                "Bounds are clamped to what telemetry extrapolation covers");
+
+    scheduler.reset();
+    for (int i = 0; i <= 40; i++) scheduler.update(1.0f, 0.0f, 0.0f, false, i * 250);
+    scheduler.update(1.0f, 0.0f, 0.0f, false, 60000);  // resumed after a pause
+    for (int i = 0; i < 11; i++) scheduler.onPollSent();
+    scheduler.onFrameHandled(400);
+    StatusPollMetrics metrics = scheduler.getMetrics();
+    TEST_ASSERT(metrics.printingMs == 11000, "Pauses do not count as printing time");
+    TEST_ASSERT(std::fabs(metrics.achievedHz - 1.0f) < 0.01f, "Achieved rate is polls per second");
+    TEST_ASSERT(metrics.pollsSaved == 33, "Savings are counted against the fixed 4Hz");
+    TEST_ASSERT(metrics.cpuSavedUsPerSec == 1200, "CPU saved is skipped polls times frame cost");
+
+    TEST_PASS("Adaptive poll rate polls less without slowing detection");
+}
+
+// Steady printing sits at the slowest poll. The printer moves TotalExtrusion
+// in 1s chunks and answers each poll 60-260ms later; expected flow must
+// still be extrapolated right up to every frame.
+void testSlowestPollKeepsExtrapolation() {
+    TEST_SECTION("Full Pipeline: Slowest Poll Stays Inside Extrapolation");
+
+    const unsigned long TICK_MS = 10;
+    const int32_t UM_PER_TICK = 80;  // 8mm/s
+
+    resetMockTime();
+    _mockMillis = 1000;
+    FilamentMotionSensor sensor;
+    StatusPollScheduler scheduler;
+    scheduler.configure(100, 1000);
+    scheduler.reset();
+    sensor.updateExpectedPositionUm(0);
+
+    int32_t printerUm = 0;
+    float carryUm = 0.0f;
+    unsigned long lastPollMs = 0;
+    unsigned long replyAtMs = 0;
+    unsigned long lastFrameMs = millis();
+    unsigned long maxFrameGapMs = 0;
+    unsigned long lastDetectMs = millis();
+    int polls = 0;
+    int ticks = 0;
+    int flat = 0;
+    for (unsigned long t = TICK_MS; t <= 60000; t += TICK_MS) {
+        advanceTime(TICK_MS);
+        unsigned long now = millis();
+        if (t % 1000 == 0) printerUm = (int32_t) (t / TICK_MS) * UM_PER_TICK;
+        carryUm += UM_PER_TICK;
+        while (carryUm >= 2880.0f) {
+            carryUm -= 2880.0f;
+            sensor.addSensorPulseAtUm(2880, now);
+        }
+
+        if (replyAtMs == 0 && now - lastPollMs >= scheduler.getIntervalMs()) {
+            lastPollMs = now;
+            replyAtMs = now + 60 + (unsigned long) ((polls * 37) % 200);
+            polls++;
+        }
+        if (replyAtMs != 0 && now >= replyAtMs) {
+            replyAtMs = 0;
+            sensor.updateExpectedPositionUm(printerUm);
+            if (t > 10000 && now - lastFrameMs > maxFrameGapMs) maxFrameGapMs = now - lastFrameMs;
+            lastFrameMs = now;
+        }
+
+        if (now - lastDetectMs >= 250) {
+            lastDetectMs = now;
+            scheduler.update(1.0f, 0.0f, 0.0f, false, now);
+        }
+        // Every tick, so the last moments before a frame are seen too
+        if (t > 10000 && now != lastFrameMs) {
+            ticks++;
+            if (sensor.getExtrapolatedExpectedUm(now) == 0) flat++;
+        }
+    }
+    std::cout << "  interval " << scheduler.getIntervalMs() << "ms, longest frame gap " << maxFrameGapMs
+              << "ms, " << flat << "/" << ticks << " ticks without extrapolation\n";
+
+    TEST_ASSERT(scheduler.getIntervalMs() == StatusPollScheduler::MAX_INTERVAL_LIMIT_MS,
+                "Steady flow should poll at the slowest allowed rate");
+    TEST_ASSERT(maxFrameGapMs < FilamentMotionSensor::EXTRAPOLATE_MAX_MS,
+                "Frames should land inside the extrapolation horizon");
+    TEST_ASSERT(flat == 0, "Expected flow should never go flat before a frame");
+
+    TEST_PASS("Slowest poll keeps expected flow extrapolated");
+}
+
 int main() {
     TEST_SUITE_BEGIN("Integration Test Suite");
 
@@ -572,6 +1172,12 @@ int main() {
     testTelemetryLossDoesNotTriggerJam();
     testSettingsChangeAffectsBehavior();
     testNotPrintingDoesNotAccumulate();
+    testLowSpeedHardJamUsesEdgeVelocity();
+    testFirstLayerJamAdaptiveGrace();
+    testSoftAlgorithmsOnReplayFixtures();
+    testKalmanRatioOnReplayFixtures();
+    testAdaptivePollRateKeepsDetectionLatency();
+    testSlowestPollKeepsExtrapolation();
 
     TEST_SUITE_END();
 }
@@ -27,6 +27,11 @@ unsigned long getTime() {
 // Include the actual implementation
 #include "../src/JamDetector.h"
 #include "../src/JamDetector.cpp"
+#include "../src/FlowRatioEstimator.cpp"
+#include "../src/ShadowJamBank.h"
+#include "../src/ShadowJamBank.cpp"
+#include "../src/FlowHistory.h"
+#include "../src/FlowHistory.cpp"
 
 int testsPassed = 0;
 int testsFailed = 0;
@@ -302,7 +307,7 @@ void testResumeGrace() {
     assert(!state.jammed);  // Resume should clear jam flags
     
     // Even with bad ratio during resume grace, no jam
-    // Note: pulseCount must stay close to baseline (200) to avoid exceeding RESUME_MIN_PULSES (5)
+    // Note: flow is unhealthy, so only the time cap or RESUME_GRACE_15MM_THRESHOLD (~15mm) ends grace
     // and expectedDistance must be < RESUME_GRACE_15MM_THRESHOLD (~15mm)
     _mockMillis = 16000;
     state = detector.update(10.0f, 6.0f, 203, true, true, _mockMillis, printStartTime, config, 5.0f, 3.0f);
@@ -534,6 +539,788 @@ void testNotPrintingState() {
     testsPassed++;
 }
 
+void testIntegerPathMatchesFloat() {
+    std::cout << "\n=== Test: Integer Path Matches Float Wrapper ===" << std::endl;
+    
+    resetMockTime();
+    JamConfig config;
+    config.graceTimeMs = 0;
+    config.hardJamMm = 5.0f;
+    config.softJamTimeMs = 3000;
+    config.hardJamTimeMs = 2000;
+    config.ratioThreshold = 0.70f;
+    config.detectionMode = DetectionMode::BOTH;
+    
+    unsigned long printStartTime = 1000;
+    JamDetector floatDetector;
+    JamDetector intDetector;
+    floatDetector.reset(printStartTime);
+    intDetector.reset(printStartTime);
+    
+    // Healthy flow, then a ratio right at the soft threshold, then a hard jam
+    const float expected[] = {12.0f, 12.0f, 12.0f, 12.0f, 15.0f, 15.0f, 15.0f, 15.0f, 15.0f, 15.0f};
+    const float actual[]   = {11.5f, 11.5f,  8.4f,  8.4f,  0.0f,  0.0f,  0.0f,  0.0f,  0.0f,  0.0f};
+    const float expRate[]  = { 2.4f,  2.4f,  2.4f,  2.4f,  3.0f,  3.0f,  3.0f,  3.0f,  3.0f,  3.0f};
+    const float actRate[]  = { 2.3f,  2.3f,  1.68f, 1.68f, 0.0f,  0.0f,  0.0f,  0.0f,  0.0f,  0.0f};
+    
+    bool match = true;
+    for (int i = 0; i < 10; i++) {
+        _mockMillis = 2000 + i * 500;
+        JamState f = floatDetector.update(expected[i], actual[i], 100 + i, true, true,
+                                          _mockMillis, printStartTime, config,
+                                          expRate[i], actRate[i]);
+        JamState n = intDetector.updateUm(FlowUnits::mmToUm(expected[i]), FlowUnits::mmToUm(actual[i]),
+                                          100 + i, true, true, _mockMillis, printStartTime, config,
+                                          FlowUnits::mmToUm(expRate[i]), FlowUnits::mmToUm(actRate[i]));
+        if (f.jammed != n.jammed || f.hardJamTriggered != n.hardJamTriggered ||
+            f.softJamTriggered != n.softJamTriggered || f.graceState != n.graceState ||
+            !floatEquals(f.passRatio, n.passRatio) || !floatEquals(f.deficit, n.deficit) ||
+            !floatEquals(f.hardJamPercent, n.hardJamPercent)) {
+            match = false;
+        }
+    }
+    
+    assert(match);
+    assert(intDetector.getState().hardJamTriggered);
+    
+    std::cout << COLOR_GREEN << "PASS: updateUm() and update() agree step for step" << COLOR_RESET << std::endl;
+    testsPassed++;
+}
+
+void testDistanceWindowMode() {
+    std::cout << "\n=== Test: Distance Window Mode ===" << std::endl;
+    
+    resetMockTime();
+    JamConfig config;
+    config.graceTimeMs = 0;
+    config.hardJamMm = 5.0f;
+    config.softJamTimeMs = 3000;
+    config.hardJamTimeMs = 2000;
+    config.ratioThreshold = 0.70f;
+    config.detectionMode = DetectionMode::BOTH;
+    
+    unsigned long printStartTime = 1000;
+    
+    // Slow flow (0.3mm/s): a 20mm distance window, only one pulse left in it,
+    // and no pulse in the current 5s time window
+    JamDetector timeDetector;
+    JamDetector distanceDetector;
+    JamConfig distanceConfig = config;
+    distanceConfig.windowMode = WindowMode::DISTANCE;
+    timeDetector.reset(printStartTime);
+    distanceDetector.reset(printStartTime);
+    
+    JamState timeState;
+    JamState distanceState;
+    for (int i = 0; i < 10; i++) {
+        _mockMillis = 2000 + i * 500;
+        timeState = timeDetector.updateUm(1500, 0, 100, true, true, _mockMillis, printStartTime,
+                                          config, 300, 0);
+        distanceState = distanceDetector.updateUm(20000, 2880, 100, true, true, _mockMillis,
+                                                  printStartTime, distanceConfig, 300, 0);
+    }
+    
+    assert(!timeState.jammed);
+    assert(distanceState.hardJamTriggered);
+    assert(floatEquals(distanceState.passRatio, 0.144f));
+    
+    // Healthy slow flow between pulses: distance ratio is fine even though
+    // the sensor rate is momentarily zero
+    distanceDetector.reset(printStartTime);
+    for (int i = 0; i < 10; i++) {
+        _mockMillis = 2000 + i * 500;
+        distanceState = distanceDetector.updateUm(20000, 17280, 100 + i, true, true, _mockMillis,
+                                                  printStartTime, distanceConfig, 300, 0);
+    }
+    assert(!distanceState.jammed);
+    assert(distanceState.tripCode != TripCode::LOW_SPEED_ANOMALY);
+    
+    std::cout << COLOR_GREEN << "PASS: Distance window catches slow-flow jams without low-speed trips" << COLOR_RESET << std::endl;
+    testsPassed++;
+}
+
+void testShortWindowHardJam() {
+    std::cout << "\n=== Test: Short Window Hard Jam ===" << std::endl;
+    
+    resetMockTime();
+    JamConfig config;
+    config.graceTimeMs = 0;
+    config.hardJamMm = 5.0f;
+    config.softJamTimeMs = 3000;
+    config.hardJamTimeMs = 2000;
+    config.ratioThreshold = 0.70f;
+    config.detectionMode = DetectionMode::HARD_ONLY;
+    
+    unsigned long printStartTime = 1000;
+    JamDetector longOnly;
+    JamDetector withShort;
+    longOnly.reset(printStartTime);
+    withShort.reset(printStartTime);
+    
+    // Blockage 1.5s ago: the 5s window still shows 70% flow, the short one none.
+    // 8mm/s keeps the long window past the low-count likelihood table.
+    JamState longState;
+    JamState shortState;
+    for (int i = 0; i < 10; i++) {
+        _mockMillis = 2000 + i * 250;
+        longState = longOnly.updateUm(40000, 28000, 100, true, true, _mockMillis, printStartTime,
+                                      config, 8000, 5600);
+        shortState = withShort.updateUm(40000, 28000, 100, true, true, _mockMillis, printStartTime,
+                                        config, 8000, 5600, 8000, 0);
+    }
+    
+    assert(!longState.hardJamTriggered);
+    assert(shortState.hardJamTriggered);
+    
+    // Short window with no commanded flow (between telemetry chunks) defers
+    // to the long window instead of reading as a stall
+    JamDetector gap;
+    gap.reset(printStartTime);
+    JamState gapState;
+    for (int i = 0; i < 10; i++) {
+        _mockMillis = 2000 + i * 250;
+        gapState = gap.updateUm(40000, 38000, 100, true, true, _mockMillis, printStartTime,
+                                config, 8000, 7600, 0, 0);
+    }
+    assert(!gapState.hardJamTriggered);
+    
+    std::cout << COLOR_GREEN << "PASS: Short window trips hard jams before the long window drains" << COLOR_RESET << std::endl;
+    testsPassed++;
+}
+
+void testLowCountLikelihood() {
+    std::cout << "\n=== Test: Low-Count Likelihood ===" << std::endl;
+    
+    // Table matches ln P(K <= k | lambda) computed directly
+    for (int row = 1; row < PoissonTable::LAMBDA_ROWS; row += 5) {
+        double lambda = (double)row / PoissonTable::STEPS_PER_PULSE;
+        double cdf = 0.0;
+        for (int k = 0; k < PoissonTable::MAX_K; k++) {
+            cdf += std::exp(-lambda + k * std::log(lambda) - std::lgamma(k + 1.0));
+            assert(std::fabs(PoissonTable::LOG_CDF_MILLI[row][k] - 1000.0 * std::log(cdf)) <= 1.0);
+        }
+    }
+    
+    resetMockTime();
+    JamConfig config;
+    config.graceTimeMs = 0;
+    config.hardJamMm = 5.0f;
+    config.softJamTimeMs = 3000;
+    config.hardJamTimeMs = 2000;
+    config.ratioThreshold = 0.70f;
+    config.detectionMode = DetectionMode::HARD_ONLY;
+    config.umPerPulse = 2880;
+    unsigned long printStartTime = 1000;
+    
+    // 2.4mm/s: a 12mm window expects ~4 pulses, so an empty one happens
+    // to healthy flow a few percent of the time. The short window still
+    // sees flow, so the count alone decides and does not trip.
+    JamDetector slow;
+    slow.reset(printStartTime);
+    JamState slowState;
+    for (int i = 0; i < 12; i++) {
+        _mockMillis = 2000 + i * 250;
+        slowState = slow.updateUm(12000, 0, 100, true, true, _mockMillis, printStartTime,
+                                  config, 2400, 0, 2400, 1920);
+    }
+    assert(!slowState.hardJamTriggered);
+    assert(slowState.hardJamPercent == 0.0f);
+    assert(floatEquals(slowState.logLikelihood, -4.0f, 0.01f));
+    
+    // ~7 pulses expected but only one seen: improbable, trips even though
+    // the window's sensor rate is above the zero-flow floor
+    JamDetector sparse;
+    sparse.reset(printStartTime);
+    JamState sparseState;
+    for (int i = 0; i < 12; i++) {
+        _mockMillis = 2000 + i * 250;
+        sparseState = sparse.updateUm(20000, 2880, 100, true, true, _mockMillis, printStartTime,
+                                      config, 4000, 576);
+    }
+    assert(sparseState.hardJamTriggered);
+    assert(sparseState.logLikelihood < -4.5f);
+    
+    // The threshold is configurable: demanding stronger evidence holds off
+    JamConfig strict = config;
+    strict.likelihoodThreshold = 8.0f;
+    sparse.reset(printStartTime);
+    for (int i = 0; i < 12; i++) {
+        _mockMillis = 2000 + i * 250;
+        sparseState = sparse.updateUm(20000, 2880, 100, true, true, _mockMillis, printStartTime,
+                                      strict, 4000, 576);
+    }
+    assert(!sparseState.hardJamTriggered);
+    
+    // High flow is past the table and keeps the rate rules unchanged
+    JamDetector fast;
+    fast.reset(printStartTime);
+    JamState fastState;
+    for (int i = 0; i < 12; i++) {
+        _mockMillis = 2000 + i * 250;
+        fastState = fast.updateUm(40000, 0, 100, true, true, _mockMillis, printStartTime,
+                                  config, 8000, 0);
+    }
+    assert(fastState.hardJamTriggered);
+    assert(fastState.logLikelihood == 0.0f);
+    
+    std::cout << COLOR_GREEN << "PASS: Low-count windows trip on pulse-count likelihood, not rate" << COLOR_RESET << std::endl;
+    testsPassed++;
+}
+
+// Feeds quantized 5s and 1.5s time windows at 4Hz: healthy flow at
+// rateUmPerSec, then flowPercent of it from jamAtMs on. Returns ms from
+// jam onset to the hard trip, or -1 within maxMs.
+static long lowSpeedHardTripMs(const JamConfig& config, int32_t rateUmPerSec, int flowPercent,
+                               unsigned long jamAtMs, unsigned long maxMs) {
+    const unsigned long LONG_MS  = 5000;
+    const unsigned long SHORT_MS = 1500;
+    unsigned long pulseAt[256];
+    int pulses = 0;
+    int64_t actualUm = 0;
+    JamDetector detector;
+    detector.reset(0);
+    for (unsigned long now = 250; now <= maxMs; now += 250) {
+        int percent = (now > jamAtMs) ? flowPercent : 100;
+        actualUm += (int64_t)rateUmPerSec * percent / 100 / 4;
+        while (actualUm >= (int64_t)config.umPerPulse && pulses < 256) {
+            actualUm -= config.umPerPulse;
+            pulseAt[pulses++] = now;
+        }
+        int longCount = 0;
+        int shortCount = 0;
+        for (int i = 0; i < pulses; i++) {
+            if (now - pulseAt[i] < LONG_MS) longCount++;
+            if (now - pulseAt[i] < SHORT_MS) shortCount++;
+        }
+        int32_t longActual  = longCount * config.umPerPulse;
+        int32_t shortActual = shortCount * config.umPerPulse;
+        _mockMillis = now;
+        JamState state = detector.updateUm((int32_t)(rateUmPerSec * LONG_MS / 1000), longActual, pulses,
+                                           true, true, now, 0, config,
+                                           rateUmPerSec, (int32_t)(longActual * 1000LL / LONG_MS),
+                                           rateUmPerSec, (int32_t)(shortActual * 1000LL / SHORT_MS));
+        if (state.hardJamTriggered) {
+            return (now > jamAtMs) ? (long)(now - jamAtMs) : 0;
+        }
+    }
+    return -1;
+}
+
+void testLowSpeedPartialJamLatency() {
+    std::cout << "\n=== Test: Low-Speed Partial Jam Latency ===" << std::endl;
+    
+    resetMockTime();
+    JamConfig config;
+    config.graceTimeMs = 0;
+    config.softJamTimeMs = 3000;
+    config.hardJamTimeMs = 2000;
+    config.detectionMode = DetectionMode::HARD_ONLY;
+    config.umPerPulse = 2880;
+    
+    // 3mm/s: the 5s window expects ~5 pulses, inside the likelihood table.
+    // Healthy quantized flow never trips.
+    assert(lowSpeedHardTripMs(config, 3000, 100, 60000, 60000) == -1);
+    
+    // Flow drops to 10%. The long window needs ~5s to drain before its
+    // count looks improbable; the short-window rate rule sees the stall
+    // within 1.5s, so the trip lands about one short window plus the hard
+    // jam time after onset.
+    long tripMs = lowSpeedHardTripMs(config, 3000, 10, 20000, 40000);
+    std::cout << "  3mm/s at 10% flow: onset->trip " << tripMs << "ms" << std::endl;
+    assert(tripMs > 0);
+    assert(tripMs <= 1500 + (long)config.hardJamTimeMs + 500);
+    
+    std::cout << COLOR_GREEN << "PASS: Low-speed partial jams trip on the short window, not the drained long one" << COLOR_RESET << std::endl;
+    testsPassed++;
+}
+
+// Runs a steady deficit at 8mm/s through the detector at 4Hz.
+// Returns ms until the soft jam trips, or -1 within maxMs.
+static long softTripMs(JamDetector& detector, const JamConfig& config,
+                       int32_t actualUm, unsigned long& now, unsigned long maxMs) {
+    const int32_t expectedUm = 40000;
+    for (unsigned long t = 250; t <= maxMs; t += 250) {
+        now += 250;
+        JamState state = detector.updateUm(expectedUm, actualUm, 100, true, true, now, 1000, config,
+                                           expectedUm / 5, actualUm / 5);
+        if (state.softJamTriggered) return (long)t;
+    }
+    return -1;
+}
+
+void testCusumSoftJam() {
+    std::cout << "\n=== Test: CUSUM Soft Jam ===" << std::endl;
+    
+    resetMockTime();
+    JamConfig timerConfig;
+    timerConfig.graceTimeMs = 0;
+    timerConfig.hardJamMm = 5.0f;
+    timerConfig.softJamTimeMs = 10000;
+    timerConfig.hardJamTimeMs = 3000;
+    timerConfig.ratioThreshold = 0.70f;
+    timerConfig.detectionMode = DetectionMode::SOFT_ONLY;
+    JamConfig cusumConfig = timerConfig;
+    cusumConfig.softJamAlgorithm = SoftJamAlgorithm::CUSUM;
+    
+    // 15% under-extrusion: above the timer's ratio threshold, so it never
+    // trips; CUSUM trips once (15% - 10% allowance) x t reaches the limit
+    JamDetector timer;
+    JamDetector cusum;
+    unsigned long now = 1000;
+    timer.reset(now);
+    assert(softTripMs(timer, timerConfig, 34000, now, 120000) == -1);
+    now = 1000;
+    cusum.reset(now);
+    long smallTrip = softTripMs(cusum, cusumConfig, 34000, now, 120000);
+    assert(smallTrip > 0 && smallTrip <= 45000);
+    
+    // 50% under-extrusion trips sooner than the timer's full soft jam time
+    now = 1000;
+    timer.reset(now);
+    long timerBig = softTripMs(timer, timerConfig, 20000, now, 60000);
+    now = 1000;
+    cusum.reset(now);
+    long cusumBig = softTripMs(cusum, cusumConfig, 20000, now, 60000);
+    assert(timerBig > 0 && cusumBig > 0 && cusumBig < timerBig);
+    
+    // A healthy print that reads 10% short (calibration) with a pulse of
+    // jitter never trips; the bias is learned, and a 15% drop below it still trips
+    now = 1000;
+    cusum.reset(now);
+    bool falseTrip = false;
+    for (int i = 0; i < 10 * 60 * 4; i++) {
+        now += 250;
+        int32_t actualUm = (i & 1) ? 33120 : 38880;
+        JamState state = cusum.updateUm(40000, actualUm, 100, true, true, now, 1000, cusumConfig,
+                                        8000, actualUm / 5);
+        falseTrip = falseTrip || state.softJamTriggered;
+    }
+    assert(!falseTrip);
+    long driftTrip = softTripMs(cusum, cusumConfig, 30000, now, 120000);
+    assert(driftTrip > 0 && driftTrip <= 60000);
+    std::cout << "  Trip time: 15% deficit " << smallTrip << "ms (timer never), 50% deficit "
+              << cusumBig << "ms (timer " << timerBig << "ms), 15% below learned bias "
+              << driftTrip << "ms" << std::endl;
+    
+    std::cout << COLOR_GREEN << "PASS: CUSUM catches small sustained deficits in bounded time" << COLOR_RESET << std::endl;
+    testsPassed++;
+}
+
+// Feeds FlowRatioEstimator 1Hz telemetry and 4Hz quantized sensor
+// positions at the given flow, running JamDetector in KALMAN mode.
+// Returns the first hard jam time after start (ms), or -1.
+static long kalmanHardTripMs(JamDetector& detector, FlowRatioEstimator& estimator,
+                             const JamConfig& config, int32_t expectedRate, int32_t actualRate,
+                             unsigned long& now, int64_t& expectedUm, int64_t& actualUm,
+                             unsigned long durationMs, FlowEstimate* last = nullptr) {
+    unsigned long start = now;
+    for (unsigned long t = 0; t < durationMs; t += 250) {
+        now += 250;
+        expectedUm += expectedRate / 4;
+        actualUm   += actualRate / 4;
+        if (now % 1000 == 0) {
+            estimator.addExpectedUm((int32_t)expectedUm, now);
+        }
+        estimator.addActualUm((int32_t)(actualUm / 2880 * 2880), now);
+        FlowEstimate estimate = estimator.getEstimate(now);
+        if (last) *last = estimate;
+        JamState state = detector.updateUm(40000, 40000, 100, true, true, now, 1000, config,
+                                           expectedRate, actualRate, -1, -1, -1, &estimate);
+        if (state.hardJamTriggered) {
+            return (long)(now - start);
+        }
+    }
+    return -1;
+}
+
+void testKalmanFlowRatio() {
+    std::cout << "\n=== Test: Kalman Flow Ratio ===" << std::endl;
+    
+    resetMockTime();
+    JamConfig config;
+    config.graceTimeMs = 0;
+    config.hardJamMm = 5.0f;
+    config.softJamTimeMs = 10000;
+    config.hardJamTimeMs = 2000;
+    config.ratioThreshold = 0.70f;
+    config.detectionMode = DetectionMode::HARD_ONLY;
+    config.ratioSource = FlowRatioSource::KALMAN;
+    
+    // Healthy 2.5mm/s: under one pulse per second, yet the band settles
+    // around 1.0 and never reads as a hard jam
+    JamDetector detector;
+    FlowRatioEstimator estimator;
+    unsigned long now = 1000;
+    int64_t expectedUm = 0;
+    int64_t actualUm = 0;
+    detector.reset(now);
+    estimator.reset(2880);
+    FlowEstimate healthy;
+    assert(kalmanHardTripMs(detector, estimator, config, 2500, 2500, now,
+                            expectedUm, actualUm, 60000, &healthy) == -1);
+    assert(healthy.valid);
+    assert(healthy.ratioPermille > 700 && healthy.ratioPermille < 1300);
+    assert(healthy.ratioSigmaPermille > 0 && healthy.ratioSigmaPermille < 500);
+    
+    // The filament stops: the ratio and its upper edge fall to zero
+    long tripMs = kalmanHardTripMs(detector, estimator, config, 2500, 0, now,
+                                   expectedUm, actualUm, 30000);
+    std::cout << "  Healthy ratio " << healthy.ratioPermille << " +/- " << healthy.ratioSigmaPermille
+              << " permille, hard jam after " << tripMs << "ms" << std::endl;
+    assert(tripMs > 0 && tripMs <= 10000);
+    
+    // Without an estimate the window rates are used as before
+    JamState state = detector.updateUm(40000, 40000, 100, true, true, now + 250, 1000, config,
+                                       8000, 8000);
+    assert(state.passRatio > 0.99f);
+    
+    std::cout << COLOR_GREEN << "PASS: Kalman flow ratio tracks low flow and catches a stop" << COLOR_RESET << std::endl;
+    testsPassed++;
+}
+
+void testShadowJamBank() {
+    std::cout << "\n=== Test: Shadow Detector Bank ===" << std::endl;
+    
+    resetMockTime();
+    JamConfig config;
+    config.graceTimeMs = 0;
+    config.hardJamMm = 5.0f;
+    config.softJamTimeMs = 4000;
+    config.hardJamTimeMs = 2000;
+    config.ratioThreshold = 0.70f;
+    config.detectionMode = DetectionMode::BOTH;
+    
+    JamDetector active;
+    ShadowJamBank bank;
+    bank.configure(config);
+    unsigned long start = 1000;
+    active.reset(start);
+    bank.reset(start);
+    
+    // 75% flow at 4Hz: fine for the active 0.70 threshold, a jam for the
+    // strict variant (0.80), nothing for the lax one (0.60)
+    unsigned long now = start;
+    JamState activeState;
+    for (int i = 0; i < 80; i++) {
+        now += 250;
+        activeState = active.updateUm(25000, 18750, 100 + i, true, true, now, start, config,
+                                      5000, 3750, 5000, 3750, -1);
+        bank.update(activeState, 25000, 18750, 100 + i, true, true, now, start,
+                    5000, 3750, 5000, 3750, -1, nullptr);
+    }
+    
+    ShadowBankReport report = bank.getReport();
+    const ShadowResult* strict = nullptr;
+    const ShadowResult* lax = nullptr;
+    for (int i = 0; i < report.count; i++) {
+        if (std::string(report.results[i].name) == "strict") strict = &report.results[i];
+        if (std::string(report.results[i].name) == "lax") lax = &report.results[i];
+    }
+    std::cout << "  strict first trip " << strict->firstTripMs << "ms, bank cost "
+              << report.maxUpdateUs << "us max, " << report.ramBytes << " bytes" << std::endl;
+    
+    assert(report.count == ShadowJamBank::SIZE);
+    assert(!activeState.jammed && report.activeTrips == 0);
+    assert(strict != nullptr && lax != nullptr);
+    assert(strict->ratioThreshold > 0.79f && strict->softJamTimeMs == 3000);
+    assert(strict->trips == 1 && strict->jammed);
+    assert(!strict->firstTripHard && strict->firstTripCode == TripCode::SOFT_UNDER_EXT);
+    assert(strict->firstTripMs >= 2000 && strict->firstTripMs <= 3500);  // ~3s soft time
+    assert(lax->trips == 0 && !lax->jammed);
+    assert(report.evaluations == 80);
+    assert(report.ramBytes <= SHADOW_BANK_RAM_BUDGET);
+    
+    // Shadows never touch the active detector's pause handling
+    assert(!active.isPauseRequested());
+    
+    // Results outlive the end-of-print reset and clear for the next print
+    bank.reset(now);
+    assert(bank.getReport().results[0].trips == strict->trips);
+    bank.clearResults();
+    assert(bank.getReport().evaluations == 0);
+    for (int i = 0; i < ShadowJamBank::SIZE; i++) {
+        assert(bank.getReport().results[i].trips == 0);
+    }
+    
+    std::cout << COLOR_GREEN << "PASS: Shadow bank records what alternative configs would do" << COLOR_RESET << std::endl;
+    testsPassed++;
+}
+
+void testFlowHistoryReplay() {
+    std::cout << "\n=== Test: Flow History Replay ===" << std::endl;
+    
+    resetMockTime();
+    JamConfig config;
+    config.graceTimeMs = 0;
+    config.hardJamMm = 5.0f;
+    config.softJamTimeMs = 4000;
+    config.hardJamTimeMs = 2000;
+    config.ratioThreshold = 0.70f;
+    config.detectionMode = DetectionMode::BOTH;
+    
+    JamDetector active;
+    FlowHistory history(400);
+    unsigned long start = 1000;
+    unsigned long now = start;
+    unsigned long pulses = 0;
+    int32_t totalActualUm = 0;
+    unsigned long firstSampleMs = 0;
+    unsigned long activeTripMs = 0;
+    active.reset(start);
+    history.markReset();
+    
+    // 30s healthy, 20s at 75% flow, then a stop; the active detector only
+    // sees the stop
+    for (int i = 0; i < 240; i++) {
+        now += 250;
+        int32_t actualRate = (i < 120) ? 5000 : (i < 200) ? 3750 : 0;
+        int32_t actualUm = actualRate * 5;
+        totalActualUm += actualRate / 4;
+        pulses = totalActualUm / 2880;
+        JamState state = active.updateUm(25000, actualUm, pulses, true, true, now, start, config,
+                                         5000, actualRate, 5000, actualRate, -1);
+        history.record(25000, actualUm, pulses, true, true, now, start,
+                       5000, actualRate, 5000, actualRate, -1, nullptr);
+        if (firstSampleMs == 0) firstSampleMs = now;
+        if (state.jammed && activeTripMs == 0) activeTripMs = now;
+    }
+    assert(activeTripMs > 0);
+    assert(history.getCount() == 240);
+    
+    // The active config replays to the same single trip at the same time
+    FlowReplayResult result;
+    history.replay(config, result);
+    std::cout << "  replay of " << result.samples << " samples took " << result.elapsedUs << "us" << std::endl;
+    assert(result.done && !result.active);
+    assert(result.samples == 240 && result.printingSamples == 240);
+    assert(result.spanMs == now - firstSampleMs);
+    assert(result.trips == 1 && result.eventCount == 1);
+    assert(result.events[0].atMs == activeTripMs - firstSampleMs);
+    assert(result.events[0].ageMs == now - activeTripMs);
+    assert(result.events[0].clearedMs == 0);
+    
+    // A stricter candidate would already have paused during the 75% stretch
+    JamConfig strict = config;
+    strict.ratioThreshold = 0.80f;
+    history.replay(strict, result);
+    assert(result.trips >= 1);
+    assert(!result.events[0].hard && result.events[0].code == TripCode::SOFT_UNDER_EXT);
+    assert(result.events[0].atMs > 30000 && result.events[0].atMs < 36000);
+    
+    // A long idle stretch adds one sample, so the print stays in the ring
+    for (int i = 0; i < 200; i++) {
+        now += 250;
+        history.record(0, 0, pulses, false, false, now, start, 0, 0, 0, 0, -1, nullptr);
+    }
+    assert(history.getCount() == 241);
+    history.replay(config, result);
+    assert(result.trips == 1 && result.events[0].clearedMs > 0);
+    
+    // The ring keeps the newest samples once full
+    for (int i = 0; i < 400; i++) {
+        now += 250;
+        history.record(25000, 25000, pulses, true, true, now, start,
+                       5000, 5000, 5000, 5000, -1, nullptr);
+    }
+    assert(history.getCount() == 400);
+    history.replay(config, result);
+    assert(result.samples == 400 && result.trips == 0);
+    
+    // Samples hold distance deltas; once the ring has wrapped, replay
+    // still starts from the right windowed totals
+    for (int i = 0; i < 400; i++) {
+        now += 250;
+        history.record(25000, 12500, pulses, true, true, now, start,
+                       5000, 2500, 5000, 2500, -1, nullptr);
+    }
+    history.replay(config, result);
+    assert(result.trips == 1 && result.events[0].passRatio < 0.6f);
+    
+    // Stepped a few samples at a time (as loop() does) it reaches the
+    // same timeline; samples recorded meanwhile are left for the next one
+    FlowReplayCursor cursor;
+    FlowReplayResult stepped;
+    history.beginReplay(config, cursor, stepped);
+    int steps = 0;
+    while (!history.stepReplay(cursor, stepped, FLOW_REPLAY_SAMPLES_PER_STEP)) {
+        assert(!stepped.done);
+        steps++;
+        now += 250;
+        history.record(25000, 12500, pulses, true, true, now, start,
+                       5000, 2500, 5000, 2500, -1, nullptr);
+    }
+    assert(steps == (400 - 1) / FLOW_REPLAY_SAMPLES_PER_STEP);
+    assert(stepped.done && stepped.samples == result.samples);
+    assert(stepped.trips == result.trips && stepped.events[0].atMs == result.events[0].atMs);
+    assert(stepped.maxStepUs <= stepped.elapsedUs);
+    
+    // Overwriting a sample it has not reached ends the replay there
+    history.beginReplay(config, cursor, stepped);
+    history.stepReplay(cursor, stepped, 10);
+    for (int i = 0; i < 20; i++) {
+        now += 250;
+        history.record(25000, 12500, pulses, true, true, now, start,
+                       5000, 2500, 5000, 2500, -1, nullptr);
+    }
+    assert(history.stepReplay(cursor, stepped, FLOW_REPLAY_SAMPLES_PER_STEP));
+    assert(stepped.done && stepped.samples == 10);
+    
+    std::cout << COLOR_GREEN << "PASS: Flow history replays a candidate config" << COLOR_RESET << std::endl;
+    testsPassed++;
+}
+
+void testAdaptiveThreshold() {
+    std::cout << "\n=== Test: Adaptive Soft Threshold ===" << std::endl;
+    
+    resetMockTime();
+    JamConfig config;
+    config.graceTimeMs = 0;
+    config.hardJamMm = 5.0f;
+    config.softJamTimeMs = 3000;
+    config.hardJamTimeMs = 2000;
+    config.ratioThreshold = 0.40f;
+    config.detectionMode = DetectionMode::BOTH;
+    JamConfig adaptive = config;
+    adaptive.adaptiveThreshold = true;
+    
+    JamDetector fixed;
+    JamDetector learning;
+    unsigned long start = 1000;
+    unsigned long now = start;
+    fixed.reset(start);
+    learning.reset(start);
+    
+    // 75s of healthy flow reading 93-97%, like a sensor that under-reads
+    JamState state;
+    for (int i = 0; i < 300; i++) {
+        now += 250;
+        int32_t actualRate = (i % 2) ? 4650 : 4850;
+        fixed.updateUm(25000, actualRate * 5, 100 + i, true, true, now, start, config,
+                       5000, actualRate, 5000, actualRate, -1);
+        state = learning.updateUm(25000, actualRate * 5, 100 + i, true, true, now, start, adaptive,
+                                  5000, actualRate, 5000, actualRate, -1);
+    }
+    FlowBaseline baseline = learning.getBaseline();
+    std::cout << "  learned mean " << baseline.meanPermille << " sigma " << baseline.sigmaPermille
+              << " threshold " << state.softThreshold << std::endl;
+    assert(baseline.meanPermille >= 940 && baseline.meanPermille <= 960);
+    assert(baseline.sigmaPermille >= 15 && baseline.sigmaPermille <= 25);
+    assert(state.softThreshold > 0.80f && state.softThreshold < 0.90f);
+    assert(!state.jammed);
+    
+    // 75% flow is a jam for this printer, but passes the fixed 40% threshold
+    unsigned long onset = now;
+    unsigned long tripMs = 0;
+    JamState fixedState;
+    for (int i = 0; i < 40; i++) {
+        now += 250;
+        fixedState = fixed.updateUm(25000, 18750, 400 + i, true, true, now, start, config,
+                                    5000, 3750, 5000, 3750, -1);
+        state = learning.updateUm(25000, 18750, 400 + i, true, true, now, start, adaptive,
+                                  5000, 3750, 5000, 3750, -1);
+        if (state.jammed && tripMs == 0) tripMs = now - onset;
+    }
+    assert(!fixedState.jammed && fixedState.softThreshold > 0.39f && fixedState.softThreshold < 0.41f);
+    assert(tripMs > 0 && tripMs <= 3500);
+    assert(state.softJamTriggered && state.tripCode == TripCode::SOFT_UNDER_EXT);
+    
+    // A stored baseline starts the next print tuned
+    JamDetector next;
+    next.reset(now);
+    next.setBaseline(baseline);
+    state = next.updateUm(25000, 24000, 10, true, true, now + 250, now, adaptive,
+                          5000, 4800, 5000, 4800, -1);
+    assert(state.softThreshold > 0.80f && state.softThreshold < 0.90f);
+    
+    // Learning never loosens the configured threshold, nor tightens past 90%
+    FlowBaseline slippy = {500, 50, 1000};
+    next.setBaseline(slippy);
+    state = next.updateUm(25000, 24000, 11, true, true, now + 500, now, adaptive,
+                          5000, 4800, 5000, 4800, -1);
+    assert(state.softThreshold > 0.39f && state.softThreshold < 0.41f);
+    FlowBaseline perfect = {1000, 0, 1000};
+    next.setBaseline(perfect);
+    state = next.updateUm(25000, 24000, 12, true, true, now + 750, now, adaptive,
+                          5000, 4800, 5000, 4800, -1);
+    assert(state.softThreshold > 0.89f && state.softThreshold < 0.91f);
+    
+    std::cout << COLOR_GREEN << "PASS: Adaptive threshold learns healthy flow and tightens to it" << COLOR_RESET << std::endl;
+    testsPassed++;
+}
+
+void testTimeToJamPrediction() {
+    std::cout << "\n=== Test: Time-To-Jam Prediction ===" << std::endl;
+    
+    resetMockTime();
+    JamConfig config;
+    config.graceTimeMs = 0;
+    config.hardJamMm = 5.0f;
+    config.softJamTimeMs = 3000;
+    config.hardJamTimeMs = 2000;
+    config.ratioThreshold = 0.40f;
+    config.detectionMode = DetectionMode::BOTH;
+    
+    JamDetector detector;
+    unsigned long start = 1000;
+    unsigned long now = start;
+    detector.reset(start);
+    
+    // Steady healthy flow predicts nothing
+    JamState state;
+    for (int i = 0; i < 40; i++) {
+        now += 250;
+        int32_t actualRate = (i % 2) ? 4900 : 5000;
+        state = detector.updateUm(25000, actualRate * 5, 100 + i, true, true, now, start, config,
+                                  5000, actualRate, 5000, actualRate, -1);
+    }
+    assert(!state.jammed && !state.jamWarning && state.timeToJamMs == -1);
+    
+    // A nozzle slowly clogging: flow falls 2% per second, so the soft
+    // threshold (40%) is crossed 30s in and the timer trips 3s later
+    unsigned long onset = now;
+    unsigned long warnMs = 0;
+    int32_t predictedAtWarn = -1;
+    int32_t lastPrediction = -1;
+    bool decreasing = true;
+    unsigned long tripMs = 0;
+    for (int i = 0; i < 160 && tripMs == 0; i++) {
+        now += 250;
+        int32_t actualRate = 5000 - 25 * i;
+        if (actualRate < 0) actualRate = 0;
+        state = detector.updateUm(25000, actualRate * 5, 140 + i, true, true, now, start, config,
+                                  5000, actualRate, 5000, actualRate, -1);
+        if (state.jammed) {
+            tripMs = now - onset;
+            break;
+        }
+        if (state.timeToJamMs >= 0) {
+            if (lastPrediction >= 0 && state.timeToJamMs > lastPrediction + 500) decreasing = false;
+            lastPrediction = state.timeToJamMs;
+        }
+        if (state.jamWarning && warnMs == 0) {
+            warnMs = now - onset;
+            predictedAtWarn = state.timeToJamMs;
+        }
+    }
+    std::cout << "  warned at " << warnMs << "ms predicting " << predictedAtWarn
+              << "ms, tripped at " << tripMs << "ms" << std::endl;
+    assert(tripMs > 0);
+    assert(warnMs > 0 && tripMs - warnMs >= 7000);
+    assert(predictedAtWarn > 0 && predictedAtWarn <= 10000);
+    long error = (long)(tripMs - warnMs) - predictedAtWarn;
+    assert(error > -1500 && error < 1500);
+    assert(decreasing);
+    assert(state.timeToJamMs == 0 && !state.jamWarning);
+    
+    // Extrapolation needs a full window after grace or a resume
+    detector.onResume(now, 500, 0.0f);
+    state = detector.getState();
+    assert(state.timeToJamMs == -1 && !state.jamWarning);
+    
+    std::cout << COLOR_GREEN << "PASS: Deficit trend predicts the soft trip seconds ahead" << COLOR_RESET << std::endl;
+    testsPassed++;
+}
+
 int main() {
     std::cout << "\n";
     std::cout << "========================================\n";
@@ -552,6 +1339,17 @@ int main() {
     testPauseRequestHandling();
     testEdgeCaseZeroExpected();
     testNotPrintingState();
+    testIntegerPathMatchesFloat();
+    testDistanceWindowMode();
+    testShortWindowHardJam();
+    testLowCountLikelihood();
+    testLowSpeedPartialJamLatency();
+    testCusumSoftJam();
+    testKalmanFlowRatio();
+    testShadowJamBank();
+    testFlowHistoryReplay();
+    testAdaptiveThreshold();
+    testTimeToJamPrediction();
     
     std::cout << "\n========================================\n";
     std::cout << "Test Results:\n";
@@ -0,0 +1,200 @@
+/**
+ * Unit Tests for PulseSource
+ *
+ * Tests the shared pulse bookkeeping, the GPIO interrupt backend and the
+ * mock backend used by other host tests. The PCNT backend needs real
+ * hardware and is not compiled on the host.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <cassert>
+#include <cmath>
+
+// Define mock globals before including mocks
+unsigned long _mockMillis = 0;
+int testsPassed = 0;
+int testsFailed = 0;
+
+// Include mock Arduino environment
+#include "mocks/Arduino.h"
+
+// Include shared test mocks (helpers)
+#include "mocks/test_mocks.h"
+
+// Include the actual implementation
+#include "../src/PulseSource.h"
+#include "../src/PulseSource.cpp"
+#include "../src/FilamentMotionSensor.h"
+#include "../src/FilamentMotionSensor.cpp"
+#include "mocks/MockPulseSource.h"
+
+// Test: host build never selects PCNT
+void testBackendSelection() {
+    TEST_SECTION("Backend Selection");
+
+    TEST_ASSERT(PULSE_SOURCE_HAS_PCNT == 0, "Host build should not have PCNT");
+
+    PulseSource& source = PulseSource::selectForPin(27);
+    TEST_ASSERT(strcmp(source.getName(), "GPIO interrupt") == 0, "Fallback should be GPIO interrupt backend");
+    TEST_ASSERT(_mockInterruptHandler() == GpioIsrPulseSource::onEdgeISR, "ISR should be attached");
+
+    TEST_PASS("selectForPin() falls back to GPIO interrupt backend");
+}
+
+// Test: GPIO backend counts edges and records their time
+void testGpioIsrBackend() {
+    TEST_SECTION("GPIO Interrupt Backend");
+
+    resetMockTime();
+    GpioIsrPulseSource source;
+    source.begin(27);
+    TEST_ASSERT(source.takeNewPulses() == 0, "No pulses right after begin()");
+
+    setMockTime(1000);
+    triggerMockInterrupt();
+    setMockTime(1040);
+    triggerMockInterrupt();
+    setMockTime(1200);
+
+    TEST_ASSERT(source.takeNewPulses() == 2, "Two edges should be counted");
+    TEST_ASSERT(source.takeNewPulses() == 0, "Count should not repeat");
+
+    unsigned long first  = source.nextEdgeTimeMs(millis(), (uint32_t) micros());
+    unsigned long second = source.nextEdgeTimeMs(millis(), (uint32_t) micros());
+    unsigned long none   = source.nextEdgeTimeMs(millis(), (uint32_t) micros());
+    TEST_ASSERT(first == 1000, "First edge time should be preserved");
+    TEST_ASSERT(second == 1040, "Second edge time should be preserved");
+    TEST_ASSERT(none == 1200, "Missing timestamp should fall back to now");
+
+    // Pulses during a frozen period are discarded by syncCount()
+    triggerMockInterrupt();
+    triggerMockInterrupt();
+    source.syncCount();
+    TEST_ASSERT(source.takeNewPulses() == 0, "syncCount() should discard pending pulses");
+    TEST_ASSERT(source.nextEdgeTimeMs(millis(), (uint32_t) micros()) == millis(),
+                "syncCount() should discard pending timestamps");
+
+    TEST_PASS("GPIO backend counts edges with timestamps");
+}
+
+// Test: edge ring overflow never loses a pulse count
+void testGpioIsrOverflow() {
+    TEST_SECTION("GPIO Interrupt Backend Overflow");
+
+    resetMockTime();
+    GpioIsrPulseSource source;
+    source.begin(27);
+    uint32_t overflowsBefore = source.getEdgeOverflows();
+
+    uint32_t edges = GpioIsrPulseSource::EDGE_RING_CAPACITY + 10;
+    for (uint32_t i = 0; i < edges; i++) {
+        triggerMockInterrupt();
+    }
+
+    TEST_ASSERT(source.takeNewPulses() == edges, "All edges should be counted despite overflow");
+    TEST_ASSERT(source.getEdgeOverflows() - overflowsBefore == 10, "Dropped timestamps should be counted");
+
+    TEST_PASS("Ring overflow keeps the count and reports dropped timestamps");
+}
+
+// Test: mock backend drives FilamentMotionSensor like the firmware loop does
+void testMockBackendFeedsSensor() {
+    TEST_SECTION("Mock Backend Drives Motion Sensor");
+
+    resetMockTime();
+    setMockTime(10000);
+    MockPulseSource source;
+    source.begin(6);
+    FilamentMotionSensor sensor;
+    sensor.updateExpectedPosition(0.0f);
+
+    // Timed edges (GPIO-style) plus untimed edges (PCNT-style)
+    source.injectEdge(10100UL * 1000UL);
+    source.injectEdge(10200UL * 1000UL);
+    source.injectUntimedPulses(1);
+    setMockTime(10500);
+
+    uint32_t pulses = source.takeNewPulses();
+    TEST_ASSERT(pulses == 3, "Mock should report all injected edges");
+
+    unsigned long nowMs = millis();
+    uint32_t nowUs = (uint32_t) micros();
+    for (uint32_t i = 0; i < pulses; i++) {
+        sensor.addSensorPulseAt(2.88f, source.nextEdgeTimeMs(nowMs, nowUs));
+    }
+    TEST_ASSERT(floatEquals(sensor.getSensorDistance(), 8.64f), "All pulses should land in window");
+
+    // The two timed edges age out before the untimed one
+    setMockTime(15250);
+    TEST_ASSERT(floatEquals(sensor.getSensorDistance(), 2.88f), "Timed edges should age out at their edge time");
+
+    TEST_PASS("Mock backend feeds motion sensor with mixed timed/untimed edges");
+}
+
+// Test: edge velocity only where the backend timestamps edges
+void testEdgeVelocityNeedsTimestamps() {
+    TEST_SECTION("Edge Velocity Needs Timestamps");
+
+    GpioIsrPulseSource gpio;
+    TEST_ASSERT(gpio.hasEdgeTimestamps(), "GPIO backend should timestamp edges");
+
+    for (int timed = 1; timed >= 0; timed--) {
+        resetMockTime();
+        setMockTime(10000);
+        MockPulseSource source;
+        source.timestamped = (timed == 1);
+        FilamentMotionSensor sensor;
+        sensor.setEdgeTimestamps(source.hasEdgeTimestamps());
+        sensor.updateExpectedPosition(0.0f);
+        sensor.updateExpectedPosition(5.0f);
+
+        // Two edges 500ms apart at 2.88mm each
+        setMockTime(10800);
+        sensor.addSensorPulseAt(2.88f, 10200);
+        sensor.addSensorPulseAt(2.88f, 10700);
+        int32_t velocity = sensor.getEdgeVelocityUmPerSec(10800);
+        if (timed) {
+            TEST_ASSERT(velocity == 5760, "Timed edges should give the inter-edge velocity");
+        } else {
+            TEST_ASSERT(velocity == -1, "Untimed backend should report unknown edge velocity");
+        }
+
+        // Survives reset() for the next print
+        sensor.reset();
+        sensor.updateExpectedPosition(0.0f);
+        setMockTime(11600);
+        sensor.addSensorPulseAt(2.88f, 11000);
+        sensor.addSensorPulseAt(2.88f, 11500);
+        TEST_ASSERT((sensor.getEdgeVelocityUmPerSec(11600) == -1) == !timed,
+                    "Edge timestamp setting should survive reset()");
+    }
+
+    TEST_PASS("getEdgeVelocityUmPerSec() is gated on edge timestamps");
+}
+
+// Test: 32-bit counter wraparound
+void testCountWraparound() {
+    TEST_SECTION("Pulse Count Wraparound");
+
+    MockPulseSource source;
+    source.injectUntimedPulses(0xFFFFFFF0u);
+    source.takeNewPulses();
+    source.injectUntimedPulses(0x20);
+    TEST_ASSERT(source.takeNewPulses() == 0x20, "Delta should survive 32-bit wraparound");
+
+    TEST_PASS("takeNewPulses() handles counter wraparound");
+}
+
+int main() {
+    TEST_SUITE_BEGIN("PulseSource Unit Test Suite");
+
+    testBackendSelection();
+    testGpioIsrBackend();
+    testGpioIsrOverflow();
+    testMockBackendFeedsSensor();
+    testEdgeVelocityNeedsTimestamps();
+    testCountWraparound();
+
+    TEST_SUITE_END();
+}
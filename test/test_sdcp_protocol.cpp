@@ -11,6 +11,11 @@
 #include <cmath>
 #include <cstdint>
 
+#include "../src/SDCPCommandQueue.cpp"
+#include "../src/SDCPCommandTemplate.cpp"
+#include "../src/SDCPLatencyTracker.cpp"
+#include "../src/SDCPStatusParser.cpp"
+
 // Mock classes in separate namespace to avoid conflicts with actual libraries
 namespace TestMocks {
 
@@ -315,6 +320,384 @@ void testTryReadExtrusionValueNotFound() {
     testsPassed++;
 }
 
+// Representative Centauri Carbon status frame (see fixtures/sdcp_status_frames.jsonl)
+static const char PRINTING_FRAME[] =
+    R"({"Status":{"CurrentStatus":[1],"TempOfHotbed":60.02,"TempOfNozzle":219.6,)"
+    R"("CurrenCoord":"112.45,98.30,0.40","CurrentFanSpeed":{"ModelFan":100,"BoxFan":20},)"
+    R"("LightStatus":{"SecondLight":1,"RgbLight":[0,0,0]},"PrintInfo":{"Status":13,)"
+    R"("CurrentLayer":2,"TotalLayer":125,"CurrentTicks":84,"TotalTicks":2280,)"
+    R"("Filename":"Caf\u00e9 \"bracket\".gcode","ErrorNumber":0,"TaskId":"job-42",)"
+    R"("PrintSpeedPct":150,"Progress":3,"TotalExtrusion":215.384521,"CurrentExtrusion":1.2}},)"
+    R"("MainboardID":"abc","TimeStamp":1734523902,"Topic":"sdcp/status/abc"})";
+
+void testStatusParserPrintingFrame() {
+    std::cout << "\n=== Test: Status Parser (Printing Frame) ===" << std::endl;
+
+    SdcpStatusFrame frame;
+    assert(SDCPStatusParser::parse(PRINTING_FRAME, strlen(PRINTING_FRAME), frame));
+
+    assert(!frame.isCommandResponse);
+    assert(frame.hasStatus);
+    assert(frame.hasMachineStatuses && frame.machineStatusCount == 1);
+    assert(frame.machineStatuses[0] == 1);
+    assert(frame.hasCurrentZ && floatEquals(frame.currentZ, 0.40f));
+    assert(frame.hasPrintInfo);
+    assert(frame.printStatus == 13);
+    assert(frame.currentLayer == 2 && frame.totalLayer == 125);
+    assert(frame.currentTicks == 84 && frame.totalTicks == 2280);
+    assert(frame.printSpeedPct == 150 && frame.progress == 3);
+    assert(frame.hasTotalExtrusion && floatEquals(frame.totalExtrusion, 215.384521f));
+    assert(strcmp(frame.taskId, "job-42") == 0);
+    assert(strcmp(frame.filename, "Caf\xC3\xA9 \"bracket\".gcode") == 0);
+    assert(frame.hasTimeStamp && frame.timeStamp == 1734523902UL);
+
+    // The frame need not be NUL-terminated: a cut-off copy is rejected
+    assert(!SDCPStatusParser::parse(PRINTING_FRAME, strlen(PRINTING_FRAME) - 1, frame));
+
+    std::cout << COLOR_GREEN << "PASS: Status frame fields extracted" << COLOR_RESET << std::endl;
+    testsPassed++;
+}
+
+void testStatusParserHexKeyAndNulls() {
+    std::cout << "\n=== Test: Status Parser (Hex Key and Nulls) ===" << std::endl;
+
+    const char *hexFrame =
+        R"({"Status":{"CurrentStatus":[1,16,3,4,5,6],"PrintInfo":{"Status":6,)"
+        R"("54 6F 74 61 6C 45 78 74 72 75 73 69 6F 6E 00":4.82177e3,"TaskId":null}}})";
+    SdcpStatusFrame frame;
+    assert(SDCPStatusParser::parse(hexFrame, strlen(hexFrame), frame));
+    assert(frame.machineStatusCount == SDCP_MAX_MACHINE_STATUSES);
+    assert(frame.machineStatuses[1] == 16);
+    assert(!frame.hasCurrentZ);
+    assert(frame.printStatus == 6);
+    assert(frame.hasTotalExtrusion && floatEquals(frame.totalExtrusion, 4821.77f));
+    assert(!frame.hasTaskId && frame.taskId[0] == '\0');
+
+    // A null TotalExtrusion is "not reported", and the plain key wins over the hex one
+    const char *idleFrame =
+        R"({"Status":{"PrintInfo":{"TotalExtrusion":null,"CurrentLayer":null}}})";
+    assert(SDCPStatusParser::parse(idleFrame, strlen(idleFrame), frame));
+    assert(frame.hasPrintInfo && !frame.hasTotalExtrusion && frame.currentLayer == 0);
+
+    const char *bothKeys =
+        R"({"Status":{"PrintInfo":{"54 6F 74 61 6C 45 78 74 72 75 73 69 6F 6E 00":1,"TotalExtrusion":2}}})";
+    assert(SDCPStatusParser::parse(bothKeys, strlen(bothKeys), frame));
+    assert(floatEquals(frame.totalExtrusion, 2.0f));
+
+    std::cout << COLOR_GREEN << "PASS: Hex key, nulls and status cap handled" << COLOR_RESET << std::endl;
+    testsPassed++;
+}
+
+void testStatusParserCommandResponse() {
+    std::cout << "\n=== Test: Status Parser (Command Response) ===" << std::endl;
+
+    const char *ack =
+        R"({"Id":"","Data":{"Cmd":0,"Data":{"Ack":0},"RequestID":"r1","MainboardID":"abc"},)"
+        R"("Topic":"sdcp/response/abc"})";
+    SdcpStatusFrame frame;
+    assert(SDCPStatusParser::parse(ack, strlen(ack), frame));
+    assert(frame.isCommandResponse);
+    assert(!frame.hasStatus);
+
+    std::cout << COLOR_GREEN << "PASS: Acks are recognized, not parsed" << COLOR_RESET << std::endl;
+    testsPassed++;
+}
+
+void testStatusParserMalformed() {
+    std::cout << "\n=== Test: Status Parser (Malformed Input) ===" << std::endl;
+
+    const char *bad[] = {
+        "",
+        "[1,2]",
+        R"({"Status":{"PrintInfo":{"Status":}}})",
+        R"({"Status":{"CurrenCoord":"1,2,3})",
+        R"({"Status" {}})",
+        R"({"Status":{"PrintInfo":{"Filename":"\q"}}})",
+    };
+    SdcpStatusFrame frame;
+    for (const char *json : bad) {
+        assert(!SDCPStatusParser::parse(json, strlen(json), frame));
+    }
+    assert(!SDCPStatusParser::parse(nullptr, 0, frame));
+
+    // Over-long strings are truncated, not overrun
+    std::string longFrame = R"({"Status":{"PrintInfo":{"TaskId":")" + std::string(500, 'x') + R"("}}})";
+    assert(SDCPStatusParser::parse(longFrame.c_str(), longFrame.size(), frame));
+    assert(strlen(frame.taskId) == SDCP_TASK_ID_MAX - 1);
+
+    std::cout << COLOR_GREEN << "PASS: Malformed frames rejected" << COLOR_RESET << std::endl;
+    testsPassed++;
+}
+
+void testCommandTemplateRender() {
+    std::cout << "\n=== Test: Command Template Render ===" << std::endl;
+
+    const char *requestId = "0123456789abcdef0123456789abcdef";
+    char out[SDCPCommandTemplate::MAX_FRAME_LENGTH];
+
+    // Same bytes buildCommandMessage serializes through ArduinoJson
+    SDCPCommandTemplate status;
+    assert(status.encode(0, ""));
+    size_t length = status.render(out, sizeof(out), requestId, 1734523902UL, 13, 0x03);
+    std::string expected =
+        R"({"Id":"0123456789abcdef0123456789abcdef","Data":{"Cmd":0,)"
+        R"("RequestID":"0123456789abcdef0123456789abcdef","MainboardID":"",)"
+        R"("TimeStamp":1734523902,"From":0,"Data":{},"PrintStatus":13,"CurrentStatus":[0,1]}})";
+    assert(std::string(out, length) == expected);
+
+    // Re-rendering patches the per-send fields only
+    length = status.render(out, sizeof(out), requestId, 7UL, 0, 0);
+    assert(std::string(out, length).find(R"("TimeStamp":7,"From":0,"Data":{},"PrintStatus":0,"CurrentStatus":[]})") != std::string::npos);
+
+    // A known MainboardID adds the request Topic
+    SDCPCommandTemplate pause;
+    assert(pause.encode(129, "ffff0000"));
+    assert(pause.matches(129, "ffff0000"));
+    assert(!pause.matches(129, ""));
+    assert(!pause.matches(0, "ffff0000"));
+    length = pause.render(out, sizeof(out), requestId, 1UL, 13, 0x02);
+    std::string paused(out, length);
+    assert(paused.find(R"("Cmd":129,)") != std::string::npos);
+    assert(paused.find(R"("MainboardID":"ffff0000",)") != std::string::npos);
+    assert(paused.substr(paused.size() - 35) == R"(]},"Topic":"sdcp/request/ffff0000"})");
+
+    // The rendered frame is a well-formed command, not a status frame
+    SdcpStatusFrame frame;
+    assert(SDCPStatusParser::parse(out, length, frame));
+    assert(frame.isCommandResponse && !frame.hasStatus);
+
+    std::cout << COLOR_GREEN << "PASS: Templates render the buildCommandMessage payload" << COLOR_RESET << std::endl;
+    testsPassed++;
+}
+
+void testCommandTemplateLimits() {
+    std::cout << "\n=== Test: Command Template Limits ===" << std::endl;
+
+    SDCPCommandTemplate command;
+    char out[SDCPCommandTemplate::MAX_FRAME_LENGTH];
+    const char *requestId = "0123456789abcdef0123456789abcdef";
+
+    // Not encoded yet, or MainboardID unusable: nothing to send
+    assert(command.render(out, sizeof(out), requestId, 1UL, 0, 0) == 0);
+    assert(!command.encode(0, "bad\"id"));
+    assert(!command.encode(0, std::string(SDCP_MAINBOARD_ID_MAX, 'f').c_str()));
+    assert(!command.matches(0, "bad\"id"));
+
+    // Worst case fits MAX_FRAME_LENGTH; a short buffer is refused, not overrun
+    std::string longestId(SDCP_MAINBOARD_ID_MAX - 1, 'f');
+    assert(command.encode(-2147483647 - 1, longestId.c_str()));
+    size_t length = command.render(out, sizeof(out), requestId, 4294967295UL, -2147483647 - 1, 0x1F);
+    assert(length > 0 && length <= SDCPCommandTemplate::MAX_FRAME_LENGTH);
+    assert(command.render(out, length - 1, requestId, 4294967295UL, -2147483647 - 1, 0x1F) == 0);
+
+    std::cout << COLOR_GREEN << "PASS: Bad IDs and short buffers rejected" << COLOR_RESET << std::endl;
+    testsPassed++;
+}
+
+static const SdcpCommandPolicy STATUS_POLICY   = {SDCP_PRIORITY_STATUS, false, 0, 1};
+static const SdcpCommandPolicy CONTINUE_POLICY = {SDCP_PRIORITY_CONTROL, true, 5000, 2};
+static const SdcpCommandPolicy PAUSE_POLICY    = {SDCP_PRIORITY_PAUSE, true, 2000, 3};
+
+void testCommandQueuePriority() {
+    std::cout << "\n=== Test: Command Queue Priority ===" << std::endl;
+
+    SDCPCommandQueue commands;
+    assert(commands.enqueue(0, STATUS_POLICY));
+    assert(commands.enqueue(131, CONTINUE_POLICY));
+    assert(commands.enqueue(129, PAUSE_POLICY));
+    assert(commands.enqueue(0, STATUS_POLICY));  // Already queued: not duplicated
+    assert(commands.queuedCount() == 3);
+
+    SdcpQueuedCommand next;
+    assert(commands.next(next) && next.command == 129);
+    assert(commands.next(next) && next.command == 131);
+    assert(commands.next(next) && next.command == 0);
+    assert(!commands.next(next));
+
+    // A full queue of polls makes room for a pause, but not for another poll
+    SDCPCommandQueue full;
+    for (int i = 0; i < SDCP_COMMAND_QUEUE_SIZE; i++) {
+        assert(full.enqueue(200 + i, STATUS_POLICY));
+    }
+    assert(!full.enqueue(300, STATUS_POLICY));
+    assert(full.enqueue(129, PAUSE_POLICY));
+    assert(full.next(next) && next.command == 129);
+
+    std::cout << COLOR_GREEN << "PASS: Pause is always sent first" << COLOR_RESET << std::endl;
+    testsPassed++;
+}
+
+void testCommandQueueInFlight() {
+    std::cout << "\n=== Test: Command Queue In-Flight Table ===" << std::endl;
+
+    SDCPCommandQueue commands;
+    SdcpQueuedCommand next;
+
+    // A continue awaiting its ack does not hold back a pause
+    commands.enqueue(131, CONTINUE_POLICY);
+    assert(commands.next(next));
+    commands.markSent(next, "continue1", 1000);
+    commands.enqueue(129, PAUSE_POLICY);
+    assert(commands.next(next) && next.command == 129);
+    commands.markSent(next, "pause1", 1010);
+    assert(commands.inFlightCount() == 2);
+    assert(commands.isPending(129) && commands.isPending(131));
+
+    // Acks match on command and RequestID
+    assert(!commands.acknowledge(129, "continue1"));
+    assert(!commands.acknowledge(129, "pause0"));
+    assert(commands.acknowledge(129, "pause1"));
+    assert(!commands.isPending(129));
+    assert(commands.acknowledge(131, "continue1"));
+    assert(commands.inFlightCount() == 0);
+
+    // Status polls are not tracked
+    commands.enqueue(0, STATUS_POLICY);
+    assert(commands.next(next));
+    commands.markSent(next, "status1", 1020);
+    assert(commands.inFlightCount() == 0);
+
+    // A full table drops the lowest-priority request, never the pause
+    for (int i = 0; i < SDCP_MAX_IN_FLIGHT; i++) {
+        SdcpQueuedCommand other = {140 + i, CONTINUE_POLICY, 0};
+        commands.markSent(other, "other", 2000 + i);
+    }
+    commands.enqueue(129, PAUSE_POLICY);
+    assert(commands.next(next));
+    commands.markSent(next, "pause2", 3000);
+    assert(commands.inFlightCount() == SDCP_MAX_IN_FLIGHT);
+    assert(!commands.isPending(140) && commands.isPending(141));
+    assert(commands.acknowledge(129, "pause2"));
+
+    // Cancel drops both the queued and the in-flight copy
+    commands.enqueue(141, CONTINUE_POLICY);
+    commands.cancel(141);
+    assert(!commands.isPending(141));
+
+    std::cout << COLOR_GREEN << "PASS: Requests tracked per RequestID" << COLOR_RESET << std::endl;
+    testsPassed++;
+}
+
+void testCommandQueueTimeouts() {
+    std::cout << "\n=== Test: Command Queue Timeouts and Retries ===" << std::endl;
+
+    SDCPCommandQueue commands;
+    SdcpQueuedCommand next;
+    SdcpCommandTimeout timeout;
+
+    commands.enqueue(129, PAUSE_POLICY);
+    unsigned long now = 10000;
+    for (int attempt = 1; attempt <= PAUSE_POLICY.maxAttempts; attempt++) {
+        assert(commands.next(next) && next.command == 129);
+        assert(next.attempts == attempt - 1);
+        commands.markSent(next, "pause", now);
+
+        assert(!commands.expireNext(now + PAUSE_POLICY.ackTimeoutMs - 1, timeout));
+        now += PAUSE_POLICY.ackTimeoutMs;
+        assert(commands.expireNext(now, timeout));
+        assert(timeout.command == 129 && timeout.attempts == attempt);
+        assert(timeout.retrying == (attempt < PAUSE_POLICY.maxAttempts));
+        assert(!commands.expireNext(now, timeout));
+    }
+    assert(!commands.isPending(129));
+
+    // A late ack for a timed-out attempt matches nothing
+    assert(!commands.acknowledge(129, "pause"));
+
+    // Timeouts survive millis() wrap
+    commands.enqueue(131, CONTINUE_POLICY);
+    assert(commands.next(next));
+    commands.markSent(next, "continue", 0xFFFFFF00UL);
+    assert(!commands.expireNext(0x00000010UL, timeout));
+    assert(commands.expireNext(0xFFFFFF00UL + CONTINUE_POLICY.ackTimeoutMs, timeout));
+
+    std::cout << COLOR_GREEN << "PASS: Timeouts retry until attempts run out" << COLOR_RESET << std::endl;
+    testsPassed++;
+}
+
+void testLatencyTrackerMatching() {
+    std::cout << "\n=== Test: Latency Tracker Matching ===" << std::endl;
+
+    SDCPLatencyTracker tracker;
+    tracker.onRequestSent("req1", 1000);
+    tracker.onRequestSent("req2", 1250);
+
+    // Acks match by RequestID, in any order
+    assert(tracker.onAck("req2", 1290));
+    assert(tracker.onAck("req1", 1060));
+    assert(!tracker.onAck("req1", 1070));
+    assert(!tracker.onAck("unknown", 1070));
+
+    // Status frames answer the oldest request; age adds half the round trip
+    tracker.onStatusFrame(true, 100, 1080);
+    tracker.onTelemetryUsed(1200);
+    SdcpLatencyReport report = tracker.getReport();
+    assert(report.rtt.samples == 2 && report.rtt.maxMs == 60 && report.rtt.lastMs == 60);
+    assert(report.rtt.counts[1] == 1 && report.rtt.counts[2] == 1);  // 40ms, 60ms
+    assert(report.telemetryAge.lastMs == 160);
+    assert(report.frames == 1 && report.pending == 1);
+
+    tracker.onStatusFrame(true, 101, 1300);
+    tracker.onStatusFrame(true, 101, 1400);   // nothing outstanding
+    tracker.onTelemetryUsed(1400);
+    report = tracker.getReport();
+    assert(report.frames == 2 && report.unsolicited == 1 && report.pending == 0);
+    assert(report.telemetryAge.lastMs == 30);  // half the last 60ms RTT
+    assert(report.late == 0 && report.dropped == 0 && report.outOfOrder == 0);
+
+    // Percentiles report bucket upper bounds, capped at the maximum seen
+    assert(report.rtt.percentileMs(50, SDCPLatencyTracker::RTT_BUCKET_MS) == 50);
+    assert(report.rtt.percentileMs(95, SDCPLatencyTracker::RTT_BUCKET_MS) == 60);
+    assert(report.rtt.meanMs() == 50);
+
+    std::cout << COLOR_GREEN << "PASS: Acks and status frames matched to their requests" << COLOR_RESET << std::endl;
+    testsPassed++;
+}
+
+void testLatencyTrackerLateAndDropped() {
+    std::cout << "\n=== Test: Latency Tracker Late and Dropped Frames ===" << std::endl;
+
+    SDCPLatencyTracker tracker;
+    tracker.onRequestSent("slow", 1000);
+    tracker.onStatusFrame(true, 200, 1000 + SDCPLatencyTracker::LATE_MS + 1);
+    tracker.onStatusFrame(true, 199, 2500);   // printer clock went backwards
+    SdcpLatencyReport report = tracker.getReport();
+    assert(report.late == 1 && report.outOfOrder == 1);
+
+    // Unanswered requests drop after DROP_MS, across millis() wrap
+    tracker.onRequestSent("lost", 0xFFFFFF00UL);
+    tracker.expire(0xFFFFFF00UL + SDCPLatencyTracker::DROP_MS - 1);
+    assert(tracker.getReport().pending == 1);
+    tracker.expire(0xFFFFFF00UL + SDCPLatencyTracker::DROP_MS);
+    report = tracker.getReport();
+    assert(report.dropped == 1 && report.pending == 0);
+
+    // A full table pushes out its oldest request
+    for (int i = 0; i <= SDCP_LATENCY_PENDING; i++) {
+        char id[8];
+        snprintf(id, sizeof(id), "r%d", i);
+        tracker.onRequestSent(id, 10000 + i * 100);
+    }
+    assert(tracker.getReport().dropped == 2);
+    assert(!tracker.onAck("r0", 12000) && tracker.onAck("r1", 12000));
+
+    // A disconnect drops everything still outstanding
+    tracker.onDisconnect();
+    report = tracker.getReport();
+    assert(report.dropped == 2 + SDCP_LATENCY_PENDING && report.pending == 0);
+
+    // Samples past the last bound land in the open-ended bucket
+    tracker.reset();
+    tracker.onRequestSent("x", 0);
+    tracker.onAck("x", 5000);
+    report = tracker.getReport();
+    assert(report.rtt.counts[SDCP_LATENCY_BUCKETS - 1] == 1);
+    assert(report.rtt.percentileMs(50, SDCPLatencyTracker::RTT_BUCKET_MS) == 5000);
+
+    std::cout << COLOR_GREEN << "PASS: Late, dropped and reordered frames counted" << COLOR_RESET << std::endl;
+    testsPassed++;
+}
+
 void testSDCPConstants() {
     std::cout << "\n=== Test: SDCP Constants ===" << std::endl;
     
@@ -341,6 +724,17 @@ int main() {
     testTryReadExtrusionValueNormalKey();
     testTryReadExtrusionValueHexKey();
     testTryReadExtrusionValueNotFound();
+    testStatusParserPrintingFrame();
+    testStatusParserHexKeyAndNulls();
+    testStatusParserCommandResponse();
+    testStatusParserMalformed();
+    testCommandTemplateRender();
+    testCommandTemplateLimits();
+    testCommandQueuePriority();
+    testCommandQueueInFlight();
+    testCommandQueueTimeouts();
+    testLatencyTrackerMatching();
+    testLatencyTrackerLateAndDropped();
     testSDCPConstants();
     
     std::cout << "\n========================================\n";
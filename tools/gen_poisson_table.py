@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+"""
+Generate src/PoissonTable.h: ln P(K <= k | lambda) for the JamDetector
+low-count likelihood check, in milli-nats so the firmware stays integer-only.
+
+Rows are lambda (expected pulses in the window) in 1/STEPS_PER_PULSE steps,
+columns are the observed pulse count k. Run after changing the dimensions:
+
+    python tools/gen_poisson_table.py
+"""
+import math
+import pathlib
+
+STEPS_PER_PULSE = 4   # lambda resolution: quarter pulses
+MAX_LAMBDA = 8        # pulses; above this the ratio rules are reliable
+MAX_K = 12            # counts at or above this are never improbable here
+FLOOR_MILLI = -32000  # int16 floor (e^-32 is far below any threshold)
+
+
+def log_cdf(lam, k):
+    if lam == 0:
+        return 0.0
+    # Sum in log space to stay accurate deep in the tail
+    terms = [-lam + i * math.log(lam) - math.lgamma(i + 1) for i in range(k + 1)]
+    peak = max(terms)
+    return peak + math.log(sum(math.exp(t - peak) for t in terms))
+
+
+def main():
+    rows = MAX_LAMBDA * STEPS_PER_PULSE + 1
+    lines = [
+        "// This file is generated by tools/gen_poisson_table.py. Do not edit.",
+        "#ifndef POISSON_TABLE_H",
+        "#define POISSON_TABLE_H",
+        "",
+        "#include <stdint.h>",
+        "",
+        "// ln P(K <= k | lambda) in milli-nats, lambda = row / STEPS_PER_PULSE",
+        "namespace PoissonTable {",
+        f"    constexpr int32_t STEPS_PER_PULSE = {STEPS_PER_PULSE};",
+        f"    constexpr int32_t LAMBDA_ROWS     = {rows};",
+        f"    constexpr int32_t MAX_K           = {MAX_K};",
+        "",
+        "    static const int16_t LOG_CDF_MILLI[LAMBDA_ROWS][MAX_K] = {",
+    ]
+    for row in range(rows):
+        lam = row / STEPS_PER_PULSE
+        values = [max(FLOOR_MILLI, round(1000 * log_cdf(lam, k))) for k in range(MAX_K)]
+        body = ", ".join(f"{v:6d}" for v in values)
+        lines.append(f"        {{{body}}},  // lambda {lam:.2f}")
+    lines += [
+        "    };",
+        "}",
+        "",
+        "#endif  // POISSON_TABLE_H",
+        "",
+    ]
+
+    out = pathlib.Path(__file__).resolve().parent.parent / "src" / "PoissonTable.h"
+    out.write_text("\n".join(lines))
+    print(f"Wrote {out}")
+
+
+if __name__ == "__main__":
+    main()